@@ -0,0 +1,148 @@
+//
+// Benchmark suite for the scanner. Every mode prints a single JSON object to stdout.
+//
+// Usage:
+//   sdd-bench suite [config.json] [text MB per file] [files per type] [seed]
+//   sdd-bench som [config.json] [corpus MB]
+//   sdd-bench generate <directory> [text MB per file] [files per type] [seed]
+//
+
+#include <thread>
+#include <iostream>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+
+#include "benchmarks.h"
+#include "patternanalyzer.h"
+#include "cputopology.h"
+#include "parsersandbox.h"
+
+#define DEFAULT_CONFIG_PATH "sdd_config.json"
+
+static bool loadScanPatterns(const QString &configPath, QJsonArray &scanPatterns) {
+    QFile file(configPath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        std::cerr << "Could not open config " << configPath.toStdString() << std::endl;
+        return false;
+    }
+    scanPatterns = QJsonDocument::fromJson(file.readAll()).object()["scanPatterns"].toArray();
+    return true;
+}
+
+static CorpusSpec corpusSpecFromArgs(int argc, char *argv[], int firstArg) {
+    CorpusSpec spec;
+    if (argc > firstArg) {
+        spec.textBytesPerFile = static_cast<size_t>(std::stod(argv[firstArg]) * 1024 * 1024);
+    }
+    if (argc > firstArg + 1) {
+        spec.filesPerKind = std::stoul(argv[firstArg + 1]);
+    }
+    if (argc > firstArg + 2) {
+        spec.seed = static_cast<uint32_t>(std::stoul(argv[firstArg + 2]));
+    }
+    return spec;
+}
+
+static QJsonObject corpusToJson(const CorpusSpec &spec, const std::vector<GeneratedFile> &files) {
+    qint64 fileBytes = 0;
+    for (const auto &file: files) {
+        fileBytes += static_cast<qint64>(file.fileBytes);
+    }
+    QJsonObject corpus;
+    corpus["seed"] = static_cast<qint64>(spec.seed);
+    corpus["filesPerKind"] = static_cast<qint64>(spec.filesPerKind);
+    corpus["textBytesPerFile"] = static_cast<qint64>(spec.textBytesPerFile);
+    corpus["sensitivePerThousand"] = spec.sensitivePerThousand;
+    corpus["files"] = static_cast<qint64>(files.size());
+    corpus["fileBytes"] = fileBytes;
+    return corpus;
+}
+
+// 1, 2, 4, ... up to and including the number of hardware threads
+static std::vector<int> threadCounts() {
+    int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> counts;
+    for (int count = 1; count < hardwareThreads; count *= 2) {
+        counts.push_back(count);
+    }
+    counts.push_back(hardwareThreads);
+    return counts;
+}
+
+static int runSuite(int argc, char *argv[]) {
+    QJsonArray scanPatterns;
+    if (!loadScanPatterns(argc > 2 ? argv[2] : DEFAULT_CONFIG_PATH, scanPatterns)) {
+        return 1;
+    }
+    std::vector<BenchPattern> patterns = patternsFromConfig(scanPatterns);
+    CorpusSpec spec = corpusSpecFromArgs(argc, argv, 3);
+
+    QTemporaryDir corpusDir;
+    if (!corpusDir.isValid()) {
+        std::cerr << "Could not create a directory for the corpus" << std::endl;
+        return 1;
+    }
+    std::vector<GeneratedFile> files = CorpusGenerator(spec).generate(corpusDir.path().toStdString());
+    std::string text = PatternAnalyzer::generateSampleText(spec.textBytesPerFile * spec.filesPerKind, spec.seed,
+                                                           spec.sensitivePerThousand);
+
+    QJsonObject report;
+    report["benchmark"] = "suite";
+    report["hardwareThreads"] = static_cast<int>(std::thread::hardware_concurrency());
+    report["numaNodes"] = static_cast<int>(CpuTopology::detect().nodes.size());
+    report["corpus"] = corpusToJson(spec, files);
+    report["readers"] = runReaderBenchmark(files);
+    report["compile"] = runCompileBenchmark(patterns);
+    report["scan"] = runScanBenchmark(patterns, text);
+    report["endToEnd"] = runEndToEndBenchmark(patterns, files, threadCounts());
+    std::cout << QJsonDocument(report).toJson().toStdString();
+    return 0;
+}
+
+static int runSom(int argc, char *argv[]) {
+    QJsonArray scanPatterns;
+    if (!loadScanPatterns(argc > 2 ? argv[2] : DEFAULT_CONFIG_PATH, scanPatterns)) {
+        return 1;
+    }
+    size_t corpusMegabytes = argc > 3 ? std::stoul(argv[3]) : 64;
+    std::cout << QJsonDocument(runSomBenchmark(scanPatterns, corpusMegabytes * 1024 * 1024)).toJson().toStdString();
+    return 0;
+}
+
+static int runGenerate(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: sdd-bench generate <directory> [text MB per file] [files per type] [seed]" << std::endl;
+        return 1;
+    }
+    CorpusSpec spec = corpusSpecFromArgs(argc, argv, 3);
+    std::vector<GeneratedFile> files = CorpusGenerator(spec).generate(argv[2]);
+    std::cout << QJsonDocument(corpusToJson(spec, files)).toJson().toStdString();
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    // Sandboxed parsers run in helper processes started from this executable
+    if (isParserHelper(argc, argv)) {
+        return runParserHelper(argc, argv);
+    }
+    QCoreApplication app(argc, argv);
+    std::string mode = argc > 1 ? argv[1] : "suite";
+
+    try {
+        if (mode == "suite") {
+            return runSuite(argc, argv);
+        } else if (mode == "som") {
+            return runSom(argc, argv);
+        } else if (mode == "generate") {
+            return runGenerate(argc, argv);
+        }
+    } catch (std::exception &e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cerr << "Usage: sdd-bench <suite|som|generate> ..." << std::endl;
+    return 1;
+}
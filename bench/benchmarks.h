@@ -0,0 +1,35 @@
+#ifndef SENSITIVE_DATA_DELETER_BENCHMARKS_H
+#define SENSITIVE_DATA_DELETER_BENCHMARKS_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include "corpusgenerator.h"
+#include "filescanner.h"
+
+struct BenchPattern {
+    std::string pattern;
+    std::string description;
+    PatternOptions options;
+};
+
+// hs_scan callback that counts matches into the uint64_t passed as context
+int countMatch(unsigned int, unsigned long long, unsigned long long, unsigned int, void *context);
+
+std::vector<BenchPattern> patternsFromConfig(const QJsonArray &scanPatterns);
+
+QJsonObject runSomBenchmark(const QJsonArray &scanPatterns, size_t corpusBytes);
+
+QJsonArray runReaderBenchmark(const std::vector<GeneratedFile> &files);
+
+QJsonObject runCompileBenchmark(const std::vector<BenchPattern> &patterns);
+
+QJsonObject runScanBenchmark(const std::vector<BenchPattern> &patterns, const std::string &corpus);
+
+QJsonArray runEndToEndBenchmark(const std::vector<BenchPattern> &patterns, const std::vector<GeneratedFile> &files,
+                                const std::vector<int> &threadCounts);
+
+#endif //SENSITIVE_DATA_DELETER_BENCHMARKS_H
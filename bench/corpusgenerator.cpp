@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <minizip-ng/zip.h>
+
+#include "corpusgenerator.h"
+#include "patternanalyzer.h"
+
+#define PDF_LINES_PER_PAGE 60
+
+static const char *corpusFileKindNames[NUM_CORPUS_FILE_KINDS] = {"txt", "csv", "xml", "pdf", "zip", "docx"};
+
+const char *corpusFileKindName(CorpusFileKind kind) {
+    return corpusFileKindNames[kind];
+}
+
+static std::vector<std::string> splitLines(const std::string &text) {
+    std::vector<std::string> lines;
+    std::istringstream stream(text);
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (!line.empty()) {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+static std::string escapeXml(const std::string &text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c: text) {
+        switch (c) {
+            case '<':
+                escaped += "&lt;";
+                break;
+            case '>':
+                escaped += "&gt;";
+                break;
+            case '&':
+                escaped += "&amp;";
+                break;
+            default:
+                escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::vector<GeneratedFile> CorpusGenerator::generate(const std::filesystem::path &directory) const {
+    std::filesystem::create_directories(directory);
+    std::vector<GeneratedFile> files;
+
+    for (size_t i = 0; i < spec.filesPerKind; i++) {
+        for (int kind = 0; kind < NUM_CORPUS_FILE_KINDS; kind++) {
+            // Every file gets its own seed so adding files does not change the existing ones
+            uint32_t fileSeed = spec.seed + static_cast<uint32_t>(i * NUM_CORPUS_FILE_KINDS + kind);
+            std::string text = PatternAnalyzer::generateSampleText(spec.textBytesPerFile, fileSeed,
+                                                                   spec.sensitivePerThousand);
+            std::filesystem::path path = directory / ("corpus_" + std::to_string(i) + "." +
+                                                      corpusFileKindName(static_cast<CorpusFileKind>(kind)));
+            switch (kind) {
+                case TEXT_FILE:
+                    writeFile(path, text);
+                    break;
+                case CSV_FILE:
+                    writeFile(path, toCsv(text));
+                    break;
+                case XML_FILE:
+                    writeFile(path, toXml(text));
+                    break;
+                case PDF_FILE:
+                    writeFile(path, toPdf(text));
+                    break;
+                case ZIP_FILE: {
+                    // Split the text between members of different types like a typical archive
+                    size_t third = text.size() / 3;
+                    writeZip(path, {{"notes.txt", text.substr(0, third)},
+                                    {"export.csv", toCsv(text.substr(third, third))},
+                                    {"records.xml", toXml(text.substr(2 * third))}});
+                    break;
+                }
+                case DOCX_FILE:
+                    writeZip(path, {{"[Content_Types].xml",
+                                     "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                                     "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+                                     "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+                                     "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+                                     "<Override PartName=\"/word/document.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.wordprocessingml.document.main+xml\"/>"
+                                     "</Types>"},
+                                    {"_rels/.rels",
+                                     "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                                     "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+                                     "<Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" Target=\"word/document.xml\"/>"
+                                     "</Relationships>"},
+                                    {"word/document.xml", toDocumentXml(text)}});
+                    break;
+                default:
+                    break;
+            }
+            files.push_back({path, static_cast<CorpusFileKind>(kind), std::filesystem::file_size(path), text.size()});
+        }
+    }
+    return files;
+}
+
+std::string CorpusGenerator::toCsv(const std::string &text) {
+    std::string csv = "id,note\n";
+    size_t row = 0;
+    for (const auto &line: splitLines(text)) {
+        csv += std::to_string(++row) + ",\"" + line + "\"\n";
+    }
+    return csv;
+}
+
+std::string CorpusGenerator::toXml(const std::string &text) {
+    std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<records>\n";
+    size_t row = 0;
+    for (const auto &line: splitLines(text)) {
+        xml += "  <record id=\"" + std::to_string(++row) + "\">" + escapeXml(line) + "</record>\n";
+    }
+    xml += "</records>\n";
+    return xml;
+}
+
+std::string CorpusGenerator::toDocumentXml(const std::string &text) {
+    std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                      "<w:document xmlns:w=\"http://schemas.openxmlformats.org/wordprocessingml/2006/main\"><w:body>";
+    for (const auto &line: splitLines(text)) {
+        xml += "<w:p><w:r><w:t>" + escapeXml(line) + "</w:t></w:r></w:p>";
+    }
+    xml += "</w:body></w:document>";
+    return xml;
+}
+
+// Minimal uncompressed PDF with one Helvetica text object per page, enough for poppler to extract the text
+std::string CorpusGenerator::toPdf(const std::string &text) {
+    std::vector<std::string> lines = splitLines(text);
+    size_t numPages = std::max<size_t>(1, (lines.size() + PDF_LINES_PER_PAGE - 1) / PDF_LINES_PER_PAGE);
+
+    // Objects 1-3 are the catalog, page tree and font, then a page and its content stream per page
+    std::vector<std::string> objects;
+    std::string kids;
+    for (size_t page = 0; page < numPages; page++) {
+        kids += std::to_string(4 + page * 2) + " 0 R ";
+    }
+    objects.emplace_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [" + kids + "] /Count " + std::to_string(numPages) + " >>");
+    objects.emplace_back("<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica >>");
+
+    for (size_t page = 0; page < numPages; page++) {
+        std::string content = "BT /F1 9 Tf 11 TL 36 806 Td\n";
+        for (size_t i = page * PDF_LINES_PER_PAGE; i < std::min(lines.size(), (page + 1) * PDF_LINES_PER_PAGE); i++) {
+            content += '(';
+            for (char c: lines[i]) {
+                if (c == '(' || c == ')' || c == '\\') {
+                    content += '\\';
+                }
+                content += c;
+            }
+            content += ") Tj T*\n";
+        }
+        content += "ET";
+        objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 595 842] /Resources << /Font << /F1 3 0 R >> >> "
+                          "/Contents " + std::to_string(5 + page * 2) + " 0 R >>");
+        objects.push_back("<< /Length " + std::to_string(content.size()) + " >>\nstream\n" + content + "\nendstream");
+    }
+
+    std::string pdf = "%PDF-1.4\n";
+    std::vector<size_t> offsets;
+    for (size_t i = 0; i < objects.size(); i++) {
+        offsets.push_back(pdf.size());
+        pdf += std::to_string(i + 1) + " 0 obj\n" + objects[i] + "\nendobj\n";
+    }
+    size_t xrefOffset = pdf.size();
+    pdf += "xref\n0 " + std::to_string(objects.size() + 1) + "\n0000000000 65535 f \n";
+    char entry[32];
+    for (size_t offset: offsets) {
+        std::snprintf(entry, sizeof(entry), "%010zu 00000 n \n", offset);
+        pdf += entry;
+    }
+    pdf += "trailer\n<< /Size " + std::to_string(objects.size() + 1) + " /Root 1 0 R >>\nstartxref\n" +
+           std::to_string(xrefOffset) + "\n%%EOF\n";
+    return pdf;
+}
+
+void CorpusGenerator::writeFile(const std::filesystem::path &path, const std::string &contents) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open corpus file for writing: " + path.string());
+    }
+    file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+}
+
+void CorpusGenerator::writeZip(const std::filesystem::path &path,
+                               const std::vector<std::pair<std::string, std::string>> &entries) {
+    zipFile zip = zipOpen64(path.generic_string().c_str(), APPEND_STATUS_CREATE);
+    if (!zip) {
+        throw std::runtime_error("Could not create zip file: " + path.string());
+    }
+    // Fixed timestamps keep the archive bytes identical between runs
+    zip_fileinfo fileInfo = {};
+    for (const auto &entry: entries) {
+        if (zipOpenNewFileInZip(zip, entry.first.c_str(), &fileInfo, nullptr, 0, nullptr, 0, nullptr,
+                                Z_DEFLATED, Z_DEFAULT_COMPRESSION) != ZIP_OK) {
+            zipClose(zip, nullptr);
+            throw std::runtime_error("Could not add " + entry.first + " to zip file: " + path.string());
+        }
+        zipWriteInFileInZip(zip, entry.second.data(), static_cast<unsigned int>(entry.second.size()));
+        zipCloseFileInZip(zip);
+    }
+    zipClose(zip, nullptr);
+}
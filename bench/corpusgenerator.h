@@ -0,0 +1,62 @@
+#ifndef SENSITIVE_DATA_DELETER_CORPUSGENERATOR_H
+#define SENSITIVE_DATA_DELETER_CORPUSGENERATOR_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+enum CorpusFileKind {
+    TEXT_FILE,
+    CSV_FILE,
+    XML_FILE,
+    PDF_FILE,
+    ZIP_FILE,
+    DOCX_FILE,
+    NUM_CORPUS_FILE_KINDS,
+};
+
+const char *corpusFileKindName(CorpusFileKind kind);
+
+struct CorpusSpec {
+    uint32_t seed = 42;
+    size_t filesPerKind = 8;
+    size_t textBytesPerFile = 1024 * 1024; // Amount of text before it is wrapped in the file format
+    int sensitivePerThousand = 5; // Sensitive values per thousand words
+};
+
+struct GeneratedFile {
+    std::filesystem::path path;
+    CorpusFileKind kind;
+    size_t fileBytes;
+    size_t textBytes;
+};
+
+/**
+ * Writes a deterministic benchmark corpus. The same spec always produces byte for byte the
+ * same files, so results from different builds and machines can be compared.
+ */
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(const CorpusSpec &spec) : spec(spec) {}
+
+    std::vector<GeneratedFile> generate(const std::filesystem::path &directory) const;
+
+    static std::string toCsv(const std::string &text);
+
+    static std::string toXml(const std::string &text);
+
+    static std::string toPdf(const std::string &text);
+
+    static std::string toDocumentXml(const std::string &text);
+
+private:
+    CorpusSpec spec;
+
+    static void writeFile(const std::filesystem::path &path, const std::string &contents);
+
+    static void writeZip(const std::filesystem::path &path,
+                         const std::vector<std::pair<std::string, std::string>> &entries);
+};
+
+#endif //SENSITIVE_DATA_DELETER_CORPUSGENERATOR_H
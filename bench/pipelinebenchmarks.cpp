@@ -0,0 +1,271 @@
+//
+// Benchmarks of the individual scan stages and of FileScanner as a whole on a generated corpus.
+//
+
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <tuple>
+#include <QPromise>
+#include <QFuture>
+#include <hs/hs.h>
+
+#include "benchmarks.h"
+#include "chunkreader.h"
+
+#define COMPILE_ITERATIONS 5
+#define SCAN_ITERATIONS 3
+
+using ScanResults = std::map<std::string, std::pair<ScanResult, std::vector<MatchInfo>>>;
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double megabytesPerSecond(uint64_t bytes, double seconds) {
+    return seconds > 0 ? bytes / (1024.0 * 1024.0) / seconds : 0;
+}
+
+std::vector<BenchPattern> patternsFromConfig(const QJsonArray &scanPatterns) {
+    std::vector<BenchPattern> patterns;
+    for (const auto &value: scanPatterns) {
+        QJsonObject patternObj = value.toObject();
+        BenchPattern pattern;
+        pattern.pattern = patternObj["pattern"].toString().toStdString();
+        pattern.description = patternObj["description"].toString().toStdString();
+        pattern.options.validator = patternObj["validator"].toString().toStdString();
+        pattern.options.somHorizon = patternObj["somHorizon"].toInt(0);
+        patterns.push_back(pattern);
+    }
+    return patterns;
+}
+
+// Compiles the pattern set exactly like FileScanner::scanFiles does
+static hs_database_t *compilePatterns(const std::vector<BenchPattern> &patterns, std::string *error) {
+    std::vector<const char *> expressions;
+    std::vector<uint32_t> flags;
+    std::vector<uint32_t> ids;
+    for (size_t i = 0; i < patterns.size(); i++) {
+        expressions.push_back(patterns[i].pattern.c_str());
+        flags.push_back(FileScanner::compileFlags(patterns[i].options));
+        ids.push_back(static_cast<uint32_t>(i));
+    }
+
+    hs_database_t *database = nullptr;
+    hs_compile_error_t *compileError = nullptr;
+    if (hs_compile_multi(expressions.data(), flags.data(), ids.data(), static_cast<unsigned int>(expressions.size()),
+                         HS_MODE_BLOCK, nullptr, &database, &compileError) != HS_SUCCESS) {
+        *error = compileError->message;
+        hs_free_compile_error(compileError);
+        return nullptr;
+    }
+    return database;
+}
+
+QJsonArray runReaderBenchmark(const std::vector<GeneratedFile> &files) {
+    struct ReaderTotals {
+        uint64_t files = 0;
+        uint64_t failures = 0;
+        uint64_t fileBytes = 0;
+        uint64_t textBytes = 0;
+        double seconds = 0;
+        std::string reader;
+    };
+    ReaderTotals totals[NUM_CORPUS_FILE_KINDS];
+
+    char buffer[CHUNK_SIZE];
+    for (const auto &file: files) {
+        ReaderTotals &kindTotals = totals[file.kind];
+        auto start = std::chrono::steady_clock::now();
+        try {
+            std::unique_ptr<ChunkReader> reader(ChunkReaderFactory::createReader(file.path));
+            if (!reader) {
+                kindTotals.failures++;
+                continue;
+            }
+            kindTotals.reader = readerTypeName(reader->readerType());
+            while (true) {
+                size_t numBytesRead = reader->readChunkFromFile(buffer, CHUNK_SIZE);
+                if (numBytesRead == 0) {
+                    break;
+                } else if (numBytesRead == -1) {
+                    continue;
+                }
+                kindTotals.textBytes += numBytesRead;
+            }
+        } catch (std::exception &e) {
+            kindTotals.failures++;
+            continue;
+        }
+        kindTotals.seconds += secondsSince(start);
+        kindTotals.fileBytes += file.fileBytes;
+        kindTotals.files++;
+    }
+
+    QJsonArray results;
+    for (int kind = 0; kind < NUM_CORPUS_FILE_KINDS; kind++) {
+        const ReaderTotals &kindTotals = totals[kind];
+        QJsonObject result;
+        result["fileKind"] = corpusFileKindName(static_cast<CorpusFileKind>(kind));
+        result["reader"] = QString::fromStdString(kindTotals.reader);
+        result["files"] = static_cast<qint64>(kindTotals.files);
+        result["failures"] = static_cast<qint64>(kindTotals.failures);
+        result["fileBytes"] = static_cast<qint64>(kindTotals.fileBytes);
+        result["textBytes"] = static_cast<qint64>(kindTotals.textBytes);
+        result["seconds"] = kindTotals.seconds;
+        result["fileMegabytesPerSecond"] = megabytesPerSecond(kindTotals.fileBytes, kindTotals.seconds);
+        result["textMegabytesPerSecond"] = megabytesPerSecond(kindTotals.textBytes, kindTotals.seconds);
+        results.append(result);
+    }
+    return results;
+}
+
+QJsonObject runCompileBenchmark(const std::vector<BenchPattern> &patterns) {
+    QJsonObject result;
+    result["patterns"] = static_cast<qint64>(patterns.size());
+
+    std::vector<double> compileMs;
+    hs_database_t *database = nullptr;
+    for (int i = 0; i < COMPILE_ITERATIONS; i++) {
+        std::string error;
+        auto start = std::chrono::steady_clock::now();
+        hs_database_t *compiled = compilePatterns(patterns, &error);
+        compileMs.push_back(secondsSince(start) * 1000.0);
+        if (!compiled) {
+            result["error"] = QString::fromStdString(error);
+            return result;
+        }
+        hs_free_database(database);
+        database = compiled;
+    }
+    std::sort(compileMs.begin(), compileMs.end());
+
+    size_t databaseBytes = 0;
+    size_t scratchBytes = 0;
+    hs_scratch_t *scratch = nullptr;
+    hs_database_size(database, &databaseBytes);
+    if (hs_alloc_scratch(database, &scratch) == HS_SUCCESS) {
+        hs_scratch_size(scratch, &scratchBytes);
+        hs_free_scratch(scratch);
+    }
+    hs_free_database(database);
+
+    result["iterations"] = COMPILE_ITERATIONS;
+    result["minMs"] = compileMs.front();
+    result["medianMs"] = compileMs[compileMs.size() / 2];
+    result["maxMs"] = compileMs.back();
+    result["databaseBytes"] = static_cast<qint64>(databaseBytes);
+    result["scratchBytes"] = static_cast<qint64>(scratchBytes);
+    return result;
+}
+
+QJsonObject runScanBenchmark(const std::vector<BenchPattern> &patterns, const std::string &corpus) {
+    QJsonObject result;
+    std::string error;
+    hs_database_t *database = compilePatterns(patterns, &error);
+    if (!database) {
+        result["error"] = QString::fromStdString(error);
+        return result;
+    }
+    hs_scratch_t *scratch = nullptr;
+    if (hs_alloc_scratch(database, &scratch) != HS_SUCCESS) {
+        result["error"] = "Unable to allocate scratch space";
+        hs_free_database(database);
+        return result;
+    }
+
+    uint64_t matches = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < SCAN_ITERATIONS; i++) {
+        for (size_t offset = 0; offset < corpus.size(); offset += CHUNK_SIZE) {
+            size_t length = std::min(static_cast<size_t>(CHUNK_SIZE), corpus.size() - offset);
+            hs_scan(database, corpus.data() + offset, length, 0, scratch, countMatch, &matches);
+        }
+    }
+    double seconds = secondsSince(start);
+    hs_free_scratch(scratch);
+    hs_free_database(database);
+
+    result["corpusBytes"] = static_cast<qint64>(corpus.size());
+    result["chunkSize"] = CHUNK_SIZE;
+    result["iterations"] = SCAN_ITERATIONS;
+    result["megabytesPerSecond"] = megabytesPerSecond(corpus.size() * SCAN_ITERATIONS, seconds);
+    result["matches"] = static_cast<qint64>(matches / SCAN_ITERATIONS);
+    return result;
+}
+
+QJsonArray runEndToEndBenchmark(const std::vector<BenchPattern> &patterns, const std::vector<GeneratedFile> &files,
+                                const std::vector<int> &threadCounts) {
+    std::vector<std::pair<std::string, std::string>> scanPatterns;
+    std::map<std::string, PatternOptions> patternOptions;
+    for (const auto &pattern: patterns) {
+        scanPatterns.emplace_back(pattern.pattern, pattern.description);
+        patternOptions[pattern.pattern] = pattern.options;
+    }
+    std::map<std::string, std::string> fileTypes;
+    std::vector<std::string> filePaths;
+    uint64_t totalBytes = 0;
+    for (const auto &file: files) {
+        fileTypes[file.path.extension().string()] = corpusFileKindName(file.kind);
+        filePaths.push_back(file.path.string());
+        totalBytes += file.fileBytes;
+    }
+
+    // The flat model is the shared queue of unpinned threads, numa pins per node groups with their own
+    // queues. On a machine with one node the difference is only the pinning.
+    // The highest thread count runs once more with the PDF, zip and XML readers in sandboxed helpers,
+    // plain text files are read in process either way
+    std::vector<std::tuple<int, const char *, bool>> runs;
+    for (int numThreads: threadCounts) {
+        runs.emplace_back(numThreads, "flat", false);
+        runs.emplace_back(numThreads, "numa", false);
+    }
+    if (!threadCounts.empty() && ParserPool::isSupported()) {
+        runs.emplace_back(threadCounts.back(), "flat", true);
+    }
+
+    QJsonArray results;
+    for (const auto &[numThreads, topology, sandbox]: runs) {
+        FileScanner scanner;
+        ScanSettings settings;
+        settings.numThreads = numThreads;
+        settings.workerTopology = topology;
+        settings.parserSandbox.enabled = sandbox;
+        scanner.setScanSettings(settings);
+        scanner.setPatternOptions(patternOptions);
+
+        QPromise<ScanResults> promise;
+        QFuture<ScanResults> future = promise.future();
+        promise.start();
+        auto start = std::chrono::steady_clock::now();
+        scanner.scanFiles(promise, filePaths, scanPatterns, fileTypes);
+        double seconds = secondsSince(start);
+
+        QJsonObject result;
+        result["threads"] = numThreads;
+        result["workerTopology"] = topology;
+        result["parserSandbox"] = sandbox;
+        try {
+            ScanResults scanResults = future.result();
+            qint64 flagged = 0;
+            for (const auto &scanResult: scanResults) {
+                if (scanResult.second.first == ScanResult::FLAGGED ||
+                    scanResult.second.first == ScanResult::FLAGGED_BUT_UNWRITABLE) {
+                    flagged++;
+                }
+            }
+            result["flaggedFiles"] = flagged;
+        } catch (std::exception &e) {
+            result["error"] = e.what();
+            results.append(result);
+            break;
+        }
+        result["files"] = static_cast<qint64>(files.size());
+        result["bytes"] = static_cast<qint64>(totalBytes);
+        result["seconds"] = seconds;
+        result["filesPerSecond"] = seconds > 0 ? files.size() / seconds : 0;
+        result["megabytesPerSecond"] = megabytesPerSecond(totalBytes, seconds);
+        results.append(result);
+    }
+    return results;
+}
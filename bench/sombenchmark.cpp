@@ -0,0 +1,117 @@
+//
+// Measures what compiling a scan pattern with HS_FLAG_SOM_LEFTMOST costs compared to the
+// HS_FLAG_SINGLEMATCH build the scanner uses by default.
+//
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <hs/hs.h>
+
+#include "benchmarks.h"
+#include "patternanalyzer.h"
+
+#define SCAN_ITERATIONS 3
+
+struct PatternCost {
+    bool compiled = false;
+    std::string error;
+    double compileMs = 0;
+    size_t databaseBytes = 0;
+    size_t scratchBytes = 0;
+    double megabytesPerSecond = 0;
+    uint64_t matches = 0;
+};
+
+int countMatch(unsigned int, unsigned long long, unsigned long long, unsigned int, void *context) {
+    ++*static_cast<uint64_t *>(context);
+    return 0;
+}
+
+static PatternCost measurePattern(const std::string &pattern, unsigned int flags, const std::string &corpus) {
+    PatternCost cost;
+    hs_database_t *database = nullptr;
+    hs_compile_error_t *compileError = nullptr;
+
+    auto compileStart = std::chrono::steady_clock::now();
+    if (hs_compile(pattern.c_str(), flags, HS_MODE_BLOCK, nullptr, &database, &compileError) != HS_SUCCESS) {
+        cost.error = compileError->message;
+        hs_free_compile_error(compileError);
+        return cost;
+    }
+    cost.compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compileStart).count();
+    cost.compiled = true;
+    hs_database_size(database, &cost.databaseBytes);
+
+    hs_scratch_t *scratch = nullptr;
+    if (hs_alloc_scratch(database, &scratch) != HS_SUCCESS) {
+        cost.error = "Unable to allocate scratch space";
+        hs_free_database(database);
+        return cost;
+    }
+    hs_scratch_size(scratch, &cost.scratchBytes);
+
+    auto scanStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < SCAN_ITERATIONS; i++) {
+        for (size_t offset = 0; offset < corpus.size(); offset += CHUNK_SIZE) {
+            size_t length = std::min(static_cast<size_t>(CHUNK_SIZE), corpus.size() - offset);
+            hs_scan(database, corpus.data() + offset, length, 0, scratch, countMatch, &cost.matches);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - scanStart).count();
+    cost.megabytesPerSecond = (corpus.size() * SCAN_ITERATIONS) / (1024.0 * 1024.0) / seconds;
+    cost.matches /= SCAN_ITERATIONS;
+
+    hs_free_scratch(scratch);
+    hs_free_database(database);
+    return cost;
+}
+
+static QJsonObject costToJson(const PatternCost &cost) {
+    QJsonObject obj;
+    obj["compiled"] = cost.compiled;
+    if (!cost.compiled) {
+        obj["error"] = QString::fromStdString(cost.error);
+        return obj;
+    }
+    obj["compileMs"] = cost.compileMs;
+    obj["databaseBytes"] = static_cast<qint64>(cost.databaseBytes);
+    obj["scratchBytes"] = static_cast<qint64>(cost.scratchBytes);
+    obj["megabytesPerSecond"] = cost.megabytesPerSecond;
+    obj["matches"] = static_cast<qint64>(cost.matches);
+    return obj;
+}
+
+QJsonObject runSomBenchmark(const QJsonArray &scanPatterns, size_t corpusBytes) {
+    std::string corpus = PatternAnalyzer::generateSampleText(corpusBytes, 42);
+
+    QJsonArray results;
+    for (const auto &value: scanPatterns) {
+        QJsonObject patternObj = value.toObject();
+        std::string pattern = patternObj["pattern"].toString().toStdString();
+
+        PatternCost singleMatch = measurePattern(pattern, HS_FLAG_UTF8 | HS_FLAG_SINGLEMATCH, corpus);
+        PatternCost leftmost = measurePattern(pattern, HS_FLAG_UTF8 | HS_FLAG_SOM_LEFTMOST, corpus);
+
+        QJsonObject result;
+        result["description"] = patternObj["description"];
+        result["pattern"] = patternObj["pattern"];
+        result["singleMatch"] = costToJson(singleMatch);
+        result["somLeftmost"] = costToJson(leftmost);
+        if (singleMatch.compiled && leftmost.compiled) {
+            result["throughputRatio"] = leftmost.megabytesPerSecond / singleMatch.megabytesPerSecond;
+            result["extraMemoryBytes"] = static_cast<qint64>(leftmost.databaseBytes + leftmost.scratchBytes) -
+                                         static_cast<qint64>(singleMatch.databaseBytes + singleMatch.scratchBytes);
+        }
+        results.append(result);
+    }
+
+    QJsonObject report;
+    report["benchmark"] = "som";
+    report["corpusBytes"] = static_cast<qint64>(corpus.size());
+    report["chunkSize"] = CHUNK_SIZE;
+    report["patterns"] = results;
+    return report;
+}
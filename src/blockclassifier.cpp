@@ -0,0 +1,136 @@
+#include <cmath>
+
+#include "blockclassifier.h"
+#include "simd.h"
+
+#define MAX_CONTROL_PERCENT 5   // Text has hardly any control bytes besides whitespace
+#define HIGH_BYTE_PERCENT 30    // Blocks with more bytes from 0x80 up are checked with the entropy estimate
+#define MAX_TEXT_ENTROPY 7.0    // Bits per byte, UTF-8 text in any script stays well below
+
+static bool isControl(unsigned char c) {
+    return (c > 0 && c < 0x20 && c != '\t' && c != '\n' && c != '\f' && c != '\r') || c == 0x7F;
+}
+
+#ifdef SDD_HAVE_SSE2
+// Sum of the 16 byte counters
+static uint32_t sumLanes(__m128i counters) {
+    __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4));
+}
+#elif defined(SDD_HAVE_NEON)
+static uint32_t sumLanes(uint8x16_t counters) {
+    return vaddlvq_u8(counters);
+}
+#endif
+
+BlockStats countBlockBytes(const char *data, size_t size) {
+    BlockStats stats;
+    stats.size = static_cast<uint32_t>(size);
+    auto *bytes = reinterpret_cast<const unsigned char *>(data);
+    size_t pos = 0;
+
+#ifdef SDD_HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i evenBytes = _mm_set1_epi16(0x00FF);
+    while (pos + 16 <= size) {
+        // Compare results are -1 per matching byte, so subtracting them counts matches per lane.
+        // A lane overflows after 255 blocks, the counters are added up before that.
+        __m128i nul = zero, evenNul = zero, control = zero, high = zero;
+        for (int blocks = 0; blocks < 255 && pos + 16 <= size; blocks++, pos += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + pos));
+            __m128i isNul = _mm_cmpeq_epi8(block, zero);
+            // Bytes from 0x80 up are negative as signed chars
+            __m128i isHigh = _mm_cmplt_epi8(block, zero);
+            __m128i isLow = _mm_andnot_si128(_mm_or_si128(isHigh, isNul), _mm_cmplt_epi8(block, _mm_set1_epi8(0x20)));
+            __m128i isSpace = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))),
+                    _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\f')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+            __m128i isControl = _mm_or_si128(_mm_andnot_si128(isSpace, isLow),
+                                             _mm_cmpeq_epi8(block, _mm_set1_epi8(0x7F)));
+            nul = _mm_sub_epi8(nul, isNul);
+            evenNul = _mm_sub_epi8(evenNul, _mm_and_si128(isNul, evenBytes));
+            control = _mm_sub_epi8(control, isControl);
+            high = _mm_sub_epi8(high, isHigh);
+        }
+        stats.nulBytes += sumLanes(nul);
+        stats.evenNulBytes += sumLanes(evenNul);
+        stats.controlBytes += sumLanes(control);
+        stats.highBytes += sumLanes(high);
+    }
+#elif defined(SDD_HAVE_NEON)
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t evenBytes = vreinterpretq_u8_u16(vdupq_n_u16(0x00FF));
+    while (pos + 16 <= size) {
+        // Same counting as the SSE2 loop, NEON compares also give 0xFF per matching byte
+        uint8x16_t nul = zero, evenNul = zero, control = zero, high = zero;
+        for (int blocks = 0; blocks < 255 && pos + 16 <= size; blocks++, pos += 16) {
+            uint8x16_t block = vld1q_u8(bytes + pos);
+            uint8x16_t isNul = vceqq_u8(block, zero);
+            uint8x16_t isHigh = vcgeq_u8(block, vdupq_n_u8(0x80));
+            uint8x16_t isLow = vbicq_u8(vcltq_u8(block, vdupq_n_u8(0x20)), isNul);
+            uint8x16_t isSpace = vorrq_u8(
+                    vorrq_u8(vceqq_u8(block, vdupq_n_u8('\t')), vceqq_u8(block, vdupq_n_u8('\n'))),
+                    vorrq_u8(vceqq_u8(block, vdupq_n_u8('\f')), vceqq_u8(block, vdupq_n_u8('\r'))));
+            uint8x16_t isControl = vorrq_u8(vbicq_u8(isLow, isSpace), vceqq_u8(block, vdupq_n_u8(0x7F)));
+            nul = vsubq_u8(nul, isNul);
+            evenNul = vsubq_u8(evenNul, vandq_u8(isNul, evenBytes));
+            control = vsubq_u8(control, isControl);
+            high = vsubq_u8(high, isHigh);
+        }
+        stats.nulBytes += sumLanes(nul);
+        stats.evenNulBytes += sumLanes(evenNul);
+        stats.controlBytes += sumLanes(control);
+        stats.highBytes += sumLanes(high);
+    }
+#endif
+    for (; pos < size; pos++) {
+        unsigned char c = bytes[pos];
+        stats.nulBytes += c == 0;
+        stats.evenNulBytes += c == 0 && pos % 2 == 0;
+        stats.controlBytes += isControl(c);
+        stats.highBytes += c >= 0x80;
+    }
+    return stats;
+}
+
+double blockEntropy(const char *data, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    uint32_t histogram[256] = {};
+    for (size_t i = 0; i < size; i++) {
+        histogram[static_cast<unsigned char>(data[i])]++;
+    }
+    double entropy = 0;
+    for (uint32_t count: histogram) {
+        if (count > 0) {
+            double p = static_cast<double>(count) / static_cast<double>(size);
+            entropy -= p * std::log2(p);
+        }
+    }
+    return entropy;
+}
+
+bool isBinaryBlock(const char *data, size_t size) {
+    auto *bytes = reinterpret_cast<const unsigned char *>(data);
+    if (size >= 2 && ((bytes[0] == 0xFF && bytes[1] == 0xFE) || (bytes[0] == 0xFE && bytes[1] == 0xFF))) {
+        return false;
+    }
+    BlockStats stats = countBlockBytes(data, size);
+
+    // Same test as the UTF-16 detection in TextDecoder, one byte of each pair is mostly zero
+    size_t pairs = size / 2;
+    size_t evenNul = stats.evenNulBytes;
+    size_t oddNul = stats.nulBytes - stats.evenNulBytes;
+    if (pairs >= 2 && ((oddNul * 10 >= pairs * 4 && evenNul * 10 < pairs) ||
+                       (evenNul * 10 >= pairs * 4 && oddNul * 10 < pairs))) {
+        return false;
+    }
+    if (stats.nulBytes > 0 || stats.controlBytes * 100 > size * MAX_CONTROL_PERCENT) {
+        return true;
+    }
+    if (stats.highBytes * 100 >= size * HIGH_BYTE_PERCENT) {
+        return blockEntropy(data, size) > MAX_TEXT_ENTROPY;
+    }
+    return false;
+}
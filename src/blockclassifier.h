@@ -0,0 +1,32 @@
+#ifndef SENSITIVE_DATA_DELETER_BLOCKCLASSIFIER_H
+#define SENSITIVE_DATA_DELETER_BLOCKCLASSIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define FIRST_BLOCK_SIZE 1024 // Bytes from the start of a file that decide whether it is text
+
+// Byte counts of a block, gathered 16 bytes at a time where SSE2 or NEON is available
+struct BlockStats {
+    uint32_t size = 0;
+    uint32_t nulBytes = 0;
+    uint32_t evenNulBytes = 0; // NUL bytes at even offsets, to recognize UTF-16
+    uint32_t controlBytes = 0; // Below 0x20 or 0x7F, except NUL and the usual whitespace
+    uint32_t highBytes = 0;    // 0x80 and up
+};
+
+BlockStats countBlockBytes(const char *data, size_t size);
+
+// Shannon entropy of the block in bits per byte
+double blockEntropy(const char *data, size_t size);
+
+/**
+ * Decides from the first block of a file whether the rest of it is worth decoding as text, so a
+ * .txt that is really a blob can be dropped after reading one chunk. UTF-16 text (a byte order mark,
+ * or NUL bytes in every other position) is text. Otherwise any NUL byte or more than a few control
+ * bytes make the block binary. Blocks that are mostly bytes from 0x80 up are either text in a
+ * non-Latin script or compressed data, only those pay for the entropy estimate.
+ */
+bool isBinaryBlock(const char *data, size_t size);
+
+#endif //SENSITIVE_DATA_DELETER_BLOCKCLASSIFIER_H
@@ -2,7 +2,44 @@
 // Created by Olaf Seisler on 07.08.2024.
 //
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include <minizip-ng/mz.h>
+#include <minizip-ng/mz_strm.h>
+#include <minizip-ng/mz_strm_mem.h>
+
 #include "chunkreader.h"
+#include "blockclassifier.h"
+#include "simd.h"
+
+const char *readerTypeName(ChunkReaderType type) {
+    switch (type) {
+        case ChunkReaderType::PLAIN_TEXT_READER:
+            return "plain_text";
+        case ChunkReaderType::PDF_READER:
+            return "pdf";
+        case ChunkReaderType::XML_READER:
+            return "xml";
+        case ChunkReaderType::ZIP_READER:
+            return "zip";
+        case ChunkReaderType::BINARY_STRINGS_READER:
+            return "binary_strings";
+        case ChunkReaderType::COMPRESSED_READER:
+            return "compressed";
+        case ChunkReaderType::TAR_READER:
+            return "tar";
+        case ChunkReaderType::MAIL_READER:
+            return "mail";
+        case ChunkReaderType::OLE_READER:
+            return "ole";
+        default:
+            return "unknown";
+    }
+}
 
 size_t PlainTextChunkReader::readChunkFromFile(char *buffer, int chunkSize) {
     if (!this->fileData.empty()) {
@@ -26,89 +63,79 @@ size_t PlainTextChunkReader::readChunkFromVector(char *buffer, int chunkSize) {
 }
 
 size_t PDFChunkReader::readChunkFromFile(char *buffer, int chunkSize) {
-    if (doc->pages() == 0) {
-        return 0;
-    }
-
     size_t numBytesRead = 0;
 
-    while (pageIndex < doc->pages()) {
-        auto page = doc->create_page(pageIndex);
-        if (!page) {
-            break;
-        }
-
-        auto text = page->text().to_utf8();
-        if (numBytesRead + text.size() > chunkSize) {
-            break;
-        }
-
-        if (!text.empty()) {
-            std::copy(text.begin(), text.end(), buffer + numBytesRead);
-            numBytesRead += text.size();
+    while (numBytesRead < static_cast<size_t>(chunkSize)) {
+        // Pages longer than a chunk are returned over several calls
+        if (pageOffset == pageText.size()) {
+            if (pageIndex >= doc->pages()) {
+                break;
+            }
+            auto page = std::unique_ptr<poppler::page>(doc->create_page(pageIndex++));
+            pageText = page ? page->text().to_utf8() : poppler::byte_array();
+            pageOffset = 0;
+            continue;
         }
 
-        pageIndex++;
+        size_t length = std::min(pageText.size() - pageOffset, chunkSize - numBytesRead);
+        std::copy(pageText.begin() + pageOffset, pageText.begin() + pageOffset + length, buffer + numBytesRead);
+        pageOffset += length;
+        numBytesRead += length;
     }
 
     return numBytesRead;
 }
 
-size_t XMLChunkReader::extractTextFromElement(tinyxml2::XMLElement *element, char *buffer, int chunkSize) {
-    if (element == nullptr)
-        return 0;
-
-    currentNode = element;
-    const char *text = element->GetText();
-    // If the length of the text is greater than the chunk size, return
-    if (text && offset + strlen(text) > chunkSize) {
-        return 0;
-    }
-
-    // Copy the text into the buffer
-    size_t numBytesRead = 0;
-    if (text) {
-        std::copy(text, text + strlen(text), buffer + offset);
-        offset += strlen(text);
-        numBytesRead += strlen(text);
+tinyxml2::XMLElement *XMLChunkReader::nextElement(tinyxml2::XMLElement *element) {
+    if (element->FirstChildElement()) {
+        return element->FirstChildElement();
     }
-
-    // Recursively extract text from all child elements
-    for (tinyxml2::XMLElement *child = element->FirstChildElement();
-         child != nullptr; child = child->NextSiblingElement()) {
-        numBytesRead += extractTextFromElement(child, buffer, chunkSize);
+    for (; element; element = element->Parent() ? element->Parent()->ToElement() : nullptr) {
+        if (element->NextSiblingElement()) {
+            return element->NextSiblingElement();
+        }
     }
-
-    return numBytesRead;
+    return nullptr;
 }
 
 size_t XMLChunkReader::readChunkFromFile(char *buffer, int chunkSize) {
-    // Read the file from the file stream
-    while (true) {
-        if (currentNode == nullptr) {
-            return 0;
-        }
+    size_t numBytesRead = 0;
 
-        size_t numBytesRead = extractTextFromElement(currentNode, buffer, chunkSize);
-        if (numBytesRead == 0) {
-            // If the node has unprocessed siblings, go to next one
-            // If not, go to the parent node
-            if (currentNode->NextSiblingElement()) {
-                currentNode = currentNode->NextSiblingElement();
-            } else {
-                auto parent = currentNode->Parent()->ToElement();
-                if (parent && parent->NextSiblingElement()) {
-                    currentNode = parent->NextSiblingElement();
-                } else {
-                    break;
-                }
+    // Text of the elements in document order, text longer than a chunk is returned over several calls
+    while (currentNode && numBytesRead < static_cast<size_t>(chunkSize)) {
+        const char *text = currentNode->GetText();
+        size_t length = text ? strlen(text) : 0;
+        if (offset < length) {
+            size_t numBytes = std::min(length - offset, chunkSize - numBytesRead);
+            std::copy(text + offset, text + offset + numBytes, buffer + numBytesRead);
+            offset += numBytes;
+            numBytesRead += numBytes;
+            if (offset < length) {
+                break;
             }
-        } else {
-            return numBytesRead;
         }
+        currentNode = nextElement(currentNode);
+        offset = 0;
     }
 
-    return 0;
+    return numBytesRead;
+}
+
+ZipChunkReader::ZipChunkReader(std::vector<uint8_t> zipData) : zipFile(nullptr), zipData(std::move(zipData)) {
+    if (this->zipData.size() > UNZIP_MAX_SIZE) {
+        throw std::runtime_error("ZIP data too large");
+    }
+    void *stream = mz_stream_mem_create();
+    mz_stream_mem_set_buffer(stream, this->zipData.data(), static_cast<int32_t>(this->zipData.size()));
+    // unzClose() closes and deletes the stream once unzOpen_MZ() took it
+    if (mz_stream_open(stream, nullptr, MZ_OPEN_MODE_READ) != MZ_OK || !(zipFile = unzOpen_MZ(stream))) {
+        mz_stream_mem_delete(&stream);
+        throw std::runtime_error("Failed to open ZIP data");
+    }
+    if (unzGoToFirstFile(zipFile) != UNZ_OK) {
+        unzClose(zipFile);
+        throw std::runtime_error("Failed to go to the first file in the zip archive");
+    }
 }
 
 // Function to extract a single file's content into memory
@@ -155,9 +182,10 @@ size_t ZipChunkReader::readChunkFromFile(char *buffer, int chunkSize) {
         qDebug() << "Extracted file: " << extractedFileName;
         currentFileName = extractedFileName;
         delete currentReader;
-        currentReader = ChunkReaderFactory::createReader(fileData);
+        currentReader = ChunkReaderFactory::createReader(std::move(fileData));
         if (!currentReader) {
-            return 0;
+            // Skip files of unsupported types and carry on with the rest of the archive
+            return unzGoToNextFile(zipFile) == UNZ_OK ? -1 : 0;
         }
     }
 
@@ -173,3 +201,1308 @@ size_t ZipChunkReader::readChunkFromFile(char *buffer, int chunkSize) {
 
     return numBytesRead;
 }
+
+size_t CompressedChunkReader::readChunkFromFile(char *buffer, int chunkSize) {
+    return decompressor->read(buffer, chunkSize);
+}
+
+// Octal, or base-256 with the high bit of the first byte set for sizes from 8 GB up
+static uint64_t parseTarNumber(const char *field, size_t length) {
+    auto *bytes = reinterpret_cast<const unsigned char *>(field);
+    uint64_t value = 0;
+    if (bytes[0] & 0x80) {
+        value = bytes[0] & 0x7F;
+        for (size_t i = 1; i < length; i++) {
+            value = value << 8 | bytes[i];
+        }
+        return value;
+    }
+    size_t i = 0;
+    while (i < length && (field[i] == ' ' || field[i] == '\0')) {
+        i++;
+    }
+    for (; i < length && field[i] >= '0' && field[i] <= '7'; i++) {
+        value = value << 3 | static_cast<uint64_t>(field[i] - '0');
+    }
+    return value;
+}
+
+// The checksum treats its own field as spaces. Some old tars summed signed chars, both are accepted.
+static bool isValidTarHeader(const char *header) {
+    uint64_t stored = parseTarNumber(header + 148, 8);
+    uint64_t unsignedSum = 0;
+    int64_t signedSum = 0;
+    for (int i = 0; i < TAR_BLOCK_SIZE; i++) {
+        bool inChecksum = i >= 148 && i < 156;
+        unsignedSum += inChecksum ? ' ' : static_cast<unsigned char>(header[i]);
+        signedSum += inChecksum ? ' ' : static_cast<signed char>(header[i]);
+    }
+    return stored == unsignedSum || static_cast<int64_t>(stored) == signedSum;
+}
+
+// Fields of the header are NUL terminated unless they fill the whole field
+static std::string tarField(const char *field, size_t length) {
+    return {field, strnlen(field, length)};
+}
+
+// Records of a pax extended header look like "<length> <key>=<value>\n"
+static void parsePaxHeader(const std::string &data, std::string &path, uint64_t &size, bool &hasSize) {
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t space = data.find(' ', pos);
+        if (space == std::string::npos) {
+            break;
+        }
+        uint64_t length = std::strtoull(data.c_str() + pos, nullptr, 10);
+        if (length == 0 || pos + length > data.size()) {
+            break;
+        }
+        std::string record = data.substr(space + 1, pos + length - space - 2);
+        size_t equals = record.find('=');
+        if (equals != std::string::npos) {
+            std::string key = record.substr(0, equals);
+            if (key == "path") {
+                path = record.substr(equals + 1);
+            } else if (key == "size") {
+                size = std::strtoull(record.c_str() + equals + 1, nullptr, 10);
+                hasSize = true;
+            }
+        }
+        pos += length;
+    }
+}
+
+TarChunkReader::TarChunkReader(const std::filesystem::path &filePath) :
+        ChunkReader(filePath), decompressor(Decompressor::open(filePath)), skipBuffer(DECOMPRESS_INPUT_SIZE) {
+    if (!decompressor) {
+        fileStream.open(filePath, std::ios::binary);
+        if (!fileStream.is_open()) {
+            throw std::runtime_error("Failed to open file: " + filePath.string());
+        }
+        std::error_code error;
+        fileSize = std::filesystem::file_size(filePath, error);
+    }
+}
+
+size_t TarChunkReader::readInput(char *buffer, size_t size) {
+    if (!decompressor) {
+        fileStream.read(buffer, static_cast<std::streamsize>(size));
+        return static_cast<size_t>(fileStream.gcount());
+    }
+    // The decompressor can return less than asked for before the end of the stream
+    size_t numBytesRead = 0;
+    while (numBytesRead < size) {
+        size_t read = decompressor->read(buffer + numBytesRead, size - numBytesRead);
+        if (read == 0) {
+            break;
+        }
+        numBytesRead += read;
+    }
+    return numBytesRead;
+}
+
+void TarChunkReader::skipInput(uint64_t size) {
+    if (!decompressor) {
+        // Seeking past the end does not fail, the position tells if the archive is truncated
+        fileStream.seekg(static_cast<std::streamoff>(size), std::ios::cur);
+        std::streamoff position = fileStream.tellg();
+        failed = failed || position < 0 || static_cast<uint64_t>(position) > fileSize;
+        return;
+    }
+    while (size > 0) {
+        size_t read = readInput(skipBuffer.data(), std::min<uint64_t>(size, skipBuffer.size()));
+        if (read == 0) {
+            failed = true;
+            return;
+        }
+        size -= read;
+    }
+}
+
+bool TarChunkReader::readHeaderData(uint64_t size, std::string &data) {
+    uint64_t padded = (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+    if (size > TAR_MAX_HEADER_DATA) {
+        skipInput(padded);
+        return false;
+    }
+    data.resize(padded);
+    if (readInput(data.data(), padded) != padded) {
+        failed = true;
+        return false;
+    }
+    data.resize(size);
+    return true;
+}
+
+bool TarChunkReader::nextMember() {
+    std::string longName;
+    std::string paxPath;
+    uint64_t paxSize = 0;
+    bool hasPaxSize = false;
+
+    while (!endOfArchive) {
+        // Whatever was not read of the previous member
+        skipInput(memberRemaining + memberPadding);
+        memberRemaining = 0;
+        memberPadding = 0;
+
+        char header[TAR_BLOCK_SIZE];
+        size_t headerSize = readInput(header, TAR_BLOCK_SIZE);
+        if (headerSize != TAR_BLOCK_SIZE) {
+            // Archives may end without the two zero blocks, but not in the middle of a header
+            failed = failed || headerSize > 0;
+            break;
+        }
+        if (std::all_of(header, header + TAR_BLOCK_SIZE, [](char c) { return c == '\0'; })) {
+            break;
+        }
+        if (!isValidTarHeader(header)) {
+            qWarning() << "Invalid tar header in" << filePath.string() << "after" << memberName;
+            failed = true;
+            break;
+        }
+
+        char type = header[156];
+        uint64_t size = hasPaxSize ? paxSize : parseTarNumber(header + 124, 12);
+        std::string name = tarField(header, 100);
+        if (std::memcmp(header + 257, "ustar", 5) == 0 && header[345] != '\0') {
+            name = tarField(header + 345, 155) + "/" + name;
+        }
+        if (!longName.empty()) {
+            name = longName;
+        }
+        if (!paxPath.empty()) {
+            name = paxPath;
+        }
+
+        // Extension headers describe the header that follows them
+        if (type == 'L') {
+            if (readHeaderData(size, longName)) {
+                longName.resize(strnlen(longName.c_str(), longName.size()));
+            }
+            continue;
+        } else if (type == 'x') {
+            std::string pax;
+            if (readHeaderData(size, pax)) {
+                parsePaxHeader(pax, paxPath, paxSize, hasPaxSize);
+            }
+            continue;
+        }
+
+        memberName = name;
+        memberRemaining = size;
+        memberPadding = (TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+        longName.clear();
+        paxPath.clear();
+        hasPaxSize = false;
+
+        // Regular files only, links, folders and devices have nothing to scan
+        bool regularFile = type == '0' || type == '\0' || type == '7';
+        if (regularFile && size > 0 && openMember(size)) {
+            return true;
+        }
+    }
+    endOfArchive = true;
+    return false;
+}
+
+bool TarChunkReader::openMember(uint64_t size) {
+    QMimeType mimeType = QMimeDatabase().mimeTypeForFile(QString::fromStdString(memberName),
+                                                         QMimeDatabase::MatchExtension);
+    location = memberName;
+    if (mimeType.inherits("application/pdf") || mimeType.inherits("application/xml") ||
+        mimeType.inherits("application/zip") || ChunkReaderFactory::isOle(mimeType) ||
+        ChunkReaderFactory::isCompressed(mimeType)) {
+        if (size > UNZIP_MAX_SIZE) {
+            return false;
+        }
+        std::vector<uint8_t> fileData(size);
+        memberRemaining -= readInput(reinterpret_cast<char *>(fileData.data()), size);
+        if (memberRemaining > 0) {
+            failed = true;
+            return false;
+        }
+        try {
+            currentReader.reset(ChunkReaderFactory::createEmbeddedReader(std::move(fileData)));
+        } catch (std::exception &e) {
+            qWarning() << "Error creating ChunkReader: " << e.what() << " for " << memberName << " in "
+                       << filePath.string();
+            currentReader.reset();
+        }
+        return currentReader != nullptr;
+    }
+    // Files without an extension are often text, the first block decides
+    if (mimeType.inherits("text/plain") || mimeType.isDefault()) {
+        streamingMember = true;
+        memberStarted = false;
+        return true;
+    }
+    return false;
+}
+
+size_t TarChunkReader::readChunkFromFile(char *buffer, int chunkSize) {
+    while (true) {
+        if (currentReader) {
+            size_t numBytesRead = currentReader->readChunkFromFile(buffer, chunkSize);
+            if (numBytesRead != 0 && numBytesRead != -1) {
+                std::string inner = currentReader->currentLocation();
+                location = inner.empty() ? memberName : memberName + ", " + inner;
+                return numBytesRead;
+            } else if (numBytesRead == 0) {
+                // Zip members end each of their files with -1, the member ends with 0
+                failed = failed || currentReader->extractionFailed();
+                currentReader.reset();
+            }
+            return -1;
+        }
+        if (streamingMember) {
+            size_t numBytesRead = memberRemaining == 0 ? 0 : readInput(
+                    buffer, std::min<uint64_t>(memberRemaining, static_cast<uint64_t>(chunkSize)));
+            memberRemaining -= numBytesRead;
+            if (numBytesRead == 0) {
+                // Done with the member, or the archive is truncated
+                streamingMember = false;
+                endOfArchive = endOfArchive || memberRemaining > 0;
+                failed = failed || memberRemaining > 0;
+                if (memberStarted) {
+                    return -1;
+                }
+                continue;
+            }
+            if (!memberStarted && isBinaryBlock(buffer, std::min<size_t>(numBytesRead, FIRST_BLOCK_SIZE))) {
+                streamingMember = false;
+                continue;
+            }
+            memberStarted = true;
+            return numBytesRead;
+        }
+        if (!nextMember()) {
+            return 0;
+        }
+    }
+}
+
+static std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+static std::string trim(const std::string &text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return {};
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r\n") + 1 - begin);
+}
+
+// Decodes the %XX escapes of an RFC 2231 parameter value
+static std::string percentDecode(const std::string &text) {
+    std::string decoded;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '%' && i + 2 < text.size() && std::isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            decoded += static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            decoded += text[i];
+        }
+    }
+    return decoded;
+}
+
+// Value of a parameter such as boundary or filename in a Content-Type or Content-Disposition header
+static std::string headerParameter(const std::string &value, const std::string &name) {
+    std::string lower = toLower(value);
+    size_t pos = 0;
+    while ((pos = lower.find(';', pos)) != std::string::npos) {
+        pos = lower.find_first_not_of(" \t", pos + 1);
+        if (pos == std::string::npos || lower.compare(pos, name.size(), name) != 0) {
+            continue;
+        }
+        size_t equals = pos + name.size();
+        // filename*=utf-8''Rechnung%20M%C3%A4rz.pdf
+        bool extended = equals < lower.size() && lower[equals] == '*';
+        equals = lower.find_first_not_of(" \t", equals + (extended ? 1 : 0));
+        if (equals == std::string::npos || lower[equals] != '=') {
+            continue;
+        }
+        size_t start = value.find_first_not_of(" \t", equals + 1);
+        if (start == std::string::npos) {
+            return {};
+        }
+        std::string result;
+        if (value[start] == '"') {
+            size_t end = value.find('"', start + 1);
+            result = value.substr(start + 1, end == std::string::npos ? end : end - start - 1);
+        } else {
+            size_t end = value.find_first_of("; \t", start);
+            result = value.substr(start, end == std::string::npos ? end : end - start);
+        }
+        if (extended) {
+            size_t quotes = result.find("''");
+            result = percentDecode(quotes == std::string::npos ? result : result.substr(quotes + 2));
+        }
+        return result;
+    }
+    return {};
+}
+
+static bool hasReader(const QMimeType &mimeType) {
+    return mimeType.inherits("application/pdf") || mimeType.inherits("application/zip") ||
+           mimeType.inherits("application/xml") || mimeType.inherits("text/plain") ||
+           ChunkReaderFactory::isOle(mimeType) || ChunkReaderFactory::isCompressed(mimeType);
+}
+
+MailChunkReader::MailChunkReader(const std::filesystem::path &filePath) :
+        ChunkReader(filePath), fileStream(filePath, std::ios::binary), input(MAIL_READ_SIZE) {
+    if (!fileStream.is_open()) {
+        throw std::runtime_error("Failed to open file: " + filePath.string());
+    }
+    char start[5] = {};
+    fileStream.read(start, sizeof(start));
+    fileStream.clear();
+    fileStream.seekg(0);
+    // An mbox file starts with the "From " line of its first message, anything else is a single message
+    mbox = std::memcmp(start, "From ", sizeof(start)) == 0;
+    if (!mbox) {
+        startMessage();
+    }
+}
+
+size_t MailChunkReader::readChunkFromFile(char *buffer, int chunkSize) {
+    while (true) {
+        if (currentReader) {
+            size_t numBytesRead = currentReader->readChunkFromFile(buffer, chunkSize);
+            if (numBytesRead != 0 && numBytesRead != -1) {
+                std::string member = currentReader->currentLocation();
+                location = member.empty() ? outputLocation : outputLocation + ", " + member;
+                return numBytesRead;
+            } else if (numBytesRead == 0) {
+                currentReader.reset();
+            }
+            return -1;
+        }
+
+        // Text is collected up to a full chunk so patterns can match across lines
+        bool ready = partEnded || endOfInput || output.size() - outputPos >= static_cast<size_t>(chunkSize);
+        if (ready && outputPos < output.size()) {
+            size_t numBytesRead = std::min(output.size() - outputPos, static_cast<size_t>(chunkSize));
+            std::memcpy(buffer, output.data() + outputPos, numBytesRead);
+            outputPos += numBytesRead;
+            location = outputLocation;
+            partReturned = true;
+            return numBytesRead;
+        }
+        if (ready) {
+            output.clear();
+            outputPos = 0;
+            if (!partEnded) {
+                return 0;
+            }
+            partEnded = false;
+            if (partReturned) {
+                partReturned = false;
+                return -1;
+            }
+            continue;
+        }
+        output.erase(0, outputPos);
+        outputPos = 0;
+        parseLine();
+    }
+}
+
+bool MailChunkReader::readLine(std::string &line, bool &complete) {
+    line.clear();
+    while (true) {
+        if (inputPos == inputEnd) {
+            fileStream.read(input.data(), static_cast<std::streamsize>(input.size()));
+            inputPos = 0;
+            inputEnd = static_cast<size_t>(fileStream.gcount());
+            if (inputEnd == 0) {
+                // A last line without a line break still ends there
+                complete = true;
+                return !line.empty();
+            }
+        }
+        size_t available = std::min(inputEnd - inputPos, MAIL_MAX_LINE - line.size());
+        const char *start = input.data() + inputPos;
+        const auto *newline = static_cast<const char *>(std::memchr(start, '\n', available));
+        size_t length = newline ? newline + 1 - start : available;
+        line.append(start, length);
+        inputPos += length;
+        if (newline || line.size() == MAIL_MAX_LINE) {
+            complete = newline != nullptr;
+            return true;
+        }
+    }
+}
+
+void MailChunkReader::startMessage() {
+    messageNumber++;
+    messageId.clear();
+    boundaries.clear();
+    partNumbers.clear();
+    headerBlock.clear();
+    state = MESSAGE_HEADERS;
+    handling = SKIP_PART;
+}
+
+std::string MailChunkReader::messageLocation() const {
+    return "message " + std::to_string(messageNumber) + (messageId.empty() ? "" : " " + messageId);
+}
+
+void MailChunkReader::parseLine() {
+    std::string line;
+    bool complete;
+    bool lineStart = atLineStart;
+    if (!readLine(line, complete)) {
+        endPart();
+        endOfInput = true;
+        return;
+    }
+    atLineStart = complete;
+
+    std::string_view text(line);
+    if (complete) {
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) {
+            text.remove_suffix(1);
+        }
+    }
+    bool blank = lineStart && complete && text.empty();
+
+    if (mbox && lineStart && previousLineBlank && text.substr(0, 5) == "From ") {
+        endPart();
+        startMessage();
+        previousLineBlank = false;
+        return;
+    }
+    previousLineBlank = blank;
+
+    if (state != PART_BODY) {
+        if (blank) {
+            parseHeaders();
+            headerBlock.clear();
+        } else if (headerBlock.size() < MAIL_MAX_HEADER) {
+            // Folded header lines are joined with the header they continue
+            bool continuation = lineStart && !text.empty() && (text[0] == ' ' || text[0] == '\t');
+            if (lineStart && !headerBlock.empty()) {
+                headerBlock += continuation ? ' ' : '\n';
+            }
+            size_t start = continuation ? text.find_first_not_of(" \t") : 0;
+            headerBlock.append(text.substr(std::min(start, text.size())));
+        }
+        return;
+    }
+
+    // A delimiter of an enclosing multipart also ends the multiparts nested in it
+    if (lineStart && text.size() > 2 && text.substr(0, 2) == "--") {
+        for (size_t i = boundaries.size(); i-- > 0;) {
+            const std::string &boundary = boundaries[i];
+            if (text.substr(2, boundary.size()) != boundary) {
+                continue;
+            }
+            bool closing = text.size() >= boundary.size() + 4 && text.substr(boundary.size() + 2, 2) == "--";
+            endPart();
+            boundaries.resize(i + 1);
+            partNumbers.resize(i + 1);
+            if (closing) {
+                // The epilogue after the closing delimiter is skipped
+                boundaries.pop_back();
+                partNumbers.pop_back();
+            } else {
+                partNumbers.back()++;
+                state = PART_HEADERS;
+            }
+            return;
+        }
+    }
+    decodeBody(line, complete);
+}
+
+void MailChunkReader::parseHeaders() {
+    std::string contentType, transferEncoding, disposition, id;
+    size_t pos = 0;
+    while (pos < headerBlock.size()) {
+        size_t end = headerBlock.find('\n', pos);
+        if (end == std::string::npos) {
+            end = headerBlock.size();
+        }
+        std::string header = headerBlock.substr(pos, end - pos);
+        pos = end + 1;
+        size_t colon = header.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string name = toLower(trim(header.substr(0, colon)));
+        std::string value = trim(header.substr(colon + 1));
+        if (name == "content-type") {
+            contentType = value;
+        } else if (name == "content-transfer-encoding") {
+            transferEncoding = toLower(value);
+        } else if (name == "content-disposition") {
+            disposition = value;
+        } else if (name == "message-id") {
+            id = value;
+        }
+    }
+
+    std::string partNumber;
+    for (int number: partNumbers) {
+        partNumber += (partNumber.empty() ? "" : ".") + std::to_string(number);
+    }
+
+    if (state == MESSAGE_HEADERS) {
+        // Messages attached to a message keep the number and id of the outer one
+        if (boundaries.empty()) {
+            messageId = id;
+        }
+        partLocation = messageLocation() + (partNumber.empty() ? "" : ", part " + partNumber) + ", headers";
+        if (output.empty()) {
+            outputLocation = partLocation;
+        }
+        output += decodeEncodedWords(headerBlock);
+        output += '\n';
+        partEnded = true;
+    }
+
+    std::string type = toLower(trim(contentType.substr(0, contentType.find(';'))));
+    if (type.empty()) {
+        type = "text/plain";
+    }
+    std::string boundary = headerParameter(contentType, "boundary");
+    if (type.rfind("multipart/", 0) == 0 && !boundary.empty()) {
+        boundaries.push_back(boundary);
+        partNumbers.push_back(0);
+        state = PART_BODY;
+        handling = SKIP_PART;
+        return;
+    } else if (type == "message/rfc822") {
+        state = MESSAGE_HEADERS;
+        handling = SKIP_PART;
+        return;
+    }
+
+    state = PART_BODY;
+    encoding = transferEncoding == "base64" ? BASE64_ENCODING :
+               transferEncoding == "quoted-printable" ? QUOTED_PRINTABLE_ENCODING : PLAIN_ENCODING;
+    std::string fileName = headerParameter(disposition, "filename");
+    if (fileName.empty()) {
+        fileName = headerParameter(contentType, "name");
+    }
+    fileName = decodeEncodedWords(fileName);
+
+    partLocation = messageLocation() + ", part " + (partNumber.empty() ? "1" : partNumber);
+    if (!fileName.empty()) {
+        partLocation += " (" + fileName + ")";
+    }
+
+    // Attachments are only decoded if one of the readers can do something with them
+    QMimeDatabase mimeDatabase;
+    if (type.rfind("text/", 0) == 0) {
+        handling = TEXT_PART;
+    } else if (hasReader(mimeDatabase.mimeTypeForName(QString::fromStdString(type))) ||
+               (!fileName.empty() && hasReader(mimeDatabase.mimeTypeForFile(QString::fromStdString(fileName),
+                                                                           QMimeDatabase::MatchExtension)))) {
+        handling = ATTACHMENT_PART;
+    } else {
+        handling = SKIP_PART;
+    }
+    base64.reset();
+    quotedPrintable.reset();
+}
+
+template<class Buffer>
+void MailChunkReader::appendDecoded(Buffer &target, const char *data, size_t size, bool lineEnd) {
+    size_t oldSize = target.size();
+    switch (encoding) {
+        case BASE64_ENCODING:
+            target.resize(oldSize + Base64Decoder::maxDecodedSize(size));
+            target.resize(oldSize + base64.decode(data, size, reinterpret_cast<char *>(&target[oldSize])));
+            break;
+        case QUOTED_PRINTABLE_ENCODING:
+            target.resize(oldSize + QuotedPrintableDecoder::maxDecodedSize(size));
+            target.resize(oldSize + quotedPrintable.decode(data, size, lineEnd,
+                                                           reinterpret_cast<char *>(&target[oldSize])));
+            break;
+        case PLAIN_ENCODING:
+            target.insert(target.end(), data, data + size);
+            break;
+    }
+}
+
+void MailChunkReader::decodeBody(const std::string &line, bool complete) {
+    size_t size = line.size();
+    // Quoted-printable needs to know where the line ends, the other encodings keep or skip line breaks
+    if (encoding == QUOTED_PRINTABLE_ENCODING && complete) {
+        while (size > 0 && (line[size - 1] == '\n' || line[size - 1] == '\r')) {
+            size--;
+        }
+    }
+    if (handling == TEXT_PART) {
+        if (output.empty()) {
+            outputLocation = partLocation;
+        }
+        appendDecoded(output, line.data(), size, complete);
+    } else if (handling == ATTACHMENT_PART && !attachmentTooLarge) {
+        appendDecoded(attachment, line.data(), size, complete);
+        if (attachment.size() > UNZIP_MAX_SIZE) {
+            attachmentTooLarge = true;
+            std::vector<uint8_t>().swap(attachment);
+        }
+    }
+}
+
+void MailChunkReader::endPart() {
+    char tail[3];
+    size_t tailSize = encoding == BASE64_ENCODING ? base64.finish(tail) :
+                      encoding == QUOTED_PRINTABLE_ENCODING ? quotedPrintable.finish(tail) : 0;
+    if (handling == TEXT_PART) {
+        if (output.empty()) {
+            outputLocation = partLocation;
+        }
+        output.append(tail, tailSize);
+        partEnded = true;
+    } else if (handling == ATTACHMENT_PART) {
+        attachment.insert(attachment.end(), tail, tail + tailSize);
+        if (!attachmentTooLarge && !attachment.empty()) {
+            openAttachment();
+        }
+        std::vector<uint8_t>().swap(attachment);
+        attachmentTooLarge = false;
+    }
+    handling = SKIP_PART;
+}
+
+void MailChunkReader::openAttachment() {
+    outputLocation = partLocation;
+    try {
+        // The decoded attachment stays in memory, its reader takes it over
+        currentReader.reset(ChunkReaderFactory::createEmbeddedReader(std::move(attachment)));
+    } catch (std::exception &e) {
+        qWarning() << "Error creating ChunkReader: " << e.what() << " for " << partLocation << " in "
+                   << filePath.string();
+        currentReader.reset();
+    }
+    attachment.clear();
+}
+
+#define WORD_FIB_IDENT 0xA5EC
+#define WORD97_FIB_VERSION 0x00C1 // Older versions have no piece table at the Word 97 offsets
+#define WORD_FLAG_COMPLEX 0x0004  // Fast-saved, the text is in several pieces
+#define WORD_FLAG_ENCRYPTED 0x0100
+#define WORD_FLAG_TABLE_1 0x0200  // The piece table is in 1Table instead of 0Table
+#define WORD_FIB_SIZE 0x1AA       // Up to fcClx and lcbClx
+
+#define BIFF_BOF 0x0809
+#define BIFF_FILEPASS 0x002F
+#define BIFF_BOUNDSHEET 0x0085
+#define BIFF_SST 0x00FC
+#define BIFF_LABEL 0x0204
+#define BIFF_STRING 0x0207
+#define BIFF_TXO 0x01B6
+#define BIFF_CONTINUE 0x003C
+#define BIFF8_VERSION 0x0600
+
+#define PPT_TEXT_CHARS_ATOM 0x0FA0
+#define PPT_TEXT_BYTES_ATOM 0x0FA8
+#define PPT_CSTRING 0x0FBA
+#define PPT_CRYPT_SESSION 0x2F14
+#define PPT_CONTAINER_VERSION 0x0F
+
+// Windows-1252 characters from 0x80 to 0x9F, the rest of the code page is Latin-1
+static const uint16_t WINDOWS_1252[32] = {
+        0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+        0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+        0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+        0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+};
+
+static void appendUtf8(std::string &out, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | codePoint >> 6);
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        out += static_cast<char>(0xE0 | codePoint >> 12);
+        out += static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | codePoint >> 18);
+        out += static_cast<char>(0x80 | (codePoint >> 12 & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+// Office marks paragraphs, cells and fields with control characters. Breaks become line breaks,
+// the non-breaking hyphen a hyphen and optional hyphens are dropped, so "123-45-6789" still
+// matches. Returns 0 for characters that are left out.
+static uint32_t officeCharacter(uint32_t c) {
+    if (c >= 0x20) {
+        return c;
+    }
+    switch (c) {
+        case '\t':
+        case '\n':
+            return c;
+        case '\r':
+        case 0x0B:
+        case 0x0C:
+            return '\n';
+        case 0x07:
+            return '\t';
+        case 0x1E:
+            return '-';
+        case 0x1F:
+            return 0;
+        default:
+            return ' ';
+    }
+}
+
+OleChunkReader::OleChunkReader(const std::filesystem::path &filePath) :
+        ChunkReader(filePath), compoundFile(filePath), data(OLE_READ_SIZE) {
+    openDocument();
+}
+
+OleChunkReader::OleChunkReader(std::vector<uint8_t> fileData) :
+        compoundFile(std::move(fileData)), data(OLE_READ_SIZE) {
+    openDocument();
+}
+
+void OleChunkReader::openDocument() {
+    if ((stream = compoundFile.findStream("WordDocument"))) {
+        documentType = WORD_DOCUMENT;
+        openWordDocument();
+    } else if ((stream = compoundFile.findStream("Workbook")) || (stream = compoundFile.findStream("Book"))) {
+        documentType = EXCEL_WORKBOOK;
+    } else if ((stream = compoundFile.findStream("PowerPoint Document"))) {
+        documentType = POWERPOINT_PRESENTATION;
+    } else {
+        throw std::runtime_error("No Word, Excel or PowerPoint document in " + filePath.string());
+    }
+}
+
+void OleChunkReader::openWordDocument() {
+    char fib[WORD_FIB_SIZE] = {};
+    size_t fibSize = compoundFile.read(*stream, 0, fib, sizeof(fib));
+    if (fibSize < 0x20 || readLittleEndian16(fib) != WORD_FIB_IDENT) {
+        throw std::runtime_error("Invalid Word document: " + filePath.string());
+    }
+    uint16_t version = readLittleEndian16(fib + 0x02);
+    uint16_t flags = readLittleEndian16(fib + 0x0A);
+    if (flags & WORD_FLAG_ENCRYPTED) {
+        qWarning() << "Skipping encrypted Word document" << filePath.string();
+        return;
+    }
+
+    if (version < WORD97_FIB_VERSION) {
+        // Word 6 and 95 keep the text of documents that were not fast-saved in one 8 bit piece
+        uint32_t textStart = readLittleEndian32(fib + 0x18);
+        uint32_t textEnd = readLittleEndian32(fib + 0x1C);
+        if (flags & WORD_FLAG_COMPLEX) {
+            qWarning() << "Skipping fast-saved Word 6/95 document" << filePath.string();
+        } else if (textEnd > textStart) {
+            pieces.push_back({textStart, textEnd - textStart, 1});
+        }
+        return;
+    }
+
+    const CompoundFileEntry *table = compoundFile.findStream(flags & WORD_FLAG_TABLE_1 ? "1Table" : "0Table");
+    uint32_t clxOffset = readLittleEndian32(fib + 0x1A2);
+    uint32_t clxSize = readLittleEndian32(fib + 0x1A6);
+    if (fibSize < WORD_FIB_SIZE || !table || clxSize == 0 || clxSize > OLE_MAX_PIECE_TABLE) {
+        qWarning() << "No piece table in Word document" << filePath.string();
+        return;
+    }
+    std::vector<char> clx(clxSize);
+    if (compoundFile.read(*table, clxOffset, clx.data(), clxSize) != clxSize) {
+        qWarning() << "Truncated piece table in Word document" << filePath.string();
+        return;
+    }
+
+    // Property modifiers (0x01) come first, then the piece table (0x02): n + 1 character
+    // positions followed by n 8 byte piece descriptors
+    size_t pos = 0;
+    while (pos + 3 <= clx.size() && clx[pos] == 0x01) {
+        pos += 3 + readLittleEndian16(clx.data() + pos + 1);
+    }
+    if (pos + 5 > clx.size() || clx[pos] != 0x02) {
+        return;
+    }
+    uint32_t tableSize = readLittleEndian32(clx.data() + pos + 1);
+    pos += 5;
+    if (tableSize < 4 || tableSize > clx.size() - pos) {
+        return;
+    }
+    size_t numPieces = (tableSize - 4) / 12;
+    const char *positions = clx.data() + pos;
+    const char *descriptors = positions + 4 * (numPieces + 1);
+    for (size_t i = 0; i < numPieces; i++) {
+        uint32_t start = readLittleEndian32(positions + 4 * i);
+        uint32_t end = readLittleEndian32(positions + 4 * (i + 1));
+        if (end <= start) {
+            continue;
+        }
+        // Bit 30 of the file offset marks 8 bit text, whose offset is stored doubled
+        uint32_t fileOffset = readLittleEndian32(descriptors + 8 * i + 2);
+        bool compressed = fileOffset & 0x40000000;
+        fileOffset &= 0x3FFFFFFF;
+        uint8_t unit = compressed ? 1 : 2;
+        pieces.push_back({compressed ? fileOffset / 2 : fileOffset, static_cast<uint64_t>(end - start) * unit, unit});
+    }
+}
+
+bool OleChunkReader::readWordText() {
+    while (pieceIndex < pieces.size()) {
+        const TextPiece &piece = pieces[pieceIndex];
+        size_t size = std::min<uint64_t>(piece.size - piecePos, data.size());
+        size_t numBytesRead = compoundFile.read(*stream, piece.offset + piecePos, data.data(), size);
+        numBytesRead -= numBytesRead % piece.unit;
+        if (numBytesRead == 0) {
+            // Done with the piece, or it points past the end of the stream
+            pieceIndex++;
+            piecePos = 0;
+            continue;
+        }
+        appendText(data.data(), numBytesRead, piece.unit);
+        piecePos += numBytesRead;
+        return true;
+    }
+    return false;
+}
+
+bool OleChunkReader::readRecord() {
+    char header[4];
+    if (compoundFile.read(*stream, streamPos, header, sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+    recordType = readLittleEndian16(header);
+    record.resize(readLittleEndian16(header + 2));
+    if (compoundFile.read(*stream, streamPos + sizeof(header), record.data(), record.size()) != record.size()) {
+        return false;
+    }
+    streamPos += sizeof(header) + record.size();
+    recordPos = 0;
+    return true;
+}
+
+bool OleChunkReader::readContinue() {
+    if (!readRecord()) {
+        return false;
+    }
+    if (recordType != BIFF_CONTINUE) {
+        recordPending = true;
+        return false;
+    }
+    return true;
+}
+
+bool OleChunkReader::readRecordBytes(char *out, size_t size) {
+    while (size > 0) {
+        if (recordPos == record.size() && !readContinue()) {
+            return false;
+        }
+        size_t length = std::min(size, record.size() - recordPos);
+        std::memcpy(out, record.data() + recordPos, length);
+        recordPos += length;
+        out += length;
+        size -= length;
+    }
+    return true;
+}
+
+bool OleChunkReader::skipRecordBytes(size_t size) {
+    while (size > 0) {
+        if (recordPos == record.size() && !readContinue()) {
+            return false;
+        }
+        size_t length = std::min(size, record.size() - recordPos);
+        recordPos += length;
+        size -= length;
+    }
+    return true;
+}
+
+bool OleChunkReader::readRecordChars(size_t count, bool highBytes) {
+    while (count > 0) {
+        if (recordPos == record.size()) {
+            if (!readContinue()) {
+                return false;
+            }
+            char flags = 0;
+            if (biff8 && !readRecordBytes(&flags, 1)) {
+                return false;
+            }
+            highBytes = flags & 0x01;
+        }
+        uint8_t unit = highBytes ? 2 : 1;
+        size_t length = std::min(count, (record.size() - recordPos) / unit);
+        if (length == 0) {
+            // Half a character at the end of the record
+            recordPos = record.size();
+            continue;
+        }
+        appendText(record.data() + recordPos, length * unit, unit);
+        recordPos += length * unit;
+        count -= length;
+    }
+    return true;
+}
+
+bool OleChunkReader::readRecordString(bool shortLength) {
+    char length[2] = {};
+    char flags = 0;
+    if (!readRecordBytes(length, shortLength ? 1 : 2) || (biff8 && !readRecordBytes(&flags, 1))) {
+        return false;
+    }
+    size_t count = shortLength ? static_cast<unsigned char>(length[0]) : readLittleEndian16(length);
+    bool complete = readRecordChars(count, flags & 0x01);
+    output += '\n';
+    return complete;
+}
+
+bool OleChunkReader::readSharedString() {
+    // Character count, flags, then the number of formatting runs and the size of the phonetic
+    // data if the flags say they follow the characters
+    char header[3];
+    char extra[4];
+    if (!readRecordBytes(header, sizeof(header))) {
+        return false;
+    }
+    size_t count = readLittleEndian16(header);
+    uint8_t flags = header[2];
+    size_t skip = 0;
+    if (flags & 0x08) {
+        if (!readRecordBytes(extra, 2)) {
+            return false;
+        }
+        skip += 4 * static_cast<size_t>(readLittleEndian16(extra));
+    }
+    if (flags & 0x04) {
+        if (!readRecordBytes(extra, 4)) {
+            return false;
+        }
+        skip += readLittleEndian32(extra);
+    }
+    bool complete = readRecordChars(count, flags & 0x01);
+    output += '\n';
+    return complete && skipRecordBytes(skip);
+}
+
+bool OleChunkReader::readWorkbookText() {
+    while (true) {
+        if (sstRemaining > 0) {
+            sstRemaining--;
+            if (!readSharedString()) {
+                sstRemaining = 0;
+            }
+            return true;
+        }
+        if (recordPending) {
+            recordPending = false;
+        } else if (!readRecord()) {
+            return false;
+        }
+
+        switch (recordType) {
+            case BIFF_BOF:
+                // BIFF5 and 7 workbooks (Excel 5 and 95) have 8 bit strings without flags
+                if (record.size() >= 2) {
+                    biff8 = readLittleEndian16(record.data()) == BIFF8_VERSION;
+                }
+                break;
+            case BIFF_FILEPASS:
+                qWarning() << "Skipping encrypted Excel workbook" << filePath.string();
+                return false;
+            case BIFF_BOUNDSHEET:
+                // Sheet name after the stream position and the sheet state
+                recordPos = std::min<size_t>(6, record.size());
+                readRecordString(true);
+                return true;
+            case BIFF_SST:
+                if (record.size() >= 8) {
+                    sstRemaining = readLittleEndian32(record.data() + 4);
+                    recordPos = 8;
+                }
+                break;
+            case BIFF_LABEL:
+                // Text cell, the string follows the row, column and format
+                recordPos = std::min<size_t>(6, record.size());
+                readRecordString(false);
+                return true;
+            case BIFF_STRING:
+                // Result of the formula in the record before
+                readRecordString(false);
+                return true;
+            case BIFF_TXO:
+                // Comment or text box, its text is in the CONTINUE records that follow
+                if (biff8 && record.size() >= 12 && readLittleEndian16(record.data() + 10) > 0) {
+                    size_t count = readLittleEndian16(record.data() + 10);
+                    recordPos = record.size();
+                    readRecordChars(count, false);
+                    output += '\n';
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+bool OleChunkReader::readPresentationText() {
+    while (true) {
+        if (atomRemaining > 0) {
+            size_t size = std::min<uint64_t>(atomRemaining, data.size());
+            size_t numBytesRead = compoundFile.read(*stream, streamPos, data.data(), size);
+            numBytesRead -= numBytesRead % atomUnit;
+            if (numBytesRead == 0) {
+                return false;
+            }
+            appendText(data.data(), numBytesRead, atomUnit);
+            streamPos += numBytesRead;
+            atomRemaining -= numBytesRead;
+            if (atomRemaining < atomUnit) {
+                streamPos += atomRemaining;
+                atomRemaining = 0;
+                output += '\n';
+            }
+            return true;
+        }
+
+        char header[8];
+        if (compoundFile.read(*stream, streamPos, header, sizeof(header)) != sizeof(header)) {
+            return false;
+        }
+        streamPos += sizeof(header);
+        uint16_t version = readLittleEndian16(header) & 0x0F;
+        uint16_t type = readLittleEndian16(header + 2);
+        uint32_t length = readLittleEndian32(header + 4);
+        if (type == PPT_CRYPT_SESSION) {
+            qWarning() << "Skipping encrypted PowerPoint presentation" << filePath.string();
+            return false;
+        }
+        if (version == PPT_CONTAINER_VERSION) {
+            // The records of a container follow its header, slides, notes and shapes are all walked
+            continue;
+        }
+        if (type == PPT_TEXT_CHARS_ATOM || type == PPT_CSTRING) {
+            atomUnit = 2;
+            atomRemaining = length;
+        } else if (type == PPT_TEXT_BYTES_ATOM) {
+            atomUnit = 1;
+            atomRemaining = length;
+        } else {
+            streamPos += length;
+        }
+    }
+}
+
+void OleChunkReader::appendText(const char *text, size_t size, uint8_t unit) {
+    auto *bytes = reinterpret_cast<const unsigned char *>(text);
+    for (size_t i = 0; i + unit <= size; i += unit) {
+        uint32_t c;
+        if (unit == 1) {
+            c = bytes[i] >= 0x80 && bytes[i] < 0xA0 ? WINDOWS_1252[bytes[i] - 0x80] : bytes[i];
+        } else {
+            c = readLittleEndian16(text + i);
+            if (highSurrogate != 0) {
+                bool low = c >= 0xDC00 && c < 0xE000;
+                appendUtf8(output, low ? 0x10000 + ((highSurrogate - 0xD800u) << 10) + (c - 0xDC00) : 0xFFFD);
+                highSurrogate = 0;
+                if (low) {
+                    continue;
+                }
+            }
+            if (c >= 0xD800 && c < 0xDC00) {
+                highSurrogate = static_cast<uint16_t>(c);
+                continue;
+            } else if (c >= 0xDC00 && c < 0xE000) {
+                c = 0xFFFD;
+            }
+        }
+        c = officeCharacter(c);
+        if (c != 0) {
+            appendUtf8(output, c);
+        }
+    }
+}
+
+size_t OleChunkReader::readChunkFromFile(char *buffer, int chunkSize) {
+    while (output.size() - outputPos < static_cast<size_t>(chunkSize) && !endOfText) {
+        output.erase(0, outputPos);
+        outputPos = 0;
+        switch (documentType) {
+            case WORD_DOCUMENT:
+                endOfText = !readWordText();
+                break;
+            case EXCEL_WORKBOOK:
+                endOfText = !readWorkbookText();
+                break;
+            case POWERPOINT_PRESENTATION:
+                endOfText = !readPresentationText();
+                break;
+        }
+    }
+    size_t numBytesRead = std::min(output.size() - outputPos, static_cast<size_t>(chunkSize));
+    std::memcpy(buffer, output.data() + outputPos, numBytesRead);
+    outputPos += numBytesRead;
+    return numBytesRead;
+}
+
+// Printable ASCII and tab, the characters strings(1) keeps
+static bool isPrintable(unsigned char c) {
+    return (c >= 0x20 && c < 0x7F) || c == '\t';
+}
+
+#ifdef SDD_HAVE_SSE2
+// True if the 16 bytes at data are all printable, or all not printable
+static bool isUniformBlock(const unsigned char *data, bool printable) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    // Bytes from 0x80 up are negative as signed chars and fail the signed compare with 0x1F
+    __m128i isPrintable = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(0x1F)),
+                                        _mm_cmplt_epi8(block, _mm_set1_epi8(0x7F)));
+    isPrintable = _mm_or_si128(isPrintable, _mm_cmpeq_epi8(block, _mm_set1_epi8('\t')));
+    return _mm_movemask_epi8(isPrintable) == (printable ? 0xFFFF : 0);
+}
+#elif defined(SDD_HAVE_NEON)
+static bool isUniformBlock(const unsigned char *data, bool printable) {
+    uint8x16_t block = vld1q_u8(data);
+    uint8x16_t isPrintable = vandq_u8(vcgtq_u8(block, vdupq_n_u8(0x1F)), vcltq_u8(block, vdupq_n_u8(0x7F)));
+    isPrintable = vorrq_u8(isPrintable, vceqq_u8(block, vdupq_n_u8('\t')));
+    return printable ? vminvq_u8(isPrintable) == 0xFF : vmaxvq_u8(isPrintable) == 0;
+}
+#endif
+
+// Position of the first byte from pos on whose printability differs from the byte at pos - 1
+static size_t skipWhile(const unsigned char *data, size_t pos, size_t end, bool printable) {
+#if defined(SDD_HAVE_SSE2) || defined(SDD_HAVE_NEON)
+    while (pos + 16 <= end && isUniformBlock(data + pos, printable)) {
+        pos += 16;
+    }
+#endif
+    while (pos < end && isPrintable(data[pos]) == printable) {
+        pos++;
+    }
+    return pos;
+}
+
+void BinaryStringsChunkReader::fillData() {
+    // Keep the bytes that were not looked at yet, a UTF-16 character can straddle two reads
+    std::memmove(data.data(), data.data() + dataPos, dataEnd - dataPos);
+    dataOffset += dataPos;
+    dataEnd -= dataPos;
+    dataPos = 0;
+
+    fileStream.read(reinterpret_cast<char *>(data.data() + dataEnd), static_cast<std::streamsize>(data.size() - dataEnd));
+    if (fileStream.gcount() == 0) {
+        endOfFile = true;
+    }
+    dataEnd += fileStream.gcount();
+}
+
+void BinaryStringsChunkReader::endRun() {
+    // The rest of a run that was split is kept whatever its length
+    if (run.size() >= BINARY_MIN_STRING || (runOffset == continuationOffset && !run.empty())) {
+        runComplete = true;
+    } else {
+        run.clear();
+        runUnit = 0;
+    }
+}
+
+void BinaryStringsChunkReader::findRun() {
+    const unsigned char *bytes = data.data();
+    // The byte after each character is needed to tell UTF-16 from ASCII, unless the file ends there
+    size_t end = endOfFile ? dataEnd : dataEnd - std::min<size_t>(dataEnd, 1);
+
+    while (dataPos < end && !runComplete) {
+        if (runUnit == 0) {
+            dataPos = skipWhile(bytes, dataPos, end, false);
+            if (dataPos == end) {
+                return;
+            }
+            runUnit = dataPos + 1 < dataEnd && bytes[dataPos + 1] == 0 ? 2 : 1;
+            runOffset = dataOffset + dataPos;
+            run.clear();
+        }
+
+        if (runUnit == 1) {
+            size_t stop = std::min(skipWhile(bytes, dataPos, end, true), dataPos + BINARY_MAX_STRING - run.size());
+            run.append(reinterpret_cast<const char *>(bytes + dataPos), stop - dataPos);
+            dataPos = stop;
+        } else {
+            while (dataPos + 1 < dataEnd && run.size() < BINARY_MAX_STRING &&
+                   isPrintable(bytes[dataPos]) && bytes[dataPos + 1] == 0) {
+                run += static_cast<char>(bytes[dataPos]);
+                dataPos += 2;
+            }
+            if (dataPos + 1 >= dataEnd && !endOfFile) {
+                return; // The next read decides if the run goes on
+            }
+        }
+
+        if (run.size() >= BINARY_MAX_STRING) {
+            runComplete = true;
+            continuationOffset = runOffset + run.size() * runUnit;
+        } else if (dataPos < end) {
+            endRun();
+        }
+    }
+}
+
+bool BinaryStringsChunkReader::emitRun(char *buffer, size_t &numBytes, size_t capacity) {
+    if (numBytes + run.size() + 1 > capacity && numBytes > 0) {
+        return false;
+    }
+    // Only a buffer smaller than BINARY_MAX_STRING splits a run here
+    size_t length = std::min(run.size(), capacity - numBytes - 1);
+    map.addRun(numBytes, runOffset, runUnit, 1);
+    std::memcpy(buffer + numBytes, run.data(), length);
+    numBytes += length;
+    // The line break maps to the end of the run
+    map.addRun(numBytes, runOffset + length * runUnit, 1, 1);
+    buffer[numBytes++] = '\n';
+
+    if (length < run.size()) {
+        run.erase(0, length);
+        runOffset += length * runUnit;
+        return false;
+    }
+    run.clear();
+    runUnit = 0;
+    runComplete = false;
+    return true;
+}
+
+size_t BinaryStringsChunkReader::readChunkFromFile(char *buffer, int chunkSize) {
+    map.clear();
+    size_t numBytesRead = 0;
+    auto capacity = static_cast<size_t>(chunkSize);
+    if (capacity < 2) {
+        return 0;
+    }
+
+    while (true) {
+        if (runComplete) {
+            if (!emitRun(buffer, numBytesRead, capacity)) {
+                return numBytesRead;
+            }
+            continue;
+        }
+        if (dataPos == dataEnd && endOfFile) {
+            if (runUnit != 0) {
+                endRun();
+                continue;
+            }
+            return numBytesRead;
+        }
+        findRun();
+        if (!runComplete && !endOfFile) {
+            fillData();
+        }
+    }
+}
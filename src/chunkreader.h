@@ -1,6 +1,7 @@
 #ifndef SENSITIVE_DATA_DELETER_CHUNKREADER_H
 #define SENSITIVE_DATA_DELETER_CHUNKREADER_H
 
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <filesystem>
@@ -12,7 +13,38 @@
 #include <QMimeDatabase>
 #include <QDebug>
 
+#include "textdecoder.h"
+#include "decompressor.h"
+#include "mimedecoder.h"
+#include "compoundfile.h"
+#include "parsersandbox.h"
+
 #define UNZIP_MAX_SIZE 1024 * 1024 * 512 // 512 MB
+#define BINARY_READ_SIZE (64 * 1024)
+#define BINARY_MIN_STRING 4     // Shorter runs of printable characters are mostly noise, same as strings(1)
+#define BINARY_MAX_STRING 4096  // Longer runs are returned in pieces
+#define TAR_BLOCK_SIZE 512
+#define TAR_MAX_HEADER_DATA (1024 * 1024) // Longer GNU long names and pax headers are skipped
+#define MAIL_READ_SIZE (64 * 1024)
+#define MAIL_MAX_LINE (64 * 1024)          // Longer lines are decoded in pieces
+#define MAIL_MAX_HEADER (256 * 1024)       // Header blocks are cut off here
+#define OLE_READ_SIZE (64 * 1024)          // Bytes of document text read from the compound file at a time
+#define OLE_MAX_PIECE_TABLE (16 * 1024 * 1024)
+
+enum ChunkReaderType {
+    PLAIN_TEXT_READER,
+    PDF_READER,
+    XML_READER,
+    ZIP_READER,
+    BINARY_STRINGS_READER,
+    COMPRESSED_READER,
+    TAR_READER,
+    MAIL_READER,
+    OLE_READER,
+    NUM_READER_TYPES,
+};
+
+const char *readerTypeName(ChunkReaderType type);
 
 class ChunkReader {
 public:
@@ -20,6 +52,8 @@ public:
 
     explicit ChunkReader(const std::vector<uint8_t> &fileData) : fileData(fileData) {}
 
+    explicit ChunkReader(std::vector<uint8_t> &&fileData) : fileData(std::move(fileData)) {}
+
     ChunkReader() = default;
 
     virtual ~ChunkReader() = default;
@@ -28,6 +62,26 @@ public:
 
     virtual size_t readChunkFromVector(char *buffer, int chunkSize) { return 0; }
 
+    // Same as readChunkFromFile, but readers that already hold the text in memory point chunk at it
+    // instead of copying it to buffer. The chunk stays valid until the next call.
+    virtual size_t readChunk(const char *&chunk, char *buffer, int chunkSize) {
+        chunk = buffer;
+        return readChunkFromFile(buffer, chunkSize);
+    }
+
+    virtual ChunkReaderType readerType() const = 0;
+
+    // Readers that return UTF-8 taken from scattered parts of the file map the last chunk to file
+    // offsets themselves. Chunks of readers without a map are decoded by the scanner.
+    virtual const OffsetMap *offsetMap() const { return nullptr; }
+
+    // Container readers name the member, message or part the last chunk came from. It stays the
+    // same after the -1 that ends the member, so the text held back by the decoder is attributed to it.
+    virtual std::string currentLocation() const { return {}; }
+
+    // True if the file could not be read to the end, the chunks returned so far are incomplete
+    virtual bool extractionFailed() const { return false; }
+
 protected:
     std::filesystem::path filePath;
     std::vector<uint8_t> fileData;
@@ -49,6 +103,8 @@ public:
 
     size_t readChunkFromVector(char *buffer, int chunkSize) override;
 
+    ChunkReaderType readerType() const override { return ChunkReaderType::PLAIN_TEXT_READER; }
+
 private:
     std::ifstream fileStream;
     std::streamsize offset = 0;
@@ -63,9 +119,11 @@ public:
         }
     }
 
-    PDFChunkReader(const std::vector<uint8_t> &fileData) :
-            doc(poppler::document::load_from_raw_data(reinterpret_cast<const char *>(fileData.data()),
-                                                      fileData.size())) {
+    // Poppler does not copy raw data, the reader keeps the bytes for as long as the document is open
+    explicit PDFChunkReader(std::vector<uint8_t> &&fileData) :
+            ChunkReader(std::move(fileData)),
+            doc(poppler::document::load_from_raw_data(reinterpret_cast<const char *>(this->fileData.data()),
+                                                      this->fileData.size())) {
         if (!doc) {
             throw std::runtime_error("Failed to open PDF document from memory");
         }
@@ -77,9 +135,13 @@ public:
 
     size_t readChunkFromFile(char *buffer, int chunkSize) override;
 
+    ChunkReaderType readerType() const override { return ChunkReaderType::PDF_READER; }
+
 private:
     poppler::document *doc;
     int pageIndex = 0;
+    poppler::byte_array pageText; // Text of the page before pageIndex
+    size_t pageOffset = 0;        // Bytes of pageText already returned
 };
 
 class XMLChunkReader : public ChunkReader {
@@ -103,12 +165,16 @@ public:
     }
 
     size_t readChunkFromFile(char *buffer, int chunkSize) override;
-    size_t extractTextFromElement(tinyxml2::XMLElement *element, char *buffer, int chunkSize);
+
+    ChunkReaderType readerType() const override { return ChunkReaderType::XML_READER; }
 
 private:
     tinyxml2::XMLDocument doc;
-    tinyxml2::XMLElement *currentNode = nullptr;
-    size_t offset = 0;
+    tinyxml2::XMLElement *currentNode = nullptr; // Element whose text is returned next
+    size_t offset = 0; // Bytes of the text of currentNode already returned
+
+    // Next element in document order
+    static tinyxml2::XMLElement *nextElement(tinyxml2::XMLElement *element);
 };
 
 class ZipChunkReader : public ChunkReader {
@@ -124,6 +190,9 @@ public:
         }
     }
 
+    // Reads a zip archive held in memory, such as an archive member, through a minizip memory stream
+    explicit ZipChunkReader(std::vector<uint8_t> zipData);
+
     ~ZipChunkReader() override {
         unzClose(zipFile);
     }
@@ -132,31 +201,472 @@ public:
 
     size_t readChunkFromFile(char *buffer, int chunkSize) override;
 
+    ChunkReaderType readerType() const override { return ChunkReaderType::ZIP_READER; }
+
+    std::string currentLocation() const override { return currentFileName; }
+
 private:
     unzFile zipFile;
+    std::vector<uint8_t> zipData; // Archives read from memory, the memory stream points into it
     int fileIndex = 0;
     std::string currentFileName;
     ChunkReader *currentReader = nullptr;
 };
 
+/**
+ * Walks the headers of a tar archive, plain or compressed in any format Decompressor knows, in a
+ * single pass. Text members are streamed to the scanner chunk by chunk and dropped once their first
+ * block turns out to be binary. PDF, XML, zip (including OOXML), Office 97-2003 and compressed
+ * members up to UNZIP_MAX_SIZE are read into memory for their readers, like mail attachments.
+ * Other members are skipped without reading their data if the archive is an uncompressed file,
+ * otherwise their data is decompressed and discarded. Understands ustar, GNU long names and
+ * base-256 sizes, and pax path and size records. A corrupt header, a truncated archive or a member
+ * that could not be read to the end sets extractionFailed().
+ */
+class TarChunkReader : public ChunkReader {
+public:
+    explicit TarChunkReader(const std::filesystem::path &filePath);
+
+    size_t readChunkFromFile(char *buffer, int chunkSize) override;
+
+    ChunkReaderType readerType() const override { return ChunkReaderType::TAR_READER; }
+
+    std::string currentLocation() const override { return location; }
+
+    bool extractionFailed() const override { return failed || (decompressor && decompressor->hasFailed()); }
+
+private:
+    std::ifstream fileStream;                  // Uncompressed archives, can seek over members
+    uint64_t fileSize = 0;
+    std::unique_ptr<Decompressor> decompressor; // Compressed archives
+    std::vector<char> skipBuffer;
+
+    std::string memberName;
+    std::string location;         // Member name, and the location inside it for zip members
+    uint64_t memberRemaining = 0; // Data of the current member that was not read yet
+    uint64_t memberPadding = 0;   // Zero bytes up to the next header
+    bool streamingMember = false;
+    bool memberStarted = false;   // The first chunk of the streamed member was returned
+    bool endOfArchive = false;
+    bool failed = false;
+    std::unique_ptr<ChunkReader> currentReader;
+
+    size_t readInput(char *buffer, size_t size);
+
+    void skipInput(uint64_t size);
+
+    bool readHeaderData(uint64_t size, std::string &data);
+
+    // Moves to the next member that can be scanned, false at the end of the archive
+    bool nextMember();
+
+    bool openMember(uint64_t size);
+};
+
+/**
+ * Streams the messages of an mbox file, or the single message of an .eml file, part by part.
+ * Message headers and text parts are decoded from base64 or quoted-printable and returned as text,
+ * PDF, XML, zip, Office 97-2003 and compressed attachments up to UNZIP_MAX_SIZE are decoded into
+ * memory and read by their own readers, without writing them to disk. Other parts are skipped without decoding them. Every header block and
+ * part ends with -1, and currentLocation() names the message by number and Message-ID and the part
+ * by its MIME part number (1, 2.1, ...) and file name.
+ */
+class MailChunkReader : public ChunkReader {
+public:
+    explicit MailChunkReader(const std::filesystem::path &filePath);
+
+    size_t readChunkFromFile(char *buffer, int chunkSize) override;
+
+    ChunkReaderType readerType() const override { return ChunkReaderType::MAIL_READER; }
+
+    std::string currentLocation() const override { return location; }
+
+private:
+    enum ParseState {
+        MESSAGE_HEADERS,
+        PART_HEADERS,
+        PART_BODY,
+    };
+
+    enum PartHandling {
+        SKIP_PART,
+        TEXT_PART,
+        ATTACHMENT_PART,
+    };
+
+    enum TransferEncoding {
+        PLAIN_ENCODING,
+        BASE64_ENCODING,
+        QUOTED_PRINTABLE_ENCODING,
+    };
+
+    std::ifstream fileStream;
+    std::vector<char> input;
+    size_t inputPos = 0;
+    size_t inputEnd = 0;
+    bool endOfInput = false; // The last line was parsed
+    bool atLineStart = true;
+    bool previousLineBlank = true; // mbox messages start with a "From " line after a blank line
+    bool mbox = false;
+
+    ParseState state = MESSAGE_HEADERS;
+    std::string headerBlock;                 // Unfolded header lines, separated by '\n'
+    std::vector<std::string> boundaries;     // Of the enclosing multiparts, innermost last
+    std::vector<int> partNumbers;            // Number of the current part in each multipart
+    int messageNumber = 0;
+    std::string messageId;
+
+    PartHandling handling = SKIP_PART;
+    TransferEncoding encoding = PLAIN_ENCODING;
+    std::string partLocation;
+    Base64Decoder base64;
+    QuotedPrintableDecoder quotedPrintable;
+    std::vector<uint8_t> attachment;
+    bool attachmentTooLarge = false;
+
+    std::string output;      // Decoded text of the current header block or part
+    size_t outputPos = 0;
+    std::string outputLocation;
+    bool partEnded = false;  // The text in output is the last of its part
+    bool partReturned = false;
+    std::string location;
+
+    std::unique_ptr<ChunkReader> currentReader; // Attachment being read
+
+    // Reads up to MAIL_MAX_LINE bytes of the next line, complete is false if the line goes on
+    bool readLine(std::string &line, bool &complete);
+
+    // Parses the next line, sets endOfInput at the end of the file
+    void parseLine();
+
+    void startMessage();
+
+    void parseHeaders();
+
+    void decodeBody(const std::string &line, bool complete);
+
+    template<class Buffer>
+    void appendDecoded(Buffer &target, const char *data, size_t size, bool lineEnd);
+
+    // Flushes the decoders and opens the reader of an attachment
+    void endPart();
+
+    void openAttachment();
+
+    std::string messageLocation() const;
+};
+
+/**
+ * Text of Word, Excel and PowerPoint files in the binary formats of Office 97 to 2003, read from
+ * their compound file without extracting it. For a .doc the pieces listed in the piece table are
+ * read from the WordDocument stream, for an .xls the shared strings, labels, string formula results,
+ * comments and sheet names are taken from the BIFF records of the workbook stream, and for a .ppt
+ * the text atoms of the PowerPoint Document stream are returned. At most one record or
+ * OLE_READ_SIZE bytes of text are held at a time. Encrypted documents are skipped with a warning.
+ */
+class OleChunkReader : public ChunkReader {
+public:
+    explicit OleChunkReader(const std::filesystem::path &filePath);
+
+    // Compound file held in memory, such as a mail attachment or an archive member
+    explicit OleChunkReader(std::vector<uint8_t> fileData);
+
+    size_t readChunkFromFile(char *buffer, int chunkSize) override;
+
+    ChunkReaderType readerType() const override { return ChunkReaderType::OLE_READER; }
+
+private:
+    enum DocumentType {
+        WORD_DOCUMENT,
+        EXCEL_WORKBOOK,
+        POWERPOINT_PRESENTATION,
+    };
+
+    // Text of a .doc that is stored in one piece, 1 or 2 bytes per character
+    struct TextPiece {
+        uint64_t offset;
+        uint64_t size;
+        uint8_t unit;
+    };
+
+    CompoundFile compoundFile;
+    const CompoundFileEntry *stream = nullptr; // The stream the text is read from
+    DocumentType documentType;
+    uint64_t streamPos = 0;
+    bool endOfText = false;
+    std::vector<char> data;
+    std::string output;
+    size_t outputPos = 0;
+    uint16_t highSurrogate = 0; // Of a UTF-16 pair split between two reads
+
+    std::vector<TextPiece> pieces;
+    size_t pieceIndex = 0;
+    uint64_t piecePos = 0;
+
+    uint64_t atomRemaining = 0; // Bytes of the PowerPoint text atom not returned yet
+    uint8_t atomUnit = 0;
+
+    std::vector<char> record;   // Data of the current BIFF record
+    uint16_t recordType = 0;
+    size_t recordPos = 0;
+    bool recordPending = false; // The record was read while looking for a CONTINUE and is handled next
+    bool biff8 = true;
+    uint32_t sstRemaining = 0;  // Strings of the shared string table not read yet
+
+    // Finds the document stream, throws std::runtime_error if there is none
+    void openDocument();
+
+    void openWordDocument();
+
+    // Each adds the next bit of text to output, false at the end of the document
+    bool readWordText();
+
+    bool readWorkbookText();
+
+    bool readPresentationText();
+
+    bool readRecord();
+
+    // Reads the next record if it is a CONTINUE record, otherwise leaves it pending
+    bool readContinue();
+
+    // Record data, continued in the CONTINUE records that follow
+    bool readRecordBytes(char *out, size_t size);
+
+    bool skipRecordBytes(size_t size);
+
+    // Characters of a BIFF string, a CONTINUE record repeats the flag that says if they are 8 or 16 bit
+    bool readRecordChars(size_t count, bool highBytes);
+
+    // A string with a 16 bit (XLUnicodeString) or 8 bit (ShortXLUnicodeString) length
+    bool readRecordString(bool shortLength);
+
+    bool readSharedString();
+
+    // Converts Windows-1252 (unit 1) or UTF-16LE (unit 2) to UTF-8, Office's paragraph and cell marks to line breaks and tabs
+    void appendText(const char *text, size_t size, uint8_t unit);
+};
+
+/**
+ * Extracts the runs of printable ASCII and UTF-16LE text from a file of any format, like strings(1).
+ * Each run is returned on a line of its own, UTF-16 runs converted to ASCII, and offsetMap() maps
+ * every returned byte back to where it was found in the file.
+ */
+class BinaryStringsChunkReader : public ChunkReader {
+public:
+    explicit BinaryStringsChunkReader(const std::filesystem::path &filePath) :
+            ChunkReader(filePath), fileStream(filePath, std::ios::binary), data(BINARY_READ_SIZE) {
+        if (!fileStream.is_open()) {
+            throw std::runtime_error("Failed to open file: " + filePath.string());
+        }
+    }
+
+    size_t readChunkFromFile(char *buffer, int chunkSize) override;
+
+    ChunkReaderType readerType() const override { return ChunkReaderType::BINARY_STRINGS_READER; }
+
+    const OffsetMap *offsetMap() const override { return &map; }
+
+private:
+    std::ifstream fileStream;
+    std::vector<unsigned char> data;
+    size_t dataPos = 0;      // Next byte of data to look at
+    size_t dataEnd = 0;
+    uint64_t dataOffset = 0; // File offset of data[0]
+    bool endOfFile = false;
+
+    std::string run;         // Characters of the run being collected
+    uint64_t runOffset = 0;  // File offset of the first character of run
+    uint8_t runUnit = 0;     // Bytes per character in the file, 1 for ASCII, 2 for UTF-16, 0 outside a run
+    bool runComplete = false;
+    uint64_t continuationOffset = UINT64_MAX; // File offset of the rest of a run that was split at BINARY_MAX_STRING
+    OffsetMap map;
+
+    void fillData();
+
+    // Scans data until a run is complete or more data is needed
+    void findRun();
+
+    void endRun();
+
+    // Copies the run to the buffer, false if the buffer is full
+    bool emitRun(char *buffer, size_t &numBytes, size_t capacity);
+};
+
+/**
+ * Text compressed in a single-file format: gzip, bzip2, xz or zstd. The decompressed bytes are
+ * returned like those of a plaintext file, so match offsets are offsets in the decompressed text.
+ */
+class CompressedChunkReader : public ChunkReader {
+public:
+    explicit CompressedChunkReader(const std::filesystem::path &filePath) :
+            ChunkReader(filePath), decompressor(Decompressor::open(filePath)) {
+        if (!decompressor) {
+            throw std::runtime_error("Unknown compression format: " + filePath.string());
+        }
+    }
+
+    size_t readChunkFromFile(char *buffer, int chunkSize) override;
+
+    // Compressed data held in memory, such as an archive member
+    explicit CompressedChunkReader(std::vector<uint8_t> compressedData) :
+            decompressor(Decompressor::open(std::move(compressedData))) {
+        if (!decompressor) {
+            throw std::runtime_error("Unknown compression format");
+        }
+    }
+
+    ChunkReaderType readerType() const override { return ChunkReaderType::COMPRESSED_READER; }
+
+    bool extractionFailed() const override { return decompressor->hasFailed(); }
+
+private:
+    std::unique_ptr<Decompressor> decompressor;
+};
+
+/**
+ * Runs the reader of a PDF, XML or container file in a helper process of a ParserPool and returns the text
+ * the helper writes to the shared memory it has with the scanner, without copying it. A crash, an
+ * error or a timeout of the helper ends the file with extractionFailed() set.
+ */
+class SandboxedChunkReader : public ChunkReader {
+public:
+    // Throws std::runtime_error if no helper could be started
+    SandboxedChunkReader(ParserPool &pool, const std::filesystem::path &filePath, ChunkReaderType type);
+
+    ~SandboxedChunkReader() override;
+
+    // Readers of the formats whose parsers are large enough to be worth isolating. Containers are
+    // included, their members go through createReader() and may be any of the other formats.
+    static bool isSandboxed(ChunkReaderType type) {
+        return type == PDF_READER || type == ZIP_READER || type == XML_READER || type == TAR_READER ||
+               type == MAIL_READER || type == OLE_READER || type == COMPRESSED_READER;
+    }
+
+    size_t readChunkFromFile(char *buffer, int chunkSize) override;
+
+    size_t readChunk(const char *&chunk, char *buffer, int chunkSize) override;
+
+    ChunkReaderType readerType() const override { return type; }
+
+    std::string currentLocation() const override { return location; }
+
+    bool extractionFailed() const override { return failed; }
+
+private:
+    ParserPool &pool;
+    std::unique_ptr<ParserHelper> helper; // Released to the pool once the file is done
+    ChunkReaderType type;
+    std::string location;
+    const char *slotData = nullptr; // Text of the slot being returned
+    size_t slotSize = 0;
+    size_t slotOffset = 0;
+    bool holdingSlot = false;
+    bool failed = false;
+
+    void fail(const std::string &reason);
+};
+
 class ChunkReaderFactory {
 public:
-    static ChunkReader *createReader(const std::filesystem::path &filePath) {
-        QMimeType mimeType = QMimeDatabase().mimeTypeForFile(QString::fromStdString(filePath.generic_string()));
+    static bool isCompressed(const QMimeType &mimeType) {
+        return mimeType.inherits("application/gzip") || mimeType.inherits("application/x-bzip2") ||
+               mimeType.inherits("application/x-xz") || mimeType.inherits("application/zstd");
+    }
+
+    // Plain and compressed tarballs, the compressed ones also count as compressed
+    static bool isTar(const QMimeType &mimeType) {
+        return mimeType.inherits("application/x-tar") || mimeType.inherits("application/x-compressed-tar") ||
+               mimeType.inherits("application/x-bzip-compressed-tar") ||
+               mimeType.inherits("application/x-bzip2-compressed-tar") ||
+               mimeType.inherits("application/x-xz-compressed-tar") ||
+               mimeType.inherits("application/x-zstd-compressed-tar");
+    }
+
+    // Both count as text/plain as well, so they have to be checked first
+    static bool isMail(const QMimeType &mimeType) {
+        return mimeType.inherits("message/rfc822") || mimeType.inherits("application/mbox");
+    }
+
+    // Word, Excel and PowerPoint files of Office 97 to 2003
+    static bool isOle(const QMimeType &mimeType) {
+        return mimeType.inherits("application/msword") || mimeType.inherits("application/vnd.ms-excel") ||
+               mimeType.inherits("application/vnd.ms-powerpoint");
+    }
+
+    // The reader createReader() picks for a file of this type, NUM_READER_TYPES if there is none.
+    // Binary strings are never picked, files are only searched for them by configuration.
+    static ChunkReaderType readerTypeFor(const QMimeType &mimeType) {
         if (mimeType.inherits("application/pdf")) {
-            return new PDFChunkReader(filePath);
+            return PDF_READER;
         } else if (mimeType.inherits("application/zip")) {
-            return new ZipChunkReader(filePath);
+            return ZIP_READER;
+        } else if (isTar(mimeType)) {
+            return TAR_READER;
+        } else if (isMail(mimeType)) {
+            return MAIL_READER;
+        } else if (isOle(mimeType)) {
+            return OLE_READER;
+        } else if (isCompressed(mimeType)) {
+            return COMPRESSED_READER;
         } else if (mimeType.inherits("application/xml")) {
-            return new XMLChunkReader(filePath);
+            return XML_READER;
         } else if (mimeType.inherits("text/plain")) {
-            return new PlainTextChunkReader(filePath);
+            return PLAIN_TEXT_READER;
         } else {
+            return NUM_READER_TYPES;
+        }
+    }
+
+    static ChunkReader *createReader(const std::filesystem::path &filePath, ChunkReaderType type) {
+        switch (type) {
+            case PDF_READER:
+                return new PDFChunkReader(filePath);
+            case ZIP_READER:
+                return new ZipChunkReader(filePath);
+            case TAR_READER:
+                return new TarChunkReader(filePath);
+            case MAIL_READER:
+                return new MailChunkReader(filePath);
+            case OLE_READER:
+                return new OleChunkReader(filePath);
+            case COMPRESSED_READER:
+                return new CompressedChunkReader(filePath);
+            case XML_READER:
+                return new XMLChunkReader(filePath);
+            case PLAIN_TEXT_READER:
+                return new PlainTextChunkReader(filePath);
+            case BINARY_STRINGS_READER:
+                return new BinaryStringsChunkReader(filePath);
+            default:
+                return nullptr;
+        }
+    }
+
+    static ChunkReader *createReader(const std::filesystem::path &filePath) {
+        QMimeType mimeType = QMimeDatabase().mimeTypeForFile(QString::fromStdString(filePath.generic_string()));
+        return createReader(filePath, readerTypeFor(mimeType));
+    }
+
+    // Reader of a file that was taken out of a tar archive or a mail. Zip, which covers OOXML,
+    // Office 97-2003 and compressed files are recognized by their magic bytes, everything else goes
+    // to createReader(). The readers of zip members only use createReader(), so nesting stops there.
+    static ChunkReader *createEmbeddedReader(std::vector<uint8_t> fileData) {
+        if (fileData.size() > UNZIP_MAX_SIZE) {
             return nullptr;
         }
+        if (fileData.size() >= 4 && std::memcmp(fileData.data(), "PK\x03\x04", 4) == 0) {
+            return new ZipChunkReader(std::move(fileData));
+        } else if (fileData.size() >= 8 && std::memcmp(fileData.data(), "\xD0\xCF\x11\xE0\xA1\xB1\x1A\xE1", 8) == 0) {
+            return new OleChunkReader(std::move(fileData));
+        } else if (detectCompressionFormat(fileData.data(), fileData.size()) != NO_COMPRESSION) {
+            return new CompressedChunkReader(std::move(fileData));
+        }
+        return createReader(std::move(fileData));
     }
 
-    static ChunkReader *createReader(const std::vector<uint8_t> &fileData) {
+    // Takes the bytes, the reader keeps them while it is read
+    static ChunkReader *createReader(std::vector<uint8_t> &&fileData) {
         if (fileData.size() > UNZIP_MAX_SIZE) {
             return nullptr;
         }
@@ -164,7 +674,7 @@ public:
                 QByteArray(reinterpret_cast<const char *>(fileData.data()), fileData.size()));
 
         if (mimeType.inherits("application/pdf")) {
-            return new PDFChunkReader(fileData);
+            return new PDFChunkReader(std::move(fileData));
         } else if (mimeType.inherits("application/xml")) {
             return new XMLChunkReader(fileData);
         } else if (mimeType.inherits("text/plain")) {
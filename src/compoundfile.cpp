@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+#include "compoundfile.h"
+
+#define CFB_MAX_REGULAR_SECTOR 0xFFFFFFFAu // Higher numbers mark free sectors and the end of a chain
+#define CFB_HEADER_FAT_SECTORS 109         // FAT sectors listed in the header, the rest are in DIFAT sectors
+#define CFB_NO_ENTRY 0xFFFFFFFFu
+
+static const unsigned char CFB_SIGNATURE[8] = {0xD0, 0xCF, 0x11, 0xE0, 0xA1, 0xB1, 0x1A, 0xE1};
+
+CompoundFile::CompoundFile(const std::filesystem::path &filePath) : file(filePath, std::ios::binary) {
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + filePath.string());
+    }
+    fileSize = std::filesystem::file_size(filePath);
+    readHeader(filePath.string());
+}
+
+CompoundFile::CompoundFile(std::vector<uint8_t> data) : data(std::move(data)) {
+    fileSize = this->data.size();
+    readHeader("embedded file");
+}
+
+void CompoundFile::readHeader(const std::string &name) {
+    char header[CFB_HEADER_SIZE];
+    if (!readAt(0, header, CFB_HEADER_SIZE) || std::memcmp(header, CFB_SIGNATURE, sizeof(CFB_SIGNATURE)) != 0) {
+        throw std::runtime_error("Not a compound file: " + name);
+    }
+
+    // Version 3 files have 512 byte sectors, version 4 files 4096 byte sectors
+    sectorShift = readLittleEndian16(header + 0x1E);
+    miniSectorShift = readLittleEndian16(header + 0x20);
+    if ((sectorShift != 9 && sectorShift != 12) || miniSectorShift != 6) {
+        throw std::runtime_error("Unsupported compound file sector size: " + name);
+    }
+    sectorSize = 1u << sectorShift;
+    maxSectors = fileSize >> sectorShift;
+    uint32_t numFatSectors = readLittleEndian32(header + 0x2C);
+    uint32_t firstDirectorySector = readLittleEndian32(header + 0x30);
+    miniStreamCutoff = readLittleEndian32(header + 0x38);
+    firstMiniFatSector = readLittleEndian32(header + 0x3C);
+    uint32_t difatSector = readLittleEndian32(header + 0x44);
+    if (numFatSectors > maxSectors) {
+        throw std::runtime_error("Corrupt compound file header: " + name);
+    }
+
+    // The FAT sectors are listed in the header, then in a chain of DIFAT sectors whose last
+    // entry points to the next one
+    for (int i = 0; i < CFB_HEADER_FAT_SECTORS && fatSectors.size() < numFatSectors; i++) {
+        fatSectors.push_back(readLittleEndian32(header + 0x4C + 4 * i));
+    }
+    std::vector<char> difat(sectorSize);
+    uint32_t entriesPerSector = sectorSize / 4 - 1;
+    for (uint64_t steps = 0; fatSectors.size() < numFatSectors && difatSector <= CFB_MAX_REGULAR_SECTOR &&
+                             steps < maxSectors; steps++) {
+        if (!readSector(difatSector, difat.data(), 0, sectorSize)) {
+            break;
+        }
+        for (uint32_t i = 0; i < entriesPerSector && fatSectors.size() < numFatSectors; i++) {
+            fatSectors.push_back(readLittleEndian32(difat.data() + 4 * i));
+        }
+        difatSector = readLittleEndian32(difat.data() + 4 * entriesPerSector);
+    }
+
+    readDirectory(firstDirectorySector);
+    if (entries.empty() || entries[0].type != CFB_ROOT_ENTRY) {
+        throw std::runtime_error("Compound file without a root entry: " + name);
+    }
+}
+
+bool CompoundFile::readSector(uint32_t sector, char *out, size_t offset, size_t size) {
+    // The header takes up the first sector
+    uint64_t position = (static_cast<uint64_t>(sector) + 1) << sectorShift;
+    if (sector > CFB_MAX_REGULAR_SECTOR) {
+        return false;
+    }
+    return readAt(position + offset, out, size);
+}
+
+bool CompoundFile::readAt(uint64_t position, char *out, size_t size) {
+    if (position + size > fileSize) {
+        return false;
+    }
+    if (!file.is_open()) {
+        std::memcpy(out, data.data() + position, size);
+        return true;
+    }
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(position));
+    file.read(out, static_cast<std::streamsize>(size));
+    return static_cast<size_t>(file.gcount()) == size;
+}
+
+uint32_t CompoundFile::nextSector(uint32_t sector) {
+    uint32_t entriesPerSector = sectorSize / 4;
+    uint32_t index = sector / entriesPerSector;
+    if (index >= fatSectors.size()) {
+        return UINT32_MAX;
+    }
+    if (index != fatCacheIndex) {
+        fatCache.resize(sectorSize);
+        if (!readSector(fatSectors[index], fatCache.data(), 0, sectorSize)) {
+            fatCacheIndex = UINT32_MAX;
+            return UINT32_MAX;
+        }
+        fatCacheIndex = index;
+    }
+    return readLittleEndian32(fatCache.data() + 4 * (sector % entriesPerSector));
+}
+
+uint32_t CompoundFile::nextMiniSector(uint32_t sector) {
+    // The miniFAT is a chain of regular sectors itself
+    uint32_t entriesPerSector = sectorSize / 4;
+    uint64_t index = sector / entriesPerSector;
+    if (index != miniFatCacheIndex) {
+        uint32_t miniFatSector = chainSector(miniFatCursor, firstMiniFatSector, index, false);
+        miniFatCache.resize(sectorSize);
+        if (!readSector(miniFatSector, miniFatCache.data(), 0, sectorSize)) {
+            miniFatCacheIndex = UINT64_MAX;
+            return UINT32_MAX;
+        }
+        miniFatCacheIndex = index;
+    }
+    return readLittleEndian32(miniFatCache.data() + 4 * (sector % entriesPerSector));
+}
+
+uint32_t CompoundFile::chainSector(ChainCursor &cursor, uint32_t startSector, uint64_t index, bool mini) {
+    if (cursor.startSector != startSector || cursor.mini != mini || cursor.index > index) {
+        cursor.startSector = startSector;
+        cursor.mini = mini;
+        cursor.index = 0;
+        cursor.sector = startSector;
+    }
+    // A chain longer than the file has sectors runs in a circle
+    if (index > maxSectors << (mini ? sectorShift - miniSectorShift : 0)) {
+        return UINT32_MAX;
+    }
+    while (cursor.index < index && cursor.sector <= CFB_MAX_REGULAR_SECTOR) {
+        cursor.sector = mini ? nextMiniSector(cursor.sector) : nextSector(cursor.sector);
+        cursor.index++;
+    }
+    return cursor.sector <= CFB_MAX_REGULAR_SECTOR ? cursor.sector : UINT32_MAX;
+}
+
+void CompoundFile::readDirectory(uint32_t firstSector) {
+    std::vector<char> sector(sectorSize);
+    uint32_t current = firstSector;
+    for (uint64_t steps = 0; current <= CFB_MAX_REGULAR_SECTOR && steps < maxSectors &&
+                             entries.size() < CFB_MAX_DIRECTORY_ENTRIES; steps++) {
+        if (!readSector(current, sector.data(), 0, sectorSize)) {
+            break;
+        }
+        for (size_t offset = 0; offset + CFB_DIRECTORY_ENTRY_SIZE <= sectorSize; offset += CFB_DIRECTORY_ENTRY_SIZE) {
+            const char *data = sector.data() + offset;
+            CompoundFileEntry entry;
+            // UTF-16 name, the length in bytes includes the terminating NUL
+            size_t nameLength = std::min<size_t>(readLittleEndian16(data + 0x40), 64) / 2;
+            for (size_t i = 0; i + 1 < nameLength; i++) {
+                uint16_t c = readLittleEndian16(data + 2 * i);
+                entry.name += c < 0x80 ? static_cast<char>(c) : '?';
+            }
+            entry.type = static_cast<uint8_t>(data[0x42]);
+            entry.leftSibling = readLittleEndian32(data + 0x44);
+            entry.rightSibling = readLittleEndian32(data + 0x48);
+            entry.child = readLittleEndian32(data + 0x4C);
+            entry.startSector = readLittleEndian32(data + 0x74);
+            entry.size = readLittleEndian64(data + 0x78);
+            // Version 3 files may leave garbage in the high half of the size
+            if (sectorShift == 9) {
+                entry.size &= UINT32_MAX;
+            }
+            entries.push_back(entry);
+        }
+        current = nextSector(current);
+    }
+}
+
+const CompoundFileEntry *CompoundFile::findStream(const std::string &name) const {
+    auto equalsIgnoreCase = [](const std::string &a, const std::string &b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    };
+    // The entries of a storage form a tree through their siblings, its root is the storage's child.
+    // Streams of embedded documents are further down and are not found.
+    std::vector<uint32_t> pending = {entries[0].child};
+    size_t visited = 0;
+    while (!pending.empty() && visited++ < entries.size()) {
+        uint32_t id = pending.back();
+        pending.pop_back();
+        if (id == CFB_NO_ENTRY || id >= entries.size()) {
+            continue;
+        }
+        const CompoundFileEntry &entry = entries[id];
+        if (entry.type == CFB_STREAM_ENTRY && equalsIgnoreCase(entry.name, name)) {
+            return &entry;
+        }
+        pending.push_back(entry.leftSibling);
+        pending.push_back(entry.rightSibling);
+    }
+    return nullptr;
+}
+
+size_t CompoundFile::read(const CompoundFileEntry &entry, uint64_t offset, char *out, size_t size) {
+    if (offset >= entry.size) {
+        return 0;
+    }
+    size = static_cast<size_t>(std::min<uint64_t>(size, entry.size - offset));
+    bool inMiniStream = entry.size < miniStreamCutoff && entry.type != CFB_ROOT_ENTRY;
+    uint32_t unitShift = inMiniStream ? miniSectorShift : sectorShift;
+    uint32_t unitSize = 1u << unitShift;
+
+    size_t numBytesRead = 0;
+    while (numBytesRead < size) {
+        uint64_t position = offset + numBytesRead;
+        uint32_t sector = chainSector(streamCursor, entry.startSector, position >> unitShift, inMiniStream);
+        if (sector == UINT32_MAX) {
+            break;
+        }
+        size_t inSector = position & (unitSize - 1);
+        size_t length = std::min<size_t>(unitSize - inSector, size - numBytesRead);
+
+        if (inMiniStream) {
+            // Mini sectors are 64 byte pieces of the stream of the root entry
+            uint64_t miniPosition = (static_cast<uint64_t>(sector) << miniSectorShift) + inSector;
+            uint32_t rootSector = chainSector(miniStreamCursor, entries[0].startSector, miniPosition >> sectorShift,
+                                              false);
+            if (!readSector(rootSector, out + numBytesRead, miniPosition & (sectorSize - 1), length)) {
+                break;
+            }
+        } else {
+            // Sectors that follow each other in the file are read at once
+            uint32_t last = sector;
+            while (numBytesRead + length < size) {
+                uint32_t next = chainSector(streamCursor, entry.startSector, streamCursor.index + 1, false);
+                if (next != last + 1) {
+                    break;
+                }
+                last = next;
+                length = std::min<size_t>(length + sectorSize, size - numBytesRead);
+            }
+            if (!readSector(sector, out + numBytesRead, inSector, length)) {
+                break;
+            }
+        }
+        numBytesRead += length;
+    }
+    return numBytesRead;
+}
@@ -0,0 +1,116 @@
+#ifndef SENSITIVE_DATA_DELETER_COMPOUNDFILE_H
+#define SENSITIVE_DATA_DELETER_COMPOUNDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define CFB_HEADER_SIZE 512
+#define CFB_DIRECTORY_ENTRY_SIZE 128
+#define CFB_MAX_DIRECTORY_ENTRIES (64 * 1024) // Far more than Office writes, bounds a corrupt directory chain
+
+inline uint16_t readLittleEndian16(const char *data) {
+    auto *bytes = reinterpret_cast<const unsigned char *>(data);
+    return static_cast<uint16_t>(bytes[0] | bytes[1] << 8);
+}
+
+inline uint32_t readLittleEndian32(const char *data) {
+    return readLittleEndian16(data) | static_cast<uint32_t>(readLittleEndian16(data + 2)) << 16;
+}
+
+inline uint64_t readLittleEndian64(const char *data) {
+    return readLittleEndian32(data) | static_cast<uint64_t>(readLittleEndian32(data + 4)) << 32;
+}
+
+enum CompoundFileEntryType {
+    CFB_EMPTY_ENTRY = 0,
+    CFB_STORAGE_ENTRY = 1,
+    CFB_STREAM_ENTRY = 2,
+    CFB_ROOT_ENTRY = 5,
+};
+
+struct CompoundFileEntry {
+    std::string name;    // Characters outside ASCII are replaced by '?', Office stream names have none
+    uint8_t type = CFB_EMPTY_ENTRY;
+    uint32_t leftSibling = 0;
+    uint32_t rightSibling = 0;
+    uint32_t child = 0;
+    uint32_t startSector = 0;
+    uint64_t size = 0;
+};
+
+/**
+ * Reads streams out of a Compound File Binary (OLE2) container, the format of .doc, .xls and .ppt
+ * files up to Office 2003. Opening the file reads the header, the list of FAT sectors and the
+ * directory. FAT and miniFAT sectors are read when a sector chain runs through them and only the
+ * last one of each is kept, stream data is read from the file as it is asked for. Sequential reads
+ * continue the chain walk where the previous one stopped, so a stream is read in linear time.
+ */
+class CompoundFile {
+public:
+    // Throws std::runtime_error if the file cannot be opened or has no valid CFB header
+    explicit CompoundFile(const std::filesystem::path &filePath);
+
+    // Same for a compound file held in memory, such as a decoded mail attachment
+    explicit CompoundFile(std::vector<uint8_t> data);
+
+    // Stream in the root storage, names are compared case-insensitively like CFB does.
+    // Returns nullptr if there is none.
+    const CompoundFileEntry *findStream(const std::string &name) const;
+
+    // Reads up to size bytes of the stream from offset on. Returns fewer at the end of the stream
+    // or where its sector chain is broken.
+    size_t read(const CompoundFileEntry &entry, uint64_t offset, char *out, size_t size);
+
+private:
+    // Position reached by the last walk along a sector chain
+    struct ChainCursor {
+        uint32_t startSector = UINT32_MAX;
+        bool mini = false;
+        uint64_t index = 0;
+        uint32_t sector = 0;
+    };
+
+    std::ifstream file;      // Not open if the compound file is held in data
+    std::vector<uint8_t> data;
+    uint64_t fileSize = 0;
+    uint32_t sectorShift = 9;
+    uint32_t sectorSize = 512;
+    uint32_t miniSectorShift = 6;
+    uint32_t miniStreamCutoff = 4096;
+    uint32_t firstMiniFatSector = 0;
+    uint64_t maxSectors = 0; // Longest chain the file has room for, longer ones loop
+    std::vector<uint32_t> fatSectors;
+    std::vector<CompoundFileEntry> entries;
+
+    std::vector<char> fatCache;
+    uint32_t fatCacheIndex = UINT32_MAX;
+    std::vector<char> miniFatCache;
+    uint64_t miniFatCacheIndex = UINT64_MAX;
+
+    ChainCursor streamCursor;
+    ChainCursor miniStreamCursor; // Along the chain of the root entry, which holds the mini stream
+    ChainCursor miniFatCursor;
+
+    // Checks the signature and reads the FAT sector list and the directory, name is used in errors
+    void readHeader(const std::string &name);
+
+    bool readSector(uint32_t sector, char *out, size_t offset, size_t size);
+
+    bool readAt(uint64_t position, char *out, size_t size);
+
+    // Next sector of a chain in the FAT or the miniFAT, UINT32_MAX if it cannot be read
+    uint32_t nextSector(uint32_t sector);
+
+    uint32_t nextMiniSector(uint32_t sector);
+
+    // Sector number of the index-th sector of the chain, UINT32_MAX if the chain is shorter
+    uint32_t chainSector(ChainCursor &cursor, uint32_t startSector, uint64_t index, bool mini);
+
+    void readDirectory(uint32_t firstSector);
+};
+
+#endif //SENSITIVE_DATA_DELETER_COMPOUNDFILE_H
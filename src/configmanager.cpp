@@ -2,6 +2,7 @@
 // Created by Olaf Seisler on 03.03.2024.
 //
 
+#include <algorithm>
 #include <QFile>
 #include <QDebug>
 #include <QString>
@@ -10,9 +11,10 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QDialog>
-#include <regex>
 
 #include "configmanager.h"
+#include "filescanner.h"
+#include "validators.h"
 
 
 void showProblemDialog(const QString &title, const QString &message) {
@@ -72,6 +74,10 @@ ConfigManager::~ConfigManager() = default;
 void ConfigManager::loadConfigFromFile(QString &path) {
     this->scanPatterns.clear();
     this->fileTypes.clear();
+    this->patternValidators.clear();
+    this->patternSomHorizons.clear();
+    this->fileTypeScanModes.clear();
+    this->scanSettings = QJsonObject();
     // Open the .json config and read it into memory
     QFile file(path);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -91,6 +97,7 @@ void ConfigManager::loadConfigFromFile(QString &path) {
     QJsonObject rootObj = jsonDocument.object();
     QJsonValue newFileTypes = rootObj["fileTypes"];
     QJsonValue newScanPatterns = rootObj["scanPatterns"];
+    this->scanSettings = rootObj["scanSettings"].toObject();
 
     if (newFileTypes.isNull() || newScanPatterns.isNull() || !newFileTypes.isArray() || !newScanPatterns.isArray()) {
         showProblemDialog("Error: The config file is not formatted correctly.",
@@ -102,6 +109,8 @@ void ConfigManager::loadConfigFromFile(QString &path) {
     bool fileTypesError = false;
     bool scanPatternsError = false;
     bool regexError = false;
+    bool validatorError = false;
+    bool scanModeError = false;
 
     for (auto &&i: fileTypesArray) {
         QJsonValue value = i;
@@ -116,6 +125,14 @@ void ConfigManager::loadConfigFromFile(QString &path) {
                 continue;
             }
             this->fileTypes.append(qMakePair(fileType, description));
+
+            QString scanMode = obj["scanMode"].toString();
+            if (scanMode == "binary") {
+                this->fileTypeScanModes[fileType] = scanMode;
+            } else if (!scanMode.isEmpty()) {
+                qDebug() << "Unknown scan mode" << scanMode << "for file type" << fileType;
+                scanModeError = true;
+            }
         }
     }
 
@@ -134,12 +151,30 @@ void ConfigManager::loadConfigFromFile(QString &path) {
                 continue;
             }
 
-            if (!isValidRegex(scanPattern)) {
+            int somHorizon = obj["somHorizon"].toInt(0);
+            QString validator = obj["validator"].toString();
+            if (!validator.isEmpty() && !isKnownValidator(validator.toStdString())) {
+                qDebug() << "Unknown validator" << validator << "for scan pattern" << scanPattern;
+                validatorError = true;
+                validator.clear();
+            }
+
+            // The options change the compile flags, check the pattern the way the scanner compiles it
+            PatternOptions options;
+            options.validator = validator.toStdString();
+            options.somHorizon = static_cast<uint32_t>(std::max(0, somHorizon));
+            if (!isValidRegex(scanPattern, FileScanner::compileFlags(options))) {
                 qDebug() << "The scan pattern is not a valid regex expression.";
                 regexError = true;
                 continue;
             }
             this->scanPatterns.append(qMakePair(scanPattern, description));
+            if (somHorizon > 0) {
+                this->patternSomHorizons[scanPattern] = somHorizon;
+            }
+            if (!validator.isEmpty()) {
+                this->patternValidators[scanPattern] = validator;
+            }
         }
     }
 
@@ -153,6 +188,12 @@ void ConfigManager::loadConfigFromFile(QString &path) {
     if (regexError) {
         errorMessage += "Some scan patterns are not valid regex expressions.\n";
     }
+    if (validatorError) {
+        errorMessage += "Some scan patterns refer to unknown validators and will be used without one.\n";
+    }
+    if (scanModeError) {
+        errorMessage += "Some file types have an unknown scan mode and will be scanned as usual.\n";
+    }
     if (!errorMessage.isEmpty()) {
         showProblemDialog("Error: Could not load all file types and scan patterns.", errorMessage);
     }
@@ -162,6 +203,11 @@ void ConfigManager::editFileType(int index, QString &fileType, QString &descript
     if (index == fileTypes.size()) {
         fileTypes.append(qMakePair(fileType, description));
     } else {
+        // Keep the scan mode attached to the file type when it is renamed
+        QString oldFileType = fileTypes[index].first;
+        if (oldFileType != fileType && fileTypeScanModes.contains(oldFileType)) {
+            fileTypeScanModes[fileType] = fileTypeScanModes.take(oldFileType);
+        }
         fileTypes[index] = qMakePair(fileType, description);
     }
     updateConfigFile();
@@ -174,6 +220,7 @@ void ConfigManager::removeFileType(QString &fileType) {
             break;
         }
     }
+    fileTypeScanModes.remove(fileType);
     updateConfigFile();
 }
 
@@ -189,6 +236,8 @@ void ConfigManager::removeScanPattern(QString &scanPattern) {
             break;
         }
     }
+    patternValidators.remove(scanPattern);
+    patternSomHorizons.remove(scanPattern);
 
     updateConfigFile();
 }
@@ -202,17 +251,29 @@ void ConfigManager::updateConfigFile() {
         QJsonObject fileTypeObj;
         fileTypeObj["fileType"] = fileType.first;
         fileTypeObj["description"] = fileType.second;
+        if (fileTypeScanModes.contains(fileType.first)) {
+            fileTypeObj["scanMode"] = fileTypeScanModes.value(fileType.first);
+        }
         fileTypesArray.append(fileTypeObj);
     }
     for (const auto &scanPattern : scanPatterns) {
         QJsonObject scanPatternObj;
         scanPatternObj["pattern"] = scanPattern.first;
         scanPatternObj["description"] = scanPattern.second;
+        if (patternValidators.contains(scanPattern.first)) {
+            scanPatternObj["validator"] = patternValidators.value(scanPattern.first);
+        }
+        if (patternSomHorizons.contains(scanPattern.first)) {
+            scanPatternObj["somHorizon"] = patternSomHorizons.value(scanPattern.first);
+        }
         scanPatternsArray.append(scanPatternObj);
     }
 
     obj["fileTypes"] = fileTypesArray;
     obj["scanPatterns"] = scanPatternsArray;
+    if (!scanSettings.isEmpty()) {
+        obj["scanSettings"] = scanSettings;
+    }
 
     QJsonDocument doc(obj);
     QFile file(configFilePath);
@@ -229,7 +290,9 @@ void ConfigManager::updateConfigFile() {
 }
 
 void ConfigManager::editScanPattern(int index, QString &scanPattern, QString &description) {
-    if (!isValidRegex(scanPattern)) {
+    // An edited pattern keeps the options of the pattern it replaces
+    QString optionsPattern = index < scanPatterns.size() ? scanPatterns[index].first : scanPattern;
+    if (!isValidRegex(scanPattern, getPatternFlags(optionsPattern))) {
         qDebug() << "The scan pattern is not a valid regex expression.";
         return;
     }
@@ -237,6 +300,14 @@ void ConfigManager::editScanPattern(int index, QString &scanPattern, QString &de
     if (index == scanPatterns.size()) {
         scanPatterns.append(qMakePair(scanPattern, description));
     } else {
+        // Keep the validator and SOM horizon attached to the pattern when its text is edited
+        QString oldPattern = scanPatterns[index].first;
+        if (oldPattern != scanPattern && patternValidators.contains(oldPattern)) {
+            patternValidators[scanPattern] = patternValidators.take(oldPattern);
+        }
+        if (oldPattern != scanPattern && patternSomHorizons.contains(oldPattern)) {
+            patternSomHorizons[scanPattern] = patternSomHorizons.take(oldPattern);
+        }
         scanPatterns[index] = qMakePair(scanPattern, description);
     }
     updateConfigFile();
@@ -250,14 +321,47 @@ QList<QPair<QString, QString>> ConfigManager::getScanPatterns() {
     return scanPatterns;
 }
 
-// Check if a string represents a valid c++ regex expression
-bool ConfigManager::isValidRegex(QString pattern) {
-    try {
-        std::regex re(pattern.toStdString());
-    } catch (std::regex_error &e) {
-        return false;
+QString ConfigManager::getPatternValidator(const QString &scanPattern) {
+    return patternValidators.value(scanPattern);
+}
+
+int ConfigManager::getPatternSomHorizon(const QString &scanPattern) {
+    return patternSomHorizons.value(scanPattern, 0);
+}
+
+QString ConfigManager::getFileTypeScanMode(const QString &fileType) {
+    return fileTypeScanModes.value(fileType);
+}
+
+QJsonObject ConfigManager::getScanSettings() {
+    return scanSettings;
+}
+
+// Hyperscan flags the scanner compiles the pattern with, they depend on its validator and SOM horizon
+uint32_t ConfigManager::getPatternFlags(const QString &scanPattern) {
+    PatternOptions options;
+    options.validator = getPatternValidator(scanPattern).toStdString();
+    options.somHorizon = static_cast<uint32_t>(getPatternSomHorizon(scanPattern));
+    return FileScanner::compileFlags(options);
+}
+
+// Check if a string is a regex expression Hyperscan can compile with the given flags
+bool ConfigManager::isValidRegex(QString pattern, uint32_t flags) {
+    return PatternAnalyzer::isCompatible(pattern.toStdString(), flags);
+}
+
+// Returns the reason Hyperscan rejects the pattern or an empty string if it is valid
+QString ConfigManager::getPatternError(const QString &scanPattern, uint32_t flags) {
+    std::string error;
+    if (PatternAnalyzer::isCompatible(scanPattern.toStdString(), flags, &error)) {
+        return {};
     }
-    return true;
+    return QString::fromStdString(error);
+}
+
+// Compile the pattern on its own and measure its cost on the sample corpus. Safe to call from a worker thread.
+PatternReport ConfigManager::analyzeScanPattern(const QString &scanPattern, uint32_t flags) const {
+    return patternAnalyzer.analyze(scanPattern.toStdString(), flags);
 }
 
 void ConfigManager::setConfigFilePath(QString &path) {
@@ -3,7 +3,11 @@
 //
 
 #include <QList>
+#include <QMap>
 #include <QString>
+#include <QJsonObject>
+
+#include "patternanalyzer.h"
 
 #ifndef SENSITIVE_DATA_DELETER_CONFIGMANAGER_H
 #define SENSITIVE_DATA_DELETER_CONFIGMANAGER_H
@@ -20,18 +24,30 @@ public:
     void addNewScanPattern(QString &scanPattern, QString &description);
     void removeScanPattern(QString &scanPattern);
     void editScanPattern(int index, QString &scanPattern, QString &description);
-    bool isValidRegex(QString pattern);
+    bool isValidRegex(QString pattern, uint32_t flags);
+    uint32_t getPatternFlags(const QString &scanPattern);
+    QString getPatternError(const QString &scanPattern, uint32_t flags);
+    PatternReport analyzeScanPattern(const QString &scanPattern, uint32_t flags) const;
+    QString getPatternValidator(const QString &scanPattern);
+    int getPatternSomHorizon(const QString &scanPattern);
+    QString getFileTypeScanMode(const QString &fileType);
+    QJsonObject getScanSettings();
     QList<QPair<QString, QString>> getFileTypes();
     QList<QPair<QString, QString>> getScanPatterns();
     void updateConfigFile();
     void setConfigFilePath(QString &path);
     QList<QPair<QString, QString>> fileTypes;
     QList<QPair<QString, QString>> scanPatterns;
+    QMap<QString, QString> patternValidators; // Scan pattern -> name of the checksum validator attached to it
+    QMap<QString, int> patternSomHorizons; // Scan pattern -> longest match for which exact start offsets are reported
+    QMap<QString, QString> fileTypeScanModes; // File type -> "binary" to extract strings from files no reader supports
+    QJsonObject scanSettings; // Optional "scanSettings" section, passed to the FileScanner as is
 
 
 private:
     QString configFilePath;
     QList<QString> immutableTypes = {".txt"};
+    PatternAnalyzer patternAnalyzer;
 };
 
 
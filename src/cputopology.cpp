@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <QDebug>
+
+#include "cputopology.h"
+
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// From linux/mempolicy.h, which glibc does not wrap
+#define MPOL_PREFERRED 1
+#define NUMA_MASK_LONGS 16 // Room for 1024 nodes
+#elif defined(Q_OS_WIN)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace fs = std::filesystem;
+
+std::vector<int> CpuTopology::parseCpuList(const std::string &list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        std::string range = list.substr(pos, end - pos);
+        pos = end + 1;
+        size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++) {
+                cpus.push_back(cpu);
+            }
+        } catch (std::exception &) {
+            // Trailing newline or an empty list
+        }
+    }
+    return cpus;
+}
+
+CpuTopology CpuTopology::detect() {
+    CpuTopology topology;
+#ifdef Q_OS_LINUX
+    std::error_code error;
+    for (const auto &entry: fs::directory_iterator("/sys/devices/system/node", error)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+            !std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+        std::ifstream cpuList(entry.path() / "cpulist");
+        std::string list;
+        std::getline(cpuList, list);
+        // Nodes with memory but no CPUs get no threads
+        std::vector<int> cpus = parseCpuList(list);
+        if (!cpus.empty()) {
+            topology.nodes.push_back({std::stoi(name.substr(4)), std::move(cpus)});
+        }
+    }
+    std::sort(topology.nodes.begin(), topology.nodes.end(),
+              [](const NumaNode &a, const NumaNode &b) { return a.id < b.id; });
+#elif defined(Q_OS_WIN)
+    ULONG highestNode = 0;
+    if (GetNumaHighestNodeNumber(&highestNode)) {
+        for (ULONG node = 0; node <= highestNode; node++) {
+            GROUP_AFFINITY affinity = {};
+            if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity)) {
+                continue;
+            }
+            NumaNode numaNode = {static_cast<int>(node), {}};
+            for (int bit = 0; bit < 64; bit++) {
+                if (affinity.Mask & (static_cast<KAFFINITY>(1) << bit)) {
+                    numaNode.cpus.push_back(affinity.Group * 64 + bit);
+                }
+            }
+            if (!numaNode.cpus.empty()) {
+                topology.nodes.push_back(std::move(numaNode));
+            }
+        }
+    }
+#endif
+    if (topology.nodes.empty()) {
+        NumaNode node = {0, {}};
+        for (int cpu = 0; cpu < static_cast<int>(std::max(1u, std::thread::hardware_concurrency())); cpu++) {
+            node.cpus.push_back(cpu);
+        }
+        topology.nodes.push_back(std::move(node));
+    }
+    return topology;
+}
+
+std::vector<WorkerSlot> CpuTopology::workerSlots(size_t numThreads) const {
+    std::vector<WorkerSlot> cores;
+    size_t maxCpus = 0;
+    for (const auto &node: nodes) {
+        maxCpus = std::max(maxCpus, node.cpus.size());
+    }
+    // One core of every node per round
+    for (size_t round = 0; round < maxCpus; round++) {
+        for (size_t node = 0; node < nodes.size(); node++) {
+            if (round < nodes[node].cpus.size()) {
+                cores.push_back({node, nodes[node].cpus[round]});
+            }
+        }
+    }
+    std::vector<WorkerSlot> slots;
+    for (size_t i = 0; i < numThreads && !cores.empty(); i++) {
+        slots.push_back(cores[i % cores.size()]);
+    }
+    return slots;
+}
+
+bool CpuTopology::pinCurrentThread(const WorkerSlot &slot) const {
+#ifdef Q_OS_LINUX
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(slot.cpu, &cpuSet);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0) {
+        return false;
+    }
+    // First touch already places the pages of a pinned thread on its node, the policy also covers
+    // pages the kernel would otherwise put elsewhere when the node is short of free memory
+    int nodeId = nodes[slot.node].id;
+    if (nodes.size() > 1 && nodeId < NUMA_MASK_LONGS * 64) {
+        unsigned long mask[NUMA_MASK_LONGS] = {};
+        mask[nodeId / 64] = 1ul << (nodeId % 64);
+        syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, NUMA_MASK_LONGS * 64 + 1);
+    }
+    return true;
+#elif defined(Q_OS_WIN)
+    // Windows allocates memory on the node of the processor a thread runs on
+    GROUP_AFFINITY affinity = {};
+    affinity.Group = static_cast<WORD>(slot.cpu / 64);
+    affinity.Mask = static_cast<KAFFINITY>(1) << (slot.cpu % 64);
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#else
+    // macOS has no API to pin threads
+    return false;
+#endif
+}
@@ -0,0 +1,42 @@
+#ifndef SENSITIVE_DATA_DELETER_CPUTOPOLOGY_H
+#define SENSITIVE_DATA_DELETER_CPUTOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+struct NumaNode {
+    int id;
+    std::vector<int> cpus; // Logical CPU numbers, on Windows 64 per processor group
+};
+
+// Core a scanner thread runs on
+struct WorkerSlot {
+    size_t node; // Index into CpuTopology::nodes
+    int cpu;
+};
+
+/**
+ * NUMA nodes of the machine and the logical CPUs that belong to each of them. Read from
+ * /sys/devices/system/node on Linux and from the processor masks of the nodes on Windows.
+ * Everywhere else, or if the topology cannot be read, all CPUs are one node.
+ */
+class CpuTopology {
+public:
+    std::vector<NumaNode> nodes;
+
+    static CpuTopology detect();
+
+    // Parses a Linux CPU list such as "0-7,16-23"
+    static std::vector<int> parseCpuList(const std::string &list);
+
+    // Places numThreads threads on the cores of the nodes in turn, so every node gets threads in
+    // proportion to its cores and the first n threads of any count are spread over all nodes.
+    // Cores are reused once there are more threads than cores.
+    std::vector<WorkerSlot> workerSlots(size_t numThreads) const;
+
+    // Pins the calling thread to the core of the slot and makes the node its preferred memory node,
+    // so the buffers and scratch it allocates afterwards are node-local. False if pinning failed.
+    bool pinCurrentThread(const WorkerSlot &slot) const;
+};
+
+#endif //SENSITIVE_DATA_DELETER_CPUTOPOLOGY_H
@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <QDebug>
+#include <zlib.h>
+#include <bzlib.h>
+#include <lzma.h>
+#include <zstd.h>
+
+#include "decompressor.h"
+
+#define XZ_THREADING_MEMORY_LIMIT (256 * 1024 * 1024) // Above this the xz decoder falls back to one thread
+
+const char *compressionFormatName(CompressionFormat format) {
+    switch (format) {
+        case CompressionFormat::GZIP_COMPRESSION:
+            return "gzip";
+        case CompressionFormat::BZIP2_COMPRESSION:
+            return "bzip2";
+        case CompressionFormat::XZ_COMPRESSION:
+            return "xz";
+        case CompressionFormat::ZSTD_COMPRESSION:
+            return "zstd";
+        default:
+            return "none";
+    }
+}
+
+CompressionFormat detectCompressionFormat(const unsigned char *magic, size_t size) {
+    if (size >= 2 && magic[0] == 0x1F && magic[1] == 0x8B) {
+        return CompressionFormat::GZIP_COMPRESSION;
+    }
+    if (size >= 3 && std::memcmp(magic, "BZh", 3) == 0) {
+        return CompressionFormat::BZIP2_COMPRESSION;
+    }
+    if (size >= 6 && std::memcmp(magic, "\xFD" "7zXZ\0", 6) == 0) {
+        return CompressionFormat::XZ_COMPRESSION;
+    }
+    if (size >= 4 && std::memcmp(magic, "\x28\xB5\x2F\xFD", 4) == 0) {
+        return CompressionFormat::ZSTD_COMPRESSION;
+    }
+    return CompressionFormat::NO_COMPRESSION;
+}
+
+class GzipDecompressor : public Decompressor {
+public:
+    GzipDecompressor() {
+        // 16 + window bits: gzip header and trailer, no zlib wrapper
+        if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+            throw std::runtime_error("Could not initialize the gzip decoder");
+        }
+    }
+
+    ~GzipDecompressor() override {
+        inflateEnd(&stream);
+    }
+
+    CompressionFormat format() const override { return CompressionFormat::GZIP_COMPRESSION; }
+
+protected:
+    size_t decompress(char *out, size_t size) override {
+        size_t produced = 0;
+        while (produced == 0) {
+            if (streamEnd) {
+                // Several gzip members in one file are decompressed as one stream
+                if (!hasMoreInput()) {
+                    return 0;
+                }
+                inflateReset(&stream);
+                streamEnd = false;
+            }
+            if (inputAvailable() == 0 && !refillInput()) {
+                throw std::runtime_error("Unexpected end of gzip data");
+            }
+            stream.next_in = const_cast<Bytef *>(inputData());
+            stream.avail_in = static_cast<uInt>(inputAvailable());
+            stream.next_out = reinterpret_cast<Bytef *>(out);
+            stream.avail_out = static_cast<uInt>(size);
+
+            int ret = inflate(&stream, Z_NO_FLUSH);
+            consumeInput(inputAvailable() - stream.avail_in);
+            produced = size - stream.avail_out;
+            if (ret == Z_STREAM_END) {
+                streamEnd = true;
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                throw std::runtime_error(std::string("Corrupt gzip data: ") + (stream.msg ? stream.msg : "unknown error"));
+            }
+        }
+        return produced;
+    }
+
+private:
+    z_stream stream{};
+    bool streamEnd = false;
+};
+
+class Bzip2Decompressor : public Decompressor {
+public:
+    Bzip2Decompressor() {
+        if (BZ2_bzDecompressInit(&stream, 0, 0) != BZ_OK) {
+            throw std::runtime_error("Could not initialize the bzip2 decoder");
+        }
+    }
+
+    ~Bzip2Decompressor() override {
+        BZ2_bzDecompressEnd(&stream);
+    }
+
+    CompressionFormat format() const override { return CompressionFormat::BZIP2_COMPRESSION; }
+
+protected:
+    size_t decompress(char *out, size_t size) override {
+        size_t produced = 0;
+        while (produced == 0) {
+            if (streamEnd) {
+                // pbzip2 and cat write several bzip2 streams one after another
+                if (!hasMoreInput()) {
+                    return 0;
+                }
+                BZ2_bzDecompressEnd(&stream);
+                if (BZ2_bzDecompressInit(&stream, 0, 0) != BZ_OK) {
+                    throw std::runtime_error("Could not initialize the bzip2 decoder");
+                }
+                streamEnd = false;
+            }
+            if (inputAvailable() == 0 && !refillInput()) {
+                throw std::runtime_error("Unexpected end of bzip2 data");
+            }
+            stream.next_in = const_cast<char *>(reinterpret_cast<const char *>(inputData()));
+            stream.avail_in = static_cast<unsigned int>(inputAvailable());
+            stream.next_out = out;
+            stream.avail_out = static_cast<unsigned int>(size);
+
+            int ret = BZ2_bzDecompress(&stream);
+            consumeInput(inputAvailable() - stream.avail_in);
+            produced = size - stream.avail_out;
+            if (ret == BZ_STREAM_END) {
+                streamEnd = true;
+            } else if (ret != BZ_OK) {
+                throw std::runtime_error("Corrupt bzip2 data (error " + std::to_string(ret) + ")");
+            }
+        }
+        return produced;
+    }
+
+private:
+    bz_stream stream{};
+    bool streamEnd = false;
+};
+
+class XzDecompressor : public Decompressor {
+public:
+    XzDecompressor() {
+        lzma_ret ret;
+#if LZMA_VERSION >= 50040002
+        // Blocks of files written with xz -T are independent and decoded in parallel
+        lzma_mt options{};
+        options.flags = LZMA_CONCATENATED;
+        options.threads = std::clamp(std::thread::hardware_concurrency(), 1u, static_cast<unsigned int>(XZ_MAX_THREADS));
+        options.memlimit_threading = XZ_THREADING_MEMORY_LIMIT;
+        options.memlimit_stop = UINT64_MAX;
+        ret = lzma_stream_decoder_mt(&stream, &options);
+#else
+        ret = lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED);
+#endif
+        if (ret != LZMA_OK) {
+            throw std::runtime_error("Could not initialize the xz decoder");
+        }
+    }
+
+    ~XzDecompressor() override {
+        lzma_end(&stream);
+    }
+
+    CompressionFormat format() const override { return CompressionFormat::XZ_COMPRESSION; }
+
+protected:
+    size_t decompress(char *out, size_t size) override {
+        size_t produced = 0;
+        while (produced == 0 && !streamEnd) {
+            // With LZMA_CONCATENATED the decoder only knows the last stream ended when told the input did
+            bool finishing = inputAvailable() == 0 && !refillInput();
+            stream.next_in = inputData();
+            stream.avail_in = inputAvailable();
+            stream.next_out = reinterpret_cast<uint8_t *>(out);
+            stream.avail_out = size;
+
+            lzma_ret ret = lzma_code(&stream, finishing ? LZMA_FINISH : LZMA_RUN);
+            consumeInput(inputAvailable() - stream.avail_in);
+            produced = size - stream.avail_out;
+            if (ret == LZMA_STREAM_END) {
+                streamEnd = true;
+            } else if (ret != LZMA_OK) {
+                throw std::runtime_error("Corrupt xz data (error " + std::to_string(ret) + ")");
+            }
+        }
+        return produced;
+    }
+
+private:
+    lzma_stream stream = LZMA_STREAM_INIT;
+    bool streamEnd = false;
+};
+
+class ZstdDecompressor : public Decompressor {
+public:
+    ZstdDecompressor() : context(ZSTD_createDCtx()) {
+        if (!context) {
+            throw std::runtime_error("Could not initialize the zstd decoder");
+        }
+    }
+
+    ~ZstdDecompressor() override {
+        ZSTD_freeDCtx(context);
+    }
+
+    CompressionFormat format() const override { return CompressionFormat::ZSTD_COMPRESSION; }
+
+protected:
+    size_t decompress(char *out, size_t size) override {
+        size_t produced = 0;
+        while (produced == 0) {
+            if (inputAvailable() == 0 && !refillInput()) {
+                if (frameOpen) {
+                    throw std::runtime_error("Unexpected end of zstd data");
+                }
+                return 0;
+            }
+            // Frames follow each other without a reset, the decoder starts the next one by itself
+            ZSTD_inBuffer in = {inputData(), inputAvailable(), 0};
+            ZSTD_outBuffer output = {out, size, 0};
+            size_t ret = ZSTD_decompressStream(context, &output, &in);
+            consumeInput(in.pos);
+            produced = output.pos;
+            if (ZSTD_isError(ret)) {
+                throw std::runtime_error(std::string("Corrupt zstd data: ") + ZSTD_getErrorName(ret));
+            }
+            frameOpen = ret != 0;
+        }
+        return produced;
+    }
+
+private:
+    ZSTD_DCtx *context;
+    bool frameOpen = false;
+};
+
+std::unique_ptr<Decompressor> Decompressor::create(const unsigned char *magic, size_t size) {
+    switch (detectCompressionFormat(magic, size)) {
+        case CompressionFormat::GZIP_COMPRESSION:
+            return std::make_unique<GzipDecompressor>();
+        case CompressionFormat::BZIP2_COMPRESSION:
+            return std::make_unique<Bzip2Decompressor>();
+        case CompressionFormat::XZ_COMPRESSION:
+            return std::make_unique<XzDecompressor>();
+        case CompressionFormat::ZSTD_COMPRESSION:
+            return std::make_unique<ZstdDecompressor>();
+        default:
+            return nullptr;
+    }
+}
+
+std::unique_ptr<Decompressor> Decompressor::open(const std::filesystem::path &filePath) {
+    std::ifstream input(filePath, std::ios::binary);
+    if (!input.is_open()) {
+        throw std::runtime_error("Failed to open file: " + filePath.string());
+    }
+    unsigned char magic[6] = {};
+    input.read(reinterpret_cast<char *>(magic), sizeof(magic));
+    auto magicSize = static_cast<size_t>(input.gcount());
+    input.clear();
+    input.seekg(0);
+
+    std::unique_ptr<Decompressor> decompressor = create(magic, magicSize);
+    if (decompressor) {
+        decompressor->input = std::move(input);
+        decompressor->inputBuffer.resize(DECOMPRESS_INPUT_SIZE);
+    }
+    return decompressor;
+}
+
+std::unique_ptr<Decompressor> Decompressor::open(std::vector<uint8_t> data) {
+    std::unique_ptr<Decompressor> decompressor = create(data.data(), data.size());
+    if (decompressor) {
+        // All of the input is buffered from the start, refillInput() has nothing to read
+        decompressor->inputBuffer = std::move(data);
+        decompressor->inputEnd = decompressor->inputBuffer.size();
+    }
+    return decompressor;
+}
+
+size_t Decompressor::read(char *out, size_t size) {
+    if (failed || size == 0) {
+        return 0;
+    }
+    size_t produced;
+    try {
+        produced = decompress(out, size);
+    } catch (std::runtime_error &e) {
+        qWarning() << "Stopped decompressing after" << outputOffset << "bytes:" << e.what();
+        failed = true;
+        return 0;
+    }
+    outputOffset += produced;
+    return produced;
+}
+
+bool Decompressor::refillInput() {
+    if (inputPos < inputEnd) {
+        return true;
+    }
+    if (!input.is_open()) {
+        return false;
+    }
+    input.read(reinterpret_cast<char *>(inputBuffer.data()), static_cast<std::streamsize>(inputBuffer.size()));
+    inputPos = 0;
+    inputEnd = static_cast<size_t>(input.gcount());
+    return inputEnd > 0;
+}
+
+bool Decompressor::hasMoreInput() {
+    return inputAvailable() > 0 || refillInput();
+}
@@ -0,0 +1,92 @@
+#ifndef SENSITIVE_DATA_DELETER_DECOMPRESSOR_H
+#define SENSITIVE_DATA_DELETER_DECOMPRESSOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#define DECOMPRESS_INPUT_SIZE (64 * 1024) // Compressed bytes read from the file at a time
+#define XZ_MAX_THREADS 4                  // Upper bound for the multithreaded xz decoder
+
+enum CompressionFormat {
+    NO_COMPRESSION,
+    GZIP_COMPRESSION,
+    BZIP2_COMPRESSION,
+    XZ_COMPRESSION,
+    ZSTD_COMPRESSION,
+};
+
+const char *compressionFormatName(CompressionFormat format);
+
+// Format of a stream that starts with the given bytes, the first 6 are enough
+CompressionFormat detectCompressionFormat(const unsigned char *magic, size_t size);
+
+/**
+ * Streams the decompressed contents of a single-file compressed format. Compressed input is read
+ * in DECOMPRESS_INPUT_SIZE pieces and output goes straight into the caller's buffer, so memory use
+ * does not depend on the file size or the compression ratio. Concatenated streams, as written by
+ * logrotate appending to a .gz or by pigz and zstd in multi-frame mode, are read one after another.
+ *
+ * xz files written in several blocks are decoded on up to XZ_MAX_THREADS threads where liblzma
+ * supports it. Deflate, bzip2 and zstd frames can only be decoded front to back.
+ *
+ * Corrupt or truncated input ends the stream with a warning, the text up to that point is kept
+ * and failed() is set.
+ */
+class Decompressor {
+public:
+    virtual ~Decompressor() = default;
+
+    // Opens the file and picks the decoder from its magic bytes. Returns nullptr if the file is not
+    // compressed in a known format, throws std::runtime_error if it cannot be opened.
+    static std::unique_ptr<Decompressor> open(const std::filesystem::path &filePath);
+
+    // Same for compressed data that is already in memory, such as an archive member
+    static std::unique_ptr<Decompressor> open(std::vector<uint8_t> data);
+
+    // Fills up to size bytes, returns 0 at the end of the stream
+    size_t read(char *out, size_t size);
+
+    // Decompressed bytes returned so far
+    uint64_t position() const { return outputOffset; }
+
+    // True if the stream ended early because the input was corrupt or truncated
+    bool hasFailed() const { return failed; }
+
+    virtual CompressionFormat format() const = 0;
+
+protected:
+    Decompressor() = default;
+
+    const uint8_t *inputData() const { return inputBuffer.data() + inputPos; }
+
+    size_t inputAvailable() const { return inputEnd - inputPos; }
+
+    void consumeInput(size_t size) { inputPos += size; }
+
+    // Reads more compressed bytes once the buffered ones are used up, false at the end of the file
+    bool refillInput();
+
+    // True if there is input left after the end of the current stream
+    bool hasMoreInput();
+
+    // Decompresses into out, returns the number of bytes written or 0 at the end of the data.
+    // Throws std::runtime_error on corrupt input.
+    virtual size_t decompress(char *out, size_t size) = 0;
+
+private:
+    std::ifstream input; // Not open if all of the input was handed over in memory
+    std::vector<uint8_t> inputBuffer;
+    size_t inputPos = 0;
+    size_t inputEnd = 0;
+    uint64_t outputOffset = 0;
+    bool failed = false;
+
+    // Decoder for the format the magic bytes belong to, without input
+    static std::unique_ptr<Decompressor> create(const unsigned char *magic, size_t size);
+};
+
+#endif //SENSITIVE_DATA_DELETER_DECOMPRESSOR_H
@@ -0,0 +1,178 @@
+#include <QDir>
+#include <QDirIterator>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "directoryloader.h"
+
+FileStat FileStat::fromFileInfo(const QFileInfo &fileInfo) {
+    FileStat stat;
+    stat.isDir = fileInfo.isDir();
+    stat.size = stat.isDir ? 0 : fileInfo.size();
+    stat.lastModified = fileInfo.lastModified();
+    return stat;
+}
+
+bool StatCache::listing(const QString &directory, QVector<DirectoryEntry> &entries) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = listings.constFind(directory);
+    if (it == listings.constEnd()) {
+        return false;
+    }
+    markUsed(it.value());
+    entries = it->entries;
+    return true;
+}
+
+void StatCache::setListing(const QString &directory, const QVector<DirectoryEntry> &entries) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = listings.find(directory);
+    if (it != listings.end()) {
+        removeListing(it);
+    }
+    // A listing larger than the whole cache is not kept
+    if (static_cast<size_t>(entries.size()) > STAT_CACHE_MAX_ENTRIES) {
+        return;
+    }
+    while (numEntries + entries.size() > STAT_CACHE_MAX_ENTRIES && !useOrder.empty()) {
+        removeListing(listings.find(useOrder.back()));
+    }
+
+    Listing listing;
+    listing.entries = entries;
+    listing.indexOfName.reserve(entries.size());
+    for (qsizetype i = 0; i < entries.size(); i++) {
+        const QString &path = entries[i].path;
+        listing.indexOfName.insert(path.mid(path.lastIndexOf('/') + 1), i);
+    }
+    useOrder.push_front(directory);
+    listing.usePosition = useOrder.begin();
+    numEntries += entries.size();
+    listings.insert(directory, std::move(listing));
+}
+
+FileStat StatCache::stat(const QString &path) const {
+    qsizetype separator = path.lastIndexOf('/');
+    QString directory = path.left(separator);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = listings.constFind(directory);
+        if (it != listings.constEnd()) {
+            auto entry = it->indexOfName.constFind(path.mid(separator + 1));
+            if (entry != it->indexOfName.constEnd()) {
+                markUsed(it.value());
+                return it->entries[entry.value()].stat;
+            }
+        }
+    }
+    return FileStat::fromFileInfo(QFileInfo(path));
+}
+
+void StatCache::invalidate(const QString &directory) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = listings.find(directory);
+    if (it != listings.end()) {
+        removeListing(it);
+    }
+}
+
+void StatCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    listings.clear();
+    useOrder.clear();
+    numEntries = 0;
+}
+
+void StatCache::markUsed(const Listing &listing) const {
+    useOrder.splice(useOrder.begin(), useOrder, listing.usePosition);
+}
+
+void StatCache::removeListing(QHash<QString, Listing>::iterator it) {
+    numEntries -= it->entries.size();
+    useOrder.erase(it->usePosition);
+    listings.erase(it);
+}
+
+DirectoryLoader::~DirectoryLoader() {
+    for (auto &request: requests) {
+        request.canceled->store(true);
+    }
+    for (auto &request: requests) {
+        request.future.waitForFinished();
+    }
+}
+
+void DirectoryLoader::load(const QString &directory) {
+    cancel(directory);
+    auto canceled = std::make_shared<std::atomic<bool>>(false);
+    Request request;
+    request.canceled = canceled;
+    request.future = QtConcurrent::run([this, directory, canceled]() {
+        listDirectory(directory, canceled);
+    });
+    requests.insert(directory, request);
+}
+
+void DirectoryLoader::cancel(const QString &directory) {
+    auto it = requests.find(directory);
+    if (it != requests.end()) {
+        // The worker notices the flag between batches, undelivered batches are dropped
+        it->canceled->store(true);
+        requests.erase(it);
+    }
+}
+
+void DirectoryLoader::listDirectory(const QString &directory, const std::shared_ptr<std::atomic<bool>> &canceled) {
+    QVector<DirectoryEntry> cached;
+    if (statCache->listing(directory, cached)) {
+        for (qsizetype i = 0; i < cached.size() && !canceled->load(); i += DIRECTORY_LOAD_BATCH_SIZE) {
+            deliver(directory, canceled, cached.mid(i, DIRECTORY_LOAD_BATCH_SIZE), false, true);
+        }
+        deliver(directory, canceled, {}, true, true);
+        return;
+    }
+
+    if (!QDir(directory).exists()) {
+        deliver(directory, canceled, {}, true, false);
+        return;
+    }
+
+    QVector<DirectoryEntry> listing;
+    QVector<DirectoryEntry> batch;
+    QDirIterator it(directory, QDir::NoDotAndDotDot | QDir::Files | QDir::Dirs);
+    while (it.hasNext() && !canceled->load()) {
+        QFileInfo fileInfo = it.nextFileInfo();
+        batch.push_back({directory + "/" + fileInfo.fileName(), FileStat::fromFileInfo(fileInfo)});
+        if (batch.size() == DIRECTORY_LOAD_BATCH_SIZE) {
+            listing += batch;
+            deliver(directory, canceled, batch, false, true);
+            batch.clear();
+        }
+    }
+    if (canceled->load()) {
+        return;
+    }
+    listing += batch;
+    statCache->setListing(directory, listing);
+    if (!batch.isEmpty()) {
+        deliver(directory, canceled, batch, false, true);
+    }
+    deliver(directory, canceled, {}, true, true);
+}
+
+void DirectoryLoader::deliver(const QString &directory, const std::shared_ptr<std::atomic<bool>> &canceled,
+                              const QVector<DirectoryEntry> &entries, bool finished, bool exists) {
+    // Runs the lambda on the thread of the loader, where the flag is checked again in case the
+    // request was cancelled while the batch was queued
+    QMetaObject::invokeMethod(this, [this, directory, canceled, entries, finished, exists]() {
+        if (canceled->load()) {
+            return;
+        }
+        if (!entries.isEmpty()) {
+            emit entriesLoaded(directory, entries);
+        }
+        if (finished) {
+            requests.remove(directory);
+            emit loadFinished(directory, exists);
+        }
+    }, Qt::QueuedConnection);
+}
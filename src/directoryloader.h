@@ -0,0 +1,109 @@
+#ifndef SENSITIVE_DATA_DELETER_DIRECTORYLOADER_H
+#define SENSITIVE_DATA_DELETER_DIRECTORYLOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QDateTime>
+#include <QFuture>
+#include <QFileInfo>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+
+#define DIRECTORY_LOAD_BATCH_SIZE 256 // Entries handed to the UI at a time
+#define STAT_CACHE_MAX_ENTRIES (1024 * 1024) // Entries of all cached listings, least recently used ones are evicted
+
+struct FileStat {
+    bool isDir = false;
+    qint64 size = 0;
+    QDateTime lastModified;
+
+    static FileStat fromFileInfo(const QFileInfo &fileInfo);
+};
+
+struct DirectoryEntry {
+    QString path;
+    FileStat stat;
+};
+
+/**
+ * Directory listings with the stat results of their entries, shared by the UI and the loader threads.
+ * Holds at most STAT_CACHE_MAX_ENTRIES entries, the listings used least recently are dropped first.
+ */
+class StatCache {
+public:
+    bool listing(const QString &directory, QVector<DirectoryEntry> &entries) const;
+
+    void setListing(const QString &directory, const QVector<DirectoryEntry> &entries);
+
+    // Looks the path up in the listing of its parent, stats it if the parent is not cached
+    FileStat stat(const QString &path) const;
+
+    void invalidate(const QString &directory);
+
+    void clear();
+
+private:
+    struct Listing {
+        QVector<DirectoryEntry> entries;
+        QHash<QString, qsizetype> indexOfName; // File name -> index in entries
+        std::list<QString>::iterator usePosition;
+    };
+
+    mutable std::mutex mutex;
+    QHash<QString, Listing> listings;
+    mutable std::list<QString> useOrder; // Cached directories, most recently used first
+    size_t numEntries = 0;
+
+    // Callers hold the mutex
+    void markUsed(const Listing &listing) const;
+
+    void removeListing(QHash<QString, Listing>::iterator it);
+};
+
+/**
+ * Lists directories on a worker thread and hands the entries to the UI thread in batches, so
+ * expanding a folder with hundreds of thousands of entries on a slow share does not block.
+ * Results of a load are only delivered until it is cancelled or the same directory is loaded again.
+ */
+class DirectoryLoader : public QObject {
+Q_OBJECT
+
+public:
+    explicit DirectoryLoader(StatCache *statCache, QObject *parent = nullptr) :
+            QObject(parent), statCache(statCache) {}
+
+    ~DirectoryLoader() override;
+
+    void load(const QString &directory);
+
+    void cancel(const QString &directory);
+
+    bool isLoading(const QString &directory) const { return requests.contains(directory); }
+
+signals:
+
+    void entriesLoaded(const QString &directory, const QVector<DirectoryEntry> &entries);
+
+    // exists is false if the directory has been removed
+    void loadFinished(const QString &directory, bool exists);
+
+private:
+    struct Request {
+        std::shared_ptr<std::atomic<bool>> canceled;
+        QFuture<void> future;
+    };
+
+    StatCache *statCache;
+    QHash<QString, Request> requests;
+
+    void listDirectory(const QString &directory, const std::shared_ptr<std::atomic<bool>> &canceled);
+
+    void deliver(const QString &directory, const std::shared_ptr<std::atomic<bool>> &canceled,
+                 const QVector<DirectoryEntry> &entries, bool finished, bool exists);
+};
+
+#endif //SENSITIVE_DATA_DELETER_DIRECTORYLOADER_H
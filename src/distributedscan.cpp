@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QProcess>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "distributedscan.h"
+#include "scancoordinator.h"
+#include "scanworker.h"
+
+bool isDistributedScan(int argc, char *argv[]) {
+    return argc > 1 && (std::strcmp(argv[1], "--coordinator") == 0 || std::strcmp(argv[1], "--worker") == 0);
+}
+
+static int runCoordinator(QCoreApplication &app, const QCommandLineParser &parser) {
+    if (!parser.isSet("config")) {
+        qWarning() << "The coordinator needs the scan config, pass it with --config";
+        return 1;
+    }
+    QFile configFile(parser.value("config"));
+    if (!configFile.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open the config file" << configFile.fileName();
+        return 1;
+    }
+    QByteArray configJson = configFile.readAll();
+    QByteArray token = qgetenv(SCAN_TOKEN_VARIABLE);
+
+    std::vector<std::string> roots;
+    for (const auto &root: parser.positionalArguments()) {
+        roots.push_back(root.toStdString());
+    }
+    if (roots.empty() && !parser.isSet("file-list")) {
+        qWarning() << "Nothing to scan, pass the scan roots or --file-list";
+        return 1;
+    }
+
+    QHostAddress address(parser.value("listen"));
+    if (address.isNull()) {
+        qWarning() << "Invalid listen address" << parser.value("listen");
+        return 1;
+    }
+    // Snippets of every match travel back from the workers in the clear
+    if (!address.isLoopback() && !parser.isSet("allow-unencrypted")) {
+        qWarning() << "The connection to the workers is not encrypted, matches are sent in clear text. Listen on a"
+                   << "loopback address, or pass --allow-unencrypted to listen on" << address.toString()
+                   << "on a trusted network";
+        return 1;
+    }
+    if (token.isEmpty() && !address.isLoopback()) {
+        qWarning() << SCAN_TOKEN_VARIABLE << "is not set, any host that can reach the coordinator can join the scan"
+                   << "and read the files it is given";
+    }
+
+    std::unique_ptr<ScanCoordinator> coordinator;
+    try {
+        std::string resultsPath = parser.value("results").toStdString();
+        if (resultsPath.empty()) {
+            QJsonObject scanSettings = QJsonDocument::fromJson(configJson).object()["scanSettings"].toObject();
+            resultsPath = scanSettings["resultsPath"].toString("sdd-results").toStdString();
+        }
+        coordinator = std::make_unique<ScanCoordinator>(configJson, token, resultsPath);
+    } catch (std::exception &e) {
+        qWarning() << "Could not start the coordinator:" << e.what();
+        return 1;
+    }
+    if (!coordinator->listen(address, parser.value("port").toUShort())) {
+        qWarning() << "Could not listen on" << address.toString() << ":" << coordinator->errorString();
+        return 1;
+    }
+    qDebug() << "Coordinator listening on" << address.toString() << "port" << coordinator->serverPort();
+
+    std::vector<QProcess *> localWorkers;
+    int numLocalWorkers = parser.value("local-workers").toInt();
+    for (int i = 0; i < numLocalWorkers; i++) {
+        auto *process = new QProcess(&app);
+        process->setProcessChannelMode(QProcess::ForwardedChannels);
+        QString host = address == QHostAddress::Any || address == QHostAddress::AnyIPv4 ? "127.0.0.1"
+                                                                                        : address.toString();
+        // Local workers share the cores of this machine unless told otherwise
+        QString threads = parser.isSet("threads") ? parser.value("threads") : QString::number(
+                std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / numLocalWorkers));
+        QStringList arguments = {"--worker", host + ":" + QString::number(coordinator->serverPort()),
+                                 "--threads", threads};
+        // Workers without a token would be rejected, the children inherit the environment
+        QObject::connect(process, &QProcess::finished, &app, [&app, &coordinator, &localWorkers](int exitCode) {
+            if (exitCode != 0) {
+                qWarning() << "A local worker exited with code" << exitCode;
+            }
+            bool allExited = std::all_of(localWorkers.begin(), localWorkers.end(), [](QProcess *worker) {
+                return worker->state() == QProcess::NotRunning;
+            });
+            if (allExited && coordinator->connectedWorkers() == 0) {
+                qWarning() << "All local workers exited before the scan was done";
+                app.exit(1);
+            }
+        });
+        process->start(QCoreApplication::applicationFilePath(), arguments);
+        localWorkers.push_back(process);
+    }
+
+    QObject::connect(coordinator.get(), &ScanCoordinator::finished, &app,
+                     [&app, &coordinator, &localWorkers]() {
+                         for (auto *process: localWorkers) {
+                             process->disconnect();
+                             process->waitForFinished(WORKER_EXIT_TIMEOUT_MS);
+                         }
+                         std::cout << QJsonDocument(coordinator->summary()).toJson().toStdString() << std::flush;
+                         app.exit(0);
+                     });
+    coordinator->start(roots, parser.value("file-list"));
+    return app.exec();
+}
+
+static int runWorker(const QCommandLineParser &parser) {
+    QString coordinator = parser.value("worker");
+    QString host = coordinator;
+    quint16 port = DEFAULT_COORDINATOR_PORT;
+    int colon = coordinator.lastIndexOf(':');
+    if (colon > 0 && !coordinator.endsWith(']')) {
+        host = coordinator.left(colon);
+        port = coordinator.mid(colon + 1).toUShort();
+    }
+    if (host.startsWith('[') && host.endsWith(']')) {
+        host = host.mid(1, host.size() - 2);
+    }
+    ScanWorker worker(host, port, qgetenv(SCAN_TOKEN_VARIABLE), parser.value("threads").toInt());
+    return worker.run();
+}
+
+int runDistributedScan(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Distributed scan without the GUI");
+    parser.addHelpOption();
+    parser.addOptions({
+            {"coordinator", "Hand out the files below the roots to workers and merge their results"},
+            {"worker", "Scan files for the coordinator at host[:port]", "host"},
+            {"config", "Scan config in the format of sdd_config.json", "file"},
+            {"listen", "Address the coordinator listens on", "address", "127.0.0.1"},
+            {"allow-unencrypted", "Allow listening on a non-loopback address, results are sent unencrypted"},
+            {"port", "Port the coordinator listens on", "port", QString::number(DEFAULT_COORDINATOR_PORT)},
+            {"results", "Directory of the merged results store", "dir"},
+            {"file-list", "File with the paths to scan, one per line", "file"},
+            {"local-workers", "Number of worker processes started on this machine", "n", "0"},
+            {"threads", "Scanner threads per worker", "n"},
+    });
+    parser.addPositionalArgument("roots", "Directories and files to scan", "[root...]");
+    parser.process(app);
+
+    if (parser.isSet("worker")) {
+        return runWorker(parser);
+    }
+    return runCoordinator(app, parser);
+}
@@ -0,0 +1,18 @@
+#ifndef SENSITIVE_DATA_DELETER_DISTRIBUTEDSCAN_H
+#define SENSITIVE_DATA_DELETER_DISTRIBUTEDSCAN_H
+
+#define WORKER_EXIT_TIMEOUT_MS 30000 // Time local workers get to exit once the scan is done
+
+// True if the command line asks for a coordinator or worker instead of the GUI
+bool isDistributedScan(int argc, char *argv[]);
+
+/*
+ * Runs the coordinator or a worker of a distributed scan without a GUI and returns the exit code.
+ *
+ *  --coordinator [--config sdd_config.json] [--listen 127.0.0.1 [--allow-unencrypted]] [--port 7400]
+ *                [--results dir] [--file-list file] [--local-workers n] [--threads n] root...
+ *  --worker host[:port] [--threads n]
+ */
+int runDistributedScan(int argc, char *argv[]);
+
+#endif //SENSITIVE_DATA_DELETER_DISTRIBUTEDSCAN_H
@@ -0,0 +1,235 @@
+#include <QJsonArray>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+#include "exclusionrules.h"
+
+#define EXCLUDE_RULE_ID 0
+#define INCLUDE_RULE_ID 1
+
+// Folders and files that are skipped when the config does not list its own excludes
+static const char *const defaultExcludes[] = {
+        ".DS_Store", "desktop.ini", "Thumbs.db", ".git", "node_modules",
+        "build/", "dist/", "target/", "out/", "__pycache__/", ".gradle/",
+        "*.vmdk", "*.vdi", "*.vhd", "*.vhdx", "*.qcow2"
+};
+
+static std::string globToRegex(const std::string &glob) {
+    std::string regex;
+    for (size_t i = 0; i < glob.size(); i++) {
+        char c = glob[i];
+        if (c == '*') {
+            if (i + 1 < glob.size() && glob[i + 1] == '*') {
+                i++;
+                if (i + 1 < glob.size() && glob[i + 1] == '/') {
+                    i++;
+                    regex += "(?:.*/)?"; // "**/" also matches no folder at all
+                } else {
+                    regex += ".*";
+                }
+            } else {
+                regex += "[^/]*";
+            }
+        } else if (c == '?') {
+            regex += "[^/]";
+        } else if (c == '[' && glob.find(']', i + 2) != std::string::npos) {
+            size_t end = glob.find(']', i + 2);
+            regex += '[';
+            for (size_t j = i + 1; j < end; j++) {
+                if (j == i + 1 && glob[j] == '!') {
+                    regex += '^';
+                } else if (glob[j] == '\\' || glob[j] == '[' || (glob[j] == '^' && j == i + 1)) {
+                    regex += '\\';
+                    regex += glob[j];
+                } else {
+                    regex += glob[j];
+                }
+            }
+            regex += ']';
+            i = end;
+        } else {
+            if (std::strchr("\\.^$|()[]{}+", c)) {
+                regex += '\\';
+            }
+            regex += c;
+        }
+    }
+    return regex;
+}
+
+static std::string ruleToRegex(std::string glob) {
+    // A trailing "/" only matches folders, excludesPath() appends one to folder paths
+    bool folderOnly = glob.size() > 1 && glob.back() == '/';
+    while (glob.size() > 1 && glob.back() == '/') {
+        glob.pop_back();
+    }
+    // Everything below a matched folder is matched as well
+    std::string end = folderOnly ? "/" : "(?:/|$)";
+    if (glob.find('/') == std::string::npos) {
+        return "(?:^|/)" + globToRegex(glob) + end;
+    }
+    return "^" + globToRegex(glob) + end;
+}
+
+static int onRuleMatch(unsigned int id, unsigned long long, unsigned long long, unsigned int, void *ctx) {
+    *static_cast<unsigned int *>(ctx) |= 1u << id;
+    // An exclude decides the outcome, there is no need to look further
+    return id == EXCLUDE_RULE_ID ? 1 : 0;
+}
+
+ExclusionRules::ExclusionRules(const ExclusionRules &other) {
+    *this = other;
+}
+
+ExclusionRules &ExclusionRules::operator=(const ExclusionRules &other) {
+    if (this == &other) {
+        return *this;
+    }
+    excludeGlobs = other.excludeGlobs;
+    includeGlobs = other.includeGlobs;
+    minFileSize = other.minFileSize;
+    maxFileSize = other.maxFileSize;
+    minAgeDays = other.minAgeDays;
+    maxAgeDays = other.maxAgeDays;
+    database = other.database;
+
+    hs_free_scratch(scratch);
+    scratch = nullptr;
+    if (other.scratch && hs_clone_scratch(other.scratch, &scratch) != HS_SUCCESS) {
+        throw std::runtime_error("Could not allocate scratch space for the exclusion rules");
+    }
+    return *this;
+}
+
+ExclusionRules::~ExclusionRules() {
+    hs_free_scratch(scratch);
+}
+
+ExclusionRules ExclusionRules::fromJson(const QJsonObject &scanSettings) {
+    ExclusionRules rules;
+    QJsonObject obj = scanSettings["exclusions"].toObject();
+
+    if (obj.contains("exclude")) {
+        for (const auto &value: obj["exclude"].toArray()) {
+            rules.excludeGlobs.push_back(value.toString().toStdString());
+        }
+    } else {
+        rules.excludeGlobs.assign(std::begin(defaultExcludes), std::end(defaultExcludes));
+    }
+    for (const auto &value: obj["include"].toArray()) {
+        rules.includeGlobs.push_back(value.toString().toStdString());
+    }
+    rules.minFileSize = obj["minFileSize"].toInteger(0);
+    rules.maxFileSize = obj["maxFileSize"].toInteger(0);
+    rules.minAgeDays = obj["minAgeDays"].toInt(0);
+    rules.maxAgeDays = obj["maxAgeDays"].toInt(0);
+
+    rules.compile();
+    return rules;
+}
+
+void ExclusionRules::compile() {
+    std::vector<std::string> regexes;
+    std::vector<const char *> expressions;
+    std::vector<unsigned int> flags;
+    std::vector<unsigned int> ids;
+    std::vector<const std::string *> sources;
+
+    auto addRules = [&](const std::vector<std::string> &globs, unsigned int id) {
+        for (const auto &glob: globs) {
+            if (glob.empty()) {
+                continue;
+            }
+            regexes.push_back(ruleToRegex(glob));
+            sources.push_back(&glob);
+            ids.push_back(id);
+            unsigned int ruleFlags = HS_FLAG_SINGLEMATCH | HS_FLAG_DOTALL;
+#ifdef Q_OS_WIN
+            ruleFlags |= HS_FLAG_CASELESS;
+#endif
+            flags.push_back(ruleFlags);
+        }
+    };
+    addRules(excludeGlobs, EXCLUDE_RULE_ID);
+    addRules(includeGlobs, INCLUDE_RULE_ID);
+    if (regexes.empty()) {
+        return;
+    }
+    for (const auto &regex: regexes) {
+        expressions.push_back(regex.c_str());
+    }
+
+    hs_database_t *compiled = nullptr;
+    hs_compile_error_t *compileError = nullptr;
+    if (hs_compile_multi(expressions.data(), flags.data(), ids.data(), static_cast<unsigned int>(expressions.size()),
+                         HS_MODE_BLOCK, nullptr, &compiled, &compileError) != HS_SUCCESS) {
+        std::string message = "Failed to compile exclusion rules: " + std::string(compileError->message);
+        if (compileError->expression >= 0 && static_cast<size_t>(compileError->expression) < sources.size()) {
+            message = "Failed to compile exclusion rule \"" + *sources[compileError->expression] + "\": " +
+                      compileError->message;
+        }
+        hs_free_compile_error(compileError);
+        throw std::runtime_error(message);
+    }
+    database.reset(compiled, hs_free_database);
+
+    if (hs_alloc_scratch(database.get(), &scratch) != HS_SUCCESS) {
+        throw std::runtime_error("Could not allocate scratch space for the exclusion rules");
+    }
+}
+
+bool ExclusionRules::excludesPath(const std::string &path, bool isDirectory) const {
+    if (!database) {
+        return false;
+    }
+    unsigned int matched = 0;
+    std::string normalized;
+    const std::string *scanned = &path;
+#ifdef Q_OS_WIN
+    // The globs use "/", native paths are converted so they work for callers that pass those
+    if (path.find('\\') != std::string::npos) {
+        normalized = path;
+        std::replace(normalized.begin(), normalized.end(), '\\', '/');
+        scanned = &normalized;
+    }
+#endif
+    if (isDirectory && (scanned->empty() || scanned->back() != '/')) {
+        normalized = *scanned + '/';
+        scanned = &normalized;
+    }
+    hs_error_t err = hs_scan(database.get(), scanned->data(), static_cast<unsigned int>(scanned->size()), 0, scratch,
+                             onRuleMatch, &matched);
+    if (err != HS_SUCCESS && err != HS_SCAN_TERMINATED) {
+        return false;
+    }
+    if (matched & (1u << EXCLUDE_RULE_ID)) {
+        return true;
+    }
+    return !isDirectory && !includeGlobs.empty() && !(matched & (1u << INCLUDE_RULE_ID));
+}
+
+bool ExclusionRules::excludesFileStat(qint64 size, const QDateTime &lastModified) const {
+    if ((minFileSize > 0 && size < minFileSize) || (maxFileSize > 0 && size > maxFileSize)) {
+        return true;
+    }
+    if (minAgeDays == 0 && maxAgeDays == 0) {
+        return false;
+    }
+    qint64 ageDays = lastModified.daysTo(QDateTime::currentDateTime());
+    return (minAgeDays > 0 && ageDays < minAgeDays) || (maxAgeDays > 0 && ageDays > maxAgeDays);
+}
+
+std::string ExclusionRules::describe() const {
+    std::string text;
+    for (const auto &glob: excludeGlobs) {
+        text += "exclude " + glob + "\n";
+    }
+    for (const auto &glob: includeGlobs) {
+        text += "include " + glob + "\n";
+    }
+    text += "size " + std::to_string(minFileSize) + " " + std::to_string(maxFileSize) + "\n";
+    text += "age " + std::to_string(minAgeDays) + " " + std::to_string(maxAgeDays) + "\n";
+    return text;
+}
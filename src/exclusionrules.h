@@ -0,0 +1,64 @@
+#ifndef SENSITIVE_DATA_DELETER_EXCLUSIONRULES_H
+#define SENSITIVE_DATA_DELETER_EXCLUSIONRULES_H
+
+#include <QDateTime>
+#include <QJsonObject>
+#include <hs/hs.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Include and exclude rules of the "exclusions" object in "scanSettings", compiled into a single
+ * Hyperscan database so a path is checked against all globs with one hs_scan call.
+ *
+ * Globs without a "/" match any component of the path, so "node_modules" excludes every
+ * node_modules folder and everything below it, and "*.vmdk" every file ending in .vmdk. Globs
+ * containing a "/" are matched against the whole path and also exclude what is below the paths
+ * they match, so a plain absolute path works as a prefix. "*" and "?" stop at "/", "**" does not.
+ * A glob ending in "/" only matches folders, so "build/" skips build folders but not a file named build.
+ *
+ * Include globs only apply to files: if there are any, a file has to match one of them. Exclude
+ * rules always win. Size and age ranges are checked separately since they need the file's stat.
+ *
+ * The Hyperscan scratch is owned by the instance, so path checks of one instance must not run on
+ * several threads at once. Copies share the database and get a scratch of their own.
+ */
+class ExclusionRules {
+public:
+    ExclusionRules() = default;
+
+    ExclusionRules(const ExclusionRules &other);
+
+    ExclusionRules &operator=(const ExclusionRules &other);
+
+    ~ExclusionRules();
+
+    // Uses the default excludes if "exclude" is missing. Throws std::runtime_error if a glob does not compile.
+    static ExclusionRules fromJson(const QJsonObject &scanSettings);
+
+    // True if the directory should not be descended into, or the file should not be scanned. Paths
+    // with "\" separators are accepted on Windows.
+    bool excludesPath(const std::string &path, bool isDirectory) const;
+
+    // True if the file is outside the size or age range, safe to call from any thread
+    bool excludesFileStat(qint64 size, const QDateTime &lastModified) const;
+
+    // The rules as text, two instances with the same rules give the same text
+    std::string describe() const;
+
+private:
+    std::vector<std::string> excludeGlobs;
+    std::vector<std::string> includeGlobs;
+    qint64 minFileSize = 0; // Bytes, 0 for no limit
+    qint64 maxFileSize = 0;
+    int minAgeDays = 0; // Days since the last modification, 0 for no limit
+    int maxAgeDays = 0;
+
+    std::shared_ptr<hs_database_t> database;
+    hs_scratch_t *scratch = nullptr;
+
+    void compile();
+};
+
+#endif //SENSITIVE_DATA_DELETER_EXCLUSIONRULES_H
@@ -10,14 +10,36 @@
 #include <random>
 #include <iostream>
 #include <QFileInfo>
+#include <chrono>
+#include <unordered_set>
 
 #include "filescanner.h"
 #include "chunkreader.h"
+#include "blockclassifier.h"
+#include "tracing.h"
+#include "resultsstore.h"
 
-#define CHUNK_SIZE (64 * 1024)
 #define MAX_NUM_MATCHES 100 // Max number of matches per file that will be stored
 #define BATCH_SIZE 10
-
+#define SNIPPET_CONTEXT 30 // Bytes of context stored before the match
+#define SNIPPET_TRAILER 10 // Bytes of context stored after the match
+
+const char *scanResultName(ScanResult result) {
+    switch (result) {
+        case ScanResult::CLEAN:
+            return "clean";
+        case ScanResult::FLAGGED:
+            return "flagged";
+        case ScanResult::UNSUPPORTED_TYPE:
+            return "unsupported_type";
+        case ScanResult::UNREADABLE:
+            return "unreadable";
+        case ScanResult::FLAGGED_BUT_UNWRITABLE:
+            return "flagged_but_unwritable";
+        default:
+            return "undefined";
+    }
+}
 
 void
 FileScanner::scanFiles(QPromise<std::map<std::string, std::pair<ScanResult, std::vector<MatchInfo>>>> &promise,
@@ -25,68 +47,307 @@ FileScanner::scanFiles(QPromise<std::map<std::string, std::pair<ScanResult, std:
                        const std::vector<std::pair<std::string, std::string>> &patterns,
                        const std::map<std::string, std::string> &fileTypes) {
 
-    hs_compile_error_t *compile_err;
-    flags = std::vector<unsigned int>(patterns.size(), HS_FLAG_SINGLEMATCH | HS_FLAG_UTF8);
-    for (int i = 0; i < patterns.size(); ++i) {
-        ids.push_back(i);
-    }
-
-    for (const auto &item: patterns) {
-        scanPatterns.emplace_back(item.first.c_str());
-        scanPatternDescriptions.emplace_back(item.second.c_str());
+    // A database compiled beforehand with the same patterns is reused and stays loaded, so a worker
+    // scanning many small jobs compiles only once
+    bool precompiled = database && compiledPatterns == patterns;
+    if (!precompiled) {
+        try {
+            compilePatterns(patterns);
+        } catch (const std::runtime_error &) {
+            promise.setException(std::current_exception());
+            promise.finish();
+            return;
+        }
     }
 
-    if (hs_compile_multi(scanPatterns.data(), flags.data(), ids.data(), scanPatterns.size(), HS_MODE_BLOCK,
-                         &platformInfo, &database, &compile_err) != HS_SUCCESS) {
-        QString errorMessage = QString("Failed to compile patterns: %1").arg(compile_err->message);
-        hs_free_compile_error(compile_err);
-        ids.clear();
-        flags.clear();
-        scanPatterns.clear();
-        scanPatternDescriptions.clear();
+    setFileTypes(fileTypes);
 
-        promise.setException(std::make_exception_ptr(std::runtime_error(errorMessage.toStdString())));
-        promise.finish();
-        return;
+    std::unique_ptr<ResultsStoreWriter> writer;
+    if (!scanSettings.resultsPath.empty()) {
+        try {
+            uint64_t fingerprint = configFingerprint(compiledPatterns, patternOptions, scanFileTypes, binaryFileTypes,
+                                                     scanSettings);
+            writer = std::make_unique<ResultsStoreWriter>(scanSettings.resultsPath, scanPatterns,
+                                                          scanPatternDescriptions, fingerprint,
+                                                          scanSettings.checkpointIntervalSeconds, scanSettings.resume);
+            if (writer->isResumed()) {
+                loadResumedResults(filePaths, *writer);
+            } else if (scanSettings.resume) {
+                qWarning() << "The scan in" << QString::fromStdString(scanSettings.resultsPath)
+                           << "was made with another config and can not be resumed, starting over";
+            }
+        } catch (std::exception &e) {
+            qWarning() << "Scan results will not be saved: " << e.what();
+            writer.reset();
+            matches.clear();
+        }
+    }
+    resultsWriter = writer.get();
+
+    uint32_t numThreads = scanSettings.numThreads > 0 ? scanSettings.numThreads
+                                                      : std::max(1u, std::thread::hardware_concurrency());
+    topology = CpuTopology::detect();
+    bool numaWorkers = scanSettings.workerTopology == "numa" ||
+                       (scanSettings.workerTopology == "auto" && topology.nodes.size() > 1);
+    std::vector<WorkerSlot> slots;
+    if (numaWorkers) {
+        slots = topology.workerSlots(numThreads);
     }
+    file_queue.reset(numaWorkers ? topology.nodes.size() : 1);
 
+    // Files an interrupted scan finished are not scanned again
+    std::vector<std::string> pendingFiles;
     for (const auto &item: filePaths) {
-        file_queue.push(std::filesystem::path(item));
+        if (matches.count(item) == 0) {
+            pendingFiles.push_back(item);
+        }
+    }
+    if (!matches.empty()) {
+        qDebug() << "Resuming scan," << matches.size() << "of" << filePaths.size() << "files were scanned already";
+    }
+    // Every node gets a contiguous part of the list in proportion to its threads, files next to each
+    // other in the list are mostly in the same folder
+    std::vector<size_t> nodeThreads(file_queue.numNodes(), 0);
+    for (const auto &slot: slots) {
+        nodeThreads[slot.node]++;
+    }
+    size_t pendingIndex = 0;
+    size_t threadsBefore = 0;
+    for (size_t node = 0; node < file_queue.numNodes(); node++) {
+        threadsBefore += slots.empty() ? numThreads : nodeThreads[node];
+        size_t nodeEnd = node + 1 == file_queue.numNodes() ? pendingFiles.size()
+                                                           : pendingFiles.size() * threadsBefore / numThreads;
+        for (; pendingIndex < nodeEnd; pendingIndex++) {
+            file_queue.push(node, std::filesystem::path(pendingFiles[pendingIndex]));
+        }
     }
-
-    this->scanFileTypes = fileTypes;
 
     // Scan files based on given patterns and file types with multiple threads
-    filesProcessed = 0;
+    filesProcessed = matches.size();
     std::vector<std::thread> threads;
-    uint32_t numThreads = std::thread::hardware_concurrency();
+    metrics.reset(numThreads, scanPatternDescriptions);
+    ResourceGovernor resourceGovernor(scanSettings.resourceLimits, numThreads,
+                                      [&promise]() { return promise.isCanceled(); });
+    governor = &resourceGovernor;
+    scanPromise = &promise;
+    if (scanSettings.parserSandbox.enabled) {
+        if (ParserPool::isSupported()) {
+            parserPool = std::make_unique<ParserPool>(scanSettings.parserSandbox,
+                                                      scanSettings.parserSandbox.helpers > 0
+                                                      ? scanSettings.parserSandbox.helpers : numThreads);
+        } else {
+            qWarning() << "The parser sandbox is not supported on this system, files are parsed in process";
+        }
+    }
 
-    for (uint32_t j = 0; j < numThreads; j++) {
-        threads.emplace_back(&FileScanner::scannerWorker, this,
-                             std::ref(promise), std::ref(filesProcessed), filePaths.size());
+    // Periodically dump the metrics so long scans can be watched while they run
+    std::mutex reporterMutex;
+    std::condition_variable reporterCond;
+    bool scanFinished = false;
+    std::thread reporter;
+    if (!scanSettings.metricsPath.empty()) {
+        reporter = std::thread([this, &reporterMutex, &reporterCond, &scanFinished]() {
+            std::unique_lock<std::mutex> lock(reporterMutex);
+            auto interval = std::chrono::seconds(std::max(1, scanSettings.metricsIntervalSeconds));
+            while (!reporterCond.wait_for(lock, interval, [&scanFinished] { return scanFinished; })) {
+                metrics.writeToFile(scanSettings.metricsPath);
+            }
+        });
     }
 
-    file_queue.set_done();
+    for (uint32_t j = 0; j < numThreads; j++) {
+        threads.emplace_back(&FileScanner::scannerWorker, this, std::ref(promise), std::ref(filesProcessed),
+                             filePaths.size(), j, slots.empty() ? nullptr : &slots[j]);
+    }
 
     for (auto &thread: threads) {
         thread.join();
     }
 
-    promise.addResult(matches);
+    if (reporter.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(reporterMutex);
+            scanFinished = true;
+        }
+        reporterCond.notify_all();
+        reporter.join();
+        metrics.writeToFile(scanSettings.metricsPath);
+    }
+
+    governor = nullptr;
+    scanPromise = nullptr;
+    parserPool.reset();
+    bool canceled = promise.isCanceled();
+    if (writer) {
+        // A cancelled scan keeps its checkpoint so that it can be resumed
+        if (canceled) {
+            writer->interrupt();
+        } else {
+            writer->finish();
+        }
+        resultsWriter = nullptr;
+    }
+
+    if (!canceled) {
+        promise.addResult(matches);
+    }
 
     // Clear the scanner state
-    hs_free_database(database);
     matches.clear();
+    file_queue.reset(1);
+    if (!precompiled) {
+        releasePatterns();
+    }
+    promise.finish();
+}
+
+void FileScanner::compilePatterns(const std::vector<std::pair<std::string, std::string>> &patterns) {
+    releasePatterns();
+    // The database refers to the pattern strings by pointer, keep them alive as long as it exists
+    compiledPatterns = patterns;
+
+    hs_compile_error_t *compile_err;
+    for (int i = 0; i < compiledPatterns.size(); ++i) {
+        ids.push_back(i);
+    }
+
+    for (const auto &item: compiledPatterns) {
+        scanPatterns.emplace_back(item.first.c_str());
+        scanPatternDescriptions.emplace_back(item.second.c_str());
+
+        PatternOptions options;
+        if (patternOptions.count(item.first)) {
+            options = patternOptions.at(item.first);
+        }
+        patternValidators.push_back(validatorFromName(options.validator));
+        patternSomHorizons.push_back(options.somHorizon);
+        flags.push_back(compileFlags(options));
+    }
+
+    if (hs_compile_multi(scanPatterns.data(), flags.data(), ids.data(), scanPatterns.size(), HS_MODE_BLOCK,
+                         &platformInfo, &database, &compile_err) != HS_SUCCESS) {
+        QString errorMessage = QString("Failed to compile patterns: %1").arg(compile_err->message);
+        if (compile_err->expression >= 0 && compile_err->expression < scanPatternDescriptions.size()) {
+            errorMessage = QString("Failed to compile pattern \"%1\": %2")
+                    .arg(scanPatternDescriptions[compile_err->expression], compile_err->message);
+        }
+        hs_free_compile_error(compile_err);
+        database = nullptr;
+        releasePatterns();
+        throw std::runtime_error(errorMessage.toStdString());
+    }
+    metrics.reset(1, scanPatternDescriptions);
+}
+
+void FileScanner::releasePatterns() {
+    hs_free_database(database);
+    database = nullptr;
     scanPatterns.clear();
     scanPatternDescriptions.clear();
+    patternValidators.clear();
+    patternSomHorizons.clear();
     ids.clear();
     flags.clear();
-    promise.finish();
+    compiledPatterns.clear();
 }
 
-void FileScanner::scannerWorker(QPromise<std::map<std::string, std::pair<ScanResult, std::vector<MatchInfo>>>> &promise,
-                                std::atomic<size_t> &filesProcessed,
-                                size_t totalFiles) {
+bool FileScanner::scanInterrupted() {
+    if (!scanPromise) {
+        return false;
+    }
+    scanPromise->suspendIfRequested();
+    return scanPromise->isCanceled();
+}
+
+uint64_t FileScanner::configFingerprint(const std::vector<std::pair<std::string, std::string>> &patterns,
+                                        const std::map<std::string, PatternOptions> &patternOptions,
+                                        const std::map<std::string, std::string> &fileTypes,
+                                        const std::set<std::string> &binaryFileTypes,
+                                        const ScanSettings &settings) {
+    // FNV-1a, every field ends with a byte that UTF-8 never contains
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const std::string &text) {
+        for (char c: text) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+        }
+        hash = (hash ^ 0xFF) * 1099511628211ull;
+    };
+    for (const auto &pattern: patterns) {
+        add(pattern.first);
+        add(pattern.second);
+        auto options = patternOptions.find(pattern.first);
+        if (options != patternOptions.end()) {
+            add(options->second.validator);
+            add(std::to_string(options->second.somHorizon));
+        }
+    }
+    for (const auto &fileType: fileTypes) {
+        add(fileType.first);
+    }
+    for (const auto &fileType: binaryFileTypes) {
+        add("binary " + fileType);
+    }
+    // Files the sandboxed readers give up on are reported unreadable instead of being scanned in-process
+    if (settings.parserSandbox.enabled) {
+        add("sandbox " + std::to_string(settings.parserSandbox.memoryLimitMB) + " " +
+            std::to_string(settings.parserSandbox.timeoutSeconds));
+    }
+    add(settings.fileSelection);
+    return hash;
+}
+
+void FileScanner::loadResumedResults(const std::vector<std::string> &filePaths, ResultsStoreWriter &writer) {
+    std::unordered_set<std::string> listed(filePaths.begin(), filePaths.end());
+    std::vector<std::pair<size_t, size_t>> stale;
+    try {
+        ResultsStore store(QString::fromStdString(scanSettings.resultsPath));
+        size_t begin = 0;
+        while (begin < store.recordCount()) {
+            size_t end = store.fileEnd(begin);
+            const StoredRecord &first = store.record(begin);
+            std::string path(store.string(first.pathOffset, first.pathLength));
+            if (!first.superseded) {
+                // Files that are no longer listed or changed since they were scanned are dropped from the results,
+                // the changed ones are scanned again
+                QFileInfo fileInfo(QString::fromStdString(path));
+                if (listed.count(path) == 0 || !fileInfo.exists() ||
+                    fileInfo.lastModified().toMSecsSinceEpoch() != first.modifiedTime ||
+                    static_cast<uint64_t>(fileInfo.size()) != first.fileSize) {
+                    stale.emplace_back(begin, end);
+                } else {
+                    matches[path] = store.fileResult(begin, end);
+                }
+            }
+            begin = end;
+        }
+    } catch (std::exception &e) {
+        // The files are all scanned again, so none of the old records may show up next to the new ones
+        qWarning() << "Could not read the interrupted scan: " << e.what();
+        matches.clear();
+        writer.supersede(0, UINT64_MAX);
+        return;
+    }
+    for (const auto &[begin, end]: stale) {
+        writer.supersede(begin, end);
+    }
+    if (!stale.empty()) {
+        qDebug() << stale.size() << "files changed since the scan was interrupted";
+    }
+}
+
+void FileScanner::setFileTypes(const std::map<std::string, std::string> &fileTypes) {
+    scanFileTypes = fileTypes;
+}
+
+void FileScanner::setBinaryFileTypes(const std::set<std::string> &fileTypes) {
+    binaryFileTypes = fileTypes;
+}
+
+bool FileScanner::isScannedType(const std::filesystem::path &filePath) const {
+    return scanFileTypes.count(filePath.extension().string()) > 0;
+}
+
+hs_scratch_t *FileScanner::allocateScratch() const {
     hs_scratch_t *scratch = nullptr;
     hs_error_t err = hs_alloc_scratch(database, &scratch);
     if (err != HS_SUCCESS) {
@@ -107,16 +368,72 @@ void FileScanner::scannerWorker(QPromise<std::map<std::string, std::pair<ScanRes
                 qDebug() << "ERROR: Unable to allocate scratch space. Unknown error occurred.";
                 break;
         }
+        return nullptr;
+    }
+    return scratch;
+}
+
+std::pair<ScanResult, std::vector<MatchInfo>>
+FileScanner::scanFile(const std::filesystem::path &filePath, hs_scratch_t *scratch) {
+    auto result = scanFileForSensitiveData(filePath, scratch, metrics.forThread(0));
+    ThreadMetrics::add(metrics.forThread(0).filesByResult[result.first], 1);
+    return result;
+}
+
+void FileScanner::scannerWorker(QPromise<std::map<std::string, std::pair<ScanResult, std::vector<MatchInfo>>>> &promise,
+                                std::atomic<size_t> &filesProcessed,
+                                size_t totalFiles,
+                                size_t threadIndex,
+                                const WorkerSlot *slot) {
+    // Pinned before anything is allocated, so the scratch and buffers of the thread are on its node
+    size_t node = 0;
+    if (slot) {
+        node = slot->node;
+        if (!topology.pinCurrentThread(*slot)) {
+            qDebug() << "Could not pin scanner thread" << threadIndex << "to CPU" << slot->cpu;
+        }
+    }
+    hs_scratch_t *scratch = allocateScratch();
+    if (!scratch) {
         return;
     }
 
+    governor->applyThreadPriority();
+    ThreadMetrics &threadMetrics = metrics.forThread(threadIndex);
     std::filesystem::path filePath;
-    while (file_queue.pop(filePath)) {
-        auto result = scanFileForSensitiveData(filePath, scratch);
+    bool stolen = false;
+    while (!scanInterrupted()) {
+        auto waitStart = std::chrono::steady_clock::now();
+        bool turn = governor->waitForTurn(static_cast<uint32_t>(threadIndex));
+        ThreadMetrics::addElapsed(threadMetrics.throttleNanos, waitStart);
+        if (!turn || !file_queue.pop(node, filePath, stolen)) {
+            break;
+        }
+        if (stolen) {
+            ThreadMetrics::add(threadMetrics.filesStolen, 1);
+        }
+        // Taken before the file is read, so a change while it is scanned makes a resumed scan read it again
+        int64_t modifiedTime = 0;
+        uint64_t fileSize = 0;
+        if (resultsWriter) {
+            QFileInfo fileInfo(QString::fromStdString(filePath.string()));
+            modifiedTime = fileInfo.lastModified().toMSecsSinceEpoch();
+            fileSize = static_cast<uint64_t>(fileInfo.size());
+        }
+        auto result = scanFileForSensitiveData(filePath, scratch, threadMetrics);
+        // The file may have been cut short, it is scanned again when the scan is resumed
+        if (scanInterrupted()) {
+            break;
+        }
+        ThreadMetrics::add(threadMetrics.filesByResult[result.first], 1);
         {
+            SDD_TRACE_SCOPE("insertResult");
             std::lock_guard<std::mutex> lock(matches_mutex);
             matches[filePath.string()] = result;
         }
+        if (resultsWriter) {
+            resultsWriter->append(filePath.string(), modifiedTime, fileSize, result);
+        }
         size_t processed = ++filesProcessed;
         promise.setProgressValue(static_cast<int>((processed * 100) / totalFiles));
     }
@@ -125,18 +442,28 @@ void FileScanner::scannerWorker(QPromise<std::map<std::string, std::pair<ScanRes
 }
 
 std::pair<ScanResult, std::vector<MatchInfo>>
-FileScanner::scanFileForSensitiveData(const std::filesystem::path &filePath, hs_scratch_t *threadScratch) {
+FileScanner::scanFileForSensitiveData(const std::filesystem::path &filePath, hs_scratch_t *threadScratch,
+                                      ThreadMetrics &threadMetrics) {
 
     // Check if the file extension exists in the file types map
-    if (scanFileTypes.find(filePath.extension().string()) == scanFileTypes.end()) {
+    if (!isScannedType(filePath)) {
         return std::make_pair(ScanResult::UNSUPPORTED_TYPE, std::vector<MatchInfo>());
     }
     // If the file is not a text file based on MIME type, skip the file
+    // File types configured for binary mode fall back to extracting strings from the raw bytes
     QMimeType mimeType = QMimeDatabase().mimeTypeForFile(QString::fromStdString(filePath.string()));
+    bool extractStrings = false;
     if (!mimeType.inherits("text/plain") &&
         !mimeType.inherits("application/pdf") &&
-        !mimeType.inherits("application/zip")) {
-        return std::make_pair(ScanResult::UNSUPPORTED_TYPE, std::vector<MatchInfo>());
+        !mimeType.inherits("application/zip") &&
+        !ChunkReaderFactory::isTar(mimeType) &&
+        !ChunkReaderFactory::isMail(mimeType) &&
+        !ChunkReaderFactory::isOle(mimeType) &&
+        !ChunkReaderFactory::isCompressed(mimeType)) {
+        if (binaryFileTypes.count(filePath.extension().string()) == 0) {
+            return std::make_pair(ScanResult::UNSUPPORTED_TYPE, std::vector<MatchInfo>());
+        }
+        extractStrings = true;
     }
     QFileInfo fileInfo(QString::fromStdString(filePath.string()));
     if (!fileInfo.isReadable()) {
@@ -144,11 +471,22 @@ FileScanner::scanFileForSensitiveData(const std::filesystem::path &filePath, hs_
     }
 
     auto returnPair = std::make_pair(ScanResult::CLEAN, std::vector<MatchInfo>());
-    ScanContext scanContext(&returnPair, &scanPatterns, &scanPatternDescriptions, nullptr);
-    
+    ScanContext scanContext(&returnPair, &scanPatterns, &scanPatternDescriptions, &patternValidators,
+                            &patternSomHorizons, nullptr);
+    scanContext.metrics = &threadMetrics;
+
     std::unique_ptr<ChunkReader> chunkReader;
     try {
-        chunkReader.reset(ChunkReaderFactory::createReader(filePath));
+        SDD_TRACE_SCOPE("createReader");
+        auto extractStart = std::chrono::steady_clock::now();
+        ChunkReaderType readerType = extractStrings ? ChunkReaderType::BINARY_STRINGS_READER
+                                                    : ChunkReaderFactory::readerTypeFor(mimeType);
+        if (parserPool && SandboxedChunkReader::isSandboxed(readerType)) {
+            chunkReader = std::make_unique<SandboxedChunkReader>(*parserPool, filePath, readerType);
+        } else {
+            chunkReader.reset(ChunkReaderFactory::createReader(filePath, readerType));
+        }
+        ThreadMetrics::addElapsed(threadMetrics.extractNanos, extractStart);
         if (!chunkReader) {
             return std::make_pair(ScanResult::UNREADABLE, std::vector<MatchInfo>());
         }
@@ -157,18 +495,84 @@ FileScanner::scanFileForSensitiveData(const std::filesystem::path &filePath, hs_
         return std::make_pair(ScanResult::UNREADABLE, std::vector<MatchInfo>());
     }
 
-    while (true) {
+    // Chunks are decoded to UTF-8 first, the patterns are compiled with HS_FLAG_UTF8
+    TextDecoder decoder;
+    auto scanText = [this, &scanContext, &chunkReader, threadScratch](std::string_view text,
+                                                                      const OffsetMap *offsetMap) {
+        if (text.empty()) {
+            return;
+        }
+        scanContext.location = chunkReader->currentLocation();
+        scanContext.chunk = text.data();
+        scanContext.chunkLength = text.size();
+        scanContext.offsetMap = offsetMap;
+        std::fill(scanContext.reportedPatterns.begin(), scanContext.reportedPatterns.end(), 0);
+        scanChunkWithRegex(text.data(), text.size(), scanContext, threadScratch);
+    };
+
+    bool firstChunk = true;
+    while (!scanInterrupted()) {
         char buffer[CHUNK_SIZE];
-        std::memset(buffer, 0, CHUNK_SIZE);
-        scanContext.chunk = buffer;
-        size_t numBytesRead = chunkReader->readChunkFromFile(buffer, CHUNK_SIZE);
+        // Sandboxed readers point chunk at the text in shared memory instead of copying it
+        const char *chunk = buffer;
+        auto readStart = std::chrono::steady_clock::now();
+        size_t numBytesRead;
+        {
+            SDD_TRACE_SCOPE("readChunkFromFile");
+            numBytesRead = chunkReader->readChunk(chunk, buffer, CHUNK_SIZE);
+        }
+        ThreadMetrics::addElapsed(threadMetrics.readNanos, readStart);
         if (numBytesRead == 0) {
             break;
         } else if (numBytesRead == -1) {
+            // The archive moved on to its next file, which can be in a different encoding
+            scanText(decoder.finish(), &decoder.offsetMap());
+            decoder.restart();
             continue;
         }
+        ThreadMetrics::add(threadMetrics.bytesRead[chunkReader->readerType()], numBytesRead);
+        if (governor) {
+            auto throttleStart = std::chrono::steady_clock::now();
+            governor->throttleRead(numBytesRead);
+            ThreadMetrics::addElapsed(threadMetrics.throttleNanos, throttleStart);
+        }
 
-        scanChunkWithRegex(buffer, scanContext, threadScratch);
+        // A whitelisted extension does not make the file text, check the first block before reading on.
+        // Only the raw bytes of a plaintext file can be searched for strings instead.
+        bool plainText = chunkReader->readerType() == ChunkReaderType::PLAIN_TEXT_READER;
+        if (firstChunk && (plainText || chunkReader->readerType() == ChunkReaderType::COMPRESSED_READER) &&
+            isBinaryBlock(chunk, std::min(numBytesRead, static_cast<size_t>(FIRST_BLOCK_SIZE)))) {
+            if (!plainText || binaryFileTypes.count(filePath.extension().string()) == 0) {
+                ThreadMetrics::add(threadMetrics.binaryFilesRejected, 1);
+                return std::make_pair(ScanResult::UNSUPPORTED_TYPE, std::vector<MatchInfo>());
+            }
+            ThreadMetrics::add(threadMetrics.binaryFilesRerouted, 1);
+            try {
+                chunkReader = std::make_unique<BinaryStringsChunkReader>(filePath);
+            } catch (std::exception &e) {
+                qWarning() << "Error creating ChunkReader: " << e.what() << " for file: " << filePath.string();
+                return std::make_pair(ScanResult::UNREADABLE, std::vector<MatchInfo>());
+            }
+            firstChunk = false;
+            continue;
+        }
+        firstChunk = false;
+
+        if (const OffsetMap *readerMap = chunkReader->offsetMap()) {
+            scanText(std::string_view(chunk, numBytesRead), readerMap);
+        } else {
+            scanText(decoder.decode(chunk, numBytesRead), &decoder.offsetMap());
+        }
+    }
+    // The text the decoder still holds was read before any failure, so it is scanned first
+    scanText(decoder.finish(), &decoder.offsetMap());
+    // The parser crashed or gave up part way, the file is not known to be clean. Matches found
+    // before that are kept, they are in the file whatever comes after them.
+    if (chunkReader->extractionFailed()) {
+        ThreadMetrics::add(threadMetrics.parserFailures, 1);
+        if (returnPair.first != ScanResult::FLAGGED) {
+            return std::make_pair(ScanResult::UNREADABLE, std::vector<MatchInfo>());
+        }
     }
 
     if (returnPair.first == ScanResult::FLAGGED && !fileInfo.isWritable()) {
@@ -186,25 +590,93 @@ int FileScanner::eventHandler(uint32_t id, uint64_t from, uint64_t to, uint32_t
         return 0;
     }
 
-    uint64_t startIndex = to > 30 ? to - 30 : 0;
-    uint64_t endIndex = to + 10 > CHUNK_SIZE ? CHUNK_SIZE : to + 10;
+    MatchValidator validator = scanContext->patternValidators->at(id);
+    uint32_t somHorizon = scanContext->patternSomHorizons->at(id);
+    if (validator != MatchValidator::NO_VALIDATOR || somHorizon > 0) {
+        if (scanContext->reportedPatterns[id]) {
+            return 0;
+        }
+        // Drop matches that fail the checksum before anything is allocated for them
+        if (validator != MatchValidator::NO_VALIDATOR &&
+            !validateMatch(validator, scanContext->chunk, scanContext->chunkLength, from, to)) {
+            ThreadMetrics::add(scanContext->metrics->validatorRejections, 1);
+            return 0;
+        }
+        scanContext->reportedPatterns[id] = 1;
+    }
+
+    // Without SOM the start of the match is unknown, guess it from the end
+    bool exactStart = somHorizon > 0 && to - from <= somHorizon;
+    uint64_t matchStart = exactStart ? from : (to > SNIPPET_CONTEXT ? to - SNIPPET_CONTEXT : 0);
+    uint64_t snippetStart = matchStart;
+    if (exactStart) {
+        snippetStart = from > SNIPPET_CONTEXT ? from - SNIPPET_CONTEXT : 0;
+    }
+    uint64_t snippetEnd = std::min(to + SNIPPET_TRAILER, static_cast<uint64_t>(scanContext->chunkLength));
+    ThreadMetrics::add(scanContext->metrics->patternMatches[id], 1);
     scanContext->returnPair->first = ScanResult::FLAGGED;
     scanContext->returnPair->second.emplace_back(
         std::make_pair(scanContext->scanPatterns->at(id), scanContext->scanPatternDescriptions->at(id)),
-        std::string(scanContext->chunk + startIndex, scanContext->chunk + endIndex),
-        startIndex,
-        to
+        std::string(scanContext->chunk + snippetStart, scanContext->chunk + snippetEnd),
+        scanContext->offsetMap->toSource(matchStart),
+        scanContext->offsetMap->toSource(to),
+        exactStart,
+        scanContext->location
     );
 
     return 0;
 }
 
 
-void FileScanner::scanChunkWithRegex(const char *chunk,
+void FileScanner::scanChunkWithRegex(const char *chunk, size_t length,
                                      ScanContext &scanContext, hs_scratch_t *scratch) {
-    if (hs_scan(database, chunk, CHUNK_SIZE, 0, scratch, &eventHandler, &scanContext) != HS_SUCCESS) {
-        qDebug() << "ERROR: Unable to scan input buffer. Likely encountered invalid UTF-8 sequence.";
+    SDD_TRACE_SCOPE("hs_scan");
+    auto matchStart = std::chrono::steady_clock::now();
+    if (hs_scan(database, chunk, static_cast<unsigned int>(length), 0, scratch, &eventHandler, &scanContext) !=
+        HS_SUCCESS) {
+        qDebug() << "ERROR: Unable to scan input buffer.";
+    }
+    ThreadMetrics::addElapsed(scanContext.metrics->matchNanos, matchStart);
+    ThreadMetrics::add(scanContext.metrics->bytesScanned, length);
+}
+
+void FileScanner::setPatternOptions(const std::map<std::string, PatternOptions> &options) {
+    patternOptions = options;
+}
+
+void FileScanner::setScanSettings(const ScanSettings &settings) {
+    scanSettings = settings;
+}
+
+const ScanSettings &FileScanner::getScanSettings() const {
+    return scanSettings;
+}
+
+ScanSettings ScanSettings::fromJson(const QJsonObject &obj) {
+    ScanSettings settings;
+    settings.metricsPath = obj["metricsPath"].toString().toStdString();
+    settings.metricsIntervalSeconds = obj["metricsIntervalSeconds"].toInt(settings.metricsIntervalSeconds);
+    settings.tracePath = obj["tracePath"].toString().toStdString();
+    settings.numThreads = obj["numThreads"].toInt(settings.numThreads);
+    settings.workerTopology = obj["workerTopology"].toString("auto").toStdString();
+    settings.resultsPath = obj["resultsPath"].toString().toStdString();
+    settings.checkpointIntervalSeconds = obj["checkpointIntervalSeconds"].toInt(settings.checkpointIntervalSeconds);
+    settings.resourceLimits = ResourceLimits::fromJson(obj["resourceLimits"].toObject());
+    settings.parserSandbox = ParserSandboxSettings::fromJson(obj["parserSandbox"].toObject());
+    return settings;
+}
+
+uint32_t FileScanner::compileFlags(const PatternOptions &options) {
+    // Validated patterns need to see every candidate, not just the first one in a chunk.
+    // HS_FLAG_SINGLEMATCH can not be combined with HS_FLAG_SOM_LEFTMOST, so those are deduplicated
+    // in the event handler as well.
+    uint32_t patternFlags = HS_FLAG_UTF8;
+    if (options.somHorizon > 0 || validatorNeedsStart(validatorFromName(options.validator))) {
+        patternFlags |= HS_FLAG_SOM_LEFTMOST;
+    } else if (validatorFromName(options.validator) == MatchValidator::NO_VALIDATOR) {
+        patternFlags |= HS_FLAG_SINGLEMATCH;
     }
+    return patternFlags;
 }
 
 /**
@@ -9,11 +9,14 @@
 #include <string>
 #include <regex>
 #include <map>
+#include <set>
 #include <utility>
 #include <QPromise>
 #include <QMetaObject>
 #include <filesystem>
 #include <queue>
+#include <deque>
+#include <memory>
 #include <functional>
 #include <condition_variable>
 #include <atomic>
@@ -21,8 +24,18 @@
 #include <filesystem>
 #include <algorithm>
 #include <thread>
+#include <QJsonObject>
 #include <hs/hs.h>
 
+#include "validators.h"
+#include "scanmetrics.h"
+#include "textdecoder.h"
+#include "resourcegovernor.h"
+#include "cputopology.h"
+#include "parsersandbox.h"
+
+#define CHUNK_SIZE (64 * 1024) // Bytes read and scanned at a time, the pattern analyzer and benchmarks use the same
+
 enum ScanResult {
     UNDEFINED,
     CLEAN,
@@ -32,70 +45,142 @@ enum ScanResult {
     FLAGGED_BUT_UNWRITABLE,
 };
 
+const char *scanResultName(ScanResult result);
+
 struct MatchInfo {
     std::pair<std::string, std::string> patternUsed;
     std::string match;
-    size_t startIndex;
+    size_t startIndex; // Offsets into the text stream read from the file, before it was decoded to UTF-8
     size_t endIndex;
+    bool exactStart; // False if startIndex is an estimate because the pattern was compiled without SOM
+    std::string location; // Member, message or part of a container file the match is in, empty for other files
 
     MatchInfo(const std::pair<std::string, std::string> &pattern,
               const std::string &mtch,
               size_t startIdx,
-              size_t endIdx)
+              size_t endIdx,
+              bool exact = false,
+              const std::string &loc = std::string())
         : patternUsed(pattern), 
           match(mtch), 
           startIndex(startIdx), 
-          endIndex(endIdx) {}
+          endIndex(endIdx),
+          exactStart(exact),
+          location(loc) {}
+};
+
+// Per-pattern options read from the scan config
+struct PatternOptions {
+    std::string validator;
+    // Longest match in bytes for which the exact start offset is reported. 0 compiles the
+    // pattern without HS_FLAG_SOM_LEFTMOST and the start is estimated from the end offset.
+    uint32_t somHorizon = 0;
+};
+
+// Scanner settings read from the "scanSettings" object of the scan config
+struct ScanSettings {
+    std::string metricsPath; // Scan metrics are written here periodically and when the scan ends
+    int metricsIntervalSeconds = 10;
+    std::string tracePath; // Chrome trace of the scan, only written in builds with SDD_ENABLE_TRACING
+    int numThreads = 0; // Scanner threads, 0 uses one per hardware thread
+    // "flat" runs unpinned threads on one shared queue, "numa" pins groups of threads to the cores of
+    // each NUMA node and gives every node its own queue, "auto" picks numa on machines with several nodes
+    std::string workerTopology = "auto";
+    std::string resultsPath; // Directory the results store is written to while the scan runs, empty disables it
+    int checkpointIntervalSeconds = 30; // Longest time between checkpoints of the results store
+    // Continue the interrupted scan in resultsPath if it was made with the same config, set by the caller
+    // when the user chose to resume. Otherwise the store in resultsPath is started over.
+    bool resume = false;
+    std::string fileSelection; // Exclusions and date range the file list was made with, set by the caller
+    ResourceLimits resourceLimits; // Read rate, priority and load limits of the scanner threads
+    ParserSandboxSettings parserSandbox; // Runs the PDF, XML and container readers in sandboxed helper processes
+
+    static ScanSettings fromJson(const QJsonObject &obj);
 };
 
 struct ScanContext {
     std::pair<ScanResult, std::vector<MatchInfo>> *returnPair;
     std::vector<const char *> *scanPatterns;
     std::vector<const char *> *scanPatternDescriptions;
-    const char *chunk;
+    std::vector<MatchValidator> *patternValidators;
+    std::vector<uint32_t> *patternSomHorizons;
+    // Patterns already reported in the current chunk, emulates HS_FLAG_SINGLEMATCH for
+    // validated patterns and patterns compiled with HS_FLAG_SOM_LEFTMOST
+    std::vector<uint8_t> reportedPatterns;
+    const char *chunk; // UTF-8 text handed to Hyperscan
+    size_t chunkLength = 0;
+    const OffsetMap *offsetMap = nullptr; // Maps offsets in the chunk to the text stream read from the file
+    std::string location; // ChunkReader::currentLocation() of the chunk
+    ThreadMetrics *metrics = nullptr;
 
     ScanContext(std::pair<ScanResult, std::vector<MatchInfo>> *retPair,
                 std::vector<const char *> *patterns,
                 std::vector<const char *> *descriptions,
+                std::vector<MatchValidator> *validators,
+                std::vector<uint32_t> *somHorizons,
                 const char *chnk)
         : returnPair(retPair), 
           scanPatterns(patterns), 
           scanPatternDescriptions(descriptions), 
+          patternValidators(validators),
+          patternSomHorizons(somHorizons),
+          reportedPatterns(patterns->size(), 0),
           chunk(chnk) {}
 };
 
-class ThreadSafeQueue {
+/**
+ * Files left to scan, one queue per NUMA node. Workers take files from the queue of their own node
+ * and only steal from the other nodes once it is empty, taking from the end the owners get to last.
+ * With one node this is a single queue shared by all workers. Filled before the workers start.
+ */
+class WorkQueues {
 private:
-    std::mutex mutex;
-    std::condition_variable cond;
-    bool done = false;
+    struct alignas(64) NodeQueue {
+        std::mutex mutex;
+        std::deque<std::filesystem::path> files;
+    };
+    std::vector<std::unique_ptr<NodeQueue>> queues;
 
 public:
-    std::vector<std::filesystem::path> queue;
-
-    void push(const std::filesystem::path &item) {
-        std::lock_guard<std::mutex> lock(mutex);
-        queue.push_back(item);
-        cond.notify_one();
+    void reset(size_t numNodes) {
+        queues.clear();
+        for (size_t i = 0; i < std::max<size_t>(1, numNodes); i++) {
+            queues.push_back(std::make_unique<NodeQueue>());
+        }
     }
 
-    bool pop(std::filesystem::path &item) {
-        std::unique_lock<std::mutex> lock(mutex);
-        cond.wait(lock, [this] { return !queue.empty() || done; });
-        if (queue.empty()) return false;
-        item = queue.back();
-        queue.pop_back();
-        return true;
-    }
+    size_t numNodes() const { return queues.size(); }
 
-    void set_done() {
-        std::lock_guard<std::mutex> lock(mutex);
-        done = true;
-        cond.notify_all();
+    void push(size_t node, const std::filesystem::path &item) {
+        NodeQueue &queue = *queues[node];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.files.push_back(item);
     }
 
+    // False once all queues are empty. stolen is set if the file came from another node.
+    bool pop(size_t node, std::filesystem::path &item, bool &stolen) {
+        for (size_t i = 0; i < queues.size(); i++) {
+            NodeQueue &queue = *queues[(node + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.files.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                item = std::move(queue.files.back());
+                queue.files.pop_back();
+            } else {
+                item = std::move(queue.files.front());
+                queue.files.pop_front();
+            }
+            stolen = i > 0;
+            return true;
+        }
+        return false;
+    }
 };
 
+class ResultsStoreWriter;
+
 class FileScanner {
 
 public:
@@ -106,34 +191,95 @@ public:
 
     void scannerWorker(QPromise<std::map<std::string, std::pair<ScanResult, std::vector<MatchInfo>>>> &promise,
                        std::atomic<size_t> &filesProcessed,
-                       size_t totalFiles);
+                       size_t totalFiles,
+                       size_t threadIndex,
+                       const WorkerSlot *slot);
 
     std::pair<ScanResult, std::vector<MatchInfo>>
-    scanFileForSensitiveData(const std::filesystem::path &filePath, hs_scratch_t *threadScratch);
+    scanFileForSensitiveData(const std::filesystem::path &filePath, hs_scratch_t *threadScratch,
+                             ThreadMetrics &threadMetrics);
 
     static int eventHandler(uint32_t id, uint64_t from, uint64_t to, uint32_t flags,
                             void *context);
 
-    void scanChunkWithRegex(const char *chunk,
+    void scanChunkWithRegex(const char *chunk, size_t length,
                             ScanContext &scanContext, hs_scratch_t *scratch);
 
     void deleteFiles(std::vector<std::string> &filePaths);
 
     void scrambleFile(const std::string &filePath);
 
+    void setPatternOptions(const std::map<std::string, PatternOptions> &options);
+
+    static uint32_t compileFlags(const PatternOptions &options);
+
+    // Compiles the patterns with the options set by setPatternOptions. The database stays loaded until
+    // releasePatterns() so files can be scanned one at a time, or so scanFiles() can be called repeatedly
+    // without compiling again. Throws std::runtime_error if Hyperscan rejects a pattern.
+    void compilePatterns(const std::vector<std::pair<std::string, std::string>> &patterns);
+
+    void releasePatterns();
+
+    void setFileTypes(const std::map<std::string, std::string> &fileTypes);
+
+    // Files of these types that no other reader supports are scanned for strings in their raw bytes
+    void setBinaryFileTypes(const std::set<std::string> &fileTypes);
+
+    bool isScannedType(const std::filesystem::path &filePath) const;
+
+    // Scratch space for the compiled database, nullptr if it could not be allocated
+    hs_scratch_t *allocateScratch() const;
+
+    // Scans one file with the compiled database, may only be called from one thread at a time
+    std::pair<ScanResult, std::vector<MatchInfo>> scanFile(const std::filesystem::path &filePath,
+                                                           hs_scratch_t *scratch);
+
+    void setScanSettings(const ScanSettings &settings);
+
+    // Hash of the patterns, their options, the file types, the sandbox and the file selection, identifies
+    // scans that can resume each other
+    static uint64_t configFingerprint(const std::vector<std::pair<std::string, std::string>> &patterns,
+                                      const std::map<std::string, PatternOptions> &patternOptions,
+                                      const std::map<std::string, std::string> &fileTypes,
+                                      const std::set<std::string> &binaryFileTypes,
+                                      const ScanSettings &settings);
+
+    const ScanSettings &getScanSettings() const;
+
     std::atomic<size_t> filesProcessed;
 private:
-    ThreadSafeQueue file_queue;
+    WorkQueues file_queue;
+    CpuTopology topology;
     std::map<std::string, std::pair<ScanResult, std::vector<MatchInfo>>> matches;
     std::mutex matches_mutex;
     std::vector<const char *> scanPatterns;
     std::vector<const char *> scanPatternDescriptions;
+    std::vector<MatchValidator> patternValidators;
+    std::vector<uint32_t> patternSomHorizons;
+    std::map<std::string, PatternOptions> patternOptions;
+    std::vector<std::pair<std::string, std::string>> compiledPatterns;
+
+    ScanSettings scanSettings;
+    ScanMetrics metrics;
+    ResultsStoreWriter *resultsWriter = nullptr; // Only set while scanFiles runs
+    ResourceGovernor *governor = nullptr; // Same
+    QPromise<std::map<std::string, std::pair<ScanResult, std::vector<MatchInfo>>>> *scanPromise = nullptr; // Same
+    std::unique_ptr<ParserPool> parserPool; // Same, and only if the parser sandbox is enabled
 
     std::map<std::string, std::string> scanFileTypes;
+    std::set<std::string> binaryFileTypes;
     hs_database_t *database = nullptr;
     std::vector<uint32_t> flags;
     std::vector<uint32_t> ids;
 
+    // Blocks while the scan is paused, true once it is cancelled. Checked between files and chunks.
+    bool scanInterrupted();
+
+    // Takes the results of the files an interrupted scan finished from the results store. Files that
+    // are not in filePaths or whose size or modification time changed are superseded in the store
+    // and scanned again.
+    void loadResumedResults(const std::vector<std::string> &filePaths, ResultsStoreWriter &writer);
+
     const hs_platform_info_t platformInfo = {
             HS_CPU_FEATURES_AVX2,
             HS_TUNE_FAMILY_GENERIC
@@ -0,0 +1,334 @@
+#include <QFont>
+#include <QUrl>
+#include <QStyle>
+#include <QMouseEvent>
+#include <QApplication>
+#include <QDesktopServices>
+#include <algorithm>
+
+#include "flaggedresultsmodel.h"
+
+// Top level indexes carry 0 as internal id, children carry the index of their file in files + 1
+#define FILE_ROW_ID 0
+#define COMPACT_MIN_REMOVED 256 // Removed entries updateFile leaves alone, compacting resets the view
+
+QModelIndex FlaggedResultsModel::index(int row, int column, const QModelIndex &parent) const {
+    if (!hasIndex(row, column, parent)) {
+        return {};
+    }
+    if (!parent.isValid()) {
+        return createIndex(row, column, static_cast<quintptr>(FILE_ROW_ID));
+    }
+    return createIndex(row, column, static_cast<quintptr>(visibleRows[parent.row()] + 1));
+}
+
+QModelIndex FlaggedResultsModel::parent(const QModelIndex &child) const {
+    if (!child.isValid() || child.internalId() == FILE_ROW_ID) {
+        return {};
+    }
+    return createIndex(visibleRowOfFile[child.internalId() - 1], 0, static_cast<quintptr>(FILE_ROW_ID));
+}
+
+int FlaggedResultsModel::rowCount(const QModelIndex &parent) const {
+    if (!parent.isValid()) {
+        return static_cast<int>(visibleRows.size());
+    }
+    if (parent.internalId() != FILE_ROW_ID || parent.column() != 0) {
+        return 0;
+    }
+    // The full path followed by the matches
+    return 1 + static_cast<int>(fileAt(parent.row()).matches.size());
+}
+
+int FlaggedResultsModel::columnCount(const QModelIndex &) const {
+    return 1;
+}
+
+QVariant FlaggedResultsModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid()) {
+        return {};
+    }
+    bool isFileRow = index.internalId() == FILE_ROW_ID;
+    const FlaggedFile &file = isFileRow ? fileAt(index.row()) : files[index.internalId() - 1];
+
+    switch (role) {
+        case Qt::DisplayRole:
+            if (isFileRow) {
+                return file.path.split("/").last(); // Get the file name only
+            } else if (index.row() == 0) {
+                return "Full path: " + file.path;
+            }
+            return matchText(file.matches[index.row() - 1]);
+        case Qt::ToolTipRole:
+            return isFileRow ? file.path : QVariant();
+        case Qt::CheckStateRole:
+            if (isFileRow) {
+                return file.checked ? Qt::Checked : Qt::Unchecked;
+            }
+            return {};
+        case Qt::FontRole: {
+            QFont font;
+            font.setPointSize(isFileRow ? 10 : 9);
+            return font;
+        }
+        case FilePathRole:
+            return file.path;
+        case IsFileRowRole:
+            return isFileRow;
+        default:
+            return {};
+    }
+}
+
+bool FlaggedResultsModel::setData(const QModelIndex &index, const QVariant &value, int role) {
+    if (!index.isValid() || index.internalId() != FILE_ROW_ID || role != Qt::CheckStateRole) {
+        return false;
+    }
+    files[visibleRows[index.row()]].checked = value.toInt() == Qt::Checked;
+    emit dataChanged(index, index, {Qt::CheckStateRole});
+    return true;
+}
+
+Qt::ItemFlags FlaggedResultsModel::flags(const QModelIndex &index) const {
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+    if (index.internalId() == FILE_ROW_ID) {
+        return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable;
+    }
+    return Qt::ItemIsEnabled;
+}
+
+QVariant FlaggedResultsModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 0) {
+        return "Flagged Files";
+    }
+    return {};
+}
+
+void FlaggedResultsModel::setFiles(std::vector<FlaggedFile> flaggedFiles) {
+    beginResetModel();
+    files = std::move(flaggedFiles);
+    searchIndex.clear();
+    fileIndexOfPath.clear();
+    numRemoved = 0;
+    for (int i = 0; i < static_cast<int>(files.size()); i++) {
+        searchIndex.addDocument(files[i].path.toStdString(), files[i].matches);
+        fileIndexOfPath.insert(files[i].path, i);
+    }
+    rebuildVisibleRows();
+    endResetModel();
+}
+
+void FlaggedResultsModel::clear() {
+    beginResetModel();
+    files.clear();
+    fileIndexOfPath.clear();
+    numRemoved = 0;
+    searchIndex.clear();
+    query = SearchQuery();
+    rebuildVisibleRows();
+    endResetModel();
+}
+
+void FlaggedResultsModel::setFilter(const QString &text, int patternId) {
+    beginResetModel();
+    query = SearchQuery::parse(text.toStdString(), patternId);
+    rebuildVisibleRows();
+    endResetModel();
+}
+
+void FlaggedResultsModel::setAllChecked(bool checked) {
+    if (visibleRows.empty()) {
+        return;
+    }
+    for (int fileIndex: visibleRows) {
+        files[fileIndex].checked = checked;
+    }
+    emit dataChanged(index(0, 0), index(static_cast<int>(visibleRows.size()) - 1, 0), {Qt::CheckStateRole});
+}
+
+void FlaggedResultsModel::removeCheckedFiles() {
+    std::vector<int> rows;
+    for (int row = 0; row < static_cast<int>(visibleRows.size()); row++) {
+        if (fileAt(row).checked) {
+            rows.push_back(row);
+        }
+    }
+    removeVisibleRows(rows);
+}
+
+void FlaggedResultsModel::removeFile(const QString &path) {
+    int fileIndex = fileIndexOfPath.value(path, -1);
+    if (fileIndex < 0 || files[fileIndex].removed) {
+        return;
+    }
+    if (visibleRowOfFile[fileIndex] >= 0) {
+        removeVisibleRows({visibleRowOfFile[fileIndex]});
+    } else {
+        files[fileIndex].removed = true; // Hidden by the filter, no rows to remove
+        numRemoved++;
+    }
+}
+
+void FlaggedResultsModel::updateFile(const QString &path, const std::vector<MatchInfo> &matches) {
+    // The old entry stays in files as removed, row and document ids must not shift
+    removeFile(path);
+    // In watch mode every save of a watched file leaves an entry behind
+    if (numRemoved >= COMPACT_MIN_REMOVED && numRemoved * 2 >= files.size()) {
+        compact();
+    }
+    auto fileIndex = static_cast<int>(files.size());
+    files.push_back({path, matches});
+    fileIndexOfPath.insert(path, fileIndex);
+    searchIndex.addDocument(path.toStdString(), matches);
+    visibleRowOfFile.push_back(-1);
+
+    if (query.isEmpty() || searchIndex.matches(fileIndex, query)) {
+        auto row = static_cast<int>(visibleRows.size());
+        beginInsertRows(QModelIndex(), row, row);
+        visibleRows.push_back(fileIndex);
+        visibleRowOfFile[fileIndex] = row;
+        endInsertRows();
+    }
+}
+
+std::vector<QString> FlaggedResultsModel::filePathsUnder(const QString &directory) const {
+    std::vector<QString> paths;
+    // The index compares lowercased paths, check the exact prefix of its candidates
+    QString prefix = directory.endsWith('/') ? directory : directory + "/";
+    for (uint32_t fileIndex: searchIndex.search(SearchQuery::inDirectory(directory.toStdString()))) {
+        if (!files[fileIndex].removed && files[fileIndex].path.startsWith(prefix)) {
+            paths.push_back(files[fileIndex].path);
+        }
+    }
+    return paths;
+}
+
+std::vector<std::string> FlaggedResultsModel::filePaths() const {
+    std::vector<std::string> paths;
+    for (const auto &file: files) {
+        if (!file.removed) {
+            paths.push_back(file.path.toStdString());
+        }
+    }
+    return paths;
+}
+
+bool FlaggedResultsModel::isEmpty() const {
+    return std::all_of(files.begin(), files.end(), [](const FlaggedFile &file) { return file.removed; });
+}
+
+void FlaggedResultsModel::rebuildVisibleRows() {
+    visibleRows.clear();
+    visibleRowOfFile.assign(files.size(), -1);
+    auto show = [this](uint32_t fileIndex) {
+        if (!files[fileIndex].removed) {
+            visibleRowOfFile[fileIndex] = static_cast<int>(visibleRows.size());
+            visibleRows.push_back(static_cast<int>(fileIndex));
+        }
+    };
+    if (query.isEmpty()) {
+        for (uint32_t i = 0; i < files.size(); i++) {
+            show(i);
+        }
+    } else {
+        for (uint32_t fileIndex: searchIndex.search(query)) {
+            show(fileIndex);
+        }
+    }
+}
+
+void FlaggedResultsModel::compact() {
+    beginResetModel();
+    files.erase(std::remove_if(files.begin(), files.end(), [](const FlaggedFile &file) { return file.removed; }),
+                files.end());
+    // Pattern ids are kept, the pattern filter refers to them
+    searchIndex.clearDocuments();
+    fileIndexOfPath.clear();
+    for (int i = 0; i < static_cast<int>(files.size()); i++) {
+        searchIndex.addDocument(files[i].path.toStdString(), files[i].matches);
+        fileIndexOfPath.insert(files[i].path, i);
+    }
+    numRemoved = 0;
+    rebuildVisibleRows();
+    endResetModel();
+}
+
+// rows must be sorted in ascending order
+void FlaggedResultsModel::removeVisibleRows(const std::vector<int> &rows) {
+    // Remove contiguous runs from the back so the remaining row numbers stay valid
+    size_t end = rows.size();
+    while (end > 0) {
+        size_t begin = end - 1;
+        while (begin > 0 && rows[begin - 1] == rows[begin] - 1) {
+            begin--;
+        }
+        int first = rows[begin];
+        int last = rows[end - 1];
+        beginRemoveRows(QModelIndex(), first, last);
+        for (int row = first; row <= last; row++) {
+            files[visibleRows[row]].removed = true;
+            visibleRowOfFile[visibleRows[row]] = -1;
+            numRemoved++;
+        }
+        visibleRows.erase(visibleRows.begin() + first, visibleRows.begin() + last + 1);
+        for (int row = first; row < static_cast<int>(visibleRows.size()); row++) {
+            visibleRowOfFile[visibleRows[row]] = row;
+        }
+        endRemoveRows();
+        end = begin;
+    }
+}
+
+QString FlaggedResultsModel::matchText(const MatchInfo &match) {
+    // Remove all leading + trailing whitespace from the match and replace whitespace runs with a single space
+    QString matchString = QString::fromStdString(match.match).simplified();
+
+    // Only patterns compiled with SOM know where the match starts
+    QString range = match.exactStart ?
+                    "... from index " + QString::number(match.startIndex) + " to " +
+                    QString::number(match.endIndex) :
+                    "... ending at index " + QString::number(match.endIndex);
+
+    // Matches inside archives and mailboxes say which member or message they are in
+    QString location = match.location.empty() ? QString() : " in " + QString::fromStdString(match.location);
+
+    return QString::fromStdString(match.patternUsed.second) + ": found ..." + matchString + range + location;
+}
+
+void FlaggedResultsDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
+                                   const QModelIndex &index) const {
+    if (!index.data(FlaggedResultsModel::IsFileRowRole).toBool()) {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+    QStyleOptionViewItem linkOption = option;
+    initStyleOption(&linkOption, index);
+    linkOption.font.setUnderline(true);
+    linkOption.palette.setColor(QPalette::Text, linkOption.palette.color(QPalette::Link));
+    QStyle *style = linkOption.widget ? linkOption.widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ItemViewItem, &linkOption, painter, linkOption.widget);
+}
+
+bool FlaggedResultsDelegate::editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+                                         const QModelIndex &index) {
+    // Let the base class toggle the check box first
+    if (QStyledItemDelegate::editorEvent(event, model, option, index)) {
+        return true;
+    }
+    if (event->type() != QEvent::MouseButtonRelease || !index.data(FlaggedResultsModel::IsFileRowRole).toBool()) {
+        return false;
+    }
+
+    QStyleOptionViewItem linkOption = option;
+    initStyleOption(&linkOption, index);
+    QStyle *style = linkOption.widget ? linkOption.widget->style() : QApplication::style();
+    QRect textRect = style->subElementRect(QStyle::SE_ItemViewItemText, &linkOption, linkOption.widget);
+    auto *mouseEvent = static_cast<QMouseEvent *>(event);
+    if (mouseEvent->button() == Qt::LeftButton && textRect.contains(mouseEvent->position().toPoint())) {
+        QDesktopServices::openUrl(QUrl::fromLocalFile(index.data(FlaggedResultsModel::FilePathRole).toString()));
+        return true;
+    }
+    return false;
+}
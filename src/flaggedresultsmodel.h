@@ -0,0 +1,115 @@
+#ifndef SENSITIVE_DATA_DELETER_FLAGGEDRESULTSMODEL_H
+#define SENSITIVE_DATA_DELETER_FLAGGEDRESULTSMODEL_H
+
+#include <QAbstractItemModel>
+#include <QStyledItemDelegate>
+#include <QHash>
+#include <vector>
+#include <string>
+
+#include "filescanner.h"
+#include "searchindex.h"
+
+struct FlaggedFile {
+    QString path;
+    std::vector<MatchInfo> matches;
+    bool checked = false;
+    bool removed = false; // Unflagged or deleted, kept until the next reset so row indices stay valid
+};
+
+/**
+ * Two level model of the flagged files. Top level rows are files, their children are the full
+ * path followed by one row per match. Nothing is created per row, the view only asks for the
+ * rows it shows, so the cost does not grow with the number of flagged files.
+ */
+class FlaggedResultsModel : public QAbstractItemModel {
+Q_OBJECT
+
+public:
+    enum Roles {
+        FilePathRole = Qt::UserRole,
+        IsFileRowRole,
+    };
+
+    explicit FlaggedResultsModel(QObject *parent = nullptr) : QAbstractItemModel(parent) {}
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+
+    QModelIndex parent(const QModelIndex &child) const override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void setFiles(std::vector<FlaggedFile> flaggedFiles);
+
+    void clear();
+
+    // Show only files whose path, matches or pattern descriptions contain the text, case insensitive.
+    // The text may contain a dir:<path> filter, patternId limits the files to one scan pattern
+    void setFilter(const QString &text, int patternId = NO_PATTERN_FILTER);
+
+    // Descriptions of the patterns that flagged files, indexed by pattern id
+    const std::vector<std::string> &patternDescriptions() const { return searchIndex.patternDescriptions(); }
+
+    void setAllChecked(bool checked);
+
+    // Removes the checked files that are currently shown
+    void removeCheckedFiles();
+
+    void removeFile(const QString &path);
+
+    // Replaces the matches of a file that was rescanned, or adds it if it was not flagged before.
+    // Once removed entries outnumber the flagged files they are dropped and the model is reset.
+    void updateFile(const QString &path, const std::vector<MatchInfo> &matches);
+
+    // Paths of the flagged files below the directory
+    std::vector<QString> filePathsUnder(const QString &directory) const;
+
+    std::vector<std::string> filePaths() const;
+
+    bool isEmpty() const;
+
+private:
+    std::vector<FlaggedFile> files;
+    std::vector<int> visibleRows; // Indices into files of the rows that pass the filter
+    std::vector<int> visibleRowOfFile; // Reverse of visibleRows, -1 for files that are not shown
+    QHash<QString, int> fileIndexOfPath; // Latest entry in files for each path
+    size_t numRemoved = 0; // Entries in files that are marked as removed
+    SearchIndex searchIndex; // Document ids are indices into files
+    SearchQuery query;
+
+    const FlaggedFile &fileAt(int row) const { return files[visibleRows[row]]; }
+
+    void rebuildVisibleRows();
+
+    // Drops the removed entries from files and the search index
+    void compact();
+
+    void removeVisibleRows(const std::vector<int> &rows);
+
+    static QString matchText(const MatchInfo &match);
+};
+
+// Draws the file name of top level rows as a link and opens the file when it is clicked
+class FlaggedResultsDelegate : public QStyledItemDelegate {
+Q_OBJECT
+
+public:
+    explicit FlaggedResultsDelegate(QObject *parent = nullptr) : QStyledItemDelegate(parent) {}
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+    bool editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+                     const QModelIndex &index) override;
+};
+
+#endif //SENSITIVE_DATA_DELETER_FLAGGEDRESULTSMODEL_H
@@ -1,6 +1,8 @@
 #include <QApplication>
 #include <QtMessageHandler>
 #include "mainwindow.h"
+#include "distributedscan.h"
+#include "parsersandbox.h"
 #include <QDebug>
 
 void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
@@ -9,6 +11,14 @@ void messageHandler(QtMsgType type, const QMessageLogContext &context, const QSt
 }
 
 int main(int argc, char *argv[]) {
+    // Sandboxed parsers run in helper processes started from this executable
+    if (isParserHelper(argc, argv)) {
+        return runParserHelper(argc, argv);
+    }
+    // Coordinator and workers of a distributed scan run without the GUI
+    if (isDistributedScan(argc, argv)) {
+        return runDistributedScan(argc, argv);
+    }
     QApplication a(argc, argv);
     qInstallMessageHandler(messageHandler);
     MainWindow w;
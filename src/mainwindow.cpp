@@ -2,21 +2,24 @@
 #include <QDir>
 #include <QFileSystemModel>
 #include <QFileDialog>
-#include <QDesktopServices>
-#include <QCheckBox>
 #include <QFutureWatcher>
 #include <QtConcurrent/QtConcurrentRun>
 #include <QProgressDialog>
 #include <QFileIconProvider>
 #include <QMessageBox>
-#include <QScrollBar>
+#include <QStandardPaths>
+#include <QGuiApplication>
 #include <QObject>
 #include <filesystem>
+#include <memory>
 #include <set>
 #include <string>
 
+#include "tracing.h"
+#include "resultsstore.h"
+
 #define MAX_DEPTH 10
-#define BATCH_SIZE 50 // Max number of flagged widget items to load at a time
+#define PLACEHOLDER_ROLE (Qt::UserRole + 1) // Set on the "Loading..." rows of folders that are being listed
 
 namespace fs = std::filesystem;
 
@@ -26,15 +29,21 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     configManager = new ConfigManager();
     watcher = new QFileSystemWatcher(this);
     fileScanner = new FileScanner();
+    patternCostPool.setMaxThreadCount(1);
     searchDebounceTimer = new QTimer(this);
-    searchDebounceTimer->setInterval(700);
+    // Searching the index takes milliseconds, the delay only batches fast typing
+    searchDebounceTimer->setInterval(150);
     searchDebounceTimer->setSingleShot(true);
     connect(searchDebounceTimer, &QTimer::timeout, this, &MainWindow::on_flaggedSearchBox_textEdited);
     connect(ui->flaggedSearchBox, &QLineEdit::textEdited, this, &MainWindow::onSearchBoxTextEdited);
+    connect(ui->flaggedPatternFilter, &QComboBox::currentIndexChanged, this, &MainWindow::onPatternFilterChanged);
     setupUI();
 }
 
 MainWindow::~MainWindow() {
+    // Pending benchmarks use the config manager
+    patternCostPool.clear();
+    patternCostPool.waitForDone();
     delete ui;
     delete configManager;
     delete watcher;
@@ -47,16 +56,29 @@ void MainWindow::setupUI() {
     fileTreeWidget->insertTopLevelItem(0, myRootItem);
     myRootItem->setExpanded(true);
 
-    flaggedFilesTreeWidget = ui->flaggedFilesTreeWidget;
+    flaggedFilesTreeView = ui->flaggedFilesTreeView;
+    flaggedResultsModel = new FlaggedResultsModel(this);
+    flaggedFilesTreeView->setModel(flaggedResultsModel);
+    flaggedFilesTreeView->setItemDelegate(new FlaggedResultsDelegate(flaggedFilesTreeView));
+    // All rows are one line of text, lets the view skip measuring rows it does not show
+    flaggedFilesTreeView->setUniformRowHeights(true);
     fileTypesTableWidget = ui->fileTypesTableWidget;
     scanPatternsTableWidget = ui->scanPatternsTableWidget;
     fileTreeWidget->setSelectionBehavior(QAbstractItemView::SelectRows);
-    flaggedFilesTreeWidget->setColumnCount(1);
 
     connect(watcher, &QFileSystemWatcher::directoryChanged, this, &MainWindow::onDirectoryChanged);
 
+    watchService = new WatchService(this);
+    connect(watchService, &WatchService::fileScanned, this, &MainWindow::onWatchedFileScanned);
+
+    directoryLoader = new DirectoryLoader(&statCache, this);
+    connect(directoryLoader, &DirectoryLoader::entriesLoaded, this, &MainWindow::onDirectoryEntriesLoaded);
+    connect(directoryLoader, &DirectoryLoader::loadFinished, this, &MainWindow::onDirectoryLoadFinished);
+
+    ui->pauseScanButton->hide();
     fileTypesTableWidget->setColumnCount(4);
-    scanPatternsTableWidget->setColumnCount(4);
+    scanPatternsTableWidget->setColumnCount(5);
+    scanPatternsTableWidget->setHorizontalHeaderItem(4, new QTableWidgetItem("Cost"));
 
     auto currentDate = QDate::currentDate();
     QTime latestTimeOnCurrentDate = QTime(23, 59, 0);
@@ -66,7 +88,7 @@ void MainWindow::setupUI() {
     // Connect the itemExpanded signal on the fileTreeWidget to load the child elements
     connect(fileTreeWidget, &QTreeWidget::itemExpanded, this, [this](QTreeWidgetItem *item) {
         auto path = item->data(0, Qt::UserRole).toString();
-        if (pathsToScan.contains(path)) {
+        if (scanPaths.contains(path)) {
             updateTreeItem(item, path);
         }
         fileTreeWidget->resizeColumnToContents(0);
@@ -76,6 +98,7 @@ void MainWindow::setupUI() {
         if (item == myRootItem) {
             return;
         }
+        directoryLoader->cancel(item->data(0, Qt::UserRole).toString());
         auto childIndex = item->childCount() - 1;
         while (childIndex >= 0) {
             auto childItem = item->child(childIndex);
@@ -84,17 +107,28 @@ void MainWindow::setupUI() {
         }
     });
 
-    flaggedFilesTreeWidget->setHeaderLabel("Flagged Files");
     fileTreeWidget->setHeaderLabel("Files and Folders");
 
     updateConfigPresentation();
 }
 
+void MainWindow::loadExclusionRules() {
+    try {
+        exclusionRules = ExclusionRules::fromJson(configManager->getScanSettings());
+    } catch (const std::exception &e) {
+        // Scanning everything is better than refusing to scan, but the user should know
+        exclusionRules = ExclusionRules();
+        QMessageBox::warning(this, "Invalid exclusion rules", QString::fromStdString(e.what()));
+    }
+}
+
 void MainWindow::onSearchBoxTextEdited(const QString &newText) {
     searchDebounceTimer->start();
 }
 
 void MainWindow::updateConfigPresentation() {
+    loadExclusionRules();
+
     // Clear current items in the file types and scan patterns tables
     fileTypesTableWidget->clearContents();
     fileTypesTableWidget->setRowCount(0);
@@ -198,6 +232,7 @@ void MainWindow::updateConfigPresentation() {
         // Add a button to the column to the right to remove the row
         auto *removeButton = new QPushButton("Remove");
         scanPatternsTableWidget->setCellWidget(row, 3, removeButton);
+        updatePatternCost(scanPattern.first);
 
         // Connect the button to the slot to remove the row
         connect(removeButton, &QPushButton::clicked, this, [this, row]() {
@@ -220,6 +255,9 @@ void MainWindow::updateConfigPresentation() {
 
     // Update the config file if any item in fileTypesTableWidget is edited
     connect(scanPatternsTableWidget, &QTableWidget::itemChanged, [this](QTableWidgetItem *item) {
+        if (item->column() == 4) {
+            return; // Cost column is only written by updatePatternCost
+        }
         auto *column1 = scanPatternsTableWidget->item(item->row(), 1);
         auto *column2 = scanPatternsTableWidget->item(item->row(), 2);
 
@@ -250,11 +288,16 @@ void MainWindow::updateConfigPresentation() {
             }
         }
 
-        if (!configManager->isValidRegex(column1->text())) {
-            qDebug() << "The scan pattern is not a valid regex expression.";
+        // An edited pattern keeps the validator and SOM horizon of the pattern it replaces
+        QString optionsPattern = item->row() < configManager->scanPatterns.size()
+                                 ? configManager->scanPatterns[item->row()].first : column1->text();
+        QString patternError = configManager->getPatternError(column1->text(),
+                                                              configManager->getPatternFlags(optionsPattern));
+        if (!patternError.isEmpty()) {
+            qDebug() << "The scan pattern is not a valid regex expression: " << patternError;
             scanPatternsTableWidget->item(item->row(), 1)->setBackground(QBrush(QColor(255, 0, 0, 50)));
             scanPatternsTableWidget->item(item->row(), 1)->setToolTip(
-                    "The scan pattern is not a valid regex expression.");
+                    "The scan pattern is not supported by Hyperscan: " + patternError);
             return;
         } else {
             scanPatternsTableWidget->item(item->row(), 1)->setBackground(QBrush(QColor(0, 0, 0, 0)));
@@ -275,26 +318,59 @@ void MainWindow::updateConfigPresentation() {
         QString newScanPattern = column1->text();
         QString newDescription = column2->text();
         configManager->editScanPattern(item->row(), newScanPattern, newDescription);
+        if (item->column() == 1) {
+            updatePatternCost(newScanPattern);
+        }
     });
 }
 
+void MainWindow::updatePatternCost(const QString &pattern) {
+    uint32_t flags = configManager->getPatternFlags(pattern);
+
+    // Compiling and benchmarking a pattern can take a while, keep it off the UI thread
+    auto *futureWatcher = new QFutureWatcher<PatternReport>(this);
+    connect(futureWatcher, &QFutureWatcher<PatternReport>::finished, this, [this, futureWatcher, pattern]() {
+        PatternReport report = futureWatcher->result();
+        futureWatcher->deleteLater();
+
+        // Rows may have moved while the analysis was running, find the pattern again
+        for (int row = 0; row < scanPatternsTableWidget->rowCount(); ++row) {
+            auto *patternItem = scanPatternsTableWidget->item(row, 1);
+            if (!patternItem || patternItem->text() != pattern) {
+                continue;
+            }
+            QString label = QString::fromStdString(report.costLabel());
+            if (report.compatible) {
+                label += " (" + QString::number(report.costScore) + ")";
+            }
+            auto *costItem = new QTableWidgetItem(label);
+            costItem->setFlags(costItem->flags() & ~Qt::ItemIsEditable);
+            costItem->setToolTip(QString::fromStdString(report.summary()));
+            if (!report.compatible || report.costScore >= 60) {
+                costItem->setBackground(QBrush(QColor(255, 0, 0, 50)));
+            } else if (report.costScore >= 25) {
+                costItem->setBackground(QBrush(QColor(255, 255, 0, 50)));
+            }
+            scanPatternsTableWidget->setItem(row, 4, costItem);
+        }
+    });
+    // One pool thread runs the benchmarks one after another, concurrent ones would compete for the cores
+    futureWatcher->setFuture(QtConcurrent::run(&patternCostPool, &ConfigManager::analyzeScanPattern, configManager,
+                                               pattern, flags));
+}
+
 void MainWindow::onDirectoryChanged(const QString &path) {
     qDebug() << "Directory changed: " << path;
 
-    // Check if the changed item is a parent of any keys in flaggedItems.
-    for (const auto &flaggedItemPath: flaggedItems.keys()) {
-        if (flaggedItemPath.find(path.toStdString()) != std::string::npos) {
-            QFile flaggedItemDir(flaggedItemPath.c_str());
-            if (!flaggedItemDir.exists()) { // If the flagged item no longer exists, remove it from the tree
-                auto *flaggedItemToRemove = flaggedItems.value(flaggedItemPath);
-                removeItemFromTree(flaggedItemToRemove);
-                flaggedItems.remove(flaggedItemPath);
-                delete flaggedItemToRemove;
-            }
+    // Flagged files under the changed directory may have been deleted or moved away
+    for (const auto &flaggedItemPath: flaggedResultsModel->filePathsUnder(path)) {
+        if (!QFile::exists(flaggedItemPath)) {
+            flaggedResultsModel->removeFile(flaggedItemPath);
         }
     }
 
-    QTreeWidgetItem *scanItem = pathsToScan.value(path);
+    statCache.invalidate(path);
+    QTreeWidgetItem *scanItem = treeItemForPath(path);
     if (scanItem) {
         updateTreeItem(scanItem, path);
         if (path == lastUpdatedPath) {
@@ -306,13 +382,6 @@ void MainWindow::onDirectoryChanged(const QString &path) {
 }
 
 void MainWindow::updateTreeItem(QTreeWidgetItem *item, const QString &path) {
-    QDir dir(path);
-    if (!dir.exists() && item != myRootItem) {
-        // Remove the item from the tree if it no longer exists
-        removeItemFromTree(item);
-        return;
-    }
-
     // Clear the existing subtree items
     int childToRemoveIndex = item->childCount() - 1;
     while (childToRemoveIndex >= 0) {
@@ -321,46 +390,69 @@ void MainWindow::updateTreeItem(QTreeWidgetItem *item, const QString &path) {
         childToRemoveIndex--;
     }
 
+    // Shown until the entries of the directory arrive from the loader
+    auto *placeholderItem = new QTreeWidgetItem(item, QStringList("Loading..."));
+    placeholderItem->setData(0, PLACEHOLDER_ROLE, true);
+    placeholderItem->setFlags(Qt::NoItemFlags);
+
+    directoryLoader->load(path);
+    item->setCheckState(0, Qt::Unchecked);
+}
+
+void MainWindow::onDirectoryEntriesLoaded(const QString &path, const QVector<DirectoryEntry> &entries) {
+    QTreeWidgetItem *item = treeItemForPath(path);
+    if (!item) {
+        directoryLoader->cancel(path);
+        return;
+    }
+
     // Add the items in the refreshed directory
-    for (const QString &entry: dir.entryList(QDir::NoDotAndDotDot | QDir::Files | QDir::Dirs,
-                                             QDir::SortFlags(Qt::AscendingOrder))) {
-        QString childPath = path + "/" + entry;
-        QTreeWidgetItem *childItem = pathsToScan.value(childPath);
+    for (const auto &entry: entries) {
+        if (exclusionRules.excludesPath(entry.path.toStdString(), entry.stat.isDir)) {
+            continue;
+        }
+        QTreeWidgetItem *childItem = treeItemForPath(entry.path);
 
         if (!childItem) {
-            childItem = createTreeItem(item, childPath, true);
-            if (QFileInfo(childPath).isDir()) {
-                watcher->addPath(childPath);
+            childItem = createTreeItem(item, entry.path, true, entry.stat);
+            if (entry.stat.isDir) {
+                watcher->addPath(entry.path);
                 childItem->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
             }
         }
 
-        pathsToScan.insert(childPath, childItem);
-        handleFlaggedScanItem(childPath.toStdString());
+        treeItems[scanPaths.insert(entry.path)] = childItem;
+        handleFlaggedScanItem(entry.path.toStdString());
     }
-    item->setCheckState(0, Qt::Unchecked);
 }
 
-bool isSystemFile(const fs::path &path) {
-    static const std::set<std::string> ignoredFiles = {
-            ".DS_Store", "desktop.ini", "Thumbs.db"
-    };
+void MainWindow::onDirectoryLoadFinished(const QString &path, bool exists) {
+    QTreeWidgetItem *item = treeItemForPath(path);
+    if (!item) {
+        return;
+    }
+    if (!exists && item != myRootItem) {
+        // Remove the item from the tree if it no longer exists
+        removeItemFromTree(item);
+        return;
+    }
 
-    // Check if the file is in the ignored list
-    return ignoredFiles.find(path.filename().string()) != ignoredFiles.end();
+    for (int i = item->childCount() - 1; i >= 0; i--) {
+        if (item->child(i)->data(0, PLACEHOLDER_ROLE).toBool()) {
+            delete item->takeChild(i);
+        }
+    }
+    // Entries arrive in directory order, sort once at the end instead of on every batch
+    item->sortChildren(0, Qt::AscendingOrder);
+    fileTreeWidget->resizeColumnToContents(0);
 }
 
-
 void MainWindow::constructScanTreeViewRecursively(QTreeWidgetItem *parentItem, const QString &currentPath) {
 
-    // Use std filesystem recursive iterator to add all folders and files into pathsToScan
+    // Use std filesystem recursive iterator to add all folders and files into scanPaths
     for (auto it = fs::recursive_directory_iterator(currentPath.toStdString());
          it != fs::recursive_directory_iterator(); ++it) {
 
-        if (isSystemFile(it->path())) {
-            continue;
-        }
-
         int current_depth = it.depth();
         if (current_depth > MAX_DEPTH) {
             it.pop();  // Skip deeper directories
@@ -373,40 +465,44 @@ void MainWindow::constructScanTreeViewRecursively(QTreeWidgetItem *parentItem, c
         QString path = QString::fromStdString(it->path().string());
         // Replace the current path separators with slashes if on Windows
         path.replace("\\", "/");
-        if (pathsToScan.contains(path)) {
-            auto *existingItem = pathsToScan.value(path);
 
-            if (existingItem) {
-                removeItemFromTree(existingItem);
+        // Excluded folders are not descended into, so nothing below them is ever listed
+        std::error_code error;
+        bool isDirectory = it->is_directory(error);
+        if (exclusionRules.excludesPath(path.toStdString(), isDirectory)) {
+            if (isDirectory) {
+                it.disable_recursion_pending();
             }
+            continue;
         }
 
-        pathsToScan.insert(path, nullptr);
+        auto *existingItem = treeItemForPath(path);
+        if (existingItem) {
+            removeItemFromTree(existingItem);
+        }
+
+        scanPaths.insert(path);
     }
 
     // Only create the tree item if the path is that of the parent item
     // and the parent item is expanded
     if (parentItem->isExpanded()) {
         bool useShortName = parentItem != myRootItem;
-        auto newItem = createTreeItem(parentItem, currentPath, useShortName);
+        auto newItem = createTreeItem(parentItem, currentPath, useShortName, statCache.stat(currentPath));
         parentItem->sortChildren(0, Qt::AscendingOrder);
-        pathsToScan[currentPath] = newItem;
+        treeItems[scanPaths.insert(currentPath)] = newItem;
         newItem->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
     }
 }
 
 QString MainWindow::getParentPath(const QString &dirPath) {
-    QString parentPath = dirPath;
-    while (true) {
-        qsizetype lastSeparatorIndex = parentPath.lastIndexOf(QDir::separator());
-        if (lastSeparatorIndex == -1) break;
-
-        parentPath = parentPath.left(lastSeparatorIndex);
-        if (pathsToScan.contains(parentPath)) {
-            return parentPath;
-        }
-    }
-    return {};
+    PathId parentId = scanPaths.findListedAncestor(dirPath);
+    return parentId == INVALID_PATH_ID ? QString() : scanPaths.path(parentId);
+}
+
+QTreeWidgetItem *MainWindow::treeItemForPath(const QString &path) const {
+    PathId id = scanPaths.find(path);
+    return id == INVALID_PATH_ID ? nullptr : treeItems.value(id, nullptr);
 }
 
 void MainWindow::on_addFolderButton_clicked() {
@@ -417,7 +513,7 @@ void MainWindow::on_addFolderButton_clicked() {
         return;
     }
 
-    if (pathsToScan.contains(dirPath)) {
+    if (scanPaths.contains(dirPath)) {
         qDebug() << "Directory already being watched";
         QMessageBox::information(this, "Directory already being watched",
                                  "The directory is already being watched.");
@@ -430,13 +526,12 @@ void MainWindow::on_addFolderButton_clicked() {
     if (!parentPath.isEmpty()) {
 
         // Create new tree item for the directory
-        auto parentItem = pathsToScan.value(parentPath);
+        auto parentItem = treeItemForPath(parentPath);
         constructScanTreeViewRecursively(parentItem, dirPath);
 
         // Uncheck all items in the tree
-        for (const auto &item: pathsToScan) {
-            if (item)
-                item->setCheckState(0, Qt::Unchecked);
+        for (const auto &item: treeItems) {
+            item->setCheckState(0, Qt::Unchecked);
         }
 
         fileTreeWidget->resizeColumnToContents(0);
@@ -469,18 +564,18 @@ QString formatFileSize(qint64 size) {
     }
 }
 
-QTreeWidgetItem *MainWindow::createTreeItem(QTreeWidgetItem *parentItem, const QString &path, bool useShortName) {
+QTreeWidgetItem *MainWindow::createTreeItem(QTreeWidgetItem *parentItem, const QString &path, bool useShortName,
+                                            const FileStat &stat) {
     QString shortName = useShortName ? path.split("/").last() : path;
     auto *item = new QTreeWidgetItem(parentItem, QStringList(shortName));
     // Set the parent
     item->setData(0, Qt::UserRole, path);
     item->setText(1, "");
     // If the item is a file, set the size and last modified date
-    if (!QFileInfo(path).isDir()) {
-        QFileInfo fileInfo(path);
-        item->setIcon(0, iconProvider.icon(fileInfo));
-        item->setText(1, formatFileSize(fileInfo.size()));
-        item->setText(2, QFileInfo(path).lastModified().toString("dd/MM/yyyy"));
+    if (!stat.isDir) {
+        item->setIcon(0, fileIcon(shortName));
+        item->setText(1, formatFileSize(stat.size));
+        item->setText(2, stat.lastModified.toString("dd/MM/yyyy"));
     } else {
         item->setIcon(0, iconProvider.icon(QFileIconProvider::Folder));
     }
@@ -489,6 +584,18 @@ QTreeWidgetItem *MainWindow::createTreeItem(QTreeWidgetItem *parentItem, const Q
     return item;
 }
 
+// The icon provider may hit the disk for every file, files with the same suffix share an icon
+QIcon MainWindow::fileIcon(const QString &fileName) {
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    auto it = fileIconCache.constFind(suffix);
+    if (it != fileIconCache.constEnd()) {
+        return it.value();
+    }
+    QIcon icon = suffix.isEmpty() ? iconProvider.icon(QFileIconProvider::File) : iconProvider.icon(QFileInfo(fileName));
+    fileIconCache.insert(suffix, icon);
+    return icon;
+}
+
 void MainWindow::on_addFileButton_clicked() {
     QStringList filePaths = QFileDialog::getOpenFileNames(this, tr("Select Files"), QDir::currentPath());
     if (filePaths.isEmpty()) {
@@ -497,7 +604,7 @@ void MainWindow::on_addFileButton_clicked() {
     }
 
     for (const auto &filePath: filePaths) {
-        if (pathsToScan.contains(filePath)) {
+        if (scanPaths.contains(filePath)) {
             qDebug() << "File " << filePath << " already being watched";
             continue;
         }
@@ -505,25 +612,23 @@ void MainWindow::on_addFileButton_clicked() {
         // If a parent directory is already being watched, add the new file to the parent item
         QString parentPath = getParentPath(filePath);
         if (!parentPath.isEmpty()) {
-            auto *parentItem = pathsToScan.value(parentPath);
+            auto *parentItem = treeItemForPath(parentPath);
+            PathId fileId = scanPaths.insert(filePath);
             if (parentItem) { // Immediate parent is expanded, add child item
-                auto *childItem = createTreeItem(parentItem, filePath, true);
+                auto *childItem = createTreeItem(parentItem, filePath, true, statCache.stat(filePath));
                 parentItem->addChild(childItem);
-                pathsToScan[filePath] = childItem;
-            } else { // Immediate parent is collapsed, do not create a tree item yet
-                pathsToScan[filePath] = nullptr;
-            }
+                treeItems[fileId] = childItem;
+            } // Immediate parent is collapsed, do not create a tree item yet
             continue;
         }
 
-        pathsToScan[filePath] = createTreeItem(myRootItem, filePath, false);
+        treeItems[scanPaths.insert(filePath)] = createTreeItem(myRootItem, filePath, false, statCache.stat(filePath));
         watcher->addPath(filePath);
     }
 
     // Uncheck all items in the tree
-    for (const auto &item: pathsToScan) {
-        if (item)
-            item->setCheckState(0, Qt::Unchecked);
+    for (const auto &item: treeItems) {
+        item->setCheckState(0, Qt::Unchecked);
     }
 
     fileTreeWidget->resizeColumnToContents(1);
@@ -550,9 +655,12 @@ void MainWindow::removeItemFromTree(QTreeWidgetItem *item) {
         childToRemoveIndex--;
     }
 
-    watcher->removePath(path);
+    // Placeholder rows have no path
+    if (!path.isEmpty()) {
+        watcher->removePath(path);
+        treeItems.remove(scanPaths.find(path));
+    }
     parent->removeChild(item);
-    pathsToScan[path] = nullptr;
     delete item;
 }
 
@@ -595,7 +703,7 @@ void MainWindow::expandToFlaggedItem(const QString &path) {
     QString currentPath = pathParts[0];
     int index = 1;
     while (currentPath != path) {
-        auto *item = pathsToScan.value(currentPath);
+        auto *item = treeItemForPath(currentPath);
         if (item && !item->isExpanded()) {
             item->setExpanded(true);
         }
@@ -611,9 +719,9 @@ void
 MainWindow::handleFlaggedScanItem(const std::string &flaggedPath) {
     int columnCount = fileTreeWidget->columnCount();
     // Set the color of the row of the corresponding element in fileTreeWidget
-    QTreeWidgetItem *scanTreeItem = pathsToScan.value(QString::fromStdString(flaggedPath));
+    QTreeWidgetItem *scanTreeItem = treeItemForPath(QString::fromStdString(flaggedPath));
 
-    switch (scanResults.value(flaggedPath).first) {
+    switch (scanResults.value(flaggedPath)) {
         case ScanResult::CLEAN:
             setRowBackgroundColor(scanTreeItem, QColor(0, 255, 0, 50), columnCount);
             scanTreeItem->setToolTip(0, "No sensitive data found");
@@ -647,8 +755,8 @@ void MainWindow::setRowBackgroundColor(QTreeWidgetItem *item, const QColor &colo
     }
 }
 
-void MainWindow::getScanResultBits(const std::pair<std::string, std::pair<ScanResult, std::vector<MatchInfo>>> &match) {
-    switch (match.second.first) {
+void MainWindow::getScanResultBits(ScanResult result) {
+    switch (result) {
         case ScanResult::CLEAN:
             scanResultBits = scanResultBits | 0b00000001;
             break;
@@ -692,19 +800,16 @@ QString getWarningMessage(uint8_t scanResultBits) {
 
 void
 MainWindow::processScanResults(const std::map<std::string, std::pair<ScanResult, std::vector<MatchInfo>>> &results) {
+    SDD_TRACE_SCOPE("processScanResults");
+    std::vector<FlaggedFile> flaggedFiles;
     for (const auto &result: results) {
-        scanResults[result.first] = result.second;
-        getScanResultBits(result);
-
-        if (result.second.first == ScanResult::FLAGGED || result.second.first == ScanResult::FLAGGED_BUT_UNWRITABLE) {
-            numFlaggedFiles++;
-        }
+        addScanResult(result.first, result.second, flaggedFiles);
 
         // TODO: Major performance bottleneck, need to find a better way to handle this
 
 //        QString qstringPath = QString::fromStdString(result.first);
 //        // If the item at given path does not exist, expand to it and it will be created
-//        if (!pathsToScan.value(qstringPath)) {
+//        if (!treeItemForPath(qstringPath)) {
 //            if (result.second.first != ScanResult::CLEAN &&
 //                result.second.first != ScanResult::UNSUPPORTED_TYPE) {
 //                expandToFlaggedItem(qstringPath);
@@ -716,160 +821,155 @@ MainWindow::processScanResults(const std::map<std::string, std::pair<ScanResult,
     }
 
 
-    qDebug() << "Number of flagged files: " << numFlaggedFiles;
-    loadNextFlaggedItemsBatch(ui->flaggedSearchBox->text());
+    showFlaggedFiles(std::move(flaggedFiles));
 }
 
-void MainWindow::addFlaggedItemWidget(const QString &path, const std::vector<MatchInfo> &matches) {
-    auto *item = new QTreeWidgetItem(flaggedFilesTreeWidget);
-
-    auto *widget = new QWidget();
-    auto *layout = new QHBoxLayout();
-    layout->setContentsMargins(0, 0, 0, 0);
-    layout->setSpacing(20);
-    widget->setLayout(layout);
-    auto *checkBox = new QCheckBox();
-    auto shortName = path.split("/").last(); // Get the file name only
-    auto *label = new QLabel("<a href=\"file:" + path + "\">" + shortName + "</a>");
-    label->setOpenExternalLinks(false);
-    connect(label, &QLabel::linkActivated, this, [path]() {
-        QDesktopServices::openUrl(QUrl::fromLocalFile(path));
-    });
-
-    QFont font = label->font();
-    font.setPointSize(10);
-    label->setFont(font);
-
-    layout->addWidget(checkBox);
-    layout->addWidget(label);
-    layout->addStretch(1);
-
-    flaggedItems[path.toStdString()] = item;
-
-    flaggedFilesTreeWidget->setItemWidget(item, 0, widget);
-
-    // Add full path of file as a child item
-    auto *fullPathItem = new QTreeWidgetItem(item);
-    auto *fullPathLabel = new QLabel("Full path: " + path);
-    QFont fullPathFont = fullPathLabel->font();
-    fullPathFont.setPointSize(9);
-    fullPathLabel->setFont(fullPathFont);
-
-    fullPathLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
-    flaggedFilesTreeWidget->setItemWidget(fullPathItem, 0, fullPathLabel);
-    fullPathItem->setFlags(fullPathItem->flags() & ~Qt::ItemIsSelectable);
-
-    for (const auto &matchInfo: matches) {
-        std::string matchString = matchInfo.match;
-        // Remove all leading + trailing whitespace from the match and replace newlines with a single space
-        matchString = std::regex_replace(matchString, std::regex("^\\s+|\\s+$"), "");
-        matchString = std::regex_replace(matchString, std::regex("\\s+"), " ");
-
-        auto *childItem = new QTreeWidgetItem(item);
-        auto *childLabel = new QLabel(
-                QString::fromStdString(matchInfo.patternUsed.second) + ": found ..." +
-                QString::fromStdString(matchString) +
-                "... from index " + QString::number(matchInfo.startIndex) + " to " +
-                QString::number(matchInfo.endIndex)
-        );
-
-        // Set child item to not be selectable
-        childItem->setFlags(childItem->flags() & ~Qt::ItemIsSelectable);
-        childLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
-        flaggedFilesTreeWidget->setItemWidget(childItem, 0, childLabel);
-
-        auto childFont = childLabel->font();
-        childFont.setPointSize(9);
-        childLabel->setFont(childFont);
+void MainWindow::addScanResult(const std::string &path, const std::pair<ScanResult, std::vector<MatchInfo>> &result,
+                               std::vector<FlaggedFile> &flaggedFiles) {
+    scanResults[path] = result.first;
+    getScanResultBits(result.first);
+    if (result.first == ScanResult::FLAGGED || result.first == ScanResult::FLAGGED_BUT_UNWRITABLE) {
+        numFlaggedFiles++;
+        flaggedFiles.push_back({QString::fromStdString(path), result.second});
     }
 }
 
-void MainWindow::onFlaggedFilesScrollBarMoved(int value) {
-    if (value == flaggedFilesTreeWidget->verticalScrollBar()->maximum() &&
-        numFlaggedItemsLoaded < scanResults.size()) {
-        loadNextFlaggedItemsBatch();
-    }
+void MainWindow::showFlaggedFiles(std::vector<FlaggedFile> flaggedFiles) {
+    SDD_TRACE_SCOPE("populateFlaggedResultsModel");
+    qDebug() << "Number of flagged files: " << numFlaggedFiles;
+    flaggedResultsModel->setFiles(std::move(flaggedFiles));
+    updatePatternFilter();
 }
 
-void MainWindow::loadNextFlaggedItemsBatch(const QString &searchText) {
-    int itemsLeft = numFlaggedFiles - numFlaggedItemsLoaded;
-    int itemsToLoad = qMin(BATCH_SIZE, itemsLeft);
-    std::string stdSearchText = searchText.toStdString();
-    qDebug() << "Loading next batch of " << itemsToLoad << " flagged items";
-    int i = 0;
-    for (auto it = scanResults.constBegin(); it != scanResults.constEnd(); ++it) {
-        if (i >= itemsToLoad)
-            break;
-
-        if (it.value().second.empty())
-            continue;
-
-        if (flaggedItems.contains(it.key()))
-            continue;
-
-        if (!searchText.isEmpty() && it.key().find(stdSearchText) != std::string::npos)
-            continue;
-
-        addFlaggedItemWidget(QString::fromStdString(it.key()), scanResults[it.key()].second);
-        numFlaggedItemsLoaded++;
-        i++;
+void MainWindow::updatePatternFilter() {
+    QSignalBlocker blocker(ui->flaggedPatternFilter);
+    // Pattern ids stay the same until the results are reset, keep the selected one
+    QVariant selected = ui->flaggedPatternFilter->currentData();
+    ui->flaggedPatternFilter->clear();
+    ui->flaggedPatternFilter->addItem("All patterns", NO_PATTERN_FILTER);
+    if (openedStore) {
+        // Store pattern ids, only the patterns with an index entry flagged a file
+        for (uint32_t id = 0; id < openedStore->patternCount(); id++) {
+            if (openedStore->patternRecords(id).second > 0) {
+                std::string_view description = openedStore->patternDescription(id);
+                ui->flaggedPatternFilter->addItem(
+                        QString::fromUtf8(description.data(), static_cast<qsizetype>(description.size())),
+                        static_cast<int>(id));
+            }
+        }
+        ui->flaggedPatternFilter->setCurrentIndex(std::max(0, ui->flaggedPatternFilter->findData(selected)));
+        return;
     }
-
-    auto scrollBar = flaggedFilesTreeWidget->verticalScrollBar();
-    if (scrollBar && !scrollBar->isHidden()) {
-        // Check if the connection already exists
-        connect(scrollBar, &QScrollBar::valueChanged, this, &MainWindow::onFlaggedFilesScrollBarMoved);
+    const auto &descriptions = flaggedResultsModel->patternDescriptions();
+    for (int id = 0; id < static_cast<int>(descriptions.size()); id++) {
+        ui->flaggedPatternFilter->addItem(QString::fromStdString(descriptions[id]), id);
     }
+    ui->flaggedPatternFilter->setCurrentIndex(std::max(0, ui->flaggedPatternFilter->findData(selected)));
 }
 
-std::vector<std::string> MainWindow::addFilesToScanList() {
+// Runs on a worker thread, everything it needs from the GUI is passed in
+std::vector<std::string> MainWindow::addFilesToScanList(const std::vector<QString> &listedPaths,
+                                                        const QDateTime &from, const QDateTime &to,
+                                                        const ExclusionRules &rules) {
     std::vector<std::string> filePaths;
-    for (auto it = pathsToScan.constBegin(); it != pathsToScan.constEnd(); ++it) {
-        const auto &key = it.key();
+    for (const auto &path: listedPaths) {
         // Check if the path is a file and if the last edited date is within range
-        QFileInfo fileInfo(key);
+        QFileInfo fileInfo(path);
         if (fileInfo.isFile() &&
-            (fileInfo.lastModified() >= ui->fromDateEdit->dateTime() &&
-             fileInfo.lastModified() <= ui->toDateEdit->dateTime())) {
-            filePaths.push_back(key.toStdString());
+            (fileInfo.lastModified() >= from && fileInfo.lastModified() <= to) &&
+            !rules.excludesFileStat(fileInfo.size(), fileInfo.lastModified()) &&
+            !rules.excludesPath(path.toStdString(), false)) {
+            filePaths.push_back(path.toStdString());
         }
     }
     return filePaths;
 }
 
-void MainWindow::on_scanButton_clicked() {
-    ui->scanButton->setEnabled(false);
+bool MainWindow::getCheckedScanConfig(std::map<std::string, std::string> &checkedFileTypes,
+                                      std::set<std::string> &binaryFileTypes,
+                                      std::vector<std::pair<std::string, std::string>> &checkedScanPatterns,
+                                      std::map<std::string, PatternOptions> &patternOptions) {
     // Get all checked file types and patterns and convert them to std strings
-    std::map<std::string, std::string> checkedFileTypes;
     for (int i = 0; i < fileTypesTableWidget->rowCount(); ++i) {
         if (fileTypesTableWidget->item(i, 0)->checkState() == Qt::Checked) {
-            checkedFileTypes[fileTypesTableWidget->item(i, 1)->text().toStdString()] =
-                    fileTypesTableWidget->item(i, 2)->text().toStdString();
+            QString fileType = fileTypesTableWidget->item(i, 1)->text();
+            checkedFileTypes[fileType.toStdString()] = fileTypesTableWidget->item(i, 2)->text().toStdString();
+            if (configManager->getFileTypeScanMode(fileType) == "binary") {
+                binaryFileTypes.insert(fileType.toStdString());
+            }
         }
     }
-    std::vector<std::pair<std::string, std::string>> checkedScanPatterns;
     for (int i = 0; i < scanPatternsTableWidget->rowCount(); ++i) {
         if (scanPatternsTableWidget->item(i, 0)->checkState() == Qt::Checked) {
-            checkedScanPatterns.emplace_back(scanPatternsTableWidget->item(i, 1)->text().toStdString(),
+            QString pattern = scanPatternsTableWidget->item(i, 1)->text();
+            checkedScanPatterns.emplace_back(pattern.toStdString(),
                                              scanPatternsTableWidget->item(i, 2)->text().toStdString());
+            patternOptions[pattern.toStdString()].validator =
+                    configManager->getPatternValidator(pattern).toStdString();
+            patternOptions[pattern.toStdString()].somHorizon = configManager->getPatternSomHorizon(pattern);
         }
     }
 
-    // If there are no file types or scan patterns selected, show a popup and return
+    // If there are no file types or scan patterns selected, show a popup
     if (checkedFileTypes.empty() || checkedScanPatterns.empty()) {
         createInfoDialog("No file types or scan patterns selected",
                          "Please select at least one file type and one scan pattern to scan.");
+        return false;
+    }
+    return true;
+}
+
+void MainWindow::on_scanButton_clicked() {
+    ui->scanButton->setEnabled(false);
+    std::map<std::string, std::string> checkedFileTypes;
+    std::set<std::string> binaryFileTypes;
+    std::vector<std::pair<std::string, std::string>> checkedScanPatterns;
+    std::map<std::string, PatternOptions> patternOptions;
+    if (!getCheckedScanConfig(checkedFileTypes, binaryFileTypes, checkedScanPatterns, patternOptions)) {
+        ui->scanButton->setEnabled(true);
         return;
     }
 
+    fileScanner->setPatternOptions(patternOptions);
+    fileScanner->setBinaryFileTypes(binaryFileTypes);
+    ScanSettings scanSettings = ScanSettings::fromJson(configManager->getScanSettings());
+    scanSettings.fileSelection = exclusionRules.describe() + "modified " +
+                                 ui->fromDateEdit->dateTime().toString(Qt::ISODate).toStdString() + " " +
+                                 ui->toDateEdit->dateTime().toString(Qt::ISODate).toStdString();
+    QString resultsRoot = QString::fromStdString(scanSettings.resultsPath);
+    QString interrupted = interruptedResultsPath(
+            resultsRoot, FileScanner::configFingerprint(checkedScanPatterns, patternOptions, checkedFileTypes,
+                                                        binaryFileTypes, scanSettings));
+    if (!interrupted.isEmpty() &&
+        QMessageBox::question(this, "Resume scan",
+                              "The scan started " + QFileInfo(interrupted).fileName() +
+                              " with the same settings was interrupted. Do you want to resume it?\n\n"
+                              "Files it scanned that did not change since are not scanned again. "
+                              "Otherwise a new scan is started and the interrupted one is kept.") ==
+        QMessageBox::Yes) {
+        scanSettings.resultsPath = interrupted.toStdString();
+        scanSettings.resume = true;
+    } else {
+        // Every scan gets its own folder, so starting a scan never overwrites the results of an earlier one
+        scanSettings.resultsPath = newResultsPath(resultsRoot).toStdString();
+    }
+    fileScanner->setScanSettings(scanSettings);
+    resultsPath = QString::fromStdString(scanSettings.resultsPath);
+
     auto *waitingDialog = new QProgressDialog("Adding files to scan list", "Cancel", 0, 0, this);
     waitingDialog->setMinimumDuration(700);
     waitingDialog->show();
 
     qDebug() << "Adding files to scan list";
-    // Get all files in pathsToScan that have been last edited in the given time period
+    // Get all files in scanPaths that have been last edited in the given time period
     auto *futureWatcher = new QFutureWatcher<std::vector<std::string>>(this);
-    auto future = QtConcurrent::run(&MainWindow::addFilesToScanList, this);
+    // The GUI thread keeps adding to scanPaths while folders load, the worker gets a snapshot
+    std::vector<QString> listedPaths;
+    scanPaths.forEachListed([this, &listedPaths](PathId id) {
+        listedPaths.push_back(scanPaths.path(id));
+    });
+    auto future = QtConcurrent::run(&MainWindow::addFilesToScanList, std::move(listedPaths),
+                                    ui->fromDateEdit->dateTime(), ui->toDateEdit->dateTime(), exclusionRules);
     connect(futureWatcher, &QFutureWatcher<const std::vector<std::string>>::finished, this,
             [this, futureWatcher, checkedFileTypes, checkedScanPatterns, waitingDialog]() {
                 const std::vector<std::string> filePaths = futureWatcher->result();
@@ -890,14 +990,45 @@ void MainWindow::on_scanButton_clicked() {
     futureWatcher->setFuture(future);
 
     // Clear any previous state
-    flaggedFilesTreeWidget->clear();
-    flaggedItems.clear();
+    clearScanResults();
+}
+
+void MainWindow::clearScanResults() {
+    openedStore.reset();
+    flaggedResultsModel->clear();
     scanResults.clear();
-    numFlaggedItemsLoaded = 0;
     numFlaggedFiles = 0;
     ui->flaggedSearchBox->clear();
+    updatePatternFilter();
     scanResultBits = 0;
-    flaggedFilesTreeWidget->disconnect();
+    allFlaggedSelected = false;
+    ui->selectAllFlaggedButton->setText("Select All");
+}
+
+QString MainWindow::defaultResultsPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/scans";
+}
+
+QString MainWindow::newResultsPath(const QString &resultsRoot) {
+    QDir root(resultsRoot.isEmpty() ? defaultResultsPath() : resultsRoot);
+    QString name = QDateTime::currentDateTime().toString("yyyy-MM-dd_HH-mm-ss");
+    // Two scans started within the same second get a suffix
+    QString candidate = name;
+    for (int i = 2; root.exists(candidate); i++) {
+        candidate = name + "_" + QString::number(i);
+    }
+    return root.filePath(candidate);
+}
+
+QString MainWindow::interruptedResultsPath(const QString &resultsRoot, uint64_t fingerprint) {
+    QDir root(resultsRoot.isEmpty() ? defaultResultsPath() : resultsRoot);
+    // The folders are named after the time their scan started, so the newest comes first
+    for (const QString &name: root.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name | QDir::Reversed)) {
+        if (ResultsStoreWriter::canResume(root.filePath(name).toStdString(), fingerprint)) {
+            return root.filePath(name);
+        }
+    }
+    return {};
 }
 
 void MainWindow::startScanOperation(const std::vector<std::string> &filePaths,
@@ -918,31 +1049,50 @@ void MainWindow::startScanOperation(const std::vector<std::string> &filePaths,
     auto *progressDialog = new QProgressDialog("Scanning in progress", "Cancel", 0, 100);
     progressDialog->setAutoReset(false);
     progressDialog->setMinimumDuration(0);
-    QObject::connect(progressDialog, &QProgressDialog::canceled, [futureWatcher, progressDialog, this]() {
+    scanFuture = future;
+    ui->pauseScanButton->setText("Pause");
+    ui->pauseScanButton->show();
+    QObject::connect(progressDialog, &QProgressDialog::canceled, [futureWatcher, progressDialog]() {
         if (futureWatcher->future().isFinished()) { return; }
+        // The scanner threads stop after their current chunk, the finished handler cleans up
         futureWatcher->future().cancel();
         progressDialog->close();
         progressDialog->deleteLater();
-        futureWatcher->deleteLater();
-        ui->scanButton->setEnabled(true);
     });
 
+    // Connected with the dialog as context, so the connections end when a cancelled scan's dialog is deleted
     QObject::connect(futureWatcher,
                      &QFutureWatcher<std::map<std::string, std::vector<MatchInfo>>>::progressValueChanged,
-                     [progressDialog](int progress) {
+                     progressDialog, [progressDialog](int progress) {
                          // Update progress
                          progressDialog->setValue(progress);
                      });
+    QObject::connect(futureWatcher, &QFutureWatcher<std::map<std::string, std::vector<MatchInfo>>>::suspended,
+                     progressDialog, [progressDialog]() { progressDialog->setLabelText("Scan paused"); });
+    QObject::connect(futureWatcher, &QFutureWatcher<std::map<std::string, std::vector<MatchInfo>>>::resumed,
+                     progressDialog, [progressDialog]() { progressDialog->setLabelText("Scanning in progress"); });
 
     QObject::connect(futureWatcher, &QFutureWatcher<std::map<std::string, std::vector<MatchInfo>>>::finished,
                      [futureWatcher, this, filePaths, progressDialog]() {
+                         scanFuture = {};
+                         ui->pauseScanButton->hide();
                          try {
+                             // Rethrows an error of the scan, which also marks the future as cancelled
+                             futureWatcher->future().waitForFinished();
+                             if (futureWatcher->future().isCanceled()) {
+                                 // Only the checkpoint is kept, the next scan with the same config offers to resume from it
+                                 qDebug() << "Scan cancelled";
+                                 futureWatcher->deleteLater();
+                                 ui->scanButton->setEnabled(true);
+                                 return;
+                             }
                              auto results = futureWatcher->result();  // Get the results when finished
                              qDebug() << "Scan task returned";
-                             if (futureWatcher->future().isCanceled()) { return; }
                              progressDialog->setValue(100);
                              progressDialog->setLabelText("Constructing results...");
                              processScanResults(results);
+                             // Written after the first batch of results is rendered so UI spans are included
+                             SDD_TRACE_DUMP(fileScanner->getScanSettings().tracePath);
 
                              progressDialog->setLabelText("Processed " + QString::number(fileScanner->filesProcessed) +
                                                           " files." + getWarningMessage(scanResultBits));
@@ -969,17 +1119,27 @@ void MainWindow::startScanOperation(const std::vector<std::string> &filePaths,
     futureWatcher->setFuture(future);
 }
 
+void MainWindow::on_pauseScanButton_clicked() {
+    if (scanFuture.isFinished()) {
+        return;
+    }
+    // Suspension takes effect when the scanner threads reach their next check between chunks
+    scanFuture.toggleSuspended();
+    bool paused = scanFuture.isSuspending() || scanFuture.isSuspended();
+    ui->pauseScanButton->setText(paused ? "Resume" : "Pause");
+}
+
 void MainWindow::on_removeSelectedButton_2_clicked() {
     // Get all checked items, only considering topmost checked items
     QList<QTreeWidgetItem *> checkedItems;
 
-    for (auto &item: pathsToScan) {
-        if (item && item->checkState(0) == Qt::Checked) {
+    for (auto &item: treeItems) {
+        if (item->checkState(0) == Qt::Checked) {
             bool isTopmost = true;
-            // Check if the current item has any ancestors in the checkedItems list
+            // Check if the current item has any checked ancestors
             QTreeWidgetItem *parent = item->parent();
             while (parent) {
-                if (checkedItems.contains(parent)) {
+                if (parent != myRootItem && parent->checkState(0) == Qt::Checked) {
                     isTopmost = false;
                     break;
                 }
@@ -1002,36 +1162,22 @@ void MainWindow::on_removeSelectedButton_2_clicked() {
     while (!checkedItems.isEmpty()) {
         auto item = checkedItems.takeFirst();
         QString itemPath = item->data(0, Qt::UserRole).toString();
+        PathId itemId = scanPaths.find(itemPath);
         removeItemFromTree(item);
-        pathsToScan.remove(itemPath);
-        // Set the scan result to clean
-        scanResults[itemPath.toStdString()].first = ScanResult::UNDEFINED;
         watcher->removePath(itemPath);
-        // Remove all flagged items that are children of the removed item
-        for (auto iter = pathsToScan.begin(); iter != pathsToScan.end();) {
-            if (iter.key().startsWith(itemPath)) {
-                scanResults[iter.key().toStdString()].first = ScanResult::UNDEFINED;
-                iter = pathsToScan.erase(iter);
-            } else {
-                ++iter;
-            }
+        if (itemId == INVALID_PATH_ID) {
+            continue;
         }
+        // Reset the scan results of the removed item and everything below it
+        scanPaths.forEachListedInSubtree(itemId, [this](PathId id) {
+            scanResults[scanPaths.path(id).toStdString()] = ScanResult::UNDEFINED;
+        });
+        scanPaths.remove(itemId);
     }
 }
 
 void MainWindow::on_selectAllFlaggedButton_clicked() {
-    for (int i = 0; i < flaggedFilesTreeWidget->topLevelItemCount(); ++i) {
-        // Get the checkbox from the layout on the top level item
-        auto *topLevelItem = flaggedFilesTreeWidget->topLevelItem(i);
-        auto *widget = flaggedFilesTreeWidget->itemWidget(topLevelItem, 0);
-        auto *layout = widget->layout();
-        auto *checkBox = qobject_cast<QCheckBox *>(layout->itemAt(0)->widget());
-        if (allFlaggedSelected) {
-            checkBox->setCheckState(Qt::Unchecked);
-        } else {
-            checkBox->setCheckState(Qt::Checked);
-        }
-    }
+    flaggedResultsModel->setAllChecked(!allFlaggedSelected);
 
     // Toggle the flag
     allFlaggedSelected = !allFlaggedSelected;
@@ -1039,34 +1185,11 @@ void MainWindow::on_selectAllFlaggedButton_clicked() {
 }
 
 void MainWindow::on_unflagSelectedButton_clicked() {
-    // Get all checked items
-    QList<QTreeWidgetItem *> checkedItems;
-    for (int i = 0; i < flaggedFilesTreeWidget->topLevelItemCount(); ++i) {
-        auto *topLevelItem = flaggedFilesTreeWidget->topLevelItem(i);
-        auto *widget = flaggedFilesTreeWidget->itemWidget(topLevelItem, 0);
-        auto *layout = widget->layout();
-        auto *checkBox = qobject_cast<QCheckBox *>(layout->itemAt(0)->widget());
-
-        if (checkBox->checkState() == Qt::Checked) {
-            auto *childLabel = qobject_cast<QLabel *>(
-                    flaggedFilesTreeWidget->itemWidget(topLevelItem->child(0), 0));
-            auto itemToRemove = childLabel->text().split(":").last().trimmed().toStdString();
-
-            flaggedItems.remove(itemToRemove);
-            checkedItems.append(topLevelItem);
-        }
-    }
-
-    // Remove checked items from the tree
-    while (!checkedItems.isEmpty()) {
-        auto item = checkedItems.takeFirst();
-        removeItemFromTree(item);
-        delete item;
-    }
+    flaggedResultsModel->removeCheckedFiles();
 }
 
 void MainWindow::on_deleteButton_clicked() {
-    if (flaggedItems.empty()) { return; }
+    if (flaggedResultsModel->isEmpty()) { return; }
 
     // Show confirmation dialog
     auto *dialog = createConfirmationDialog("Delete Files",
@@ -1077,25 +1200,129 @@ void MainWindow::on_deleteButton_clicked() {
         return;
     }
 
-    QList<std::string> flaggedItemsToRemove = flaggedItems.keys();
-    std::vector<std::string> flaggedItemsToRemoveVector(flaggedItemsToRemove.begin(), flaggedItemsToRemove.end());
-    fileScanner->deleteFiles(flaggedItemsToRemoveVector);
+    std::vector<std::string> flaggedItemsToRemove = flaggedResultsModel->filePaths();
+    fileScanner->deleteFiles(flaggedItemsToRemove);
 
     // Remove all flagged files
-    while (!flaggedItems.empty()) {
-        auto item = flaggedItems.begin();
-        removeItemFromTree(item.value());
-        if (item.value()) {
-            delete item.value();
-        }
-        flaggedItems.remove(item.key());
-    }
+    flaggedResultsModel->clear();
 
     // Close the dialog
     dialog->close();
     delete dialog;
 }
 
+void MainWindow::on_watchCheckBox_toggled(bool checked) {
+    if (!checked) {
+        watchService->stop();
+        return;
+    }
+
+    std::map<std::string, std::string> checkedFileTypes;
+    std::set<std::string> binaryFileTypes;
+    std::vector<std::pair<std::string, std::string>> checkedScanPatterns;
+    std::map<std::string, PatternOptions> patternOptions;
+    if (!getCheckedScanConfig(checkedFileTypes, binaryFileTypes, checkedScanPatterns, patternOptions)) {
+        QSignalBlocker blocker(ui->watchCheckBox);
+        ui->watchCheckBox->setChecked(false);
+        return;
+    }
+
+    // Watch the topmost listed paths, everything listed below them is covered by their watch
+    std::vector<std::string> roots;
+    scanPaths.forEachListed([this, &roots](PathId id) {
+        QString path = scanPaths.path(id);
+        if (scanPaths.findListedAncestor(path) == INVALID_PATH_ID) {
+            roots.push_back(path.toStdString());
+        }
+    });
+
+    try {
+        watchService->start(roots, checkedScanPatterns, checkedFileTypes, binaryFileTypes, patternOptions,
+                            exclusionRules);
+    } catch (const std::exception &e) {
+        QSignalBlocker blocker(ui->watchCheckBox);
+        ui->watchCheckBox->setChecked(false);
+        QMessageBox::critical(this, "Error", QString::fromStdString(e.what()));
+    }
+}
+
+void MainWindow::onWatchedFileScanned(const QString &path, ScanResult result, const std::vector<MatchInfo> &matches) {
+    std::string stdPath = path.toStdString();
+    scanResults[stdPath] = result;
+    if (result == ScanResult::FLAGGED || result == ScanResult::FLAGGED_BUT_UNWRITABLE) {
+        flaggedResultsModel->updateFile(path, matches);
+        if (static_cast<size_t>(ui->flaggedPatternFilter->count() - 1) !=
+            flaggedResultsModel->patternDescriptions().size()) {
+            updatePatternFilter();
+        }
+    } else {
+        flaggedResultsModel->removeFile(path);
+    }
+    if (treeItemForPath(path)) {
+        handleFlaggedScanItem(stdPath);
+    }
+}
+
+void MainWindow::on_openResultsButton_clicked() {
+    // The scanner rewrites the store while a scan is running
+    if (!ui->scanButton->isEnabled()) { return; }
+
+    QString dirPath = QFileDialog::getExistingDirectory(this, tr("Open Scan Results"), defaultResultsPath());
+    if (dirPath.isEmpty()) { return; }
+
+    // Opening validates the whole store, nothing is shown if it is damaged
+    std::unique_ptr<ResultsStore> store;
+    try {
+        store = std::make_unique<ResultsStore>(dirPath);
+    } catch (const std::exception &e) {
+        QMessageBox::critical(this, "Error", QString::fromStdString(e.what()));
+        return;
+    }
+
+    // Only the flagged files are read from the mapped store, the index lists their records
+    clearScanResults();
+    std::vector<FlaggedFile> flaggedFiles;
+    store->forEachFileWithMatches(NO_STORED_PATTERN, [this, &flaggedFiles](const std::string &path,
+                                                                           const std::pair<ScanResult, std::vector<MatchInfo>> &result) {
+        addScanResult(path, result, flaggedFiles);
+    });
+    openedStore = std::move(store);
+    showFlaggedFiles(std::move(flaggedFiles));
+    resultsPath = dirPath;
+    if (!openedStore->isComplete()) {
+        createInfoDialog("Incomplete scan results",
+                                "The scan was interrupted, only the files scanned before that are shown.");
+    }
+}
+
+void MainWindow::on_exportResultsButton_clicked() {
+    if (!ui->scanButton->isEnabled()) { return; }
+
+    if (resultsPath.isEmpty() || !QFile::exists(resultsPath + "/" RESULTS_RECORDS_FILE)) {
+        createInfoDialog("No scan results", "Run a scan or open saved scan results before exporting.");
+        return;
+    }
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export Scan Results"), QDir::currentPath(),
+                                                    tr("JSON Lines (*.jsonl);;CSV (*.csv)"));
+    if (fileName.isEmpty()) { return; }
+
+    // Both exporters stream from the mapped store, nothing is collected in memory
+    QGuiApplication::setOverrideCursor(Qt::WaitCursor);
+    try {
+        ResultsStore store(resultsPath);
+        if (fileName.endsWith(".csv", Qt::CaseInsensitive)) {
+            store.exportCsv(fileName);
+        } else {
+            store.exportJsonl(fileName);
+        }
+    } catch (const std::exception &e) {
+        QGuiApplication::restoreOverrideCursor();
+        QMessageBox::critical(this, "Error", QString::fromStdString(e.what()));
+        return;
+    }
+    QGuiApplication::restoreOverrideCursor();
+}
+
 void MainWindow::on_addPatternButton_clicked() {
     // Add a new row to the scan patterns table
     int row = scanPatternsTableWidget->rowCount();
@@ -1253,65 +1480,34 @@ void MainWindow::on_startConfigButton_clicked() {
     configManager->setConfigFilePath(fileName);
     configManager->scanPatterns.clear();
     configManager->fileTypes.clear();
+    configManager->patternValidators.clear();
+    configManager->patternSomHorizons.clear();
+    configManager->scanSettings = QJsonObject();
     configManager->updateConfigFile();
     configManager->loadConfigFromFile(fileName);
     updateConfigPresentation();
 }
 
-bool MainWindow::isStringInMatchInfo(const MatchInfo &match, const std::string &path, const std::string &searchString) {
-    std::string lowerFilePath = path;
-    std::string lowerMatch = match.match;
-    std::string lowerPattern = match.patternUsed.second;
-
-    std::transform(lowerFilePath.begin(), lowerFilePath.end(), lowerFilePath.begin(), ::tolower);
-    std::transform(lowerFilePath.begin(), lowerFilePath.end(), lowerFilePath.begin(), ::tolower);
-    std::transform(lowerMatch.begin(), lowerMatch.end(), lowerMatch.begin(), ::tolower);
-    std::transform(lowerPattern.begin(), lowerPattern.end(), lowerPattern.begin(), ::tolower);
-
-    if (lowerFilePath.find(searchString) != std::string::npos) {
-        return true;
-    }
-    if (lowerMatch.find(searchString) != std::string::npos) {
-        return true;
-    }
-    if (lowerPattern.find(searchString) != std::string::npos) {
-        return true;
-    }
-
-    return false;
+void MainWindow::on_flaggedSearchBox_textEdited() {
+    // Opened results are already limited to the pattern when they are loaded
+    int patternId = openedStore ? NO_PATTERN_FILTER : ui->flaggedPatternFilter->currentData().toInt();
+    flaggedResultsModel->setFilter(ui->flaggedSearchBox->text(), patternId);
 }
 
-void MainWindow::on_flaggedSearchBox_textEdited() {
-    QString newText = ui->flaggedSearchBox->text();
-    std::string searchText = newText.toStdString();
-    std::transform(searchText.begin(), searchText.end(), searchText.begin(), ::tolower);
-    int activeItems = 0;
-    int matchingItems = 0;
-
-    while (true) {
-        for (auto it = scanResults.begin(); it != scanResults.end(); ++it) {
-            const std::string &filePath = it.key();
-            const auto &matches = it.value();
-
-            for (const auto &match: matches.second) {
-                if (isStringInMatchInfo(match, filePath, searchText)) {
-                    matchingItems++;
-                    if (flaggedItems.contains(filePath)) {
-                        flaggedItems[filePath]->setHidden(false);
-                    }
-                } else {
-                    if (flaggedItems.contains(filePath)) {
-                        flaggedItems[filePath]->setHidden(true);
-                    }
-                }
-                activeItems++;
-            }
-        }
-        if (activeItems < matchingItems) {
-            loadNextFlaggedItemsBatch(newText);
-        } else {
-            break;
-        }
+void MainWindow::onPatternFilterChanged() {
+    if (openedStore) {
+        int patternId = ui->flaggedPatternFilter->currentData().toInt();
+        showOpenedFiles(patternId == NO_PATTERN_FILTER ? NO_STORED_PATTERN : static_cast<uint32_t>(patternId));
     }
+    on_flaggedSearchBox_textEdited();
 }
 
+void MainWindow::showOpenedFiles(uint32_t patternId) {
+    SDD_TRACE_SCOPE("showOpenedFiles");
+    std::vector<FlaggedFile> flaggedFiles;
+    openedStore->forEachFileWithMatches(patternId, [&flaggedFiles](const std::string &path,
+                                                                   const std::pair<ScanResult, std::vector<MatchInfo>> &result) {
+        flaggedFiles.push_back({QString::fromStdString(path), result.second});
+    });
+    flaggedResultsModel->setFiles(std::move(flaggedFiles));
+}
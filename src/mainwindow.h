@@ -7,18 +7,29 @@
 
 #include <QMainWindow>
 #include <QTreeWidget>
+#include <QTreeView>
 #include <QTableWidget>
 #include <QFileSystemWatcher>
 #include <QMap>
+#include <QHash>
 #include <QDebug>
 #include <QProgressDialog>
+#include <QFuture>
 #include <QFileIconProvider>
 #include <QTimer>
+#include <QThreadPool>
 #include <map>
+#include <set>
 
 #include "ui_mainwindow.h"
 #include "configmanager.h"
 #include "filescanner.h"
+#include "flaggedresultsmodel.h"
+#include "patharena.h"
+#include "directoryloader.h"
+#include "watchservice.h"
+#include "exclusionrules.h"
+#include "resultsstore.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -44,10 +55,18 @@ private slots:
 
     void on_scanButton_clicked();
 
+    void on_pauseScanButton_clicked();
+
     void on_selectAllFlaggedButton_clicked();
 
     void on_unflagSelectedButton_clicked();
 
+    void on_watchCheckBox_toggled(bool checked);
+
+    void on_openResultsButton_clicked();
+
+    void on_exportResultsButton_clicked();
+
     void on_addPatternButton_clicked();
 
     void on_deleteButton_clicked();
@@ -60,31 +79,39 @@ private slots:
 
     void on_flaggedSearchBox_textEdited();
 
+    void onPatternFilterChanged();
+
     void startScanOperation(const std::vector<std::string> &filePaths,
                             const std::vector<std::pair<std::string, std::string>> &checkedScanPatterns,
                             const std::map<std::string, std::string> &checkedFileTypes);
 
 public slots:
 
-    void onFlaggedFilesScrollBarMoved(int value);
-
     void onSearchBoxTextEdited(const QString &newText);
 
     void processScanResults(const std::map<std::string, std::pair<ScanResult, std::vector<MatchInfo>>> &results);
 
+    void onDirectoryEntriesLoaded(const QString &path, const QVector<DirectoryEntry> &entries);
+
+    void onDirectoryLoadFinished(const QString &path, bool exists);
+
+    void onWatchedFileScanned(const QString &path, ScanResult result, const std::vector<MatchInfo> &matches);
+
 private:
     QTreeWidget *fileTreeWidget;
-    QTreeWidget *flaggedFilesTreeWidget;
+    QTreeView *flaggedFilesTreeView;
+    FlaggedResultsModel *flaggedResultsModel;
     QTableWidget *fileTypesTableWidget;
     QTableWidget *scanPatternsTableWidget;
     QDateEdit *fromDateEdit;
     QDateEdit *toDateEdit;
-    QMap<QString, QTreeWidgetItem *> pathsToScan;
+    PathArena scanPaths; // Every file and folder added to the scan list
+    QHash<PathId, QTreeWidgetItem *> treeItems; // Tree items of the listed paths that are currently shown
 
-    QMap<std::string, QTreeWidgetItem *> flaggedItems;
-    QMap<std::string, std::pair<ScanResult, std::vector<MatchInfo>>> scanResults;
+    QMap<std::string, ScanResult> scanResults;
 
     ConfigManager *configManager;
+    QThreadPool patternCostPool; // Runs the pattern cost benchmarks one at a time
     QTreeWidgetItem *myRootItem;
     QFileSystemWatcher *watcher;
     FileScanner *fileScanner;
@@ -92,10 +119,17 @@ private:
     bool maxDepthReached = false;
     QString lastUpdatedPath = "";
     QFileIconProvider iconProvider = QFileIconProvider();
+    QHash<QString, QIcon> fileIconCache; // File suffix -> icon
+    StatCache statCache;
+    DirectoryLoader *directoryLoader;
+    WatchService *watchService;
+    ExclusionRules exclusionRules; // Used on the GUI thread, background work gets a copy
     Ui::MainWindow *ui;
     uint8_t scanResultBits = 0;
-    int numFlaggedItemsLoaded = 0;
     int numFlaggedFiles = 0;
+    QString resultsPath; // Results store of the last scan or of the results that were opened
+    std::unique_ptr<ResultsStore> openedStore; // Results opened from disk, the pattern filter reloads them through its index
+    QFuture<std::map<std::string, std::pair<ScanResult, std::vector<MatchInfo>>>> scanFuture; // Running scan
 
 
     QTimer *searchDebounceTimer;
@@ -106,33 +140,67 @@ private:
 
     void updateTreeItem(QTreeWidgetItem *item, const QString &path);
 
-    QTreeWidgetItem *createTreeItem(QTreeWidgetItem *parentItem, const QString &path, bool useShortName);
+    QTreeWidgetItem *createTreeItem(QTreeWidgetItem *parentItem, const QString &path, bool useShortName,
+                                    const FileStat &stat);
+
+    QIcon fileIcon(const QString &fileName);
 
     void removeItemFromTree(QTreeWidgetItem *item);
 
     QString getParentPath(const QString &dirPath);
 
+    QTreeWidgetItem *treeItemForPath(const QString &path) const;
+
     void expandToFlaggedItem(const QString &path);
 
     QDialog *createConfirmationDialog(const QString &title, const QString &labelText, const QString &buttonText);
 
     QDialog *createInfoDialog(const QString &title, const QString &labelText);
 
-    void getScanResultBits(const std::pair<std::string, std::pair<ScanResult, std::vector<MatchInfo>>> &match);
+    void getScanResultBits(ScanResult result);
 
     void setRowBackgroundColor(QTreeWidgetItem *item, const QColor &color, int columnCount);
 
-    void addFlaggedItemWidget(const QString &path, const std::vector<MatchInfo> &matches);
+    void handleFlaggedScanItem(const std::string &flaggedPath);
 
-    void loadNextFlaggedItemsBatch(const QString &searchText = "");
+    // Fills the pattern filter with the patterns that flagged files in the last scan or in the opened results
+    void updatePatternFilter();
 
-    void handleFlaggedScanItem(const std::string &flaggedPath);
+    void clearScanResults();
+
+    // Returns false and tells the user if no file type or pattern is checked
+    bool getCheckedScanConfig(std::map<std::string, std::string> &checkedFileTypes,
+                              std::set<std::string> &binaryFileTypes,
+                              std::vector<std::pair<std::string, std::string>> &checkedScanPatterns,
+                              std::map<std::string, PatternOptions> &patternOptions);
+
+    // Folder the scans are saved in when scanSettings has no resultsPath
+    static QString defaultResultsPath();
+
+    // New folder for the results of one scan below resultsRoot, or below defaultResultsPath() if it is empty
+    static QString newResultsPath(const QString &resultsRoot);
 
-    bool isStringInMatchInfo(const MatchInfo &match, const std::string &path, const std::string &searchString);
+    // Newest folder below resultsRoot with an interrupted scan that has this config fingerprint, empty if there is none
+    static QString interruptedResultsPath(const QString &resultsRoot, uint64_t fingerprint);
 
-    std::vector<std::string> addFilesToScanList();
+    // Records the result of a file and collects it if it was flagged
+    void addScanResult(const std::string &path, const std::pair<ScanResult, std::vector<MatchInfo>> &result,
+                       std::vector<FlaggedFile> &flaggedFiles);
+
+    void showFlaggedFiles(std::vector<FlaggedFile> flaggedFiles);
+
+    // Shows the files of the opened results with a match of the pattern, found through the store index
+    void showOpenedFiles(uint32_t patternId);
+
+    static std::vector<std::string> addFilesToScanList(const std::vector<QString> &listedPaths,
+                                                       const QDateTime &from, const QDateTime &to,
+                                                       const ExclusionRules &rules);
 
     void updateConfigPresentation();
+
+    void loadExclusionRules();
+
+    void updatePatternCost(const QString &pattern);
 };
 
 #endif //SENSITIVE_DATA_DELETER_MAINWINDOW_H
@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cstring>
+
+#include "mimedecoder.h"
+#include "simd.h"
+
+#define BASE64_PADDING -2
+#define BASE64_INVALID -1
+
+static int base64Value(unsigned char c) {
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A';
+    } else if (c >= 'a' && c <= 'z') {
+        return c - 'a' + 26;
+    } else if (c >= '0' && c <= '9') {
+        return c - '0' + 52;
+    } else if (c == '+') {
+        return 62;
+    } else if (c == '/') {
+        return 63;
+    }
+    return c == '=' ? BASE64_PADDING : BASE64_INVALID;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+#ifdef SDD_HAVE_SSE2
+// Decodes 16 base64 characters into 12 bytes, false if any of them is outside the alphabet
+static bool decodeBase64Block(const char *data, char *out) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    auto inRange = [&block](char low, char high) {
+        return _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(static_cast<char>(low - 1))),
+                             _mm_cmplt_epi8(block, _mm_set1_epi8(static_cast<char>(high + 1))));
+    };
+    // Bytes from 0x80 up are negative as signed chars and fall in none of the ranges
+    __m128i upper = inRange('A', 'Z');
+    __m128i lower = inRange('a', 'z');
+    __m128i digit = inRange('0', '9');
+    __m128i plus = _mm_cmpeq_epi8(block, _mm_set1_epi8('+'));
+    __m128i slash = _mm_cmpeq_epi8(block, _mm_set1_epi8('/'));
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+    if (_mm_movemask_epi8(valid) != 0xFFFF) {
+        return false;
+    }
+
+    // Each range is moved to its 6 bit values by adding a constant
+    __m128i shift = _mm_or_si128(
+            _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')), _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+            _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+                         _mm_or_si128(_mm_and_si128(plus, _mm_set1_epi8(62 - '+')),
+                                      _mm_and_si128(slash, _mm_set1_epi8(63 - '/')))));
+    __m128i values = _mm_add_epi8(block, shift);
+
+    // Pairs of 6 bit values to 12 bits per 16 bit lane, then pairs of those to 24 bits per 32 bit lane
+    __m128i pairs = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(values, _mm_set1_epi16(0x00FF)), 6),
+                                 _mm_srli_epi16(values, 8));
+    __m128i groups = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pairs, _mm_set1_epi32(0xFFFF)), 12),
+                                  _mm_srli_epi32(pairs, 16));
+    uint32_t words[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(words), groups);
+    for (int i = 0; i < 4; i++) {
+        out[3 * i] = static_cast<char>(words[i] >> 16);
+        out[3 * i + 1] = static_cast<char>(words[i] >> 8);
+        out[3 * i + 2] = static_cast<char>(words[i]);
+    }
+    return true;
+}
+#elif defined(SDD_HAVE_NEON)
+static bool decodeBase64Block(const char *data, char *out) {
+    uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t *>(data));
+    auto inRange = [&block](char low, char high) {
+        return vandq_u8(vcgeq_u8(block, vdupq_n_u8(low)), vcleq_u8(block, vdupq_n_u8(high)));
+    };
+    uint8x16_t upper = inRange('A', 'Z');
+    uint8x16_t lower = inRange('a', 'z');
+    uint8x16_t digit = inRange('0', '9');
+    uint8x16_t plus = vceqq_u8(block, vdupq_n_u8('+'));
+    uint8x16_t slash = vceqq_u8(block, vdupq_n_u8('/'));
+    uint8x16_t valid = vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, vorrq_u8(plus, slash)));
+    if (vminvq_u8(valid) != 0xFF) {
+        return false;
+    }
+
+    uint8x16_t shift = vorrq_u8(
+            vorrq_u8(vandq_u8(upper, vdupq_n_u8(static_cast<uint8_t>(-'A'))),
+                     vandq_u8(lower, vdupq_n_u8(static_cast<uint8_t>(26 - 'a')))),
+            vorrq_u8(vandq_u8(digit, vdupq_n_u8(static_cast<uint8_t>(52 - '0'))),
+                     vorrq_u8(vandq_u8(plus, vdupq_n_u8(static_cast<uint8_t>(62 - '+'))),
+                              vandq_u8(slash, vdupq_n_u8(static_cast<uint8_t>(63 - '/'))))));
+    uint16x8_t values = vreinterpretq_u16_u8(vaddq_u8(block, shift));
+
+    // Same packing as the SSE2 version, 12 bits per 16 bit lane, then 24 bits per 32 bit lane
+    uint32x4_t pairs = vreinterpretq_u32_u16(vorrq_u16(vshlq_n_u16(vandq_u16(values, vdupq_n_u16(0x00FF)), 6),
+                                                       vshrq_n_u16(values, 8)));
+    uint32x4_t groups = vorrq_u32(vshlq_n_u32(vandq_u32(pairs, vdupq_n_u32(0xFFFF)), 12), vshrq_n_u32(pairs, 16));
+    uint32_t words[4];
+    vst1q_u32(words, groups);
+    for (int i = 0; i < 4; i++) {
+        out[3 * i] = static_cast<char>(words[i] >> 16);
+        out[3 * i + 1] = static_cast<char>(words[i] >> 8);
+        out[3 * i + 2] = static_cast<char>(words[i]);
+    }
+    return true;
+}
+#endif
+
+size_t Base64Decoder::decode(const char *data, size_t size, char *out) {
+    size_t written = 0;
+    size_t pos = 0;
+    while (pos < size) {
+#if defined(SDD_HAVE_SSE2) || defined(SDD_HAVE_NEON)
+        if (numChars == 0 && pos + 16 <= size && decodeBase64Block(data + pos, out + written)) {
+            pos += 16;
+            written += 12;
+            continue;
+        }
+#endif
+        int value = base64Value(static_cast<unsigned char>(data[pos++]));
+        if (value == BASE64_PADDING) {
+            written += finish(out + written);
+        } else if (value != BASE64_INVALID) {
+            quantum = quantum << 6 | static_cast<uint32_t>(value);
+            if (++numChars == 4) {
+                out[written++] = static_cast<char>(quantum >> 16);
+                out[written++] = static_cast<char>(quantum >> 8);
+                out[written++] = static_cast<char>(quantum);
+                numChars = 0;
+            }
+        }
+    }
+    return written;
+}
+
+size_t Base64Decoder::finish(char *out) {
+    size_t written = 0;
+    if (numChars == 2) {
+        out[written++] = static_cast<char>(quantum >> 4);
+    } else if (numChars == 3) {
+        out[written++] = static_cast<char>(quantum >> 10);
+        out[written++] = static_cast<char>(quantum >> 2);
+    }
+    numChars = 0;
+    return written;
+}
+
+// Position of the first '=' from pos on, or end
+static size_t findEscape(const char *data, size_t pos, size_t end) {
+#ifdef SDD_HAVE_SSE2
+    __m128i equals = _mm_set1_epi8('=');
+    while (pos + 16 <= end &&
+           _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos)),
+                                            equals)) == 0) {
+        pos += 16;
+    }
+#elif defined(SDD_HAVE_NEON)
+    uint8x16_t equals = vdupq_n_u8('=');
+    while (pos + 16 <= end &&
+           vmaxvq_u8(vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(data + pos)), equals)) == 0) {
+        pos += 16;
+    }
+#endif
+    while (pos < end && data[pos] != '=') {
+        pos++;
+    }
+    return pos;
+}
+
+size_t QuotedPrintableDecoder::decode(const char *data, size_t size, bool lineEnd, char *out) {
+    if (carryLength > 0) {
+        std::string joined(carry, carryLength);
+        joined.append(data, size);
+        carryLength = 0;
+        return decode(joined.data(), joined.size(), lineEnd, out);
+    }
+
+    size_t written = 0;
+    size_t pos = 0;
+    bool softBreak = false;
+    while (pos < size) {
+        size_t escape = findEscape(data, pos, size);
+        std::memcpy(out + written, data + pos, escape - pos);
+        written += escape - pos;
+        pos = escape;
+        if (pos == size) {
+            break;
+        }
+
+        size_t remaining = size - pos - 1;
+        int high = remaining >= 1 ? hexValue(data[pos + 1]) : -1;
+        int low = remaining >= 2 ? hexValue(data[pos + 2]) : -1;
+        if (high >= 0 && low >= 0) {
+            out[written++] = static_cast<char>(high << 4 | low);
+            pos += 3;
+        } else if (!lineEnd && remaining < 2) {
+            // The rest of the escape is in the next piece of the line
+            carryLength = size - pos;
+            std::memcpy(carry, data + pos, carryLength);
+            return written;
+        } else if (lineEnd && data + size == std::find_if(data + pos + 1, data + size,
+                                                          [](char c) { return c != ' ' && c != '\t'; })) {
+            // "=" at the end of a line, maybe followed by whitespace, joins it with the next line
+            softBreak = true;
+            break;
+        } else {
+            out[written++] = '=';
+            pos++;
+        }
+    }
+    if (lineEnd && !softBreak) {
+        out[written++] = '\n';
+    }
+    return written;
+}
+
+size_t QuotedPrintableDecoder::finish(char *out) {
+    std::memcpy(out, carry, carryLength);
+    size_t written = carryLength;
+    carryLength = 0;
+    return written;
+}
+
+std::string decodeEncodedWords(std::string_view header) {
+    std::string decoded;
+    decoded.reserve(header.size());
+    size_t pos = 0;
+    bool afterWord = false;
+    while (pos < header.size()) {
+        size_t start = header.find("=?", pos);
+        // =?charset?encoding?text?=
+        size_t charsetEnd = start == std::string_view::npos ? start : header.find('?', start + 2);
+        size_t textStart = charsetEnd == std::string_view::npos || charsetEnd + 2 >= header.size() ||
+                           header[charsetEnd + 2] != '?' ? std::string_view::npos : charsetEnd + 3;
+        size_t end = textStart == std::string_view::npos ? textStart : header.find("?=", textStart);
+        if (end == std::string_view::npos) {
+            decoded.append(header.substr(pos));
+            break;
+        }
+
+        // Whitespace between two encoded words is not part of the text
+        std::string_view between = header.substr(pos, start - pos);
+        if (!afterWord || between.find_first_not_of(" \t\r\n") != std::string_view::npos) {
+            decoded.append(between);
+        }
+        std::string_view text = header.substr(textStart, end - textStart);
+        char encoding = header[charsetEnd + 1];
+        size_t oldSize = decoded.size();
+        if (encoding == 'B' || encoding == 'b') {
+            Base64Decoder base64;
+            decoded.resize(oldSize + Base64Decoder::maxDecodedSize(text.size()));
+            size_t written = base64.decode(text.data(), text.size(), &decoded[oldSize]);
+            written += base64.finish(&decoded[oldSize + written]);
+            decoded.resize(oldSize + written);
+        } else if (encoding == 'Q' || encoding == 'q') {
+            std::string underscores(text);
+            std::replace(underscores.begin(), underscores.end(), '_', ' ');
+            QuotedPrintableDecoder quotedPrintable;
+            decoded.resize(oldSize + QuotedPrintableDecoder::maxDecodedSize(text.size()));
+            size_t written = quotedPrintable.decode(underscores.data(), underscores.size(), false, &decoded[oldSize]);
+            written += quotedPrintable.finish(&decoded[oldSize + written]);
+            decoded.resize(oldSize + written);
+        } else {
+            decoded.append(header.substr(start, end + 2 - start));
+        }
+        pos = end + 2;
+        afterWord = true;
+    }
+    return decoded;
+}
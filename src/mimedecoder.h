@@ -0,0 +1,58 @@
+#ifndef SENSITIVE_DATA_DELETER_MIMEDECODER_H
+#define SENSITIVE_DATA_DELETER_MIMEDECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Streaming base64 decoder for MIME bodies. Line breaks and other characters outside the alphabet
+ * are skipped, so lines can be passed in as they are read. Groups of 16 characters are decoded with
+ * SSE2 or NEON where available, which covers all but the end of a 76 character line.
+ */
+class Base64Decoder {
+public:
+    // Room decode() needs in out for size characters
+    static size_t maxDecodedSize(size_t size) { return size / 4 * 3 + 3; }
+
+    // Returns the number of bytes written to out
+    size_t decode(const char *data, size_t size, char *out);
+
+    // Bytes of a last group that had no padding, at most 2
+    size_t finish(char *out);
+
+    void reset() { numChars = 0; }
+
+private:
+    uint32_t quantum = 0; // 6 bits per character of the group decoded so far
+    int numChars = 0;
+};
+
+/**
+ * Streaming quoted-printable decoder, fed one line at a time without its line break. Runs of
+ * literal text are found 16 bytes at a time where SSE2 or NEON is available.
+ */
+class QuotedPrintableDecoder {
+public:
+    // Room decode() needs in out for a line of size bytes
+    static size_t maxDecodedSize(size_t size) { return size + 3; }
+
+    // lineEnd is false for the leading pieces of a line too long to be read at once. An escape that
+    // is cut off at the end of such a piece is kept until the next one.
+    size_t decode(const char *data, size_t size, bool lineEnd, char *out);
+
+    size_t finish(char *out);
+
+    void reset() { carryLength = 0; }
+
+private:
+    char carry[2] = {};
+    size_t carryLength = 0;
+};
+
+// Decodes the RFC 2047 encoded words (=?charset?B?...?= and =?charset?Q?...?=) in a header. The
+// bytes are left in their charset, the scanner's text decoder takes care of that.
+std::string decodeEncodedWords(std::string_view header);
+
+#endif //SENSITIVE_DATA_DELETER_MIMEDECODER_H
@@ -0,0 +1,611 @@
+#include <QDebug>
+#include <QMimeDatabase>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "parsersandbox.h"
+#include "chunkreader.h"
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+
+extern char **environ;
+
+#if defined(__x86_64__)
+#define SECCOMP_AUDIT_ARCH AUDIT_ARCH_X86_64
+#elif defined(__aarch64__)
+#define SECCOMP_AUDIT_ARCH AUDIT_ARCH_AARCH64
+#endif
+
+#define HELPER_RING_FD 3   // Descriptors a helper inherits
+#define HELPER_SOCKET_FD 4
+#define HELPER_MAX_FILES 64
+#define HELPER_MAX_PATH (64 * 1024)
+#endif
+
+#define SLOT_END_OF_FILE 0
+#define SLOT_END_OF_MEMBER (-1)
+#define SLOT_ERROR (-2) // The error message is in the location of the slot
+
+#define COMMAND_FILE 'F'      // Scanner -> helper, followed by the reader type, the path size and the path
+#define COMMAND_SLOT_FREED 'R' // Scanner -> helper, only sent while the helper waits for a free slot
+#define EVENT_SLOT_FILLED 'S'  // Helper -> scanner, only sent while the scanner waits for a filled slot
+
+struct SandboxSlot {
+    int64_t size; // Bytes of text in data, or one of the SLOT_ markers
+    uint32_t locationSize;
+    char location[SANDBOX_LOCATION_SIZE];
+    char data[SANDBOX_SLOT_SIZE];
+};
+
+// Shared by the scanner and one helper. The counters only grow, slot n is slots[n % SANDBOX_RING_SLOTS].
+struct SandboxRing {
+    std::atomic<uint64_t> filled; // Written by the helper
+    std::atomic<uint64_t> freed;  // Written by the scanner
+    std::atomic<uint32_t> scannerWaiting;
+    std::atomic<uint32_t> helperWaiting;
+    SandboxSlot slots[SANDBOX_RING_SLOTS];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "The ring is shared between processes, its atomics can not use locks");
+
+ParserSandboxSettings ParserSandboxSettings::fromJson(const QJsonObject &obj) {
+    ParserSandboxSettings settings;
+    settings.enabled = obj["enabled"].toBool(settings.enabled);
+    settings.helpers = std::max(0, obj["helpers"].toInt(settings.helpers));
+    settings.memoryLimitMB = std::max(0, obj["memoryLimitMB"].toInt(settings.memoryLimitMB));
+    settings.timeoutSeconds = std::max(1, obj["timeoutSeconds"].toInt(settings.timeoutSeconds));
+    return settings;
+}
+
+/**
+ * Scanner side of one helper process: its ring and the socket to it.
+ */
+class ParserHelper {
+public:
+    // Throws std::runtime_error if the helper can not be started
+    explicit ParserHelper(int memoryLimitMB);
+
+    ~ParserHelper();
+
+    bool startFile(const std::filesystem::path &filePath, ChunkReaderType type);
+
+    // The next slot the helper filled, nullptr if the helper is gone or filled none for timeoutMs
+    const SandboxSlot *nextSlot(int timeoutMs);
+
+    void releaseSlot();
+
+    void kill();
+
+    // How the helper ended, for the log
+    std::string exitReason();
+
+private:
+#ifdef Q_OS_LINUX
+    pid_t pid = -1;
+    int socketFd = -1;
+    SandboxRing *ring = nullptr;
+    uint64_t consumed = 0; // Slots released by the scanner
+#endif
+};
+
+#ifdef Q_OS_LINUX
+
+static bool sendAll(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+static bool readAll(int fd, char *data, size_t size) {
+    while (size > 0) {
+        ssize_t received = read(fd, data, size);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+// Moves a descriptor above the ones the helper inherits, so that placing them can not overwrite it
+static int moveAboveHelperFds(int fd) {
+    if (fd < 0 || fd > HELPER_SOCKET_FD) {
+        return fd;
+    }
+    int moved = fcntl(fd, F_DUPFD_CLOEXEC, HELPER_SOCKET_FD + 1);
+    close(fd);
+    return moved;
+}
+
+ParserHelper::ParserHelper(int memoryLimitMB) {
+    int ringFd = moveAboveHelperFds(memfd_create("sdd-parser-ring", MFD_CLOEXEC));
+    int sockets[2] = {-1, -1};
+    void *mapping = MAP_FAILED;
+    if (ringFd >= 0 && ftruncate(ringFd, sizeof(SandboxRing)) == 0) {
+        mapping = mmap(nullptr, sizeof(SandboxRing), PROT_READ | PROT_WRITE, MAP_SHARED, ringFd, 0);
+    }
+    if (mapping == MAP_FAILED || socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+        std::string error = std::strerror(errno);
+        if (mapping != MAP_FAILED) munmap(mapping, sizeof(SandboxRing));
+        if (ringFd >= 0) close(ringFd);
+        throw std::runtime_error("Could not set up a parser helper: " + error);
+    }
+    ring = static_cast<SandboxRing *>(mapping);
+    sockets[1] = moveAboveHelperFds(sockets[1]);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, ringFd, HELPER_RING_FD);
+    posix_spawn_file_actions_adddup2(&actions, sockets[1], HELPER_SOCKET_FD);
+    std::string memoryLimit = std::to_string(memoryLimitMB);
+    char name[] = "sdd-parser-helper";
+    char argument[] = PARSER_HELPER_ARGUMENT;
+    char *argv[] = {name, argument, memoryLimit.data(), nullptr};
+    // The helper is this executable, /proc/self/exe still finds it if it was moved or replaced
+    int error = posix_spawn(&pid, "/proc/self/exe", &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(ringFd);
+    close(sockets[1]);
+    socketFd = sockets[0];
+    if (error != 0) {
+        pid = -1;
+        munmap(ring, sizeof(SandboxRing));
+        close(socketFd);
+        throw std::runtime_error(std::string("Could not start a parser helper: ") + std::strerror(error));
+    }
+}
+
+ParserHelper::~ParserHelper() {
+    // An idle helper exits once its socket is closed
+    close(socketFd);
+    munmap(ring, sizeof(SandboxRing));
+    if (pid > 0) {
+        waitpid(pid, nullptr, 0);
+    }
+}
+
+bool ParserHelper::startFile(const std::filesystem::path &filePath, ChunkReaderType type) {
+    std::string path = filePath.string();
+    std::string command(1, COMMAND_FILE);
+    command += static_cast<char>(type);
+    for (int i = 0; i < 4; i++) {
+        command += static_cast<char>(path.size() >> 8 * i);
+    }
+    command += path;
+    return sendAll(socketFd, command.data(), command.size());
+}
+
+const SandboxSlot *ParserHelper::nextSlot(int timeoutMs) {
+    while (ring->filled.load() == consumed) {
+        // Either the helper sees the flag or this sees the slot it filled in the meantime
+        ring->scannerWaiting.store(1);
+        if (ring->filled.load() != consumed) {
+            ring->scannerWaiting.store(0);
+            break;
+        }
+        pollfd pollFd = {socketFd, POLLIN, 0};
+        int ready = poll(&pollFd, 1, timeoutMs);
+        ring->scannerWaiting.store(0);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            return nullptr;
+        }
+        char events[64];
+        if (read(socketFd, events, sizeof(events)) <= 0 && ring->filled.load() == consumed) {
+            return nullptr;
+        }
+    }
+    return &ring->slots[consumed % SANDBOX_RING_SLOTS];
+}
+
+void ParserHelper::releaseSlot() {
+    ring->freed.store(++consumed);
+    if (ring->helperWaiting.load()) {
+        char command = COMMAND_SLOT_FREED;
+        sendAll(socketFd, &command, 1);
+    }
+}
+
+void ParserHelper::kill() {
+    if (pid > 0) {
+        ::kill(pid, SIGKILL);
+    }
+}
+
+std::string ParserHelper::exitReason() {
+    int status = 0;
+    if (pid <= 0 || waitpid(pid, &status, WNOHANG) != pid) {
+        return "the parser helper stopped responding";
+    }
+    pid = -1;
+    if (WIFSIGNALED(status)) {
+        return "the parser helper was killed by signal " + std::to_string(WTERMSIG(status));
+    }
+    return "the parser helper exited with code " + std::to_string(WEXITSTATUS(status));
+}
+
+static bool applyHelperLimits(int memoryLimitMB) {
+    rlimit noCores = {0, 0};
+    rlimit files = {HELPER_MAX_FILES, HELPER_MAX_FILES};
+    if (setrlimit(RLIMIT_CORE, &noCores) != 0 || setrlimit(RLIMIT_NOFILE, &files) != 0) {
+        return false;
+    }
+    if (memoryLimitMB > 0) {
+        rlim_t bytes = static_cast<rlim_t>(memoryLimitMB) * 1024 * 1024;
+        rlimit memory = {bytes, bytes};
+        return setrlimit(RLIMIT_AS, &memory) == 0;
+    }
+    return true;
+}
+
+// Everything not allowed fails with EPERM, so a parser that tries something unexpected gets an
+// error instead of taking the helper down
+static bool installSyscallFilter() {
+#ifdef SECCOMP_AUDIT_ARCH
+    std::vector<sock_filter> filter = {
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(seccomp_data, arch)),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SECCOMP_AUDIT_ARCH, 1, 0),
+            BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS),
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(seccomp_data, nr)),
+    };
+    auto allow = [&filter](uint32_t nr) {
+        filter.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, nr, 0, 1));
+        filter.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+    };
+    // Allowed unless one of the flags is set in the lower half of the argument
+    auto allowWithout = [&filter](uint32_t nr, uint32_t argument, uint32_t flags) {
+        filter.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, nr, 0, 4));
+        filter.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                                  static_cast<uint32_t>(offsetof(seccomp_data, args) + argument * sizeof(uint64_t))));
+        filter.push_back(BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, flags, 1, 0));
+        filter.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+        filter.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EACCES));
+    };
+
+    for (uint32_t nr: {SYS_read, SYS_pread64, SYS_readv, SYS_write, SYS_writev, SYS_lseek, SYS_close,
+                       SYS_fstat, SYS_newfstatat, SYS_statx, SYS_getdents64, SYS_fcntl, SYS_munmap,
+                       SYS_mremap, SYS_madvise, SYS_brk, SYS_futex, SYS_clock_gettime, SYS_clock_nanosleep,
+                       SYS_nanosleep, SYS_getpid, SYS_gettid, SYS_getuid, SYS_geteuid, SYS_getgid,
+                       SYS_getegid, SYS_getrandom, SYS_prlimit64, SYS_sched_yield, SYS_sched_getaffinity,
+                       SYS_rt_sigreturn, SYS_rt_sigprocmask, SYS_exit, SYS_exit_group}) {
+        allow(nr);
+    }
+#ifdef SYS_stat
+    allow(SYS_stat);
+    allow(SYS_lstat);
+#endif
+    // Files are only opened for reading, and no new code is mapped
+    allowWithout(SYS_openat, 2, O_WRONLY | O_RDWR | O_CREAT | O_TRUNC | O_APPEND);
+#ifdef SYS_open
+    allowWithout(SYS_open, 1, O_WRONLY | O_RDWR | O_CREAT | O_TRUNC | O_APPEND);
+#endif
+    allowWithout(SYS_mmap, 2, PROT_EXEC);
+    allowWithout(SYS_mprotect, 2, PROT_EXEC);
+    filter.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EPERM));
+
+    sock_fprog program = {static_cast<unsigned short>(filter.size()), filter.data()};
+    return prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == 0 &&
+           prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &program) == 0;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Helper side of the ring.
+ */
+class HelperRing {
+public:
+    explicit HelperRing(SandboxRing *ring) : ring(ring) {}
+
+    // Waits until the scanner released a slot, false if the scanner is gone
+    SandboxSlot *freeSlot() {
+        while (filled - ring->freed.load() >= SANDBOX_RING_SLOTS) {
+            ring->helperWaiting.store(1);
+            if (filled - ring->freed.load() < SANDBOX_RING_SLOTS) {
+                ring->helperWaiting.store(0);
+                break;
+            }
+            char command;
+            bool received = readAll(HELPER_SOCKET_FD, &command, 1);
+            ring->helperWaiting.store(0);
+            if (!received) {
+                return nullptr;
+            }
+        }
+        return &ring->slots[filled % SANDBOX_RING_SLOTS];
+    }
+
+    bool publish(SandboxSlot &slot, int64_t size, const std::string &location) {
+        slot.size = size;
+        slot.locationSize = static_cast<uint32_t>(std::min(location.size(), static_cast<size_t>(SANDBOX_LOCATION_SIZE)));
+        std::memcpy(slot.location, location.data(), slot.locationSize);
+        ring->filled.store(++filled);
+        if (ring->scannerWaiting.load()) {
+            char event = EVENT_SLOT_FILLED;
+            return write(HELPER_SOCKET_FD, &event, 1) == 1;
+        }
+        return true;
+    }
+
+private:
+    SandboxRing *ring;
+    uint64_t filled = 0;
+};
+
+// Reads the file with its reader into the ring, false if the scanner is gone
+static bool extractFile(HelperRing &helperRing, const std::string &path, ChunkReaderType type) {
+    std::unique_ptr<ChunkReader> reader;
+    SandboxSlot *slot = helperRing.freeSlot();
+    if (!slot) {
+        return false;
+    }
+    try {
+        reader.reset(ChunkReaderFactory::createReader(path, type));
+        if (!reader) {
+            return helperRing.publish(*slot, SLOT_ERROR, "No reader for the file type");
+        }
+    } catch (std::exception &e) {
+        return helperRing.publish(*slot, SLOT_ERROR, e.what());
+    }
+    while (true) {
+        size_t size;
+        try {
+            size = reader->readChunkFromFile(slot->data, SANDBOX_SLOT_SIZE);
+        } catch (std::exception &e) {
+            return helperRing.publish(*slot, SLOT_ERROR, e.what());
+        }
+        int64_t slotSize = size == static_cast<size_t>(-1) ? SLOT_END_OF_MEMBER : static_cast<int64_t>(size);
+        if (!helperRing.publish(*slot, slotSize, reader->currentLocation())) {
+            return false;
+        }
+        if (size == 0) {
+            return true;
+        }
+        slot = helperRing.freeSlot();
+        if (!slot) {
+            return false;
+        }
+    }
+}
+
+#else
+
+ParserHelper::ParserHelper(int) {
+    throw std::runtime_error("Parser helpers are only supported on Linux");
+}
+
+ParserHelper::~ParserHelper() = default;
+
+bool ParserHelper::startFile(const std::filesystem::path &, ChunkReaderType) {
+    return false;
+}
+
+const SandboxSlot *ParserHelper::nextSlot(int) {
+    return nullptr;
+}
+
+void ParserHelper::releaseSlot() {}
+
+void ParserHelper::kill() {}
+
+std::string ParserHelper::exitReason() {
+    return {};
+}
+
+#endif
+
+ParserPool::ParserPool(const ParserSandboxSettings &settings, size_t maxHelpers)
+        : settings(settings), maxHelpers(std::max<size_t>(1, maxHelpers)) {}
+
+ParserPool::~ParserPool() = default;
+
+bool ParserPool::isSupported() {
+#if defined(Q_OS_LINUX) && defined(SECCOMP_AUDIT_ARCH)
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<ParserHelper> ParserPool::acquire() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this]() { return !idleHelpers.empty() || numHelpers < maxHelpers; });
+    if (!idleHelpers.empty()) {
+        std::unique_ptr<ParserHelper> helper = std::move(idleHelpers.back());
+        idleHelpers.pop_back();
+        return helper;
+    }
+    numHelpers++;
+    lock.unlock();
+    try {
+        return std::make_unique<ParserHelper>(settings.memoryLimitMB);
+    } catch (std::runtime_error &) {
+        lock.lock();
+        numHelpers--;
+        cond.notify_one();
+        throw;
+    }
+}
+
+void ParserPool::release(std::unique_ptr<ParserHelper> helper, bool healthy) {
+    if (!helper) {
+        return;
+    }
+    if (!healthy) {
+        helper->kill();
+        helper.reset();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (healthy) {
+        idleHelpers.push_back(std::move(helper));
+    } else {
+        numHelpers--;
+    }
+    cond.notify_one();
+}
+
+SandboxedChunkReader::SandboxedChunkReader(ParserPool &pool, const std::filesystem::path &filePath,
+                                           ChunkReaderType type)
+        : ChunkReader(filePath), pool(pool), helper(pool.acquire()), type(type) {
+    if (!helper->startFile(filePath, type)) {
+        pool.release(std::move(helper), false);
+        throw std::runtime_error("The parser helper is not responding");
+    }
+}
+
+SandboxedChunkReader::~SandboxedChunkReader() {
+    // The helper of a file that was not read to the end is still busy with it
+    pool.release(std::move(helper), false);
+}
+
+void SandboxedChunkReader::fail(const std::string &reason) {
+    failed = true;
+    qWarning() << "Could not extract the text of" << filePath.string() << ":" << reason;
+}
+
+size_t SandboxedChunkReader::readChunk(const char *&chunk, char *buffer, int chunkSize) {
+    if (slotOffset == slotSize) {
+        if (!helper) {
+            return 0;
+        }
+        if (holdingSlot) {
+            helper->releaseSlot();
+            holdingSlot = false;
+        }
+        const SandboxSlot *slot = helper->nextSlot(pool.timeoutMs());
+        if (!slot) {
+            fail(helper->exitReason());
+            pool.release(std::move(helper), false);
+            return 0;
+        }
+        // The helper can still write the slot, each field is read once and only the checked copy is used
+        int64_t size = *static_cast<const volatile int64_t *>(&slot->size);
+        uint32_t locationSize = *static_cast<const volatile uint32_t *>(&slot->locationSize);
+        if (size > SANDBOX_SLOT_SIZE || locationSize > SANDBOX_LOCATION_SIZE) {
+            fail("the parser helper returned a broken slot");
+            pool.release(std::move(helper), false);
+            return 0;
+        }
+        holdingSlot = true;
+        location.assign(slot->location, locationSize);
+        slotData = slot->data;
+        slotSize = 0;
+        slotOffset = 0;
+        if (size == SLOT_END_OF_MEMBER) {
+            return static_cast<size_t>(-1);
+        } else if (size == SLOT_END_OF_FILE || size == SLOT_ERROR) {
+            if (size == SLOT_ERROR) {
+                fail(location);
+            }
+            helper->releaseSlot();
+            holdingSlot = false;
+            pool.release(std::move(helper), true);
+            return 0;
+        } else if (size < 0) {
+            fail("the parser helper returned a broken slot");
+            pool.release(std::move(helper), false);
+            return 0;
+        }
+        slotSize = static_cast<size_t>(size);
+    }
+    size_t size = std::min(slotSize - slotOffset, static_cast<size_t>(std::max(0, chunkSize)));
+    chunk = slotData + slotOffset;
+    slotOffset += size;
+    return size;
+}
+
+size_t SandboxedChunkReader::readChunkFromFile(char *buffer, int chunkSize) {
+    const char *chunk = buffer;
+    size_t size = readChunk(chunk, buffer, chunkSize);
+    if (chunk != buffer && size != 0 && size != static_cast<size_t>(-1)) {
+        std::memcpy(buffer, chunk, size);
+    }
+    return size;
+}
+
+bool isParserHelper(int argc, char *argv[]) {
+    return argc > 1 && std::strcmp(argv[1], PARSER_HELPER_ARGUMENT) == 0;
+}
+
+int runParserHelper(int argc, char *argv[]) {
+#ifdef Q_OS_LINUX
+    // Helpers exit when the socket to the scanner is closed, which also happens if the scanner dies.
+    // PR_SET_PDEATHSIG would not do, it fires when the scanner thread that started the helper exits.
+    int memoryLimitMB = argc > 2 ? std::atoi(argv[2]) : 0;
+    void *mapping = mmap(nullptr, sizeof(SandboxRing), PROT_READ | PROT_WRITE, MAP_SHARED, HELPER_RING_FD, 0);
+    close(HELPER_RING_FD);
+    if (mapping == MAP_FAILED) {
+        qWarning() << "The parser helper could not map its ring";
+        return 1;
+    }
+    // Zip members are told apart by their content, the MIME database is loaded before the filter is in place
+    QMimeDatabase().mimeTypeForData(QByteArray("%PDF-"));
+    if (!applyHelperLimits(memoryLimitMB) || !installSyscallFilter()) {
+        qWarning() << "The parser helper could not sandbox itself";
+        return 1;
+    }
+
+    HelperRing helperRing(static_cast<SandboxRing *>(mapping));
+    while (true) {
+        char command;
+        if (!readAll(HELPER_SOCKET_FD, &command, 1)) {
+            return 0;
+        }
+        if (command == COMMAND_SLOT_FREED) {
+            // Wake-up that arrived after the last file was done
+            continue;
+        }
+        unsigned char header[5];
+        if (command != COMMAND_FILE || !readAll(HELPER_SOCKET_FD, reinterpret_cast<char *>(header), sizeof(header))) {
+            return 1;
+        }
+        uint32_t pathSize = header[1] | header[2] << 8 | header[3] << 16 | static_cast<uint32_t>(header[4]) << 24;
+        if (header[0] >= NUM_READER_TYPES || pathSize > HELPER_MAX_PATH) {
+            return 1;
+        }
+        std::string path(pathSize, '\0');
+        if (!readAll(HELPER_SOCKET_FD, path.data(), pathSize) ||
+            !extractFile(helperRing, path, static_cast<ChunkReaderType>(header[0]))) {
+            return 1;
+        }
+    }
+#else
+    return 1;
+#endif
+}
@@ -0,0 +1,72 @@
+#ifndef SENSITIVE_DATA_DELETER_PARSERSANDBOX_H
+#define SENSITIVE_DATA_DELETER_PARSERSANDBOX_H
+
+#include <QJsonObject>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define SANDBOX_SLOT_SIZE (64 * 1024) // Text per ring slot, the same as the scanner's chunk size
+#define SANDBOX_RING_SLOTS 8
+#define SANDBOX_LOCATION_SIZE 1024    // Longer member names are cut off
+#define PARSER_HELPER_ARGUMENT "--parser-helper"
+
+struct ParserSandboxSettings {
+    bool enabled = false;
+    int helpers = 0;           // 0 for one per scanner thread
+    int memoryLimitMB = 1024;  // Address space of a helper, a file that needs more fails
+    int timeoutSeconds = 120;  // Longest a helper may take for one chunk before it is killed
+
+    static ParserSandboxSettings fromJson(const QJsonObject &obj);
+};
+
+class ParserHelper;
+
+/**
+ * Helper processes that run the PDF, XML and container readers for the scanner threads, so a parser
+ * that crashes on a malformed file takes down only its helper. Helpers are started on demand, up to
+ * the configured number, and wait for the next file after one is done. A helper that crashed or
+ * timed out is replaced by a new one.
+ *
+ * Each helper is this executable started with PARSER_HELPER_ARGUMENT. Before it reads its first file
+ * it limits its address space, may not write or create files, and installs a seccomp filter that
+ * denies everything besides reading files, managing memory and talking to the scanner over the
+ * descriptors it inherited. The extracted text goes through a ring of SANDBOX_RING_SLOTS slots in
+ * shared memory, which the helper fills in place and the scanner matches in place. A Unix socket pair
+ * only wakes up the other side when it is waiting. Linux only.
+ */
+class ParserPool {
+public:
+    ParserPool(const ParserSandboxSettings &settings, size_t maxHelpers);
+
+    ~ParserPool();
+
+    static bool isSupported();
+
+    // An idle helper, or a new one while fewer than maxHelpers exist, otherwise waits for one to be
+    // released. Throws std::runtime_error if a helper can not be started.
+    std::unique_ptr<ParserHelper> acquire();
+
+    // Helpers that are not healthy are stopped instead of waiting for the next file
+    void release(std::unique_ptr<ParserHelper> helper, bool healthy);
+
+    int timeoutMs() const { return settings.timeoutSeconds * 1000; }
+
+private:
+    ParserSandboxSettings settings;
+    size_t maxHelpers;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<std::unique_ptr<ParserHelper>> idleHelpers;
+    size_t numHelpers = 0;
+};
+
+// True if the process was started as a parser helper
+bool isParserHelper(int argc, char *argv[]);
+
+// Main loop of a parser helper, returns the exit code
+int runParserHelper(int argc, char *argv[]);
+
+#endif //SENSITIVE_DATA_DELETER_PARSERSANDBOX_H
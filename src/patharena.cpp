@@ -0,0 +1,242 @@
+#include "patharena.h"
+
+#define INITIAL_TABLE_SIZE 1024 // Must be a power of two
+
+PathArena::PathArena() {
+    clear();
+}
+
+void PathArena::clear() {
+    nodes.clear();
+    listed.clear();
+    numListed = 0;
+    componentPool.clear();
+    componentOffsets.assign(1, 0);
+    componentTable.assign(INITIAL_TABLE_SIZE, 0);
+    childTable.assign(INITIAL_TABLE_SIZE, 0);
+
+    // The root has no name, "/a" starts with an empty component and "C:/a" with "C:"
+    nodes.push_back({INVALID_PATH_ID, 0, INVALID_PATH_ID, INVALID_PATH_ID});
+    listed.push_back(0);
+}
+
+// FNV-1a
+uint32_t PathArena::hashBytes(const char *data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+uint32_t PathArena::hashChild(PathId parent, uint32_t component) {
+    uint64_t key = (static_cast<uint64_t>(parent) << 32) | component;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return static_cast<uint32_t>(key);
+}
+
+template<typename F>
+void PathArena::forEachComponent(const std::string &path, F f) {
+    size_t start = 0;
+    while (true) {
+        size_t end = path.find('/', start);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        // Skip empty components except the leading one of an absolute path
+        if (end > start || start == 0) {
+            if (!f(path.data() + start, end - start)) {
+                return;
+            }
+        }
+        if (end == path.size()) {
+            return;
+        }
+        start = end + 1;
+    }
+}
+
+uint32_t PathArena::findComponent(const char *data, size_t size) const {
+    size_t mask = componentTable.size() - 1;
+    for (size_t slot = hashBytes(data, size) & mask;; slot = (slot + 1) & mask) {
+        uint32_t entry = componentTable[slot];
+        if (entry == 0) {
+            return UINT32_MAX;
+        }
+        uint32_t component = entry - 1;
+        uint32_t offset = componentOffsets[component];
+        if (componentOffsets[component + 1] - offset == size &&
+            componentPool.compare(offset, size, data, size) == 0) {
+            return component;
+        }
+    }
+}
+
+uint32_t PathArena::internComponent(const char *data, size_t size) {
+    uint32_t component = findComponent(data, size);
+    if (component != UINT32_MAX) {
+        return component;
+    }
+    if (componentOffsets.size() * 4 > componentTable.size() * 3) {
+        growComponentTable();
+    }
+    component = static_cast<uint32_t>(componentOffsets.size() - 1);
+    componentPool.append(data, size);
+    componentOffsets.push_back(static_cast<uint32_t>(componentPool.size()));
+
+    size_t mask = componentTable.size() - 1;
+    size_t slot = hashBytes(data, size) & mask;
+    while (componentTable[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    componentTable[slot] = component + 1;
+    return component;
+}
+
+void PathArena::growComponentTable() {
+    std::vector<uint32_t> table(componentTable.size() * 2, 0);
+    size_t mask = table.size() - 1;
+    for (uint32_t component = 0; component + 1 < componentOffsets.size(); component++) {
+        uint32_t offset = componentOffsets[component];
+        size_t slot = hashBytes(componentPool.data() + offset, componentOffsets[component + 1] - offset) & mask;
+        while (table[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = component + 1;
+    }
+    componentTable.swap(table);
+}
+
+PathId PathArena::findChild(PathId parent, uint32_t component) const {
+    size_t mask = childTable.size() - 1;
+    for (size_t slot = hashChild(parent, component) & mask;; slot = (slot + 1) & mask) {
+        PathId entry = childTable[slot];
+        if (entry == 0) {
+            return INVALID_PATH_ID;
+        }
+        const Node &node = nodes[entry - 1];
+        if (node.parent == parent && node.component == component) {
+            return entry - 1;
+        }
+    }
+}
+
+PathId PathArena::addChild(PathId parent, uint32_t component) {
+    if (nodes.size() * 4 > childTable.size() * 3) {
+        growChildTable();
+    }
+    auto id = static_cast<PathId>(nodes.size());
+    nodes.push_back({parent, component, INVALID_PATH_ID, nodes[parent].firstChild});
+    listed.push_back(0);
+    nodes[parent].firstChild = id;
+
+    size_t mask = childTable.size() - 1;
+    size_t slot = hashChild(parent, component) & mask;
+    while (childTable[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    childTable[slot] = id + 1;
+    return id;
+}
+
+void PathArena::growChildTable() {
+    std::vector<PathId> table(childTable.size() * 2, 0);
+    size_t mask = table.size() - 1;
+    for (PathId id = 1; id < nodes.size(); id++) {
+        size_t slot = hashChild(nodes[id].parent, nodes[id].component) & mask;
+        while (table[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = id + 1;
+    }
+    childTable.swap(table);
+}
+
+PathId PathArena::insert(const QString &path) {
+    PathId node = ROOT_PATH_ID;
+    forEachComponent(path.toStdString(), [this, &node](const char *data, size_t size) {
+        uint32_t component = internComponent(data, size);
+        PathId child = findChild(node, component);
+        node = child != INVALID_PATH_ID ? child : addChild(node, component);
+        return true;
+    });
+    if (node != ROOT_PATH_ID && !listed[node]) {
+        listed[node] = 1;
+        numListed++;
+    }
+    return node;
+}
+
+PathId PathArena::find(const QString &path) const {
+    PathId node = ROOT_PATH_ID;
+    forEachComponent(path.toStdString(), [this, &node](const char *data, size_t size) {
+        uint32_t component = findComponent(data, size);
+        node = component == UINT32_MAX ? INVALID_PATH_ID : findChild(node, component);
+        return node != INVALID_PATH_ID;
+    });
+    return node != INVALID_PATH_ID && node != ROOT_PATH_ID && listed[node] ? node : INVALID_PATH_ID;
+}
+
+PathId PathArena::findListedAncestor(const QString &path) const {
+    PathId node = ROOT_PATH_ID;
+    PathId ancestor = INVALID_PATH_ID;
+    forEachComponent(path.toStdString(), [this, &node, &ancestor](const char *data, size_t size) {
+        // node is the parent of the current component here, so the path itself is never returned
+        if (listed[node]) {
+            ancestor = node;
+        }
+        uint32_t component = findComponent(data, size);
+        node = component == UINT32_MAX ? INVALID_PATH_ID : findChild(node, component);
+        return node != INVALID_PATH_ID;
+    });
+    return ancestor;
+}
+
+QString PathArena::path(PathId id) const {
+    std::vector<uint32_t> components;
+    for (PathId node = id; node != ROOT_PATH_ID && node != INVALID_PATH_ID; node = nodes[node].parent) {
+        components.push_back(nodes[node].component);
+    }
+    std::string result;
+    for (auto it = components.rbegin(); it != components.rend(); ++it) {
+        if (it != components.rbegin()) {
+            result += '/';
+        }
+        uint32_t offset = componentOffsets[*it];
+        result.append(componentPool, offset, componentOffsets[*it + 1] - offset);
+    }
+    return QString::fromStdString(result);
+}
+
+PathId PathArena::nextInSubtree(PathId node, PathId root) const {
+    if (nodes[node].firstChild != INVALID_PATH_ID) {
+        return nodes[node].firstChild;
+    }
+    while (node != root) {
+        if (nodes[node].nextSibling != INVALID_PATH_ID) {
+            return nodes[node].nextSibling;
+        }
+        node = nodes[node].parent;
+    }
+    return INVALID_PATH_ID;
+}
+
+void PathArena::remove(PathId id) {
+    if (id == INVALID_PATH_ID || id == ROOT_PATH_ID) {
+        return;
+    }
+    for (PathId node = id; node != INVALID_PATH_ID; node = nextInSubtree(node, id)) {
+        if (listed[node]) {
+            listed[node] = 0;
+            numListed--;
+        }
+    }
+}
+
+size_t PathArena::memoryUsage() const {
+    return nodes.capacity() * sizeof(Node) + listed.capacity() + componentPool.capacity() +
+           componentOffsets.capacity() * sizeof(uint32_t) + componentTable.capacity() * sizeof(uint32_t) +
+           childTable.capacity() * sizeof(PathId);
+}
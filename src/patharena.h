@@ -0,0 +1,111 @@
+#ifndef SENSITIVE_DATA_DELETER_PATHARENA_H
+#define SENSITIVE_DATA_DELETER_PATHARENA_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <QString>
+
+typedef uint32_t PathId;
+
+#define INVALID_PATH_ID UINT32_MAX
+#define ROOT_PATH_ID 0
+
+/**
+ * Set of paths stored as a trie of interned '/' separated components. Every node is 16 bytes
+ * plus a flag, and a name shared by many directories ("src", "index.html") is stored once, so
+ * millions of paths take tens of MB instead of a full QString per path.
+ * Nodes are addressed by integer ids that stay valid until clear(). Removing a path only clears
+ * the listed flag of its subtree, the nodes are kept and reused if the path is added again.
+ */
+class PathArena {
+public:
+    PathArena();
+
+    // Adds the path to the list and returns its id, creates the nodes of missing parent directories
+    PathId insert(const QString &path);
+
+    // Id of a listed path or INVALID_PATH_ID
+    PathId find(const QString &path) const;
+
+    bool contains(const QString &path) const { return find(path) != INVALID_PATH_ID; }
+
+    bool isListed(PathId id) const { return listed[id] != 0; }
+
+    PathId parent(PathId id) const { return nodes[id].parent; }
+
+    // Closest listed directory above the path, INVALID_PATH_ID if there is none. O(depth).
+    PathId findListedAncestor(const QString &path) const;
+
+    QString path(PathId id) const;
+
+    // Removes the path and everything below it from the list. O(size of the subtree).
+    void remove(PathId id);
+
+    void clear();
+
+    size_t size() const { return numListed; }
+
+    size_t memoryUsage() const;
+
+    // Calls f(PathId) for every listed path
+    template<typename F>
+    void forEachListed(F f) const {
+        for (PathId id = 1; id < nodes.size(); id++) {
+            if (listed[id]) {
+                f(id);
+            }
+        }
+    }
+
+    // Calls f(PathId) for every listed path in the subtree of id, including id itself
+    template<typename F>
+    void forEachListedInSubtree(PathId id, F f) const {
+        for (PathId node = id; node != INVALID_PATH_ID; node = nextInSubtree(node, id)) {
+            if (listed[node]) {
+                f(node);
+            }
+        }
+    }
+
+private:
+    struct Node {
+        PathId parent;
+        uint32_t component;
+        PathId firstChild;
+        PathId nextSibling;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint8_t> listed;
+    size_t numListed = 0;
+
+    std::string componentPool; // UTF-8 names of all components back to back
+    std::vector<uint32_t> componentOffsets; // Start of each component in the pool, plus the end of the last one
+    std::vector<uint32_t> componentTable; // Open addressing, component id + 1 or 0 for empty
+    std::vector<PathId> childTable; // Open addressing over (parent, component), node id + 1 or 0 for empty
+
+    static uint32_t hashBytes(const char *data, size_t size);
+
+    static uint32_t hashChild(PathId parent, uint32_t component);
+
+    uint32_t findComponent(const char *data, size_t size) const;
+
+    uint32_t internComponent(const char *data, size_t size);
+
+    PathId findChild(PathId parent, uint32_t component) const;
+
+    PathId addChild(PathId parent, uint32_t component);
+
+    void growComponentTable();
+
+    void growChildTable();
+
+    // Pre-order successor of node that stays inside the subtree of root
+    PathId nextInSubtree(PathId node, PathId root) const;
+
+    template<typename F>
+    static void forEachComponent(const std::string &path, F f);
+};
+
+#endif //SENSITIVE_DATA_DELETER_PATHARENA_H
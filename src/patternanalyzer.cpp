@@ -0,0 +1,175 @@
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <iterator>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+
+#include "patternanalyzer.h"
+#include "filescanner.h"
+
+#define REFERENCE_PATTERN "sdd"
+#define DATABASE_SIZE_BASELINE (16 * 1024)
+
+std::string PatternReport::costLabel() const {
+    if (!compatible) {
+        return "Invalid";
+    } else if (costScore < 25) {
+        return "Low";
+    } else if (costScore < 60) {
+        return "Medium";
+    }
+    return "High";
+}
+
+std::string PatternReport::summary() const {
+    if (!compatible) {
+        return "Not supported by Hyperscan: " + error;
+    }
+    std::string width = maxWidth == UINT_MAX ? std::to_string(minWidth) + "+"
+                                             : std::to_string(minWidth) + "-" + std::to_string(maxWidth);
+    char buffer[256];
+    std::snprintf(buffer, sizeof(buffer),
+                  "Cost score %d. Database %zu KB, scratch %zu KB, compiled in %.1f ms, "
+                  "%.0f MB/s on sample text, %.1f matches/MB, match width %s bytes",
+                  costScore, databaseBytes / 1024, scratchBytes / 1024, compileMs,
+                  megabytesPerSecond, matchesPerMegabyte, width.c_str());
+    return buffer;
+}
+
+PatternAnalyzer::PatternAnalyzer() = default;
+
+PatternAnalyzer::PatternAnalyzer(std::string sampleCorpus) : corpus(std::move(sampleCorpus)) {}
+
+void PatternAnalyzer::setUp() const {
+    if (corpus.empty()) {
+        corpus = generateSampleText(SAMPLE_CORPUS_SIZE, 42);
+    }
+
+    // Throughput of a plain literal on this machine, costs are relative to it
+    hs_database_t *database = nullptr;
+    hs_compile_error_t *compileError = nullptr;
+    if (hs_compile(REFERENCE_PATTERN, HS_FLAG_SINGLEMATCH, HS_MODE_BLOCK, nullptr, &database,
+                   &compileError) != HS_SUCCESS) {
+        hs_free_compile_error(compileError);
+        return;
+    }
+    hs_scratch_t *scratch = nullptr;
+    if (hs_alloc_scratch(database, &scratch) == HS_SUCCESS) {
+        uint64_t numMatches = 0;
+        referenceMegabytesPerSecond = measureThroughput(database, scratch, &numMatches);
+        hs_free_scratch(scratch);
+    }
+    hs_free_database(database);
+}
+
+// Check the pattern with the same compiler the scanner uses, std::regex accepts a different dialect
+bool PatternAnalyzer::isCompatible(const std::string &pattern, uint32_t flags, std::string *error) {
+    // The parser alone accepts patterns that are too large or unsupported with these flags in block mode
+    hs_database_t *database = nullptr;
+    hs_compile_error_t *compileError = nullptr;
+    if (hs_compile(pattern.c_str(), flags, HS_MODE_BLOCK, nullptr, &database, &compileError) != HS_SUCCESS) {
+        if (error) {
+            *error = compileError->message;
+        }
+        hs_free_compile_error(compileError);
+        return false;
+    }
+    hs_free_database(database);
+    return true;
+}
+
+PatternReport PatternAnalyzer::analyze(const std::string &pattern, uint32_t flags) const {
+    std::call_once(setupFlag, &PatternAnalyzer::setUp, this);
+    PatternReport report;
+
+    hs_expr_info_t *info = nullptr;
+    hs_compile_error_t *compileError = nullptr;
+    if (hs_expression_info(pattern.c_str(), flags, &info, &compileError) != HS_SUCCESS) {
+        report.error = compileError->message;
+        hs_free_compile_error(compileError);
+        return report;
+    }
+    report.minWidth = info->min_width;
+    report.maxWidth = info->max_width;
+    free(info);
+
+    // Some patterns pass the parser but are too large or unsupported in block mode
+    hs_database_t *database = nullptr;
+    auto compileStart = std::chrono::steady_clock::now();
+    if (hs_compile(pattern.c_str(), flags, HS_MODE_BLOCK, nullptr, &database, &compileError) != HS_SUCCESS) {
+        report.error = compileError->message;
+        hs_free_compile_error(compileError);
+        return report;
+    }
+    report.compileMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - compileStart).count();
+    report.compatible = true;
+    hs_database_size(database, &report.databaseBytes);
+
+    hs_scratch_t *scratch = nullptr;
+    if (hs_alloc_scratch(database, &scratch) != HS_SUCCESS) {
+        report.compatible = false;
+        report.error = "Unable to allocate scratch space";
+        hs_free_database(database);
+        return report;
+    }
+    hs_scratch_size(scratch, &report.scratchBytes);
+
+    uint64_t numMatches = 0;
+    report.megabytesPerSecond = measureThroughput(database, scratch, &numMatches);
+    report.matchesPerMegabyte = numMatches / (corpus.size() / (1024.0 * 1024.0));
+    hs_free_scratch(scratch);
+    hs_free_database(database);
+
+    // Slowdown against a literal dominates, large databases and noisy patterns add to it
+    double slowdown = report.megabytesPerSecond > 0 && referenceMegabytesPerSecond > 0 ?
+                      referenceMegabytesPerSecond / report.megabytesPerSecond : 1.0;
+    double timeScore = std::min(60.0, 15.0 * std::log2(std::max(1.0, slowdown)));
+    double sizeScore = std::min(20.0, 5.0 * std::log2(std::max(1.0, report.databaseBytes /
+                                                                     static_cast<double>(DATABASE_SIZE_BASELINE))));
+    double densityScore = std::min(20.0, report.matchesPerMegabyte / 50.0);
+    report.costScore = static_cast<int>(std::lround(timeScore + sizeScore + densityScore));
+
+    return report;
+}
+
+double PatternAnalyzer::measureThroughput(const hs_database_t *database, hs_scratch_t *scratch,
+                                          uint64_t *numMatches) const {
+    auto onMatch = [](unsigned int, unsigned long long, unsigned long long, unsigned int, void *context) -> int {
+        ++*static_cast<uint64_t *>(context);
+        return 0;
+    };
+
+    auto scanStart = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset < corpus.size(); offset += CHUNK_SIZE) {
+        size_t length = std::min(static_cast<size_t>(CHUNK_SIZE), corpus.size() - offset);
+        hs_scan(database, corpus.data() + offset, length, 0, scratch, onMatch, numMatches);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - scanStart).count();
+    return seconds > 0 ? corpus.size() / (1024.0 * 1024.0) / seconds : 0;
+}
+
+// Lorem ipsum style text with emails, personal codes, IBANs and phone numbers sprinkled in
+std::string PatternAnalyzer::generateSampleText(size_t size, uint32_t seed, int sensitivePerThousand) {
+    static const char *words[] = {"lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing",
+                                  "elit", "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore",
+                                  "et", "dolore", "magna", "aliqua", "telefon", "nr", "arve", "konto"};
+    static const char *sensitive[] = {"jaan.tamm@example.ee", "38001085718", "EE382200221020145685",
+                                      "+372 5123 4567", "49403136526", "mari.maasikas@post.ee"};
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<size_t> wordDist(0, std::size(words) - 1);
+    std::uniform_int_distribution<size_t> sensitiveDist(0, std::size(sensitive) - 1);
+    std::uniform_int_distribution<int> densityDist(0, 999);
+
+    std::string text;
+    text.reserve(size + 64);
+    while (text.size() < size) {
+        text += densityDist(gen) < sensitivePerThousand ? sensitive[sensitiveDist(gen)] : words[wordDist(gen)];
+        text += densityDist(gen) < 50 ? '\n' : ' ';
+    }
+    text.resize(size);
+    return text;
+}
@@ -0,0 +1,59 @@
+#ifndef SENSITIVE_DATA_DELETER_PATTERNANALYZER_H
+#define SENSITIVE_DATA_DELETER_PATTERNANALYZER_H
+
+#include <string>
+#include <cstdint>
+#include <mutex>
+#include <hs/hs.h>
+
+#define SAMPLE_CORPUS_SIZE (1024 * 1024)
+
+struct PatternReport {
+    bool compatible = false;
+    std::string error;
+    unsigned int minWidth = 0;
+    unsigned int maxWidth = 0; // UINT_MAX if the pattern has no upper bound
+    size_t databaseBytes = 0;
+    size_t scratchBytes = 0;
+    double compileMs = 0;
+    double megabytesPerSecond = 0;
+    double matchesPerMegabyte = 0;
+    int costScore = 0; // 0 (cheap) to 100 (pathological)
+
+    std::string costLabel() const;
+
+    std::string summary() const;
+};
+
+/**
+ * Compiles scan patterns one at a time with Hyperscan to find patterns it rejects before
+ * a scan is started, and measures how expensive each pattern is on a sample corpus.
+ * The corpus and the reference throughput are set up by the first analyze(), so constructing
+ * the analyzer is cheap. analyze() is thread safe, but throughput measured while other
+ * analyses run is not comparable, callers should run them one at a time.
+ */
+class PatternAnalyzer {
+public:
+    PatternAnalyzer();
+
+    explicit PatternAnalyzer(std::string sampleCorpus);
+
+    // Compiles the pattern with the flags the scanner uses, some patterns only fail with SOM
+    static bool isCompatible(const std::string &pattern, uint32_t flags, std::string *error = nullptr);
+
+    PatternReport analyze(const std::string &pattern, uint32_t flags) const;
+
+    // sensitivePerThousand is the number of sensitive values per thousand words
+    static std::string generateSampleText(size_t size, uint32_t seed, int sensitivePerThousand = 5);
+
+private:
+    mutable std::once_flag setupFlag;
+    mutable std::string corpus;
+    mutable double referenceMegabytesPerSecond = 0;
+
+    void setUp() const;
+
+    double measureThroughput(const hs_database_t *database, hs_scratch_t *scratch, uint64_t *numMatches) const;
+};
+
+#endif //SENSITIVE_DATA_DELETER_PATTERNANALYZER_H
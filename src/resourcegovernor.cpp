@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <QDebug>
+
+#include "resourcegovernor.h"
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <cstring>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// From linux/ioprio.h, which glibc does not wrap
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_LOWEST_LEVEL 7
+#elif defined(Q_OS_MACOS)
+#include <pthread.h>
+#include <sys/resource.h>
+#elif defined(Q_OS_WIN)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+using std::chrono::steady_clock;
+
+ResourceLimits ResourceLimits::fromJson(const QJsonObject &obj) {
+    ResourceLimits limits;
+    limits.maxBytesPerSecond = std::max<qint64>(0, obj["maxBytesPerSecond"].toInteger(0));
+    limits.maxReadsPerSecond = static_cast<uint32_t>(std::max(0, obj["maxReadsPerSecond"].toInt(0)));
+    limits.ioPriority = obj["ioPriority"].toString().toStdString();
+    if (!limits.ioPriority.empty() && limits.ioPriority != "low" && limits.ioPriority != "idle") {
+        qWarning() << "Unknown ioPriority" << QString::fromStdString(limits.ioPriority) << ", expected low or idle";
+        limits.ioPriority.clear();
+    }
+    limits.niceLevel = std::clamp(obj["niceLevel"].toInt(0), 0, 19);
+    limits.maxLoadAverage = std::max(0.0, obj["maxLoadAverage"].toDouble(0));
+    return limits;
+}
+
+ResourceGovernor::ResourceGovernor(const ResourceLimits &limits, uint32_t numThreads, std::function<bool()> canceled)
+        : limits(limits), numThreads(std::max(1u, numThreads)), canceled(std::move(canceled)),
+          activeThreads(this->numThreads) {
+#ifdef Q_OS_WIN
+    if (this->limits.maxLoadAverage > 0) {
+        qWarning() << "maxLoadAverage is ignored, Windows has no load average";
+        this->limits.maxLoadAverage = 0;
+    }
+#endif
+}
+
+void ResourceGovernor::applyThreadPriority() const {
+#ifdef Q_OS_LINUX
+    if (!limits.ioPriority.empty()) {
+        int priority = limits.ioPriority == "idle" ? IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT
+                                                   : IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT | IOPRIO_LOWEST_LEVEL;
+        // Process id 0 is the calling thread
+        if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, priority) != 0) {
+            qWarning() << "Could not set the I/O priority of a scanner thread:" << strerror(errno);
+        }
+    }
+    if (limits.niceLevel > 0) {
+        // The nice value of a thread id only applies to that thread on Linux
+        auto thread = static_cast<id_t>(syscall(SYS_gettid));
+        errno = 0;
+        int current = getpriority(PRIO_PROCESS, thread);
+        if (errno != 0 || setpriority(PRIO_PROCESS, thread, std::min(current + limits.niceLevel, 19)) != 0) {
+            qWarning() << "Could not set the nice value of a scanner thread:" << strerror(errno);
+        }
+    }
+#elif defined(Q_OS_MACOS)
+    if (!limits.ioPriority.empty()) {
+        setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD,
+                       limits.ioPriority == "idle" ? IOPOL_THROTTLE : IOPOL_UTILITY);
+    }
+    // There is no per thread nice value, the QoS class lowers the CPU priority instead
+    if (limits.niceLevel > 0) {
+        pthread_set_qos_class_self_np(limits.niceLevel >= 10 ? QOS_CLASS_BACKGROUND : QOS_CLASS_UTILITY, 0);
+    }
+#elif defined(Q_OS_WIN)
+    // Background mode lowers the CPU, I/O and memory priority of the thread together
+    if (!limits.ioPriority.empty()) {
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+    } else if (limits.niceLevel > 0) {
+        SetThreadPriority(GetCurrentThread(),
+                          limits.niceLevel >= 10 ? THREAD_PRIORITY_LOWEST : THREAD_PRIORITY_BELOW_NORMAL);
+    }
+#endif
+}
+
+void ResourceGovernor::throttleRead(size_t size) {
+    if (limits.maxBytesPerSecond == 0 && limits.maxReadsPerSecond == 0) {
+        return;
+    }
+    auto now = steady_clock::now();
+    auto deadline = now;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // An idle bucket starts over at now, so at most GOVERNOR_BURST worth of reads go through at once
+        if (limits.maxBytesPerSecond > 0) {
+            bytesClock = std::max(bytesClock, now) + std::chrono::duration_cast<steady_clock::duration>(
+                    std::chrono::duration<double>(static_cast<double>(size) / limits.maxBytesPerSecond));
+            deadline = std::max(deadline, bytesClock - GOVERNOR_BURST);
+        }
+        if (limits.maxReadsPerSecond > 0) {
+            readsClock = std::max(readsClock, now) + std::chrono::duration_cast<steady_clock::duration>(
+                    std::chrono::duration<double>(1.0 / limits.maxReadsPerSecond));
+            deadline = std::max(deadline, readsClock - GOVERNOR_BURST);
+        }
+    }
+    sleepUntil(deadline);
+}
+
+bool ResourceGovernor::waitForTurn(uint32_t threadIndex) {
+    if (limits.maxLoadAverage > 0) {
+        sampleLoad();
+        while (threadIndex >= activeThreads.load() && !canceled()) {
+            sleepUntil(steady_clock::now() + GOVERNOR_SLEEP_SLICE);
+            sampleLoad();
+        }
+    }
+    return !canceled();
+}
+
+void ResourceGovernor::sleepUntil(steady_clock::time_point deadline) const {
+    while (!canceled()) {
+        auto now = steady_clock::now();
+        if (now >= deadline) {
+            return;
+        }
+        std::this_thread::sleep_for(std::min<steady_clock::duration>(deadline - now, GOVERNOR_SLEEP_SLICE));
+    }
+}
+
+void ResourceGovernor::sampleLoad() {
+#ifndef Q_OS_WIN
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = steady_clock::now();
+    if (lastLoadSample != steady_clock::time_point() && now - lastLoadSample < GOVERNOR_LOAD_INTERVAL) {
+        return;
+    }
+    lastLoadSample = now;
+    double load;
+    if (getloadavg(&load, 1) != 1) {
+        return;
+    }
+    uint32_t active = activeThreads.load();
+    if (load > limits.maxLoadAverage && active > 1) {
+        activeThreads = active / 2;
+        qDebug() << "Load average" << load << "is above the limit, scanning with" << active / 2 << "threads";
+    } else if (load < limits.maxLoadAverage * GOVERNOR_LOAD_RECOVERY && active < numThreads) {
+        activeThreads = active + 1;
+    }
+#endif
+}
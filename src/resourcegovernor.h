@@ -0,0 +1,72 @@
+#ifndef SENSITIVE_DATA_DELETER_RESOURCEGOVERNOR_H
+#define SENSITIVE_DATA_DELETER_RESOURCEGOVERNOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <QJsonObject>
+
+#define GOVERNOR_BURST std::chrono::milliseconds(100)       // Reads may run this far ahead of the rate limits
+#define GOVERNOR_SLEEP_SLICE std::chrono::milliseconds(200) // Longest sleep before cancellation is checked again
+#define GOVERNOR_LOAD_INTERVAL std::chrono::seconds(5)      // Time between load average samples
+#define GOVERNOR_LOAD_RECOVERY 0.8 // Parked threads come back once the load is below this part of the limit
+
+// Limits of the "resourceLimits" object in "scanSettings", 0 or empty for no limit
+struct ResourceLimits {
+    uint64_t maxBytesPerSecond = 0; // Bytes read by all scanner threads together, decompressed size for archives
+    uint32_t maxReadsPerSecond = 0; // Chunks read by all scanner threads together
+    std::string ioPriority; // "low" or "idle", the I/O scheduling class of the scanner threads
+    int niceLevel = 0; // Added to the CPU nice value of the scanner threads, 1 to 19
+    double maxLoadAverage = 0; // One minute load average above which scanner threads are parked
+
+    static ResourceLimits fromJson(const QJsonObject &obj);
+};
+
+/**
+ * Keeps a scan from saturating the disks and CPUs of the machine it runs on. Reads are rate
+ * limited with one token bucket for bytes and one for read calls, shared by all scanner threads,
+ * so a thread that reads past the budget sleeps until the average rate is back under the limit.
+ *
+ * The load back-off samples the one minute load average between files. While it is above
+ * maxLoadAverage the number of running scanner threads is halved every GOVERNOR_LOAD_INTERVAL
+ * down to one, and raised by one per interval once it drops below GOVERNOR_LOAD_RECOVERY of
+ * the limit. Threads above the current count wait before they take their next file.
+ *
+ * All waits are cut into slices of GOVERNOR_SLEEP_SLICE and end when canceled() returns true.
+ */
+class ResourceGovernor {
+public:
+    ResourceGovernor(const ResourceLimits &limits, uint32_t numThreads, std::function<bool()> canceled);
+
+    // Lowers the CPU and I/O priority of the calling thread as configured. The GUI thread keeps
+    // its priority, so this is called by every scanner thread.
+    void applyThreadPriority() const;
+
+    // Accounts for one read of size bytes and sleeps as long as the rate limits require
+    void throttleRead(size_t size);
+
+    // Waits between files while the load back-off has parked the thread, false once the scan is cancelled
+    bool waitForTurn(uint32_t threadIndex);
+
+private:
+    ResourceLimits limits;
+    uint32_t numThreads;
+    std::function<bool()> canceled;
+
+    std::mutex mutex;
+    // Time at which the token buckets are empty again, reads may start up to GOVERNOR_BURST before it
+    std::chrono::steady_clock::time_point bytesClock;
+    std::chrono::steady_clock::time_point readsClock;
+    std::chrono::steady_clock::time_point lastLoadSample;
+    std::atomic<uint32_t> activeThreads;
+
+    // Sleeps until deadline or the scan is cancelled
+    void sleepUntil(std::chrono::steady_clock::time_point deadline) const;
+
+    void sampleLoad();
+};
+
+#endif //SENSITIVE_DATA_DELETER_RESOURCEGOVERNOR_H
@@ -0,0 +1,583 @@
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include "resultsstore.h"
+
+#define RESULTS_FLUSH_INTERVAL 4096 // Records between flushes, bounds what an interrupted scan loses
+
+namespace fs = std::filesystem;
+
+static void writeRaw(std::ofstream &stream, const void *data, size_t size) {
+    stream.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+}
+
+ResultsStoreWriter::ResultsStoreWriter(const std::string &directory, const std::vector<const char *> &patterns,
+                                       const std::vector<const char *> &descriptions, uint64_t fingerprint,
+                                       int checkpointSeconds, bool resumeScan) :
+        directory(directory), fingerprint(fingerprint),
+        headerBytes(sizeof(StoreHeader) + patterns.size() * sizeof(StoredPattern)),
+        checkpointInterval(std::chrono::seconds(std::max(1, checkpointSeconds))),
+        lastCheckpoint(std::chrono::steady_clock::now()) {
+    std::error_code error;
+    fs::create_directories(directory, error);
+    for (size_t i = 0; i < patterns.size(); i++) {
+        patternIds.emplace(std::make_pair(std::string(patterns[i]), std::string(descriptions[i])),
+                           static_cast<uint32_t>(i));
+    }
+    patternRecords.resize(patterns.size());
+
+    resumed = resumeScan && resume(patterns.size());
+    // A stale index would describe the records of the previous scan
+    fs::remove(fs::path(directory) / RESULTS_INDEX_FILE, error);
+    if (resumed) {
+        stringsStream.open(fs::path(directory) / RESULTS_STRINGS_FILE, std::ios::binary | std::ios::app);
+        recordsStream.open(fs::path(directory) / RESULTS_RECORDS_FILE, std::ios::binary | std::ios::app);
+        if (!stringsStream || !recordsStream) {
+            throw std::runtime_error("Could not reopen results store in " + directory);
+        }
+        return;
+    }
+    fs::remove(fs::path(directory) / RESULTS_CHECKPOINT_FILE, error);
+
+    stringsStream.open(fs::path(directory) / RESULTS_STRINGS_FILE, std::ios::binary | std::ios::trunc);
+    recordsStream.open(fs::path(directory) / RESULTS_RECORDS_FILE, std::ios::binary | std::ios::trunc);
+    if (!stringsStream || !recordsStream) {
+        throw std::runtime_error("Could not create results store in " + directory);
+    }
+
+    StoreHeader header = {{'S', 'D', 'D', 'R'}, RESULTS_STORE_VERSION, static_cast<uint32_t>(patterns.size()), 0};
+    writeRaw(recordsStream, &header, sizeof(header));
+    for (size_t i = 0; i < patterns.size(); i++) {
+        StoredPattern stored = {};
+        stored.patternLength = static_cast<uint32_t>(std::strlen(patterns[i]));
+        stored.patternOffset = writeString(patterns[i]);
+        stored.descriptionLength = static_cast<uint32_t>(std::strlen(descriptions[i]));
+        stored.descriptionOffset = writeString(descriptions[i]);
+        writeRaw(recordsStream, &stored, sizeof(stored));
+    }
+}
+
+ResultsStoreWriter::~ResultsStoreWriter() {
+    finish();
+}
+
+void ResultsStoreWriter::append(const std::string &path, int64_t modifiedTime, uint64_t fileSize,
+                                const std::pair<ScanResult, std::vector<MatchInfo>> &result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (finished) {
+        return;
+    }
+
+    StoredRecord record = {};
+    record.pathOffset = writeString(path);
+    record.pathLength = static_cast<uint32_t>(path.size());
+    record.modifiedTime = modifiedTime;
+    record.fileSize = fileSize;
+    record.result = static_cast<uint8_t>(result.first);
+    record.patternId = NO_STORED_PATTERN;
+
+    if (result.second.empty()) {
+        writeRaw(recordsStream, &record, sizeof(record));
+        numRecords++;
+    }
+    for (const auto &match: result.second) {
+        auto it = patternIds.find(match.patternUsed);
+        record.patternId = it != patternIds.end() ? it->second : NO_STORED_PATTERN;
+        record.snippetOffset = writeString(match.match);
+        record.snippetLength = static_cast<uint32_t>(match.match.size());
+        record.startIndex = match.startIndex;
+        record.endIndex = match.endIndex;
+        record.exactStart = match.exactStart;
+        record.locationLength = static_cast<uint32_t>(match.location.size());
+        record.locationOffset = writeString(match.location);
+        writeRaw(recordsStream, &record, sizeof(record));
+        if (record.patternId != NO_STORED_PATTERN) {
+            patternRecords[record.patternId].push_back(numRecords);
+        }
+        numRecords++;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (numRecords - flushedRecords >= RESULTS_FLUSH_INTERVAL || now - lastCheckpoint >= checkpointInterval) {
+        // Strings first, records pointing past the end of strings.bin are dropped when the store is opened
+        stringsStream.flush();
+        recordsStream.flush();
+        flushedRecords = numRecords;
+        writeCheckpoint();
+        lastCheckpoint = now;
+    }
+}
+
+void ResultsStoreWriter::supersede(uint64_t begin, uint64_t end) {
+    std::lock_guard<std::mutex> lock(mutex);
+    end = std::min(end, flushedRecords);
+    if (finished || begin >= end) {
+        return;
+    }
+    // The flag is written in place, the records stay where they are so the offsets of the others do not change
+    std::fstream recordsInPlace(fs::path(directory) / RESULTS_RECORDS_FILE,
+                                std::ios::binary | std::ios::in | std::ios::out);
+    uint8_t superseded = 1;
+    for (auto &list: patternRecords) {
+        list.erase(std::lower_bound(list.begin(), list.end(), begin), std::lower_bound(list.begin(), list.end(), end));
+    }
+    for (uint64_t i = begin; i < end; i++) {
+        recordsInPlace.seekp(static_cast<std::streamoff>(headerBytes + i * sizeof(StoredRecord) +
+                                                         offsetof(StoredRecord, superseded)));
+        recordsInPlace.write(reinterpret_cast<const char *>(&superseded), sizeof(superseded));
+    }
+    recordsInPlace.close();
+    if (!recordsInPlace) {
+        qWarning() << "Could not mark the old results of a changed file in " << QString::fromStdString(directory);
+    }
+}
+
+bool ResultsStoreWriter::readCheckpoint(const std::string &directory, CheckpointHeader &checkpoint) {
+    std::ifstream checkpointStream(fs::path(directory) / RESULTS_CHECKPOINT_FILE, std::ios::binary);
+    return checkpointStream.read(reinterpret_cast<char *>(&checkpoint), sizeof(checkpoint)) &&
+           std::memcmp(checkpoint.magic, "SDDC", 4) == 0 && checkpoint.version == RESULTS_STORE_VERSION;
+}
+
+bool ResultsStoreWriter::canResume(const std::string &directory, uint64_t fingerprint) {
+    CheckpointHeader checkpoint = {};
+    return readCheckpoint(directory, checkpoint) && checkpoint.fingerprint == fingerprint;
+}
+
+bool ResultsStoreWriter::resume(size_t numPatterns) {
+    fs::path recordsPath = fs::path(directory) / RESULTS_RECORDS_FILE;
+    fs::path stringsPath = fs::path(directory) / RESULTS_STRINGS_FILE;
+    CheckpointHeader checkpoint = {};
+    if (!readCheckpoint(directory, checkpoint) || checkpoint.fingerprint != fingerprint) {
+        return false;
+    }
+
+    std::ifstream recordsInput(recordsPath, std::ios::binary);
+    StoreHeader header = {};
+    if (!recordsInput.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, "SDDR", 4) != 0 || header.numPatterns != numPatterns) {
+        return false;
+    }
+    uint64_t recordsBytes = headerBytes + checkpoint.numRecords * sizeof(StoredRecord);
+    std::error_code error;
+    if (fs::file_size(recordsPath, error) < recordsBytes || error ||
+        fs::file_size(stringsPath, error) < checkpoint.stringsSize || error) {
+        return false;
+    }
+
+    std::vector<std::vector<uint64_t>> records(numPatterns);
+    recordsInput.seekg(static_cast<std::streamoff>(headerBytes));
+    StoredRecord record = {};
+    for (uint64_t i = 0; i < checkpoint.numRecords; i++) {
+        if (!recordsInput.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+            return false;
+        }
+        if (record.patternId < numPatterns && !record.superseded) {
+            records[record.patternId].push_back(i);
+        }
+    }
+    recordsInput.close();
+
+    // Whatever was written after the checkpoint may lack its strings or the rest of a file's records
+    fs::resize_file(recordsPath, recordsBytes, error);
+    if (!error) {
+        fs::resize_file(stringsPath, checkpoint.stringsSize, error);
+    }
+    if (error) {
+        return false;
+    }
+    patternRecords = std::move(records);
+    numRecords = checkpoint.numRecords;
+    flushedRecords = numRecords;
+    stringsSize = checkpoint.stringsSize;
+    return true;
+}
+
+void ResultsStoreWriter::writeCheckpoint() {
+    // Replaced in one step so a crash never leaves half a checkpoint
+    fs::path checkpointPath = fs::path(directory) / RESULTS_CHECKPOINT_FILE;
+    fs::path tempPath = checkpointPath;
+    tempPath += ".tmp";
+    std::ofstream checkpointStream(tempPath, std::ios::binary | std::ios::trunc);
+    CheckpointHeader header = {{'S', 'D', 'D', 'C'}, RESULTS_STORE_VERSION, fingerprint, flushedRecords, stringsSize};
+    writeRaw(checkpointStream, &header, sizeof(header));
+    checkpointStream.close();
+    std::error_code error;
+    if (checkpointStream && stringsStream && recordsStream) {
+        fs::rename(tempPath, checkpointPath, error);
+    }
+    if (!checkpointStream || !stringsStream || !recordsStream || error) {
+        qWarning() << "Could not write the scan checkpoint to " << QString::fromStdString(checkpointPath.string());
+    }
+}
+
+void ResultsStoreWriter::interrupt() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (finished) {
+        return;
+    }
+    finished = true;
+    stringsStream.flush();
+    recordsStream.flush();
+    flushedRecords = numRecords;
+    writeCheckpoint();
+    stringsStream.close();
+    recordsStream.close();
+}
+
+void ResultsStoreWriter::finish() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (finished) {
+        return;
+    }
+    finished = true;
+    stringsStream.close();
+    recordsStream.close();
+    writeIndex();
+
+    // The flag is only set after everything else reached the file
+    std::fstream headerStream(fs::path(directory) / RESULTS_RECORDS_FILE,
+                              std::ios::binary | std::ios::in | std::ios::out);
+    uint32_t complete = 1;
+    headerStream.seekp(offsetof(StoreHeader, complete));
+    headerStream.write(reinterpret_cast<const char *>(&complete), sizeof(complete));
+    headerStream.close();
+    if (!headerStream) {
+        qWarning() << "Could not mark the results in " << QString::fromStdString(directory) << " as complete";
+        return;
+    }
+    // The scan is complete, the next one starts over
+    std::error_code error;
+    fs::remove(fs::path(directory) / RESULTS_CHECKPOINT_FILE, error);
+}
+
+void ResultsStoreWriter::writeIndex() {
+    // Written under a temporary name so an index is only ever found complete. Without it the reader
+    // indexes the records itself.
+    fs::path indexPath = fs::path(directory) / RESULTS_INDEX_FILE;
+    fs::path tempPath = indexPath;
+    tempPath += ".tmp";
+    std::ofstream indexStream(tempPath, std::ios::binary | std::ios::trunc);
+    IndexHeader header = {{'S', 'D', 'D', 'I'}, RESULTS_STORE_VERSION, static_cast<uint32_t>(patternRecords.size()),
+                          0, numRecords};
+    writeRaw(indexStream, &header, sizeof(header));
+    for (const auto &list: patternRecords) {
+        uint64_t count = list.size();
+        writeRaw(indexStream, &count, sizeof(count));
+    }
+    for (const auto &list: patternRecords) {
+        writeRaw(indexStream, list.data(), list.size() * sizeof(uint64_t));
+    }
+    indexStream.close();
+    std::error_code error;
+    if (indexStream) {
+        fs::rename(tempPath, indexPath, error);
+    }
+    if (!indexStream || error) {
+        qWarning() << "Could not write the results index to " << QString::fromStdString(indexPath.string());
+    }
+}
+
+uint64_t ResultsStoreWriter::writeString(const std::string &text) {
+    uint64_t offset = stringsSize;
+    stringsStream.write(text.data(), static_cast<std::streamsize>(text.size()));
+    stringsSize += text.size();
+    return offset;
+}
+
+ResultsStore::ResultsStore(const QString &directory) {
+    qint64 recordsBytes = 0;
+    const uchar *recordsData = mapFile(recordsFile, directory + "/" RESULTS_RECORDS_FILE, &recordsBytes);
+    if (!recordsData || recordsBytes < static_cast<qint64>(sizeof(StoreHeader))) {
+        throw std::runtime_error("Not a results store: " + directory.toStdString());
+    }
+    auto *header = reinterpret_cast<const StoreHeader *>(recordsData);
+    if (std::memcmp(header->magic, "SDDR", 4) != 0 || header->version != RESULTS_STORE_VERSION) {
+        throw std::runtime_error("Unsupported results store format: " + directory.toStdString());
+    }
+    numPatterns = header->numPatterns;
+    qint64 headerBytes = sizeof(StoreHeader) + numPatterns * sizeof(StoredPattern);
+    if (recordsBytes < headerBytes) {
+        throw std::runtime_error("Truncated results store: " + directory.toStdString());
+    }
+    patterns = reinterpret_cast<const StoredPattern *>(recordsData + sizeof(StoreHeader));
+    records = reinterpret_cast<const StoredRecord *>(recordsData + headerBytes);
+    numRecords = (recordsBytes - headerBytes) / sizeof(StoredRecord);
+
+    qint64 bytes = 0;
+    strings = reinterpret_cast<const char *>(mapFile(stringsFile, directory + "/" RESULTS_STRINGS_FILE, &bytes));
+    stringsSize = bytes;
+    complete = header->complete != 0;
+
+    for (size_t i = 0; i < numPatterns; i++) {
+        if (!inStrings(patterns[i].patternOffset, patterns[i].patternLength) ||
+            !inStrings(patterns[i].descriptionOffset, patterns[i].descriptionLength)) {
+            throw std::runtime_error("Truncated results store: " + directory.toStdString());
+        }
+    }
+    // An interrupted scan may have flushed records whose strings never made it to disk
+    if (!complete) {
+        while (numRecords > 0 && !isValidRecord(records[numRecords - 1])) {
+            numRecords--;
+        }
+    }
+    // Anything else that does not fit is damage, reading it would go out of bounds
+    for (size_t i = 0; i < numRecords; i++) {
+        if (!isValidRecord(records[i])) {
+            throw std::runtime_error("Corrupt results store, record " + std::to_string(i) + " is invalid: " +
+                                     directory.toStdString());
+        }
+    }
+
+    // Only a finished scan has an index, a missing or unusable one is rebuilt from the records
+    bool indexed = false;
+    if (complete && QFile::exists(directory + "/" RESULTS_INDEX_FILE)) {
+        try {
+            indexed = openIndex(directory + "/" RESULTS_INDEX_FILE);
+        } catch (const std::runtime_error &e) {
+            qWarning() << "Rebuilding the results index: " << e.what();
+        }
+    }
+    if (!indexed) {
+        buildIndex();
+    }
+}
+
+bool ResultsStore::openIndex(const QString &path) {
+    qint64 bytes = 0;
+    const uchar *data = mapFile(indexFile, path, &bytes);
+    if (!data || bytes < static_cast<qint64>(sizeof(IndexHeader))) {
+        return false;
+    }
+    auto *header = reinterpret_cast<const IndexHeader *>(data);
+    if (std::memcmp(header->magic, "SDDI", 4) != 0 || header->version != RESULTS_STORE_VERSION ||
+        header->numPatterns != numPatterns || header->numRecords != numRecords ||
+        static_cast<uint64_t>(bytes) < sizeof(IndexHeader) + numPatterns * sizeof(uint64_t)) {
+        return false;
+    }
+    auto *counts = reinterpret_cast<const uint64_t *>(data + sizeof(IndexHeader));
+    const uint64_t *list = counts + numPatterns;
+    const auto *end = reinterpret_cast<const uint64_t *>(data + bytes);
+    std::vector<std::pair<const uint64_t *, size_t>> lists;
+    for (size_t i = 0; i < numPatterns; i++) {
+        if (counts[i] > static_cast<uint64_t>(end - list)) {
+            return false;
+        }
+        // Checked like the records, the readers trust the record numbers
+        for (uint64_t j = 0; j < counts[i]; j++) {
+            if (list[j] >= numRecords || records[list[j]].patternId != i) {
+                return false;
+            }
+        }
+        lists.emplace_back(list, counts[i]);
+        list += counts[i];
+    }
+    indexLists = std::move(lists);
+    return true;
+}
+
+void ResultsStore::buildIndex() {
+    builtIndex.assign(numPatterns, {});
+    for (size_t i = 0; i < numRecords; i++) {
+        uint32_t patternId = records[i].patternId;
+        if (patternId != NO_STORED_PATTERN && !records[i].superseded) {
+            builtIndex[patternId].push_back(i);
+        }
+    }
+    indexLists.clear();
+    for (const auto &list: builtIndex) {
+        indexLists.emplace_back(list.data(), list.size());
+    }
+}
+
+bool ResultsStore::isValidRecord(const StoredRecord &record) const {
+    return inStrings(record.pathOffset, record.pathLength) && inStrings(record.snippetOffset, record.snippetLength) &&
+           inStrings(record.locationOffset, record.locationLength) &&
+           (record.patternId < numPatterns || record.patternId == NO_STORED_PATTERN) &&
+           record.result <= ScanResult::FLAGGED_BUT_UNWRITABLE && record.superseded <= 1;
+}
+
+std::string_view ResultsStore::string(uint64_t offset, uint32_t length) const {
+    return length == 0 ? std::string_view() : std::string_view(strings + offset, length);
+}
+
+std::string_view ResultsStore::patternText(uint32_t patternId) const {
+    return string(patterns[patternId].patternOffset, patterns[patternId].patternLength);
+}
+
+std::string_view ResultsStore::patternDescription(uint32_t patternId) const {
+    return string(patterns[patternId].descriptionOffset, patterns[patternId].descriptionLength);
+}
+
+std::pair<ScanResult, std::vector<MatchInfo>> ResultsStore::fileResult(size_t begin, size_t end) const {
+    std::pair<ScanResult, std::vector<MatchInfo>> result(static_cast<ScanResult>(records[begin].result), {});
+    for (size_t i = begin; i < end; i++) {
+        const StoredRecord &record = records[i];
+        if (record.patternId == NO_STORED_PATTERN) {
+            continue;
+        }
+        result.second.emplace_back(std::make_pair(std::string(patternText(record.patternId)),
+                                                  std::string(patternDescription(record.patternId))),
+                                   std::string(string(record.snippetOffset, record.snippetLength)),
+                                   record.startIndex, record.endIndex, record.exactStart != 0,
+                                   std::string(string(record.locationOffset, record.locationLength)));
+    }
+    return result;
+}
+
+void ResultsStore::forEachFile(const std::function<void(const std::string &path,
+                                                        const std::pair<ScanResult, std::vector<MatchInfo>> &result)> &callback) const {
+    size_t begin = 0;
+    while (begin < numRecords) {
+        size_t end = fileEnd(begin);
+        const StoredRecord &first = records[begin];
+        if (!first.superseded) {
+            callback(std::string(string(first.pathOffset, first.pathLength)), fileResult(begin, end));
+        }
+        begin = end;
+    }
+}
+
+void ResultsStore::forEachFileWithMatches(uint32_t patternId,
+                                          const std::function<void(const std::string &path,
+                                                                   const std::pair<ScanResult, std::vector<MatchInfo>> &result)> &callback) const {
+    std::vector<size_t> fileBegins;
+    for (uint32_t id = 0; id < numPatterns; id++) {
+        if (patternId != NO_STORED_PATTERN && id != patternId) {
+            continue;
+        }
+        auto [list, count] = indexLists[id];
+        for (size_t i = 0; i < count; i++) {
+            fileBegins.push_back(fileBegin(list[i]));
+        }
+    }
+    // A file with several matches is listed once per match
+    std::sort(fileBegins.begin(), fileBegins.end());
+    fileBegins.erase(std::unique(fileBegins.begin(), fileBegins.end()), fileBegins.end());
+    for (size_t begin: fileBegins) {
+        const StoredRecord &first = records[begin];
+        if (!first.superseded) {
+            callback(std::string(string(first.pathOffset, first.pathLength)), fileResult(begin, fileEnd(begin)));
+        }
+    }
+}
+
+void ResultsStore::exportJsonl(const QString &path) const {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        throw std::runtime_error("Could not open " + path.toStdString() + " for writing");
+    }
+    forEachFile([&file](const std::string &filePath, const std::pair<ScanResult, std::vector<MatchInfo>> &result) {
+        QJsonArray matches;
+        for (const auto &match: result.second) {
+            QJsonObject matchObj;
+            matchObj["pattern"] = QString::fromStdString(match.patternUsed.second);
+            matchObj["match"] = QString::fromStdString(match.match);
+            matchObj["start"] = static_cast<qint64>(match.startIndex);
+            matchObj["end"] = static_cast<qint64>(match.endIndex);
+            matchObj["exactStart"] = match.exactStart;
+            if (!match.location.empty()) {
+                matchObj["location"] = QString::fromStdString(match.location);
+            }
+            matches.append(matchObj);
+        }
+        QJsonObject obj;
+        obj["path"] = QString::fromStdString(filePath);
+        obj["result"] = scanResultName(result.first);
+        obj["matches"] = matches;
+        file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+        file.write("\n");
+    });
+    if (!file.commit()) {
+        throw std::runtime_error("Could not write " + path.toStdString());
+    }
+}
+
+static void appendCsvField(std::string &line, std::string_view field) {
+    if (field.find_first_of(",\"\r\n") == std::string_view::npos) {
+        line += field;
+        return;
+    }
+    line += '"';
+    for (char c: field) {
+        if (c == '"') {
+            line += '"';
+        }
+        line += c;
+    }
+    line += '"';
+}
+
+void ResultsStore::exportCsv(const QString &path) const {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        throw std::runtime_error("Could not open " + path.toStdString() + " for writing");
+    }
+    file.write("path,result,pattern,match,start,end,exact_start,location\n");
+    std::string line;
+    for (size_t i = 0; i < numRecords; i++) {
+        const StoredRecord &record = records[i];
+        if (record.superseded) {
+            continue;
+        }
+        line.clear();
+        appendCsvField(line, string(record.pathOffset, record.pathLength));
+        line += ',';
+        line += scanResultName(static_cast<ScanResult>(record.result));
+        if (record.patternId == NO_STORED_PATTERN) {
+            line += ",,,,,,\n";
+        } else {
+            line += ',';
+            appendCsvField(line, patternDescription(record.patternId));
+            line += ',';
+            appendCsvField(line, string(record.snippetOffset, record.snippetLength));
+            line += ',' + std::to_string(record.startIndex) + ',' + std::to_string(record.endIndex) + ',' +
+                    (record.exactStart ? "true" : "false") + ',';
+            appendCsvField(line, string(record.locationOffset, record.locationLength));
+            line += '\n';
+        }
+        file.write(line.data(), static_cast<qint64>(line.size()));
+    }
+    if (!file.commit()) {
+        throw std::runtime_error("Could not write " + path.toStdString());
+    }
+}
+
+const uchar *ResultsStore::mapFile(QFile &file, const QString &path, qint64 *size) {
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("Could not open " + path.toStdString());
+    }
+    *size = file.size();
+    if (*size == 0) {
+        return nullptr;
+    }
+    const uchar *data = file.map(0, *size);
+    if (!data) {
+        throw std::runtime_error("Could not map " + path.toStdString());
+    }
+    return data;
+}
+
+size_t ResultsStore::fileBegin(size_t record) const {
+    size_t begin = record;
+    while (begin > 0 && records[begin - 1].pathOffset == records[record].pathOffset) {
+        begin--;
+    }
+    return begin;
+}
+
+size_t ResultsStore::fileEnd(size_t begin) const {
+    size_t end = begin + 1;
+    while (end < numRecords && records[end].pathOffset == records[begin].pathOffset) {
+        end++;
+    }
+    return end;
+}
@@ -0,0 +1,252 @@
+#ifndef SENSITIVE_DATA_DELETER_RESULTSSTORE_H
+#define SENSITIVE_DATA_DELETER_RESULTSSTORE_H
+
+#include <QFile>
+#include <QString>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "filescanner.h"
+
+#define RESULTS_STORE_VERSION 4
+#define RESULTS_STRINGS_FILE "strings.bin"
+#define RESULTS_RECORDS_FILE "records.bin"
+#define RESULTS_INDEX_FILE "patterns.idx"
+#define RESULTS_CHECKPOINT_FILE "checkpoint.bin"
+#define NO_STORED_PATTERN UINT32_MAX
+
+/*
+ * A results store is a directory with these files:
+ *
+ *  strings.bin   Paths, snippets, locations and patterns back to back, referenced by offset and length.
+ *  records.bin   StoreHeader, numPatterns StoredPatterns, then fixed size StoredRecords. A file has
+ *                one record per match, or a single record with NO_STORED_PATTERN if it had none.
+ *                The records of a file are always consecutive. StoreHeader::complete is set once
+ *                the scan finishes. Records of a file that changed before the scan was resumed are
+ *                marked superseded and skipped by the readers, the file is appended again.
+ *  patterns.idx  IndexHeader, the number of records of each pattern, then the record numbers of
+ *                each pattern in ascending order, without superseded records. Only written once
+ *                the scan finishes, an interrupted store is indexed when it is opened.
+ *  checkpoint.bin  CheckpointHeader, rewritten after every flush while the scan runs and removed
+ *                once it finishes.
+ *
+ * strings.bin and records.bin are appended to while the scan runs, so an interrupted scan can still
+ * be opened up to the last record that was flushed. A scan with the same config that is told to resume
+ * picks up where an interrupted one stopped: the data files are cut back to the checkpoint and appended to again.
+ */
+
+struct StoreHeader {
+    char magic[4]; // "SDDR"
+    uint32_t version;
+    uint32_t numPatterns;
+    uint32_t complete; // 1 once the scan finished, 0 while it runs or if it was interrupted
+};
+
+struct StoredPattern {
+    uint64_t patternOffset;
+    uint64_t descriptionOffset;
+    uint32_t patternLength;
+    uint32_t descriptionLength;
+};
+
+struct StoredRecord {
+    uint64_t pathOffset;
+    uint64_t snippetOffset;
+    uint64_t startIndex;
+    uint64_t endIndex;
+    uint64_t locationOffset; // MatchInfo::location
+    int64_t modifiedTime; // Of the file when it was scanned, ms since the epoch, a resumed scan rescans changed files
+    uint64_t fileSize;
+    uint32_t pathLength;
+    uint32_t snippetLength;
+    uint32_t patternId;
+    uint32_t locationLength;
+    uint8_t result; // ScanResult
+    uint8_t exactStart;
+    uint8_t superseded; // 1 if the file was scanned again by a resumed scan
+    uint8_t reserved[5];
+};
+
+struct IndexHeader {
+    char magic[4]; // "SDDI"
+    uint32_t version;
+    uint32_t numPatterns;
+    uint32_t reserved;
+    uint64_t numRecords; // Of the store the index was written for
+};
+
+struct CheckpointHeader {
+    char magic[4]; // "SDDC"
+    uint32_t version;
+    uint64_t fingerprint; // Of the scan config, only a scan with the same config resumes the store
+    uint64_t numRecords;  // Records and strings that were flushed, whole files only
+    uint64_t stringsSize;
+};
+
+static_assert(sizeof(StoreHeader) == 16 && sizeof(StoredPattern) == 24 && sizeof(StoredRecord) == 80 &&
+              sizeof(IndexHeader) == 24 && sizeof(CheckpointHeader) == 32,
+              "The results store layout must not depend on the compiler");
+
+/**
+ * Appends scan results to a results store while the scan runs. append() can be called from
+ * several scanner threads. The data files are flushed and a checkpoint is written every
+ * RESULTS_FLUSH_INTERVAL records or checkpointSeconds, whichever comes first.
+ * Throws std::runtime_error if the store can not be created.
+ */
+class ResultsStoreWriter {
+public:
+    // Continues the store in directory if resumeScan is set and the store has a checkpoint with the
+    // same fingerprint, otherwise starts a new one
+    ResultsStoreWriter(const std::string &directory, const std::vector<const char *> &patterns,
+                       const std::vector<const char *> &descriptions, uint64_t fingerprint,
+                       int checkpointSeconds, bool resumeScan);
+
+    ~ResultsStoreWriter();
+
+    // True if directory has a checkpoint of an interrupted scan with this fingerprint
+    static bool canResume(const std::string &directory, uint64_t fingerprint);
+
+    // True if the store was continued, its files are skipped by the scan
+    bool isResumed() const { return resumed; }
+
+    // modifiedTime and fileSize are the stat of the file before it was scanned, 0 if they are not known
+    void append(const std::string &path, int64_t modifiedTime, uint64_t fileSize,
+                const std::pair<ScanResult, std::vector<MatchInfo>> &result);
+
+    // Marks the records [begin, end) of a resumed store as superseded, their file is scanned again.
+    // end is cut back to the records the store was resumed with.
+    void supersede(uint64_t begin, uint64_t end);
+
+    // Flushes the data files and marks the store as complete
+    void finish();
+
+    // Flushes the data files and writes a last checkpoint instead of marking the store complete, so
+    // that the scan can be resumed from the files appended so far
+    void interrupt();
+
+private:
+    std::string directory;
+    std::mutex mutex;
+    std::ofstream stringsStream;
+    std::ofstream recordsStream;
+    uint64_t stringsSize = 0;
+    uint64_t numRecords = 0;
+    uint64_t flushedRecords = 0;
+    uint64_t fingerprint;
+    uint64_t headerBytes = 0; // StoreHeader and StoredPatterns before the first record
+    std::chrono::steady_clock::duration checkpointInterval;
+    std::chrono::steady_clock::time_point lastCheckpoint;
+    bool resumed = false;
+    bool finished = false;
+    std::map<std::pair<std::string, std::string>, uint32_t> patternIds;
+    std::vector<std::vector<uint64_t>> patternRecords; // Record numbers of each pattern for the index
+
+    uint64_t writeString(const std::string &text);
+
+    // False if there is no valid checkpoint in directory
+    static bool readCheckpoint(const std::string &directory, CheckpointHeader &checkpoint);
+
+    // Cuts the data files back to the checkpoint, false if there is no checkpoint of a scan with
+    // this fingerprint
+    bool resume(size_t numPatterns);
+
+    void writeCheckpoint();
+
+    void writeIndex();
+};
+
+/**
+ * Read only view of a results store. The files are memory mapped and records are only paged in
+ * when they are read. Every record is checked once when the store is opened, so the accessors can
+ * trust the offsets and pattern ids.
+ * Throws std::runtime_error if the store is missing or malformed.
+ */
+class ResultsStore {
+public:
+    explicit ResultsStore(const QString &directory);
+
+    ResultsStore(const ResultsStore &) = delete;
+
+    ResultsStore &operator=(const ResultsStore &) = delete;
+
+    size_t recordCount() const { return numRecords; }
+
+    const StoredRecord &record(size_t index) const { return records[index]; }
+
+    std::string_view string(uint64_t offset, uint32_t length) const;
+
+    size_t patternCount() const { return numPatterns; }
+
+    std::string_view patternText(uint32_t patternId) const;
+
+    std::string_view patternDescription(uint32_t patternId) const;
+
+    // False if the scan is still running or was interrupted
+    bool isComplete() const { return complete; }
+
+    // Index of the record after the last record of the file starting at begin
+    size_t fileEnd(size_t begin) const;
+
+    // The records [begin, end) of one file converted to a scan result
+    std::pair<ScanResult, std::vector<MatchInfo>> fileResult(size_t begin, size_t end) const;
+
+    // Calls back once per file that is not superseded with its records converted to a scan result
+    void forEachFile(const std::function<void(const std::string &path,
+                                              const std::pair<ScanResult, std::vector<MatchInfo>> &result)> &callback) const;
+
+    // Record numbers of the matches of a pattern in ascending order, taken from the index
+    std::pair<const uint64_t *, size_t> patternRecords(uint32_t patternId) const { return indexLists[patternId]; }
+
+    // Like forEachFile, but only for the files with a match of the pattern, or of any pattern for
+    // NO_STORED_PATTERN. Found through the index, the records of the other files are not read.
+    void forEachFileWithMatches(uint32_t patternId,
+                                const std::function<void(const std::string &path,
+                                                         const std::pair<ScanResult, std::vector<MatchInfo>> &result)> &callback) const;
+
+    // One JSON object per file
+    void exportJsonl(const QString &path) const;
+
+    // One row per match, files without matches get a single row with empty match columns
+    void exportCsv(const QString &path) const;
+
+private:
+    QFile stringsFile;
+    QFile recordsFile;
+    QFile indexFile;
+    const char *strings = nullptr;
+    uint64_t stringsSize = 0;
+    const StoredPattern *patterns = nullptr;
+    const StoredRecord *records = nullptr;
+    size_t numPatterns = 0;
+    size_t numRecords = 0;
+    bool complete = false;
+    std::vector<std::pair<const uint64_t *, size_t>> indexLists; // Into the mapped index or builtIndex
+    std::vector<std::vector<uint64_t>> builtIndex;
+
+    static const uchar *mapFile(QFile &file, const QString &path, qint64 *size);
+
+    // offset + length can overflow, so the length is compared against what is left after the offset
+    bool inStrings(uint64_t offset, uint32_t length) const {
+        return offset <= stringsSize && length <= stringsSize - offset;
+    }
+
+    bool isValidRecord(const StoredRecord &record) const;
+
+    // False if the index is missing, was written for other records or does not fit
+    bool openIndex(const QString &path);
+
+    // Index of the records, for stores whose scan did not finish
+    void buildIndex();
+
+    // Index of the first record of the file the record belongs to
+    size_t fileBegin(size_t record) const;
+};
+
+#endif //SENSITIVE_DATA_DELETER_RESULTSSTORE_H
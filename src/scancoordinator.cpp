@@ -0,0 +1,313 @@
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QTextStream>
+#include <QTimer>
+#include <filesystem>
+#include <stdexcept>
+
+#include "scancoordinator.h"
+#include "resultsstore.h"
+
+namespace fs = std::filesystem;
+
+ScanCoordinator::ScanCoordinator(const QByteArray &configJson, const QByteArray &token,
+                                 const std::string &resultsPath, QObject *parent)
+        : QObject(parent), config(ScanJobConfig::fromJson(configJson)), configJson(configJson), token(token) {
+    exclusions = ExclusionRules::fromJson(config.scanSettings);
+    std::vector<const char *> patterns;
+    std::vector<const char *> descriptions;
+    for (const auto &pattern: config.patterns) {
+        patterns.push_back(pattern.first.c_str());
+        descriptions.push_back(pattern.second.c_str());
+    }
+    // Jobs finish in any order, so an interrupted distributed scan is not resumed
+    writer = std::make_unique<ResultsStoreWriter>(resultsPath, patterns, descriptions, 0,
+                                                  config.scanSettings["checkpointIntervalSeconds"].toInt(0), false);
+    connect(&server, &QTcpServer::newConnection, this, &ScanCoordinator::onNewConnection);
+}
+
+ScanCoordinator::~ScanCoordinator() {
+    stopping = true;
+    if (lister.joinable()) {
+        lister.join();
+    }
+}
+
+bool ScanCoordinator::listen(const QHostAddress &address, quint16 port) {
+    return server.listen(address, port);
+}
+
+void ScanCoordinator::start(const std::vector<std::string> &roots, const QString &fileList) {
+    timer.start();
+    lister = std::thread(&ScanCoordinator::listFiles, this, roots, fileList);
+}
+
+void ScanCoordinator::queueJob(std::vector<std::string> &files) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingJobs.push_back({nextJobId++, std::move(files)});
+    }
+    files.clear();
+    QMetaObject::invokeMethod(this, [this]() { dispatchJobs(); }, Qt::QueuedConnection);
+}
+
+void ScanCoordinator::listFiles(const std::vector<std::string> &roots, const QString &fileList) {
+    std::vector<std::string> files;
+    uint64_t jobBytes = 0;
+    auto addFile = [&](const std::string &path) {
+        fs::path filePath(path);
+        if (config.fileTypes.count(filePath.extension().string()) == 0 || exclusions.excludesPath(path, false)) {
+            return;
+        }
+        QFileInfo fileInfo(QString::fromStdString(path));
+        if (exclusions.excludesFileStat(fileInfo.size(), fileInfo.lastModified())) {
+            return;
+        }
+        files.push_back(path);
+        jobBytes += fileInfo.size();
+        if (files.size() >= JOB_MAX_FILES || jobBytes >= JOB_MAX_BYTES) {
+            queueJob(files);
+            jobBytes = 0;
+        }
+    };
+
+    if (!fileList.isEmpty()) {
+        QFile file(fileList);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            qWarning() << "Could not open the file list" << fileList;
+        }
+        QTextStream stream(&file);
+        QString line;
+        while (!stopping && stream.readLineInto(&line)) {
+            if (!line.trimmed().isEmpty()) {
+                addFile(line.toStdString());
+            }
+        }
+    }
+    for (const auto &root: roots) {
+        std::error_code error;
+        if (fs::is_regular_file(root, error)) {
+            addFile(root);
+            continue;
+        }
+        fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, error);
+        if (error) {
+            qWarning() << "Could not list" << QString::fromStdString(root) << ":" << error.message().c_str();
+            continue;
+        }
+        for (; it != fs::recursive_directory_iterator() && !stopping; it.increment(error)) {
+            if (error) {
+                error.clear();
+                continue;
+            }
+            // The exclusion globs use "/" on every platform
+            std::string path = it->path().generic_string();
+            if (it->is_directory(error)) {
+                if (exclusions.excludesPath(path, true)) {
+                    it.disable_recursion_pending();
+                }
+            } else if (it->is_regular_file(error)) {
+                addFile(path);
+            }
+        }
+    }
+    if (!files.empty()) {
+        queueJob(files);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        listingDone = true;
+    }
+    QMetaObject::invokeMethod(this, [this]() { dispatchJobs(); }, Qt::QueuedConnection);
+}
+
+void ScanCoordinator::onNewConnection() {
+    while (QTcpSocket *socket = server.nextPendingConnection()) {
+        // Notices workers that vanished without closing the connection, their jobs are then requeued
+        socket->setSocketOption(QAbstractSocket::KeepAliveOption, 1);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { onDisconnected(socket); });
+        // Until the worker authenticated, Qt buffers no more than a HELLO can take
+        socket->setReadBufferSize(SCAN_FRAME_HEADER_SIZE + SCAN_MAX_HANDSHAKE_FRAME_SIZE);
+        QTimer::singleShot(SCAN_HELLO_TIMEOUT_MS, socket, [this, socket]() {
+            auto it = workers.find(socket);
+            if (it != workers.end() && !it->second.authenticated) {
+                qWarning() << "Dropping" << socket->peerAddress().toString() << ", it did not authenticate in time";
+                socket->abort();
+            }
+        });
+        WorkerConnection &worker = workers[socket];
+        worker.nonce = randomNonce();
+        MessageWriter challenge(ScanMessageType::CHALLENGE);
+        challenge.writeString(worker.nonce.toStdString());
+        socket->write(challenge.frame());
+    }
+}
+
+void ScanCoordinator::onReadyRead(QTcpSocket *socket) {
+    auto it = workers.find(socket);
+    if (it == workers.end()) {
+        return;
+    }
+    WorkerConnection &worker = it->second;
+    worker.buffer.append(socket->readAll());
+    ScanMessageType type;
+    QByteArray payload;
+    try {
+        while (takeFrame(worker.buffer, type, payload,
+                         worker.authenticated ? SCAN_MAX_FRAME_SIZE : SCAN_MAX_HANDSHAKE_FRAME_SIZE)) {
+            if (!handleMessage(socket, worker, type, payload)) {
+                qWarning() << "Dropping worker" << socket->peerAddress().toString() << "after an invalid message";
+                socket->abort();
+                return;
+            }
+        }
+    } catch (std::runtime_error &e) {
+        qWarning() << "Dropping worker" << socket->peerAddress().toString() << ":" << e.what();
+        socket->abort();
+    }
+}
+
+bool ScanCoordinator::handleMessage(QTcpSocket *socket, WorkerConnection &worker, ScanMessageType type,
+                                    const QByteArray &payload) {
+    if (!worker.authenticated) {
+        if (type != ScanMessageType::HELLO) {
+            return false;
+        }
+        MessageReader reader(payload);
+        uint32_t version = reader.readU32();
+        std::string name = reader.readString();
+        uint32_t threads = reader.readU32();
+        QByteArray workerNonce = QByteArray::fromStdString(reader.readString());
+        QByteArray proof = QByteArray::fromStdString(reader.readString());
+        if (!reader.ok() || version != SCAN_PROTOCOL_VERSION) {
+            return false;
+        }
+        if (!proofMatches(proof, tokenProof(token, "worker", worker.nonce))) {
+            qWarning() << "Worker" << socket->peerAddress().toString() << "does not know the token";
+            return false;
+        }
+        worker.authenticated = true;
+        socket->setReadBufferSize(0);
+        worker.name = name;
+        qDebug() << "Worker" << QString::fromStdString(name) << "joined with" << threads << "threads";
+        MessageWriter reply(ScanMessageType::CONFIG);
+        reply.writeString(tokenProof(token, "coordinator", workerNonce).toStdString());
+        reply.writeString(configJson.toStdString());
+        socket->write(reply.frame());
+        if (done) {
+            socket->write(MessageWriter(ScanMessageType::NO_MORE_JOBS).frame());
+        }
+        return true;
+    }
+
+    switch (type) {
+        case ScanMessageType::JOB_REQUEST:
+            worker.requestedJobs++;
+            dispatchJobs();
+            return true;
+        case ScanMessageType::JOB_RESULT: {
+            uint64_t jobId;
+            std::vector<FileResult> results;
+            if (!decodeJobResult(payload, config.patterns, jobId, results) || worker.jobs.erase(jobId) == 0) {
+                return false;
+            }
+            for (const auto &[path, result]: results) {
+                // A distributed scan is never resumed, so the stat of the file is not needed
+                writer->append(path, 0, 0, result);
+                if (result.first == ScanResult::FLAGGED || result.first == ScanResult::FLAGGED_BUT_UNWRITABLE) {
+                    flaggedFiles++;
+                }
+            }
+            filesScanned += results.size();
+            filesByWorker[worker.name] += results.size();
+            outstandingJobs.erase(jobId);
+            jobsDone++;
+            qDebug() << "Job" << jobId << "done by" << QString::fromStdString(worker.name) << "," << filesScanned
+                     << "files scanned";
+            dispatchJobs();
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+void ScanCoordinator::onDisconnected(QTcpSocket *socket) {
+    auto it = workers.find(socket);
+    if (it != workers.end()) {
+        WorkerConnection &worker = it->second;
+        if (!worker.jobs.empty()) {
+            qWarning() << "Worker" << QString::fromStdString(worker.name) << "left with" << worker.jobs.size()
+                       << "unfinished jobs, handing them out again";
+            std::lock_guard<std::mutex> lock(mutex);
+            for (uint64_t jobId: worker.jobs) {
+                pendingJobs.push_front(std::move(outstandingJobs[jobId]));
+                outstandingJobs.erase(jobId);
+                requeuedJobs++;
+            }
+        }
+        workers.erase(it);
+    }
+    socket->deleteLater();
+    dispatchJobs();
+}
+
+void ScanCoordinator::dispatchJobs() {
+    if (done) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    for (auto &[socket, worker]: workers) {
+        while (worker.authenticated && worker.requestedJobs > 0 && !pendingJobs.empty()) {
+            Job job = std::move(pendingJobs.front());
+            pendingJobs.pop_front();
+            MessageWriter message(ScanMessageType::JOB);
+            message.writeU64(job.id);
+            message.writeU32(static_cast<uint32_t>(job.files.size()));
+            for (const auto &file: job.files) {
+                message.writeString(file);
+            }
+            socket->write(message.frame());
+            worker.jobs.insert(job.id);
+            worker.requestedJobs--;
+            outstandingJobs[job.id] = std::move(job);
+        }
+    }
+    bool allDone = listingDone && pendingJobs.empty() && outstandingJobs.empty();
+    lock.unlock();
+    if (allDone) {
+        finishScan();
+    }
+}
+
+void ScanCoordinator::finishScan() {
+    done = true;
+    for (auto &[socket, worker]: workers) {
+        if (worker.authenticated) {
+            socket->write(MessageWriter(ScanMessageType::NO_MORE_JOBS).frame());
+            socket->flush();
+        }
+    }
+    writer->finish();
+    emit finished();
+}
+
+QJsonObject ScanCoordinator::summary() const {
+    double seconds = static_cast<double>(timer.elapsed()) / 1000.0;
+    QJsonObject summary;
+    summary["filesScanned"] = static_cast<qint64>(filesScanned);
+    summary["flaggedFiles"] = static_cast<qint64>(flaggedFiles);
+    summary["jobs"] = static_cast<qint64>(jobsDone);
+    summary["requeuedJobs"] = static_cast<qint64>(requeuedJobs);
+    summary["seconds"] = seconds;
+    summary["filesPerSecond"] = seconds > 0 ? static_cast<double>(filesScanned) / seconds : 0.0;
+    QJsonObject perWorker;
+    for (const auto &[name, files]: filesByWorker) {
+        perWorker[QString::fromStdString(name)] = static_cast<qint64>(files);
+    }
+    summary["filesByWorker"] = perWorker;
+    return summary;
+}
@@ -0,0 +1,126 @@
+#ifndef SENSITIVE_DATA_DELETER_SCANCOORDINATOR_H
+#define SENSITIVE_DATA_DELETER_SCANCOORDINATOR_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "scanprotocol.h"
+#include "exclusionrules.h"
+
+#define JOB_MAX_FILES 256                    // A job is cut once it has this many files
+#define JOB_MAX_BYTES (256ull * 1024 * 1024) // or this many bytes
+
+class ResultsStoreWriter;
+
+/**
+ * Coordinator of a distributed scan. Lists the files below the scan roots on a thread of its own and
+ * cuts the list into jobs of up to JOB_MAX_FILES files or JOB_MAX_BYTES bytes, which workers fetch
+ * one at a time as they finish the previous one. Faster workers therefore simply take more jobs.
+ *
+ * Every job a worker holds is remembered until its results arrive, and goes back to the front of
+ * the queue if the worker disconnects. Results are appended to one results store as they arrive.
+ */
+class ScanCoordinator : public QObject {
+Q_OBJECT
+
+public:
+    // Throws std::runtime_error if the config is invalid or the results store can not be created
+    ScanCoordinator(const QByteArray &configJson, const QByteArray &token, const std::string &resultsPath,
+                    QObject *parent = nullptr);
+
+    ~ScanCoordinator() override;
+
+    // False if the address can not be bound
+    bool listen(const QHostAddress &address, quint16 port);
+
+    quint16 serverPort() const { return server.serverPort(); }
+
+    QString errorString() const { return server.errorString(); }
+
+    // Starts listing the files below roots, or the paths in fileList if it is not empty, one per line
+    void start(const std::vector<std::string> &roots, const QString &fileList);
+
+    size_t connectedWorkers() const { return workers.size(); }
+
+    // Files, flagged files, run time and the files scanned by every worker
+    QJsonObject summary() const;
+
+signals:
+
+    void finished();
+
+private:
+    struct Job {
+        uint64_t id;
+        std::vector<std::string> files;
+    };
+
+    struct WorkerConnection {
+        QByteArray buffer;
+        QByteArray nonce;
+        bool authenticated = false;
+        std::string name;
+        int requestedJobs = 0;
+        std::set<uint64_t> jobs; // Sent but not answered yet
+    };
+
+    ScanJobConfig config;
+    QByteArray configJson;
+    QByteArray token;
+    ExclusionRules exclusions; // Only used by the lister thread
+    std::unique_ptr<ResultsStoreWriter> writer;
+    QTcpServer server;
+    std::map<QTcpSocket *, WorkerConnection> workers;
+    std::map<uint64_t, Job> outstandingJobs;
+    std::map<std::string, uint64_t> filesByWorker;
+    QElapsedTimer timer;
+    bool done = false;
+
+    uint64_t filesScanned = 0;
+    uint64_t flaggedFiles = 0;
+    uint64_t jobsDone = 0;
+    uint64_t requeuedJobs = 0;
+
+    // Filled by the lister thread
+    std::mutex mutex;
+    std::deque<Job> pendingJobs;
+    uint64_t nextJobId = 0;
+    bool listingDone = false;
+    std::atomic<bool> stopping{false};
+    std::thread lister;
+
+    void listFiles(const std::vector<std::string> &roots, const QString &fileList);
+
+    void queueJob(std::vector<std::string> &files);
+
+    void onNewConnection();
+
+    void onReadyRead(QTcpSocket *socket);
+
+    void onDisconnected(QTcpSocket *socket);
+
+    // Returns false if the worker broke the protocol and has to be dropped
+    bool handleMessage(QTcpSocket *socket, WorkerConnection &worker, ScanMessageType type,
+                       const QByteArray &payload);
+
+    // Sends queued jobs to the workers that asked for them and finishes the scan once all are done
+    void dispatchJobs();
+
+    void finishScan();
+};
+
+#endif //SENSITIVE_DATA_DELETER_SCANCOORDINATOR_H
@@ -0,0 +1,201 @@
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+#include "scanmetrics.h"
+#include "filescanner.h"
+#include "chunkreader.h"
+
+static_assert(ChunkReaderType::NUM_READER_TYPES <= MAX_READER_TYPES, "Increase MAX_READER_TYPES");
+static_assert(ScanResult::FLAGGED_BUT_UNWRITABLE + 1 == NUM_SCAN_RESULTS, "Update NUM_SCAN_RESULTS");
+
+ThreadMetrics::ThreadMetrics(size_t numPatterns) :
+        patternMatches(new std::atomic<uint64_t>[numPatterns]) {
+    for (auto &counter: bytesRead) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (auto &counter: filesByResult) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < numPatterns; i++) {
+        patternMatches[i].store(0, std::memory_order_relaxed);
+    }
+    bytesScanned.store(0, std::memory_order_relaxed);
+    validatorRejections.store(0, std::memory_order_relaxed);
+    binaryFilesRejected.store(0, std::memory_order_relaxed);
+    binaryFilesRerouted.store(0, std::memory_order_relaxed);
+    filesStolen.store(0, std::memory_order_relaxed);
+    parserFailures.store(0, std::memory_order_relaxed);
+    extractNanos.store(0, std::memory_order_relaxed);
+    readNanos.store(0, std::memory_order_relaxed);
+    matchNanos.store(0, std::memory_order_relaxed);
+    throttleNanos.store(0, std::memory_order_relaxed);
+}
+
+void ScanMetrics::reset(size_t numThreads, const std::vector<const char *> &patternDescriptions) {
+    patternNames.assign(patternDescriptions.begin(), patternDescriptions.end());
+    threads.clear();
+    for (size_t i = 0; i < numThreads; i++) {
+        threads.push_back(std::make_unique<ThreadMetrics>(patternNames.size()));
+    }
+    startTime = std::chrono::steady_clock::now();
+}
+
+MetricsSnapshot ScanMetrics::snapshot() const {
+    MetricsSnapshot snapshot;
+    snapshot.patternMatches.resize(patternNames.size(), 0);
+    for (const auto &thread: threads) {
+        for (int i = 0; i < MAX_READER_TYPES; i++) {
+            snapshot.bytesRead[i] += thread->bytesRead[i].load(std::memory_order_relaxed);
+        }
+        for (int i = 0; i < NUM_SCAN_RESULTS; i++) {
+            snapshot.filesByResult[i] += thread->filesByResult[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < patternNames.size(); i++) {
+            snapshot.patternMatches[i] += thread->patternMatches[i].load(std::memory_order_relaxed);
+        }
+        snapshot.bytesScanned += thread->bytesScanned.load(std::memory_order_relaxed);
+        snapshot.validatorRejections += thread->validatorRejections.load(std::memory_order_relaxed);
+        snapshot.binaryFilesRejected += thread->binaryFilesRejected.load(std::memory_order_relaxed);
+        snapshot.binaryFilesRerouted += thread->binaryFilesRerouted.load(std::memory_order_relaxed);
+        snapshot.filesStolen += thread->filesStolen.load(std::memory_order_relaxed);
+        snapshot.parserFailures += thread->parserFailures.load(std::memory_order_relaxed);
+        snapshot.extractNanos += thread->extractNanos.load(std::memory_order_relaxed);
+        snapshot.readNanos += thread->readNanos.load(std::memory_order_relaxed);
+        snapshot.matchNanos += thread->matchNanos.load(std::memory_order_relaxed);
+        snapshot.throttleNanos += thread->throttleNanos.load(std::memory_order_relaxed);
+    }
+    snapshot.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return snapshot;
+}
+
+std::string ScanMetrics::toJson() const {
+    MetricsSnapshot metrics = snapshot();
+
+    QJsonObject bytesRead;
+    for (int i = 0; i < ChunkReaderType::NUM_READER_TYPES; i++) {
+        bytesRead[readerTypeName(static_cast<ChunkReaderType>(i))] = static_cast<qint64>(metrics.bytesRead[i]);
+    }
+    QJsonObject files;
+    for (int i = 0; i < NUM_SCAN_RESULTS; i++) {
+        files[scanResultName(static_cast<ScanResult>(i))] = static_cast<qint64>(metrics.filesByResult[i]);
+    }
+    QJsonArray patterns;
+    for (size_t i = 0; i < patternNames.size(); i++) {
+        QJsonObject pattern;
+        pattern["description"] = QString::fromStdString(patternNames[i]);
+        pattern["matches"] = static_cast<qint64>(metrics.patternMatches[i]);
+        patterns.append(pattern);
+    }
+    QJsonObject binaryFiles;
+    binaryFiles["rejected"] = static_cast<qint64>(metrics.binaryFilesRejected);
+    binaryFiles["rerouted"] = static_cast<qint64>(metrics.binaryFilesRerouted);
+    QJsonObject stageSeconds;
+    stageSeconds["extract"] = metrics.extractNanos / 1e9;
+    stageSeconds["read"] = metrics.readNanos / 1e9;
+    stageSeconds["match"] = metrics.matchNanos / 1e9;
+    stageSeconds["throttle"] = metrics.throttleNanos / 1e9;
+
+    QJsonObject root;
+    root["elapsedSeconds"] = metrics.elapsedSeconds;
+    root["bytesRead"] = bytesRead;
+    root["bytesScanned"] = static_cast<qint64>(metrics.bytesScanned);
+    root["files"] = files;
+    root["validatorRejections"] = static_cast<qint64>(metrics.validatorRejections);
+    root["binaryFiles"] = binaryFiles;
+    root["filesStolen"] = static_cast<qint64>(metrics.filesStolen);
+    root["parserFailures"] = static_cast<qint64>(metrics.parserFailures);
+    root["stageSeconds"] = stageSeconds;
+    root["patterns"] = patterns;
+    return QJsonDocument(root).toJson().toStdString();
+}
+
+static std::string escapeLabel(const std::string &value) {
+    std::string escaped;
+    for (char c: value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string ScanMetrics::toPrometheus() const {
+    MetricsSnapshot metrics = snapshot();
+    std::string out;
+
+    out += "# HELP sdd_scan_elapsed_seconds Time since the scan started.\n";
+    out += "# TYPE sdd_scan_elapsed_seconds gauge\n";
+    out += "sdd_scan_elapsed_seconds " + std::to_string(metrics.elapsedSeconds) + "\n";
+
+    out += "# HELP sdd_bytes_read_total Bytes of text produced by each reader type.\n";
+    out += "# TYPE sdd_bytes_read_total counter\n";
+    for (int i = 0; i < ChunkReaderType::NUM_READER_TYPES; i++) {
+        out += std::string("sdd_bytes_read_total{reader=\"") + readerTypeName(static_cast<ChunkReaderType>(i)) +
+               "\"} " + std::to_string(metrics.bytesRead[i]) + "\n";
+    }
+
+    out += "# HELP sdd_bytes_scanned_total Bytes passed to hs_scan.\n";
+    out += "# TYPE sdd_bytes_scanned_total counter\n";
+    out += "sdd_bytes_scanned_total " + std::to_string(metrics.bytesScanned) + "\n";
+
+    out += "# HELP sdd_files_total Scanned files by result.\n";
+    out += "# TYPE sdd_files_total counter\n";
+    for (int i = 0; i < NUM_SCAN_RESULTS; i++) {
+        out += std::string("sdd_files_total{result=\"") + scanResultName(static_cast<ScanResult>(i)) + "\"} " +
+               std::to_string(metrics.filesByResult[i]) + "\n";
+    }
+
+    out += "# HELP sdd_validator_rejections_total Matches dropped by a pattern validator.\n";
+    out += "# TYPE sdd_validator_rejections_total counter\n";
+    out += "sdd_validator_rejections_total " + std::to_string(metrics.validatorRejections) + "\n";
+
+    out += "# HELP sdd_binary_files_total Text files by extension whose first block was binary.\n";
+    out += "# TYPE sdd_binary_files_total counter\n";
+    out += "sdd_binary_files_total{decision=\"rejected\"} " + std::to_string(metrics.binaryFilesRejected) + "\n";
+    out += "sdd_binary_files_total{decision=\"rerouted\"} " + std::to_string(metrics.binaryFilesRerouted) + "\n";
+
+    out += "# HELP sdd_files_stolen_total Files a scanner thread took from the queue of another NUMA node.\n";
+    out += "# TYPE sdd_files_stolen_total counter\n";
+    out += "sdd_files_stolen_total " + std::to_string(metrics.filesStolen) + "\n";
+
+    out += "# HELP sdd_parser_failures_total Files whose sandboxed parser crashed, failed or timed out.\n";
+    out += "# TYPE sdd_parser_failures_total counter\n";
+    out += "sdd_parser_failures_total " + std::to_string(metrics.parserFailures) + "\n";
+
+    out += "# HELP sdd_stage_seconds_total Thread time spent in each scan stage.\n";
+    out += "# TYPE sdd_stage_seconds_total counter\n";
+    out += "sdd_stage_seconds_total{stage=\"extract\"} " + std::to_string(metrics.extractNanos / 1e9) + "\n";
+    out += "sdd_stage_seconds_total{stage=\"read\"} " + std::to_string(metrics.readNanos / 1e9) + "\n";
+    out += "sdd_stage_seconds_total{stage=\"match\"} " + std::to_string(metrics.matchNanos / 1e9) + "\n";
+    out += "sdd_stage_seconds_total{stage=\"throttle\"} " + std::to_string(metrics.throttleNanos / 1e9) + "\n";
+
+    out += "# HELP sdd_pattern_matches_total Recorded matches per scan pattern.\n";
+    out += "# TYPE sdd_pattern_matches_total counter\n";
+    for (size_t i = 0; i < patternNames.size(); i++) {
+        out += "sdd_pattern_matches_total{pattern=\"" + escapeLabel(patternNames[i]) + "\"} " +
+               std::to_string(metrics.patternMatches[i]) + "\n";
+    }
+    return out;
+}
+
+bool ScanMetrics::writeToFile(const std::string &path) const {
+    QString qPath = QString::fromStdString(path);
+    std::string contents = qPath.endsWith(".prom") ? toPrometheus() : toJson();
+
+    // Write to a temporary file and rename it so readers never see a partial file
+    QSaveFile file(qPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Could not open metrics file for writing: " << qPath;
+        return false;
+    }
+    file.write(contents.data(), static_cast<qint64>(contents.size()));
+    return file.commit();
+}
@@ -0,0 +1,84 @@
+#ifndef SENSITIVE_DATA_DELETER_SCANMETRICS_H
+#define SENSITIVE_DATA_DELETER_SCANMETRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define MAX_READER_TYPES 16
+#define NUM_SCAN_RESULTS 6
+
+/**
+ * Counters owned by a single scanner thread. Only the owning thread writes them, so they are
+ * updated with relaxed load + store instead of locked read-modify-write, and the reporter
+ * sums them with relaxed loads while the scan is running. Aligned to a cache line so that
+ * neighbouring threads do not share one.
+ */
+struct alignas(64) ThreadMetrics {
+    std::atomic<uint64_t> bytesRead[MAX_READER_TYPES];
+    std::atomic<uint64_t> bytesScanned;
+    std::atomic<uint64_t> filesByResult[NUM_SCAN_RESULTS];
+    std::atomic<uint64_t> validatorRejections;
+    std::atomic<uint64_t> binaryFilesRejected; // Plain text by extension, binary by the first block
+    std::atomic<uint64_t> binaryFilesRerouted; // Same, but scanned for strings since the type is in binary mode
+    std::atomic<uint64_t> filesStolen; // Taken from the queue of another NUMA node
+    std::atomic<uint64_t> parserFailures; // Files whose sandboxed parser crashed, failed or timed out
+    std::atomic<uint64_t> extractNanos; // Opening and parsing the file in ChunkReaderFactory
+    std::atomic<uint64_t> readNanos;    // readChunkFromFile
+    std::atomic<uint64_t> matchNanos;   // hs_scan
+    std::atomic<uint64_t> throttleNanos; // Waiting for the rate limits and the load back-off of the ResourceGovernor
+    std::unique_ptr<std::atomic<uint64_t>[]> patternMatches;
+
+    explicit ThreadMetrics(size_t numPatterns);
+
+    static void add(std::atomic<uint64_t> &counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    static void addElapsed(std::atomic<uint64_t> &counter, std::chrono::steady_clock::time_point start) {
+        add(counter, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+};
+
+struct MetricsSnapshot {
+    uint64_t bytesRead[MAX_READER_TYPES] = {};
+    uint64_t bytesScanned = 0;
+    uint64_t filesByResult[NUM_SCAN_RESULTS] = {};
+    uint64_t validatorRejections = 0;
+    uint64_t binaryFilesRejected = 0;
+    uint64_t binaryFilesRerouted = 0;
+    uint64_t filesStolen = 0;
+    uint64_t parserFailures = 0;
+    uint64_t extractNanos = 0;
+    uint64_t readNanos = 0;
+    uint64_t matchNanos = 0;
+    uint64_t throttleNanos = 0;
+    std::vector<uint64_t> patternMatches;
+    double elapsedSeconds = 0;
+};
+
+class ScanMetrics {
+public:
+    void reset(size_t numThreads, const std::vector<const char *> &patternDescriptions);
+
+    ThreadMetrics &forThread(size_t threadIndex) { return *threads[threadIndex]; }
+
+    MetricsSnapshot snapshot() const;
+
+    std::string toJson() const;
+
+    std::string toPrometheus() const;
+
+    // Files ending in .prom are written in Prometheus text format, everything else as JSON
+    bool writeToFile(const std::string &path) const;
+
+private:
+    std::vector<std::unique_ptr<ThreadMetrics>> threads;
+    std::vector<std::string> patternNames;
+    std::chrono::steady_clock::time_point startTime;
+};
+
+#endif //SENSITIVE_DATA_DELETER_SCANMETRICS_H
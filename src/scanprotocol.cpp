@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMessageAuthenticationCode>
+#include <QRandomGenerator>
+#include <cstring>
+#include <stdexcept>
+
+#include "scanprotocol.h"
+#include "validators.h"
+
+static uint32_t readU32At(const char *data) {
+    auto *bytes = reinterpret_cast<const unsigned char *>(data);
+    return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+MessageWriter::MessageWriter(ScanMessageType type) {
+    // The payload size is filled in by frame()
+    data.resize(SCAN_FRAME_HEADER_SIZE);
+    data[4] = static_cast<char>(type);
+}
+
+void MessageWriter::writeU8(uint8_t value) {
+    data.append(static_cast<char>(value));
+}
+
+void MessageWriter::writeU32(uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        data.append(static_cast<char>(value >> 8 * i));
+    }
+}
+
+void MessageWriter::writeU64(uint64_t value) {
+    writeU32(static_cast<uint32_t>(value));
+    writeU32(static_cast<uint32_t>(value >> 32));
+}
+
+void MessageWriter::writeString(std::string_view value) {
+    writeU32(static_cast<uint32_t>(value.size()));
+    data.append(value.data(), static_cast<qsizetype>(value.size()));
+}
+
+const QByteArray &MessageWriter::frame() {
+    auto size = static_cast<uint32_t>(data.size() - SCAN_FRAME_HEADER_SIZE);
+    for (int i = 0; i < 4; i++) {
+        data[i] = static_cast<char>(size >> 8 * i);
+    }
+    return data;
+}
+
+const char *MessageReader::take(size_t size) {
+    if (!valid || payload.size() - pos < size) {
+        valid = false;
+        return nullptr;
+    }
+    const char *data = payload.constData() + pos;
+    pos += size;
+    return data;
+}
+
+uint8_t MessageReader::readU8() {
+    const char *data = take(1);
+    return data ? static_cast<uint8_t>(data[0]) : 0;
+}
+
+uint32_t MessageReader::readU32() {
+    const char *data = take(4);
+    return data ? readU32At(data) : 0;
+}
+
+uint64_t MessageReader::readU64() {
+    uint64_t low = readU32();
+    return low | static_cast<uint64_t>(readU32()) << 32;
+}
+
+std::string MessageReader::readString() {
+    uint32_t size = readU32();
+    const char *data = take(size);
+    return data ? std::string(data, size) : std::string();
+}
+
+bool takeFrame(QByteArray &buffer, ScanMessageType &type, QByteArray &payload, uint32_t maxSize) {
+    if (buffer.size() < SCAN_FRAME_HEADER_SIZE) {
+        return false;
+    }
+    uint32_t size = readU32At(buffer.constData());
+    if (size > maxSize) {
+        throw std::runtime_error("Frame of " + std::to_string(size) + " bytes is too large");
+    }
+    if (static_cast<size_t>(buffer.size()) < SCAN_FRAME_HEADER_SIZE + static_cast<size_t>(size)) {
+        return false;
+    }
+    type = static_cast<ScanMessageType>(buffer[4]);
+    payload = buffer.mid(SCAN_FRAME_HEADER_SIZE, size);
+    buffer.remove(0, SCAN_FRAME_HEADER_SIZE + size);
+    return true;
+}
+
+QByteArray tokenProof(const QByteArray &token, const char *role, const QByteArray &nonce) {
+    QMessageAuthenticationCode code(QCryptographicHash::Sha256, token);
+    code.addData(role, static_cast<qsizetype>(std::strlen(role)));
+    code.addData(nonce);
+    return code.result();
+}
+
+bool proofMatches(const QByteArray &proof, const QByteArray &expected) {
+    // The length of an HMAC is no secret
+    if (proof.size() != expected.size()) {
+        return false;
+    }
+    uint8_t difference = 0;
+    for (qsizetype i = 0; i < proof.size(); i++) {
+        difference |= static_cast<uint8_t>(proof[i] ^ expected[i]);
+    }
+    return difference == 0;
+}
+
+QByteArray randomNonce() {
+    QByteArray nonce(SCAN_NONCE_SIZE, '\0');
+    QRandomGenerator::system()->generate(nonce.begin(), nonce.end());
+    return nonce;
+}
+
+ScanJobConfig ScanJobConfig::fromJson(const QByteArray &json) {
+    QJsonParseError error = {};
+    QJsonDocument document = QJsonDocument::fromJson(json, &error);
+    if (document.isNull() || !document.isObject()) {
+        throw std::runtime_error("The scan config is not valid JSON: " + error.errorString().toStdString());
+    }
+    QJsonObject root = document.object();
+
+    ScanJobConfig config;
+    for (const auto &value: root["fileTypes"].toArray()) {
+        QJsonObject obj = value.toObject();
+        std::string fileType = obj["fileType"].toString().toStdString();
+        if (fileType.empty()) {
+            continue;
+        }
+        config.fileTypes[fileType] = obj["description"].toString().toStdString();
+        if (obj["scanMode"].toString() == "binary") {
+            config.binaryFileTypes.insert(fileType);
+        }
+    }
+    for (const auto &value: root["scanPatterns"].toArray()) {
+        QJsonObject obj = value.toObject();
+        std::string pattern = obj["pattern"].toString().toStdString();
+        if (pattern.empty()) {
+            continue;
+        }
+        config.patterns.emplace_back(pattern, obj["description"].toString().toStdString());
+        PatternOptions &options = config.patternOptions[pattern];
+        options.somHorizon = static_cast<uint32_t>(std::max(0, obj["somHorizon"].toInt(0)));
+        std::string validator = obj["validator"].toString().toStdString();
+        if (isKnownValidator(validator)) {
+            options.validator = validator;
+        }
+    }
+    if (config.patterns.empty() || config.fileTypes.empty()) {
+        throw std::runtime_error("The scan config has no scan patterns or no file types");
+    }
+    config.scanSettings = root["scanSettings"].toObject();
+    return config;
+}
+
+QByteArray encodeJobResult(uint64_t jobId, const std::vector<FileResult> &results,
+                           const std::map<std::string, uint32_t> &patternIndexes) {
+    MessageWriter writer(ScanMessageType::JOB_RESULT);
+    writer.writeU64(jobId);
+    writer.writeU32(static_cast<uint32_t>(results.size()));
+    for (const auto &[path, result]: results) {
+        writer.writeString(path);
+        writer.writeU8(static_cast<uint8_t>(result.first));
+        writer.writeU32(static_cast<uint32_t>(result.second.size()));
+        for (const auto &match: result.second) {
+            auto index = patternIndexes.find(match.patternUsed.first);
+            writer.writeU32(index != patternIndexes.end() ? index->second : UINT32_MAX);
+            writer.writeString(match.match);
+            writer.writeU64(match.startIndex);
+            writer.writeU64(match.endIndex);
+            writer.writeU8(match.exactStart);
+            writer.writeString(match.location);
+        }
+    }
+    return writer.frame();
+}
+
+bool decodeJobResult(const QByteArray &payload, const std::vector<std::pair<std::string, std::string>> &patterns,
+                     uint64_t &jobId, std::vector<FileResult> &results) {
+    MessageReader reader(payload);
+    jobId = reader.readU64();
+    uint32_t numFiles = reader.readU32();
+    for (uint32_t i = 0; i < numFiles && reader.ok(); i++) {
+        FileResult fileResult;
+        fileResult.first = reader.readString();
+        uint8_t result = reader.readU8();
+        if (result >= NUM_SCAN_RESULTS) {
+            return false;
+        }
+        fileResult.second.first = static_cast<ScanResult>(result);
+        uint32_t numMatches = reader.readU32();
+        for (uint32_t j = 0; j < numMatches && reader.ok(); j++) {
+            uint32_t patternIndex = reader.readU32();
+            std::string snippet = reader.readString();
+            uint64_t start = reader.readU64();
+            uint64_t end = reader.readU64();
+            bool exactStart = reader.readU8() != 0;
+            std::string location = reader.readString();
+            if (patternIndex >= patterns.size()) {
+                return false;
+            }
+            fileResult.second.second.emplace_back(patterns[patternIndex], snippet, start, end, exactStart, location);
+        }
+        results.push_back(std::move(fileResult));
+    }
+    return reader.ok() && reader.atEnd();
+}
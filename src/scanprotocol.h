@@ -0,0 +1,136 @@
+#ifndef SENSITIVE_DATA_DELETER_SCANPROTOCOL_H
+#define SENSITIVE_DATA_DELETER_SCANPROTOCOL_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "filescanner.h"
+
+#define SCAN_PROTOCOL_VERSION 1
+#define SCAN_FRAME_HEADER_SIZE 5                 // uint32 payload size, uint8 message type
+#define SCAN_MAX_FRAME_SIZE (512 * 1024 * 1024) // Larger frames are treated as a broken connection
+#define SCAN_MAX_HANDSHAKE_FRAME_SIZE (4 * 1024) // Same for the frames before the other side proved it knows the token
+#define SCAN_MAX_CONFIG_FRAME_SIZE (16 * 1024 * 1024) // The scan config, read before the coordinator is checked
+#define SCAN_HELLO_TIMEOUT_MS 10000              // Connections that do not authenticate in time are dropped
+#define SCAN_NONCE_SIZE 16
+#define SCAN_TOKEN_VARIABLE "SDD_CLUSTER_TOKEN" // Environment variable with the token shared by coordinator and workers
+#define DEFAULT_COORDINATOR_PORT 7400
+
+/*
+ * Coordinator and workers talk over TCP in frames of a little endian uint32 payload size, a message
+ * type byte and the payload. Integers in payloads are little endian, strings are a uint32 length
+ * followed by the bytes.
+ *
+ *  CHALLENGE     coordinator -> worker  nonce
+ *  HELLO         worker -> coordinator  version, worker name, scanner threads, nonce, proof
+ *  CONFIG        coordinator -> worker  proof, scan config JSON in the format of sdd_config.json
+ *  JOB_REQUEST   worker -> coordinator  empty, asks for one more job
+ *  JOB           coordinator -> worker  job id, file paths
+ *  JOB_RESULT    worker -> coordinator  job id, per file: path, result, matches by pattern index
+ *  NO_MORE_JOBS  coordinator -> worker  empty, the worker exits
+ *
+ * Both sides prove that they know the shared token by sending an HMAC-SHA256 of the other side's
+ * nonce. A worker only reads files for a coordinator that passed the check, since the patterns it
+ * receives decide which file contents are sent back. Until then frames are limited to
+ * SCAN_MAX_HANDSHAKE_FRAME_SIZE, or SCAN_MAX_CONFIG_FRAME_SIZE for CONFIG, so a peer without the
+ * token can not make the other side buffer much.
+ * The connection is not encrypted.
+ */
+enum class ScanMessageType : uint8_t {
+    CHALLENGE = 1,
+    HELLO = 2,
+    CONFIG = 3,
+    JOB_REQUEST = 4,
+    JOB = 5,
+    JOB_RESULT = 6,
+    NO_MORE_JOBS = 7,
+};
+
+using FileResult = std::pair<std::string, std::pair<ScanResult, std::vector<MatchInfo>>>;
+
+class MessageWriter {
+public:
+    explicit MessageWriter(ScanMessageType type);
+
+    void writeU8(uint8_t value);
+
+    void writeU32(uint32_t value);
+
+    void writeU64(uint64_t value);
+
+    void writeString(std::string_view value);
+
+    // The frame with its header, ready to be written to the socket
+    const QByteArray &frame();
+
+private:
+    QByteArray data;
+};
+
+// Reads the payload of a frame. Reading past its end returns zeros and empty strings and clears ok().
+class MessageReader {
+public:
+    explicit MessageReader(const QByteArray &payload) : payload(payload) {}
+
+    uint8_t readU8();
+
+    uint32_t readU32();
+
+    uint64_t readU64();
+
+    std::string readString();
+
+    bool ok() const { return valid; }
+
+    bool atEnd() const { return pos == static_cast<size_t>(payload.size()); }
+
+private:
+    const QByteArray &payload;
+    size_t pos = 0;
+    bool valid = true;
+
+    const char *take(size_t size);
+};
+
+// Moves the first complete frame out of buffer. False if the buffer does not hold a whole frame yet.
+// Throws std::runtime_error if the frame is larger than maxSize.
+bool takeFrame(QByteArray &buffer, ScanMessageType &type, QByteArray &payload,
+               uint32_t maxSize = SCAN_MAX_FRAME_SIZE);
+
+// HMAC-SHA256 of the role and the nonce of the other side, keyed with the shared token
+QByteArray tokenProof(const QByteArray &token, const char *role, const QByteArray &nonce);
+
+// Compares a received proof with the expected one in constant time, so the time it takes does not
+// tell how many leading bytes were right
+bool proofMatches(const QByteArray &proof, const QByteArray &expected);
+
+QByteArray randomNonce();
+
+// The scan config of sdd_config.json with all patterns and file types enabled
+struct ScanJobConfig {
+    std::vector<std::pair<std::string, std::string>> patterns;
+    std::map<std::string, PatternOptions> patternOptions;
+    std::map<std::string, std::string> fileTypes;
+    std::set<std::string> binaryFileTypes;
+    QJsonObject scanSettings;
+
+    // Throws std::runtime_error if the JSON is malformed or has no patterns or file types
+    static ScanJobConfig fromJson(const QByteArray &json);
+};
+
+// Matches refer to their pattern by its index in the config, which both sides have
+QByteArray encodeJobResult(uint64_t jobId, const std::vector<FileResult> &results,
+                           const std::map<std::string, uint32_t> &patternIndexes);
+
+// False if the payload is malformed or refers to a pattern the config does not have
+bool decodeJobResult(const QByteArray &payload, const std::vector<std::pair<std::string, std::string>> &patterns,
+                     uint64_t &jobId, std::vector<FileResult> &results);
+
+#endif //SENSITIVE_DATA_DELETER_SCANPROTOCOL_H
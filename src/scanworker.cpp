@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QPromise>
+#include <QSysInfo>
+#include <stdexcept>
+
+#include "scanworker.h"
+
+ScanWorker::ScanWorker(const QString &host, quint16 port, const QByteArray &token, int numThreads)
+        : host(host), port(port), token(token), numThreads(numThreads) {}
+
+bool ScanWorker::readFrame(ScanMessageType &type, QByteArray &payload, uint32_t maxSize) {
+    while (!takeFrame(buffer, type, payload, maxSize)) {
+        if (!socket.waitForReadyRead(-1)) {
+            return false;
+        }
+        buffer.append(socket.readAll());
+    }
+    return true;
+}
+
+bool ScanWorker::send(const QByteArray &frame) {
+    socket.write(frame);
+    while (socket.bytesToWrite() > 0) {
+        if (!socket.waitForBytesWritten(-1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ScanWorker::run() {
+    socket.connectToHost(host, port);
+    if (!socket.waitForConnected(WORKER_CONNECT_TIMEOUT_MS)) {
+        qWarning() << "Could not connect to the coordinator at" << host << ":" << socket.errorString();
+        return 1;
+    }
+
+    ScanMessageType type;
+    QByteArray payload;
+    try {
+        if (!readFrame(type, payload, SCAN_MAX_HANDSHAKE_FRAME_SIZE) || type != ScanMessageType::CHALLENGE) {
+            qWarning() << "The coordinator did not send a challenge";
+            return 1;
+        }
+        QByteArray coordinatorNonce = QByteArray::fromStdString(MessageReader(payload).readString());
+        QByteArray nonce = randomNonce();
+        QString name = QSysInfo::machineHostName() + ":" + QString::number(QCoreApplication::applicationPid());
+        MessageWriter hello(ScanMessageType::HELLO);
+        hello.writeU32(SCAN_PROTOCOL_VERSION);
+        hello.writeString(name.toStdString());
+        hello.writeU32(static_cast<uint32_t>(std::max(0, numThreads)));
+        hello.writeString(nonce.toStdString());
+        hello.writeString(tokenProof(token, "worker", coordinatorNonce).toStdString());
+        if (!send(hello.frame()) || !readFrame(type, payload, SCAN_MAX_CONFIG_FRAME_SIZE) ||
+            type != ScanMessageType::CONFIG) {
+            qWarning() << "The coordinator rejected the worker, check" << SCAN_TOKEN_VARIABLE;
+            return 1;
+        }
+        MessageReader configReader(payload);
+        QByteArray proof = QByteArray::fromStdString(configReader.readString());
+        QByteArray configJson = QByteArray::fromStdString(configReader.readString());
+        if (!configReader.ok() || !proofMatches(proof, tokenProof(token, "coordinator", nonce))) {
+            qWarning() << "The coordinator does not know the token, no files are scanned for it";
+            return 1;
+        }
+
+        ScanJobConfig config = ScanJobConfig::fromJson(configJson);
+        // Results go back to the coordinator, which owns the results store
+        ScanSettings settings = ScanSettings::fromJson(config.scanSettings);
+        settings.resultsPath.clear();
+        settings.metricsPath.clear();
+        settings.tracePath.clear();
+        if (numThreads > 0) {
+            settings.numThreads = numThreads;
+        }
+        FileScanner scanner;
+        scanner.setScanSettings(settings);
+        scanner.setPatternOptions(config.patternOptions);
+        scanner.setBinaryFileTypes(config.binaryFileTypes);
+        scanner.compilePatterns(config.patterns);
+        std::map<std::string, uint32_t> patternIndexes;
+        for (uint32_t i = 0; i < config.patterns.size(); i++) {
+            patternIndexes[config.patterns[i].first] = i;
+        }
+
+        for (int i = 0; i < WORKER_PREFETCH_JOBS; i++) {
+            send(MessageWriter(ScanMessageType::JOB_REQUEST).frame());
+        }
+        size_t jobsDone = 0;
+        while (readFrame(type, payload)) {
+            if (type == ScanMessageType::NO_MORE_JOBS) {
+                qDebug() << "Worker" << name << "done after" << jobsDone << "jobs";
+                scanner.releasePatterns();
+                return 0;
+            }
+            if (type != ScanMessageType::JOB) {
+                qWarning() << "Unexpected message from the coordinator";
+                break;
+            }
+            MessageReader reader(payload);
+            uint64_t jobId = reader.readU64();
+            uint32_t numFiles = reader.readU32();
+            std::vector<std::string> files;
+            for (uint32_t i = 0; i < numFiles && reader.ok(); i++) {
+                files.push_back(reader.readString());
+            }
+            if (!reader.ok()) {
+                qWarning() << "Malformed job from the coordinator";
+                break;
+            }
+
+            QPromise<std::map<std::string, std::pair<ScanResult, std::vector<MatchInfo>>>> promise;
+            promise.start();
+            scanner.scanFiles(promise, files, config.patterns, config.fileTypes);
+            std::vector<FileResult> results;
+            QFuture<std::map<std::string, std::pair<ScanResult, std::vector<MatchInfo>>>> future = promise.future();
+            if (future.resultCount() > 0) {
+                for (auto &item: future.resultAt(0)) {
+                    results.emplace_back(item.first, std::move(item.second));
+                }
+            }
+            if (!send(encodeJobResult(jobId, results, patternIndexes)) ||
+                !send(MessageWriter(ScanMessageType::JOB_REQUEST).frame())) {
+                break;
+            }
+            jobsDone++;
+        }
+        scanner.releasePatterns();
+    } catch (std::runtime_error &e) {
+        qWarning() << "Worker failed:" << e.what();
+        return 1;
+    }
+    qWarning() << "Lost the connection to the coordinator";
+    return 1;
+}
@@ -0,0 +1,39 @@
+#ifndef SENSITIVE_DATA_DELETER_SCANWORKER_H
+#define SENSITIVE_DATA_DELETER_SCANWORKER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QTcpSocket>
+
+#include "scanprotocol.h"
+
+#define WORKER_CONNECT_TIMEOUT_MS 30000
+#define WORKER_PREFETCH_JOBS 2 // Jobs requested before the first one is done, so the next is always at hand
+
+/**
+ * Worker process of a distributed scan. Connects to the coordinator, receives the scan config and
+ * compiles its patterns once, then scans one job after another with all threads of a FileScanner
+ * until the coordinator has no more. The socket is used blocking, there is no event loop.
+ */
+class ScanWorker {
+public:
+    ScanWorker(const QString &host, quint16 port, const QByteArray &token, int numThreads);
+
+    // Returns the exit code of the process
+    int run();
+
+private:
+    QString host;
+    quint16 port;
+    QByteArray token;
+    int numThreads;
+    QTcpSocket socket;
+    QByteArray buffer;
+
+    // Blocks until a whole frame arrived, false if the connection was closed
+    bool readFrame(ScanMessageType &type, QByteArray &payload, uint32_t maxSize = SCAN_MAX_FRAME_SIZE);
+
+    bool send(const QByteArray &frame);
+};
+
+#endif //SENSITIVE_DATA_DELETER_SCANWORKER_H
@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <numeric>
+#include <string_view>
+
+#include "searchindex.h"
+
+static void appendLower(std::string &out, const std::string &text) {
+    for (unsigned char c: text) {
+        out += static_cast<char>(std::tolower(c));
+    }
+}
+
+static std::string toLower(const std::string &text) {
+    std::string lower;
+    lower.reserve(text.size());
+    appendLower(lower, text);
+    return lower;
+}
+
+static uint32_t trigramKey(const char *p) {
+    return static_cast<uint32_t>(static_cast<unsigned char>(p[0])) << 16 |
+           static_cast<uint32_t>(static_cast<unsigned char>(p[1])) << 8 |
+           static_cast<uint32_t>(static_cast<unsigned char>(p[2]));
+}
+
+static std::vector<uint32_t> intersect(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+    std::vector<uint32_t> result;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+    return result;
+}
+
+SearchQuery SearchQuery::parse(const std::string &input, int patternId) {
+    SearchQuery query;
+    query.patternId = patternId;
+
+    std::string remaining;
+    size_t pos = 0;
+    while (pos < input.size()) {
+        if (std::isspace(static_cast<unsigned char>(input[pos]))) {
+            pos++;
+            continue;
+        }
+        size_t end;
+        if (input.compare(pos, 4, "dir:") == 0) {
+            size_t start = pos + 4;
+            if (start < input.size() && input[start] == '"') {
+                start++;
+                end = input.find('"', start);
+                query.directory = input.substr(start, end == std::string::npos ? end : end - start);
+                end = end == std::string::npos ? input.size() : end + 1;
+            } else {
+                end = start;
+                while (end < input.size() && !std::isspace(static_cast<unsigned char>(input[end]))) {
+                    end++;
+                }
+                query.directory = input.substr(start, end - start);
+            }
+        } else {
+            end = pos;
+            while (end < input.size() && !std::isspace(static_cast<unsigned char>(input[end]))) {
+                end++;
+            }
+            if (!remaining.empty()) {
+                remaining += ' ';
+            }
+            remaining.append(input, pos, end - pos);
+        }
+        pos = end;
+    }
+
+    query.text = toLower(remaining);
+    query.directory = inDirectory(query.directory).directory;
+    return query;
+}
+
+SearchQuery SearchQuery::inDirectory(const std::string &directory) {
+    SearchQuery query;
+    query.directory = toLower(directory);
+    std::replace(query.directory.begin(), query.directory.end(), '\\', '/');
+    while (query.directory.size() > 1 && query.directory.back() == '/') {
+        query.directory.pop_back();
+    }
+    return query;
+}
+
+void SearchIndex::clear() {
+    clearDocuments();
+    patterns.clear();
+    lowerPatterns.clear();
+    patternIds.clear();
+    patternPostings.clear();
+}
+
+void SearchIndex::clearDocuments() {
+    text.clear();
+    docOffsets.assign(1, 0);
+    pathLengths.clear();
+    trigramPostings.clear();
+    for (auto &postings: patternPostings) {
+        postings.clear();
+    }
+}
+
+uint32_t SearchIndex::addDocument(const std::string &path, const std::vector<MatchInfo> &matches) {
+    auto doc = static_cast<uint32_t>(pathLengths.size());
+    size_t begin = text.size();
+
+    appendLower(text, path);
+    pathLengths.push_back(static_cast<uint32_t>(path.size()));
+    for (const auto &match: matches) {
+        text += '\0';
+        appendLower(text, match.match);
+
+        auto [it, inserted] = patternIds.try_emplace(match.patternUsed.second, static_cast<int>(patterns.size()));
+        if (inserted) {
+            patterns.push_back(match.patternUsed.second);
+            lowerPatterns.push_back(toLower(match.patternUsed.second));
+            patternPostings.emplace_back();
+        }
+        auto &postings = patternPostings[it->second];
+        if (postings.empty() || postings.back() != doc) {
+            postings.push_back(doc);
+        }
+    }
+    docOffsets.push_back(text.size());
+
+    // Documents are added in ascending order, so checking the last entry is enough to skip repeats
+    for (size_t i = begin; i + 3 <= text.size(); i++) {
+        if (text[i] == '\0' || text[i + 1] == '\0' || text[i + 2] == '\0') {
+            continue;
+        }
+        auto &postings = trigramPostings[trigramKey(text.data() + i)];
+        if (postings.empty() || postings.back() != doc) {
+            postings.push_back(doc);
+        }
+    }
+    return doc;
+}
+
+std::vector<uint32_t> SearchIndex::search(const SearchQuery &query) const {
+    std::vector<uint32_t> result;
+
+    if (query.text.empty()) {
+        if (query.patternId != NO_PATTERN_FILTER) {
+            result = patternPostings[query.patternId];
+        } else {
+            result.resize(size());
+            std::iota(result.begin(), result.end(), 0);
+        }
+    } else {
+        // Candidates must contain every trigram of the query, rarest first so the lists shrink quickly
+        std::vector<const std::vector<uint32_t> *> lists;
+        bool missingTrigram = false;
+        for (size_t i = 0; i + 3 <= query.text.size(); i++) {
+            auto it = trigramPostings.find(trigramKey(query.text.data() + i));
+            if (it == trigramPostings.end()) {
+                missingTrigram = true;
+                break;
+            }
+            lists.push_back(&it->second);
+        }
+        if (query.patternId != NO_PATTERN_FILTER) {
+            lists.push_back(&patternPostings[query.patternId]);
+        }
+
+        std::vector<uint32_t> candidates;
+        if (!missingTrigram) {
+            if (lists.empty()) {
+                candidates.resize(size());
+                std::iota(candidates.begin(), candidates.end(), 0);
+            } else {
+                std::sort(lists.begin(), lists.end(), [](const auto *a, const auto *b) { return a->size() < b->size(); });
+                candidates = *lists[0];
+                for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+                    candidates = intersect(candidates, *lists[i]);
+                }
+            }
+        }
+        for (uint32_t doc: candidates) {
+            if (containsText(doc, query.text)) {
+                result.push_back(doc);
+            }
+        }
+
+        // Pattern descriptions are stored once, files match through the patterns that flagged them
+        for (size_t id = 0; id < lowerPatterns.size(); id++) {
+            if (lowerPatterns[id].find(query.text) == std::string::npos ||
+                (query.patternId != NO_PATTERN_FILTER && query.patternId != static_cast<int>(id))) {
+                continue;
+            }
+            std::vector<uint32_t> merged;
+            std::set_union(result.begin(), result.end(), patternPostings[id].begin(), patternPostings[id].end(),
+                           std::back_inserter(merged));
+            result = std::move(merged);
+        }
+    }
+
+    if (!query.directory.empty()) {
+        result.erase(std::remove_if(result.begin(), result.end(), [this, &query](uint32_t doc) {
+            return !isUnderDirectory(doc, query.directory);
+        }), result.end());
+    }
+    return result;
+}
+
+bool SearchIndex::matches(uint32_t doc, const SearchQuery &query) const {
+    auto hasPattern = [this, doc](size_t patternId) {
+        return std::binary_search(patternPostings[patternId].begin(), patternPostings[patternId].end(), doc);
+    };
+    if ((query.patternId != NO_PATTERN_FILTER && !hasPattern(query.patternId)) ||
+        (!query.directory.empty() && !isUnderDirectory(doc, query.directory))) {
+        return false;
+    }
+    if (query.text.empty() || containsText(doc, query.text)) {
+        return true;
+    }
+    for (size_t id = 0; id < lowerPatterns.size(); id++) {
+        if ((query.patternId == NO_PATTERN_FILTER || query.patternId == static_cast<int>(id)) &&
+            lowerPatterns[id].find(query.text) != std::string::npos && hasPattern(id)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t SearchIndex::memoryUsage() const {
+    size_t bytes = text.capacity() + docOffsets.capacity() * sizeof(size_t) +
+                   pathLengths.capacity() * sizeof(uint32_t);
+    for (const auto &[key, postings]: trigramPostings) {
+        bytes += sizeof(key) + sizeof(postings) + postings.capacity() * sizeof(uint32_t);
+    }
+    for (const auto &postings: patternPostings) {
+        bytes += postings.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+bool SearchIndex::containsText(uint32_t doc, const std::string &needle) const {
+    std::string_view document(text.data() + docOffsets[doc], docOffsets[doc + 1] - docOffsets[doc]);
+    return document.find(needle) != std::string_view::npos;
+}
+
+bool SearchIndex::isUnderDirectory(uint32_t doc, const std::string &directory) const {
+    std::string_view path(text.data() + docOffsets[doc], pathLengths[doc]);
+    if (path.size() <= directory.size() || path.compare(0, directory.size(), directory) != 0) {
+        return false;
+    }
+    return directory.back() == '/' || path[directory.size()] == '/';
+}
@@ -0,0 +1,72 @@
+#ifndef SENSITIVE_DATA_DELETER_SEARCHINDEX_H
+#define SENSITIVE_DATA_DELETER_SEARCHINDEX_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include "filescanner.h"
+
+#define NO_PATTERN_FILTER (-1)
+
+struct SearchQuery {
+    std::string text;      // Lowercase substring to look for, empty matches everything
+    std::string directory; // Lowercase directory the file has to be under, empty for any
+    int patternId = NO_PATTERN_FILTER;
+
+    // Splits "dir:<path>" (or dir:"<path with spaces>") out of the search box text
+    static SearchQuery parse(const std::string &input, int patternId = NO_PATTERN_FILTER);
+
+    // Matches every file under the directory
+    static SearchQuery inDirectory(const std::string &directory);
+
+    bool isEmpty() const { return text.empty() && directory.empty() && patternId == NO_PATTERN_FILTER; }
+};
+
+/**
+ * Substring index over the flagged files. Each file is a document made of its path, its matched
+ * text and its pattern descriptions, lowercased once when it is added. Queries of three or more
+ * characters only look at documents containing all trigrams of the query, shorter ones fall back
+ * to scanning the lowercased text. Documents are identified by the order they were added in.
+ */
+class SearchIndex {
+public:
+    void clear();
+
+    // Removes the documents but keeps the pattern ids, so ids handed out before stay valid
+    void clearDocuments();
+
+    uint32_t addDocument(const std::string &path, const std::vector<MatchInfo> &matches);
+
+    // Ids of the matching documents in ascending order
+    std::vector<uint32_t> search(const SearchQuery &query) const;
+
+    // Same as checking if search() returns doc, without looking at the other documents
+    bool matches(uint32_t doc, const SearchQuery &query) const;
+
+    size_t size() const { return docOffsets.size() - 1; }
+
+    // Pattern descriptions in the order they were first seen, the index is the pattern id
+    const std::vector<std::string> &patternDescriptions() const { return patterns; }
+
+    size_t memoryUsage() const;
+
+private:
+    // Lowercased "path\0match\0match\0..." of every document back to back
+    std::string text;
+    std::vector<size_t> docOffsets{0};
+    std::vector<uint32_t> pathLengths;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigramPostings;
+
+    std::vector<std::string> patterns;
+    std::vector<std::string> lowerPatterns;
+    std::unordered_map<std::string, int> patternIds;
+    std::vector<std::vector<uint32_t>> patternPostings;
+
+    bool containsText(uint32_t doc, const std::string &needle) const;
+
+    bool isUnderDirectory(uint32_t doc, const std::string &directory) const;
+};
+
+#endif //SENSITIVE_DATA_DELETER_SEARCHINDEX_H
@@ -0,0 +1,14 @@
+#ifndef SENSITIVE_DATA_DELETER_SIMD_H
+#define SENSITIVE_DATA_DELETER_SIMD_H
+
+// SSE2 is part of x86-64 and NEON of AArch64, so x64 and arm64 builds get the vectorized byte loops.
+// Other targets, such as 32 bit ARM, use the scalar ones.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SDD_HAVE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SDD_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+#endif //SENSITIVE_DATA_DELETER_SIMD_H
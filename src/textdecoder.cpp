@@ -0,0 +1,350 @@
+#include <algorithm>
+
+#include "textdecoder.h"
+#include "simd.h"
+
+#define DETECTION_SAMPLE_SIZE 4096
+#define MIN_DETECTION_SIZE 4 // Shorter first chunks are held back until more of the text is read
+#define REPLACEMENT_CHARACTER 0xFFFD
+
+const char *textEncodingName(TextEncoding encoding) {
+    switch (encoding) {
+        case TextEncoding::UTF8_TEXT:
+            return "utf-8";
+        case TextEncoding::UTF16LE_TEXT:
+            return "utf-16le";
+        case TextEncoding::UTF16BE_TEXT:
+            return "utf-16be";
+        case TextEncoding::LATIN1_TEXT:
+            return "latin-1";
+        default:
+            return "unknown";
+    }
+}
+
+static size_t asciiPrefix(const unsigned char *data, size_t size) {
+    size_t i = 0;
+#ifdef SDD_HAVE_SSE2
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        if (_mm_movemask_epi8(block) != 0) {
+            break;
+        }
+    }
+#elif defined(SDD_HAVE_NEON)
+    for (; i + 16 <= size; i += 16) {
+        if (vmaxvq_u8(vld1q_u8(data + i)) >= 0x80) {
+            break;
+        }
+    }
+#endif
+    while (i < size && data[i] < 0x80) {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * Length of the UTF-8 sequence at data, 0 if it is invalid. Sets incomplete if the bytes up to end
+ * are the valid start of a sequence that continues past end.
+ */
+static size_t utf8SequenceLength(const unsigned char *data, const unsigned char *end, bool &incomplete) {
+    incomplete = false;
+    unsigned char lead = data[0];
+    size_t length;
+    unsigned char low = 0x80, high = 0xBF; // Allowed range of the second byte
+    if (lead < 0x80) {
+        return 1;
+    } else if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0) low = 0xA0;      // Overlong
+        else if (lead == 0xED) high = 0x9F; // Surrogates
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0) low = 0x90;       // Overlong
+        else if (lead == 0xF4) high = 0x8F; // Above U+10FFFF
+    } else {
+        return 0;
+    }
+
+    for (size_t i = 1; i < length; i++) {
+        if (data + i >= end) {
+            incomplete = true;
+            return 0;
+        }
+        unsigned char byte = data[i];
+        if (i == 1 ? (byte < low || byte > high) : (byte & 0xC0) != 0x80) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+size_t validUtf8Prefix(const char *data, size_t size) {
+    auto *bytes = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char *end = bytes + size;
+    size_t i = 0;
+    while (i < size) {
+        i += asciiPrefix(bytes + i, size - i);
+        if (i == size) {
+            break;
+        }
+        bool incomplete;
+        size_t length = utf8SequenceLength(bytes + i, end, incomplete);
+        if (length == 0) {
+            break;
+        }
+        i += length;
+    }
+    return i;
+}
+
+void OffsetMap::addRun(size_t decodedStart, uint64_t sourceStart, uint8_t sourceUnit, uint8_t decodedUnit) {
+    // A run that continues the last one with the same ratio is already covered by it
+    if (!runs.empty()) {
+        const Run &last = runs.back();
+        size_t decoded = decodedStart - last.decodedStart;
+        if (last.sourceUnit == sourceUnit && last.decodedUnit == decodedUnit && decoded % decodedUnit == 0 &&
+            last.sourceStart + decoded / decodedUnit * sourceUnit == sourceStart) {
+            return;
+        }
+    }
+    runs.push_back({decodedStart, sourceStart, sourceUnit, decodedUnit});
+}
+
+uint64_t OffsetMap::toSource(size_t decodedOffset) const {
+    if (runs.empty()) {
+        return decodedOffset;
+    }
+    auto it = std::upper_bound(runs.begin(), runs.end(), decodedOffset, [](size_t offset, const Run &run) {
+        return offset < run.decodedStart;
+    });
+    const Run &run = it == runs.begin() ? runs.front() : *(it - 1);
+    if (decodedOffset < run.decodedStart) {
+        return run.sourceStart;
+    }
+    return run.sourceStart + (decodedOffset - run.decodedStart) / run.decodedUnit * run.sourceUnit;
+}
+
+size_t TextDecoder::detectEncoding(const unsigned char *data, size_t size) {
+    detected = true;
+    if (size >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF) {
+        currentEncoding = UTF8_TEXT;
+        return 3;
+    }
+    if (size >= 2 && data[0] == 0xFF && data[1] == 0xFE) {
+        currentEncoding = UTF16LE_TEXT;
+        return 2;
+    }
+    if (size >= 2 && data[0] == 0xFE && data[1] == 0xFF) {
+        currentEncoding = UTF16BE_TEXT;
+        return 2;
+    }
+
+    // UTF-16 without a byte order mark: Windows tools write mostly ASCII, so one byte of each pair is zero
+    size_t pairs = std::min(size, static_cast<size_t>(DETECTION_SAMPLE_SIZE)) / 2;
+    size_t evenZeros = 0, oddZeros = 0;
+    for (size_t i = 0; i < pairs; i++) {
+        evenZeros += data[2 * i] == 0;
+        oddZeros += data[2 * i + 1] == 0;
+    }
+    if (pairs >= 2 && oddZeros * 10 >= pairs * 4 && evenZeros * 10 < pairs) {
+        currentEncoding = UTF16LE_TEXT;
+    } else if (pairs >= 2 && evenZeros * 10 >= pairs * 4 && oddZeros * 10 < pairs) {
+        currentEncoding = UTF16BE_TEXT;
+    } else {
+        // A character cut off at the end of the chunk does not make the text invalid
+        size_t valid = validUtf8Prefix(reinterpret_cast<const char *>(data), size);
+        bool incomplete = false;
+        if (valid < size) {
+            utf8SequenceLength(data + valid, data + size, incomplete);
+        }
+        currentEncoding = valid == size || incomplete ? UTF8_TEXT : LATIN1_TEXT;
+    }
+    return 0;
+}
+
+std::string_view TextDecoder::decode(const char *data, size_t size) {
+    output.clear();
+    map.clear();
+
+    auto *bytes = reinterpret_cast<const unsigned char *>(data);
+    if (!carry.empty()) {
+        joined.assign(carry);
+        joined.append(data, size);
+        bytes = reinterpret_cast<const unsigned char *>(joined.data());
+        size = joined.size();
+        carry.clear();
+    }
+
+    if (!detected) {
+        if (size < MIN_DETECTION_SIZE) {
+            carry.assign(reinterpret_cast<const char *>(bytes), size);
+            return output;
+        }
+        // The byte order mark is not part of the text
+        size_t bomLength = detectEncoding(bytes, size);
+        bytes += bomLength;
+        size -= bomLength;
+        sourceOffset += bomLength;
+    }
+
+    switch (currentEncoding) {
+        case UTF8_TEXT:
+            // Valid UTF-8 is passed through as is, this is the common case
+            if (validUtf8Prefix(reinterpret_cast<const char *>(bytes), size) == size) {
+                map.addRun(0, sourceOffset, 1, 1);
+                sourceOffset += size;
+                return {reinterpret_cast<const char *>(bytes), size};
+            }
+            appendUtf8(bytes, size, false);
+            break;
+        case LATIN1_TEXT:
+            appendLatin1(bytes, size);
+            break;
+        case UTF16LE_TEXT:
+        case UTF16BE_TEXT:
+            appendUtf16(bytes, size, false);
+            break;
+    }
+    return output;
+}
+
+std::string_view TextDecoder::finish() {
+    output.clear();
+    map.clear();
+    if (carry.empty()) {
+        return output;
+    }
+
+    std::string rest;
+    rest.swap(carry);
+    auto *bytes = reinterpret_cast<const unsigned char *>(rest.data());
+    size_t size = rest.size();
+    if (!detected) { // The whole text was shorter than MIN_DETECTION_SIZE
+        size_t bomLength = detectEncoding(bytes, size);
+        bytes += bomLength;
+        size -= bomLength;
+        sourceOffset += bomLength;
+    }
+    if (currentEncoding == UTF16LE_TEXT || currentEncoding == UTF16BE_TEXT) {
+        appendUtf16(bytes, size, true);
+    } else if (currentEncoding == LATIN1_TEXT) {
+        appendLatin1(bytes, size);
+    } else {
+        appendUtf8(bytes, size, true);
+    }
+    return output;
+}
+
+void TextDecoder::restart() {
+    detected = false;
+    carry.clear();
+}
+
+void TextDecoder::appendUtf8(const unsigned char *data, size_t size, bool atEnd) {
+    const unsigned char *end = data + size;
+    size_t i = 0;
+    while (i < size) {
+        size_t valid = validUtf8Prefix(reinterpret_cast<const char *>(data + i), size - i);
+        if (valid > 0) {
+            map.addRun(output.size(), sourceOffset, 1, 1);
+            output.append(reinterpret_cast<const char *>(data + i), valid);
+            sourceOffset += valid;
+            i += valid;
+            continue;
+        }
+        bool incomplete;
+        utf8SequenceLength(data + i, end, incomplete);
+        if (incomplete && !atEnd) {
+            carry.assign(reinterpret_cast<const char *>(data + i), size - i);
+            return;
+        }
+        // Not UTF-8 after all, keep the byte as the Latin-1 character it most likely is
+        appendCodePoint(data[i], 1);
+        i++;
+    }
+}
+
+void TextDecoder::appendLatin1(const unsigned char *data, size_t size) {
+    size_t i = 0;
+    while (i < size) {
+        size_t ascii = asciiPrefix(data + i, size - i);
+        if (ascii > 0) {
+            map.addRun(output.size(), sourceOffset, 1, 1);
+            output.append(reinterpret_cast<const char *>(data + i), ascii);
+            sourceOffset += ascii;
+            i += ascii;
+            continue;
+        }
+        appendCodePoint(data[i], 1);
+        i++;
+    }
+}
+
+void TextDecoder::appendUtf16(const unsigned char *data, size_t size, bool atEnd) {
+    bool bigEndian = currentEncoding == UTF16BE_TEXT;
+    auto unitAt = [data, bigEndian](size_t i) {
+        return bigEndian ? static_cast<uint32_t>(data[i] << 8 | data[i + 1])
+                         : static_cast<uint32_t>(data[i + 1] << 8 | data[i]);
+    };
+
+    size_t i = 0;
+    while (i + 2 <= size) {
+        uint32_t unit = unitAt(i);
+        if (unit >= 0xD800 && unit <= 0xDBFF) {
+            if (i + 4 > size && !atEnd) {
+                break; // The low surrogate is in the next chunk
+            }
+            uint32_t low = i + 4 <= size ? unitAt(i + 2) : 0;
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                appendCodePoint(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00), 4);
+                i += 4;
+                continue;
+            }
+            appendCodePoint(REPLACEMENT_CHARACTER, 2);
+        } else if (unit >= 0xDC00 && unit <= 0xDFFF) {
+            appendCodePoint(REPLACEMENT_CHARACTER, 2);
+        } else {
+            appendCodePoint(unit, 2);
+        }
+        i += 2;
+    }
+
+    if (i < size) {
+        if (atEnd) {
+            appendCodePoint(REPLACEMENT_CHARACTER, 1); // Odd trailing byte
+        } else {
+            carry.assign(reinterpret_cast<const char *>(data + i), size - i);
+        }
+    }
+}
+
+void TextDecoder::appendCodePoint(uint32_t codePoint, uint8_t sourceUnit) {
+    char encoded[4];
+    uint8_t length;
+    if (codePoint < 0x80) {
+        encoded[0] = static_cast<char>(codePoint);
+        length = 1;
+    } else if (codePoint < 0x800) {
+        encoded[0] = static_cast<char>(0xC0 | codePoint >> 6);
+        encoded[1] = static_cast<char>(0x80 | (codePoint & 0x3F));
+        length = 2;
+    } else if (codePoint < 0x10000) {
+        encoded[0] = static_cast<char>(0xE0 | codePoint >> 12);
+        encoded[1] = static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+        encoded[2] = static_cast<char>(0x80 | (codePoint & 0x3F));
+        length = 3;
+    } else {
+        encoded[0] = static_cast<char>(0xF0 | codePoint >> 18);
+        encoded[1] = static_cast<char>(0x80 | (codePoint >> 12 & 0x3F));
+        encoded[2] = static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+        encoded[3] = static_cast<char>(0x80 | (codePoint & 0x3F));
+        length = 4;
+    }
+    map.addRun(output.size(), sourceOffset, sourceUnit, length);
+    output.append(encoded, length);
+    sourceOffset += sourceUnit;
+}
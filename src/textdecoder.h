@@ -0,0 +1,96 @@
+#ifndef SENSITIVE_DATA_DELETER_TEXTDECODER_H
+#define SENSITIVE_DATA_DELETER_TEXTDECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum TextEncoding {
+    UTF8_TEXT,
+    UTF16LE_TEXT,
+    UTF16BE_TEXT,
+    LATIN1_TEXT,
+};
+
+const char *textEncodingName(TextEncoding encoding);
+
+// Length of the longest prefix of data that is valid UTF-8. ASCII runs are skipped 16 bytes at a
+// time where SSE2 or NEON is available, which covers most of the text we see.
+size_t validUtf8Prefix(const char *data, size_t size);
+
+/**
+ * Maps offsets in decoded text back to offsets in the stream it was decoded from. Consecutive
+ * characters that were decoded with the same ratio of source to decoded bytes share one run,
+ * so text that is mostly ASCII needs only a handful of runs per chunk. Runs do not have to be
+ * contiguous in the source, readers that skip bytes start a new run after every gap.
+ */
+class OffsetMap {
+public:
+    void clear() { runs.clear(); }
+
+    // Maps the bytes from decodedStart on, sourceUnit source bytes per decodedUnit decoded bytes
+    void addRun(size_t decodedStart, uint64_t sourceStart, uint8_t sourceUnit, uint8_t decodedUnit);
+
+    // Offset in the source stream of the character that contains the decoded byte
+    uint64_t toSource(size_t decodedOffset) const;
+
+private:
+    struct Run {
+        size_t decodedStart;
+        uint64_t sourceStart;
+        uint8_t sourceUnit;
+        uint8_t decodedUnit;
+    };
+    std::vector<Run> runs;
+};
+
+/**
+ * Turns the chunks read from a file into UTF-8 for Hyperscan. The encoding is detected from the
+ * first chunk: a byte order mark wins, otherwise text where every other byte is zero is taken as
+ * UTF-16 and text that is not valid UTF-8 as Latin-1. Bytes that are not valid in the detected
+ * encoding are decoded as Latin-1 (or U+FFFD for broken UTF-16) instead of being dropped, so every
+ * byte of the file ends up in the scanned text. Characters split between two chunks are held
+ * back and decoded with the next chunk.
+ */
+class TextDecoder {
+public:
+    // Decodes the next bytes of the stream. The text stays valid until the next call and is the
+    // input itself when it is valid UTF-8 already.
+    std::string_view decode(const char *data, size_t size);
+
+    // Decodes the bytes that were held back at the end of the stream
+    std::string_view finish();
+
+    // The next chunk starts a new text, for archives that return several files one after another.
+    // Call finish() first. Source offsets keep counting from where the previous text ended.
+    void restart();
+
+    // Maps offsets in the text returned by the last decode() or finish() call to stream offsets
+    const OffsetMap &offsetMap() const { return map; }
+
+    TextEncoding encoding() const { return currentEncoding; }
+
+private:
+    TextEncoding currentEncoding = UTF8_TEXT;
+    bool detected = false;
+    uint64_t sourceOffset = 0; // Stream offset of the next byte that has not been decoded
+    std::string carry;         // Start of a character that continues in the next chunk
+    std::string joined;        // carry + the next chunk
+    std::string output;
+    OffsetMap map;
+
+    // Returns the length of the byte order mark
+    size_t detectEncoding(const unsigned char *data, size_t size);
+
+    void appendUtf8(const unsigned char *data, size_t size, bool atEnd);
+
+    void appendLatin1(const unsigned char *data, size_t size);
+
+    void appendUtf16(const unsigned char *data, size_t size, bool atEnd);
+
+    void appendCodePoint(uint32_t codePoint, uint8_t sourceUnit);
+};
+
+#endif //SENSITIVE_DATA_DELETER_TEXTDECODER_H
@@ -0,0 +1,88 @@
+#include "tracing.h"
+
+#ifdef SDD_ENABLE_TRACING
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <QSaveFile>
+#include <QDebug>
+
+static std::mutex registryMutex;
+// Buffers are shared so spans of threads that have already exited can still be dumped
+static std::vector<std::shared_ptr<TraceBuffer>> registry;
+static uint32_t nextThreadId = 1; // Not reused when the buffer of an exited thread is freed
+static const auto traceEpoch = std::chrono::steady_clock::now();
+
+int64_t Tracer::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - traceEpoch).count();
+}
+
+TraceBuffer &Tracer::threadBuffer() {
+    thread_local std::shared_ptr<TraceBuffer> buffer = [] {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto newBuffer = std::make_shared<TraceBuffer>(nextThreadId++);
+        registry.push_back(newBuffer);
+        return newBuffer;
+    }();
+    return *buffer;
+}
+
+void Tracer::record(const char *name, int64_t startNanos, int64_t endNanos) {
+    TraceBuffer &buffer = threadBuffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % TRACE_BUFFER_CAPACITY] = {name, startNanos, endNanos - startNanos};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+static void appendEscaped(std::string &out, const char *value) {
+    for (const char *c = value; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+        }
+        out += *c;
+    }
+}
+
+bool Tracer::dumpChromeTrace(const std::string &path) {
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    char numbers[96];
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto &buffer: registry) {
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t begin = std::max(buffer->dumped, head > TRACE_BUFFER_CAPACITY ? head - TRACE_BUFFER_CAPACITY : 0);
+            buffer->dumped = head;
+            for (uint64_t i = begin; i < head && !path.empty(); i++) {
+                const TraceEvent &event = buffer->events[i % TRACE_BUFFER_CAPACITY];
+                out += first ? "{\"name\":\"" : ",\n{\"name\":\"";
+                first = false;
+                appendEscaped(out, event.name);
+                // Chrome trace timestamps are in microseconds
+                std::snprintf(numbers, sizeof(numbers), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                              buffer->threadId, event.startNanos / 1000.0, event.durationNanos / 1000.0);
+                out += numbers;
+            }
+        }
+        // Only the registry still refers to the buffer of a thread that exited, its spans were just written
+        registry.erase(std::remove_if(registry.begin(), registry.end(), [](const std::shared_ptr<TraceBuffer> &buffer) {
+            return buffer.use_count() == 1;
+        }), registry.end());
+    }
+    if (path.empty()) {
+        return false;
+    }
+    out += "\n]}\n";
+
+    QSaveFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Could not open trace file for writing: " << QString::fromStdString(path);
+        return false;
+    }
+    file.write(out.data(), static_cast<qint64>(out.size()));
+    return file.commit();
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef SENSITIVE_DATA_DELETER_TRACING_H
+#define SENSITIVE_DATA_DELETER_TRACING_H
+
+/**
+ * Span tracing of the scan pipeline, enabled with the SDD_ENABLE_TRACING CMake option.
+ * Spans are written into a fixed size ring buffer owned by the recording thread and dumped
+ * in Chrome trace JSON, which can be opened in chrome://tracing or ui.perfetto.dev.
+ * Without the option the macros expand to nothing and no tracing code is compiled in.
+ */
+
+#ifdef SDD_ENABLE_TRACING
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define TRACE_BUFFER_CAPACITY (64 * 1024) // Spans kept per thread, older spans are overwritten
+
+struct TraceEvent {
+    const char *name; // Must be a string literal, only the pointer is stored
+    int64_t startNanos;
+    int64_t durationNanos;
+};
+
+struct TraceBuffer {
+    uint32_t threadId;
+    std::vector<TraceEvent> events;
+    std::atomic<uint64_t> head{0}; // Total number of spans recorded, only written by the owning thread
+    uint64_t dumped = 0; // Spans already written by a dump, guarded by the registry mutex
+
+    explicit TraceBuffer(uint32_t threadId) : threadId(threadId), events(TRACE_BUFFER_CAPACITY) {}
+};
+
+class Tracer {
+public:
+    static int64_t now();
+
+    static void record(const char *name, int64_t startNanos, int64_t endNanos);
+
+    // Meant to be called while the scanner threads are idle, spans recorded during the dump may be torn.
+    // Writes the spans recorded since the last dump and frees the buffers of threads that have exited,
+    // which happens even if path is empty so a long session does not keep the buffers of every scan.
+    static bool dumpChromeTrace(const std::string &path);
+
+private:
+    static TraceBuffer &threadBuffer();
+};
+
+class TraceScope {
+public:
+    explicit TraceScope(const char *name) : name(name), start(Tracer::now()) {}
+
+    ~TraceScope() { Tracer::record(name, start, Tracer::now()); }
+
+    TraceScope(const TraceScope &) = delete;
+
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name;
+    int64_t start;
+};
+
+#define SDD_TRACE_CONCAT_INNER(a, b) a##b
+#define SDD_TRACE_CONCAT(a, b) SDD_TRACE_CONCAT_INNER(a, b)
+#define SDD_TRACE_SCOPE(name) TraceScope SDD_TRACE_CONCAT(sddTraceScope, __LINE__)(name)
+#define SDD_TRACE_DUMP(path) Tracer::dumpChromeTrace(path)
+
+#else
+
+#define SDD_TRACE_SCOPE(name) ((void) 0)
+#define SDD_TRACE_DUMP(path) ((void) 0)
+
+#endif
+
+#endif //SENSITIVE_DATA_DELETER_TRACING_H
@@ -0,0 +1,280 @@
+#include <initializer_list>
+
+#include "validators.h"
+
+#define IBAN_MIN_LENGTH 15
+#define IBAN_MAX_LENGTH 34
+#define IBAN_MAX_SPACES 9
+#define LUHN_MIN_DIGITS 12
+#define LUHN_MAX_DIGITS 19
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline bool isUpper(char c) {
+    return c >= 'A' && c <= 'Z';
+}
+
+static bool isValidCalendarDate(int year, int month, int day) {
+    static const int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month < 1 || month > 12 || day < 1) {
+        return false;
+    }
+    bool leapYear = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    int maxDay = daysInMonth[month - 1] + (month == 2 && leapYear ? 1 : 0);
+    return day <= maxDay;
+}
+
+static int parseNumber(const char *text, size_t length) {
+    int value = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (!isDigit(text[i])) {
+            return -1;
+        }
+        value = value * 10 + (text[i] - '0');
+    }
+    return value;
+}
+
+MatchValidator validatorFromName(const std::string &name) {
+    if (name == "isikukood") {
+        return MatchValidator::ISIKUKOOD;
+    } else if (name == "iban") {
+        return MatchValidator::IBAN_MOD97;
+    } else if (name == "luhn") {
+        return MatchValidator::LUHN;
+    } else if (name == "date") {
+        return MatchValidator::DATE;
+    }
+    return MatchValidator::NO_VALIDATOR;
+}
+
+const char *validatorName(MatchValidator validator) {
+    switch (validator) {
+        case MatchValidator::ISIKUKOOD:
+            return "isikukood";
+        case MatchValidator::IBAN_MOD97:
+            return "iban";
+        case MatchValidator::LUHN:
+            return "luhn";
+        case MatchValidator::DATE:
+            return "date";
+        default:
+            return "";
+    }
+}
+
+bool isKnownValidator(const std::string &name) {
+    return validatorFromName(name) != MatchValidator::NO_VALIDATOR;
+}
+
+bool validatorNeedsStart(MatchValidator validator) {
+    // Walking back from the end can not tell a card number from the tail of a longer digit run
+    return validator == MatchValidator::LUHN;
+}
+
+/**
+ * Estonian personal identification code GYYMMDDSSSC: the first digit encodes
+ * the century and sex, followed by the date of birth, a serial number and a
+ * mod 11 check digit with a second weight set as fallback.
+ */
+bool validateIsikukood(const char *text, size_t length) {
+    static const int weights1[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 1};
+    static const int weights2[] = {3, 4, 5, 6, 7, 8, 9, 1, 2, 3};
+
+    if (length != 11) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (!isDigit(text[i])) {
+            return false;
+        }
+    }
+
+    int genderCentury = text[0] - '0';
+    if (genderCentury < 1 || genderCentury > 8) {
+        return false;
+    }
+    int year = 1800 + 100 * ((genderCentury - 1) / 2) + parseNumber(text + 1, 2);
+    int month = parseNumber(text + 3, 2);
+    int day = parseNumber(text + 5, 2);
+    if (!isValidCalendarDate(year, month, day)) {
+        return false;
+    }
+
+    int sum = 0;
+    for (int i = 0; i < 10; i++) {
+        sum += (text[i] - '0') * weights1[i];
+    }
+    int checkDigit = sum % 11;
+    if (checkDigit == 10) {
+        sum = 0;
+        for (int i = 0; i < 10; i++) {
+            sum += (text[i] - '0') * weights2[i];
+        }
+        checkDigit = sum % 11;
+        if (checkDigit == 10) {
+            checkDigit = 0;
+        }
+    }
+
+    return checkDigit == text[10] - '0';
+}
+
+/**
+ * ISO 13616 IBAN: two letter country code, two check digits and an alphanumeric BBAN.
+ * Spaces between groups are ignored. The account is rearranged (first four characters
+ * moved to the end) and checked with an incremental mod 97.
+ */
+bool validateIban(const char *text, size_t length) {
+    size_t numChars = 0;
+    char prefix[4];
+    int remainder = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        if (c == ' ') {
+            continue;
+        }
+        if (!isDigit(c) && !isUpper(c)) {
+            return false;
+        }
+        if (numChars < 4) {
+            // Country code must be letters and check digits must be digits
+            if ((numChars < 2 && !isUpper(c)) || (numChars >= 2 && !isDigit(c))) {
+                return false;
+            }
+            prefix[numChars++] = c;
+            continue;
+        }
+        remainder = isDigit(c) ? (remainder * 10 + (c - '0')) % 97
+                               : (remainder * 100 + (c - 'A' + 10)) % 97;
+        numChars++;
+    }
+
+    if (numChars < IBAN_MIN_LENGTH || numChars > IBAN_MAX_LENGTH) {
+        return false;
+    }
+
+    for (char c: prefix) {
+        remainder = isDigit(c) ? (remainder * 10 + (c - '0')) % 97
+                               : (remainder * 100 + (c - 'A' + 10)) % 97;
+    }
+    return remainder == 1;
+}
+
+/**
+ * Luhn (mod 10) check used by payment card numbers. Spaces and dashes between
+ * digit groups are ignored.
+ */
+bool validateLuhn(const char *text, size_t length) {
+    int sum = 0;
+    int numDigits = 0;
+    for (size_t i = length; i > 0; i--) {
+        char c = text[i - 1];
+        if (c == ' ' || c == '-') {
+            continue;
+        }
+        if (!isDigit(c)) {
+            return false;
+        }
+        int digit = c - '0';
+        if (numDigits % 2 == 1) {
+            digit *= 2;
+            if (digit > 9) {
+                digit -= 9;
+            }
+        }
+        sum += digit;
+        numDigits++;
+    }
+    return numDigits >= LUHN_MIN_DIGITS && numDigits <= LUHN_MAX_DIGITS && sum % 10 == 0;
+}
+
+/**
+ * Accepts YYYY-MM-DD, DD.MM.YYYY (with '.', '-' or '/' as separator) and YYYYMMDD
+ * with a year between 1800 and 2199 and a day that exists in the given month.
+ */
+bool validateDate(const char *text, size_t length) {
+    int year, month, day;
+    if (length == 8) {
+        year = parseNumber(text, 4);
+        month = parseNumber(text + 4, 2);
+        day = parseNumber(text + 6, 2);
+    } else if (length == 10 && (text[4] == '-' || text[4] == '.' || text[4] == '/') && text[7] == text[4]) {
+        year = parseNumber(text, 4);
+        month = parseNumber(text + 5, 2);
+        day = parseNumber(text + 8, 2);
+    } else if (length == 10 && (text[2] == '-' || text[2] == '.' || text[2] == '/') && text[5] == text[2]) {
+        day = parseNumber(text, 2);
+        month = parseNumber(text + 3, 2);
+        year = parseNumber(text + 6, 4);
+    } else {
+        return false;
+    }
+
+    if (year < 1800 || year > 2199) {
+        return false;
+    }
+    return isValidCalendarDate(year, month, day);
+}
+
+bool validateMatch(MatchValidator validator, const char *data, size_t length, size_t from, size_t to) {
+    if (to <= from || to > length) {
+        return false;
+    }
+
+    switch (validator) {
+        case MatchValidator::ISIKUKOOD: {
+            if (to - from < 11) {
+                return false;
+            }
+            return validateIsikukood(data + to - 11, 11);
+        }
+        case MatchValidator::IBAN_MOD97: {
+            // Walk back over the characters an IBAN may contain
+            size_t windowStart = to;
+            while (windowStart > from && to - windowStart < IBAN_MAX_LENGTH + IBAN_MAX_SPACES &&
+                   (isDigit(data[windowStart - 1]) || isUpper(data[windowStart - 1]) ||
+                    data[windowStart - 1] == ' ')) {
+                windowStart--;
+            }
+            // Try every word start in the window as the country code, longest candidate first
+            for (size_t i = windowStart; i + IBAN_MIN_LENGTH <= to; i++) {
+                if (i != windowStart && data[i - 1] != ' ') {
+                    continue;
+                }
+                if (validateIban(data + i, to - i)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        case MatchValidator::LUHN: {
+            // Luhn patterns are compiled with SOM, so the match is the whole candidate. Characters
+            // the pattern matched around the number are trimmed.
+            while (from < to && !isDigit(data[from])) {
+                from++;
+            }
+            while (to > from && !isDigit(data[to - 1])) {
+                to--;
+            }
+            // A run of digits that continues past the match is a longer number, not a card number
+            if (from == to || (from > 0 && isDigit(data[from - 1])) || (to < length && isDigit(data[to]))) {
+                return false;
+            }
+            return validateLuhn(data + from, to - from);
+        }
+        case MatchValidator::DATE: {
+            for (size_t dateLength: {10, 8}) {
+                if (to - from >= dateLength && validateDate(data + to - dateLength, dateLength)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        default:
+            return true;
+    }
+}
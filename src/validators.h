@@ -0,0 +1,45 @@
+#ifndef SENSITIVE_DATA_DELETER_VALIDATORS_H
+#define SENSITIVE_DATA_DELETER_VALIDATORS_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Checksum and sanity validators that can be attached to a scan pattern in the config
+ * ("validator": "<name>"). They run on the matched bytes inside the Hyperscan match
+ * callback, so none of them allocate.
+ */
+enum MatchValidator {
+    NO_VALIDATOR,
+    ISIKUKOOD,
+    IBAN_MOD97,
+    LUHN,
+    DATE,
+};
+
+MatchValidator validatorFromName(const std::string &name);
+
+const char *validatorName(MatchValidator validator);
+
+bool isKnownValidator(const std::string &name);
+
+/**
+ * Validate the match that ends at data[to - 1] in a chunk of length bytes. If the start of the
+ * match is not known (from == 0 without SOM), the validator walks back from the end over the
+ * characters its format allows, but never past data[from]. Luhn needs the exact start, see
+ * validatorNeedsStart().
+ */
+bool validateMatch(MatchValidator validator, const char *data, size_t length, size_t from, size_t to);
+
+// True if patterns with this validator have to be compiled with HS_FLAG_SOM_LEFTMOST
+bool validatorNeedsStart(MatchValidator validator);
+
+bool validateIsikukood(const char *text, size_t length);
+
+bool validateIban(const char *text, size_t length);
+
+bool validateLuhn(const char *text, size_t length);
+
+bool validateDate(const char *text, size_t length);
+
+#endif //SENSITIVE_DATA_DELETER_VALIDATORS_H
@@ -0,0 +1,396 @@
+#include <QDir>
+#include <QDirIterator>
+#include <QDebug>
+#include <filesystem>
+#include <stdexcept>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+#include "watchservice.h"
+
+namespace fs = std::filesystem;
+using std::chrono::milliseconds;
+
+WatchService::WatchService(QObject *parent) : QObject(parent) {}
+
+WatchService::~WatchService() {
+    stop();
+}
+
+void WatchService::start(const std::vector<std::string> &roots,
+                         const std::vector<std::pair<std::string, std::string>> &patterns,
+                         const std::map<std::string, std::string> &fileTypes,
+                         const std::set<std::string> &binaryFileTypes,
+                         const std::map<std::string, PatternOptions> &patternOptions,
+                         const ExclusionRules &exclusionRules) {
+    stop();
+    exclusions = exclusionRules;
+    scanner.setPatternOptions(patternOptions);
+    scanner.compilePatterns(patterns);
+    scanner.setFileTypes(fileTypes);
+    scanner.setBinaryFileTypes(binaryFileTypes);
+    // Allocated here so that a failure is reported to the caller instead of leaving a service that never scans
+    hs_scratch_t *scratch = scanner.allocateScratch();
+    if (!scratch) {
+        scanner.releasePatterns();
+        throw std::runtime_error("Could not allocate the scratch space for watching");
+    }
+    stopping = false;
+
+#ifdef Q_OS_LINUX
+    inotifyFd = inotify_init1(IN_CLOEXEC);
+    wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (inotifyFd < 0 || wakeFd < 0) {
+        std::string error = std::strerror(errno);
+        if (inotifyFd >= 0) close(inotifyFd);
+        if (wakeFd >= 0) close(wakeFd);
+        inotifyFd = wakeFd = -1;
+        hs_free_scratch(scratch);
+        scanner.releasePatterns();
+        throw std::runtime_error("Could not start watching for changes: " + error);
+    }
+    // Walking large roots takes a while, the event thread adds the watches before it starts reading
+    eventThread = std::thread(&WatchService::eventLoop, this, roots);
+#else
+    watcher = new QFileSystemWatcher(this);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &WatchService::onDirectoryChanged);
+    for (const auto &root: roots) {
+        QString path = QString::fromStdString(root);
+        QFileInfo fileInfo(path);
+        if (fileInfo.isDir()) {
+            addWatchRecursively(path, false);
+        } else {
+            singleFiles.insert(root);
+            QString parent = fileInfo.absolutePath();
+            if (!snapshots.contains(parent) && watcher->addPath(parent)) {
+                snapshots.insert(parent, listDirectory(parent));
+            }
+        }
+    }
+    if (snapshots.isEmpty()) {
+        delete watcher;
+        watcher = nullptr;
+        singleFiles.clear();
+        hs_free_scratch(scratch);
+        scanner.releasePatterns();
+        throw std::runtime_error("None of the scanned folders could be watched");
+    }
+#endif
+
+    scanThread = std::thread(&WatchService::scanLoop, this, scratch);
+    running = true;
+}
+
+void WatchService::stop() {
+    if (!running) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        pending.clear();
+    }
+    cond.notify_all();
+
+#ifdef Q_OS_LINUX
+    uint64_t wake = 1;
+    if (write(wakeFd, &wake, sizeof(wake)) < 0) {
+        qWarning() << "Could not wake the watch thread: " << std::strerror(errno);
+    }
+    eventThread.join();
+    close(inotifyFd);
+    close(wakeFd);
+    inotifyFd = wakeFd = -1;
+    watchedDirs.clear();
+    recursiveWatches.clear();
+    watchLimitReached = false;
+#else
+    delete watcher;
+    watcher = nullptr;
+    snapshots.clear();
+    recursiveDirs.clear();
+#endif
+
+    scanThread.join();
+    singleFiles.clear();
+    scanner.releasePatterns();
+    running = false;
+}
+
+void WatchService::enqueue(const std::string &path, milliseconds delay) {
+    if (!scanner.isScannedType(path) || exclusions.excludesPath(path, false)) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = pending.try_emplace(path, PendingFile{now, now}).first;
+    // Every change pushes the scan back, but never further than WATCH_MAX_DELAY_MS after the first one
+    it->second.due = std::min(now + delay, it->second.firstChange + milliseconds(WATCH_MAX_DELAY_MS));
+    cond.notify_one();
+}
+
+bool WatchService::isStopping() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stopping;
+}
+
+void WatchService::scanLoop(hs_scratch_t *scratch) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (pending.empty()) {
+            cond.wait(lock);
+            continue;
+        }
+        auto now = std::chrono::steady_clock::now();
+        auto next = std::chrono::steady_clock::time_point::max();
+        std::vector<std::string> due;
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (it->second.due <= now) {
+                due.push_back(it->first);
+                it = pending.erase(it);
+            } else {
+                next = std::min(next, it->second.due);
+                ++it;
+            }
+        }
+        if (due.empty()) {
+            cond.wait_until(lock, next);
+            continue;
+        }
+
+        lock.unlock();
+        for (const auto &path: due) {
+            std::error_code error;
+            // Temporary files are often gone again by the time they are due
+            if (isStopping() || !fs::is_regular_file(path, error)) {
+                continue;
+            }
+            QFileInfo fileInfo(QString::fromStdString(path));
+            if (exclusions.excludesFileStat(fileInfo.size(), fileInfo.lastModified())) {
+                continue;
+            }
+            auto result = scanner.scanFile(path, scratch);
+            QString qPath = QString::fromStdString(path);
+            QMetaObject::invokeMethod(this, [this, qPath, result]() {
+                emit fileScanned(qPath, result.first, result.second);
+            }, Qt::QueuedConnection);
+        }
+        lock.lock();
+    }
+    lock.unlock();
+    hs_free_scratch(scratch);
+}
+
+#ifdef Q_OS_LINUX
+
+int WatchService::addWatch(const std::string &directory) {
+    int wd = inotify_add_watch(inotifyFd, directory.c_str(),
+                               IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVE_SELF | IN_DELETE_SELF |
+                               IN_ONLYDIR | IN_DONT_FOLLOW);
+    if (wd < 0) {
+        if (errno == ENOSPC && !watchLimitReached) {
+            watchLimitReached = true;
+            qWarning() << "Reached the inotify watch limit, raise fs.inotify.max_user_watches to watch all folders";
+        }
+        return -1;
+    }
+    watchedDirs[wd] = directory;
+    return wd;
+}
+
+void WatchService::addWatchRecursively(const std::string &root, bool enqueueFiles) {
+    std::vector<std::string> stack{root};
+    while (!stack.empty() && !isStopping()) {
+        std::string directory = std::move(stack.back());
+        stack.pop_back();
+        int wd = addWatch(directory);
+        if (wd < 0) {
+            continue;
+        }
+        recursiveWatches.insert(wd);
+
+        // Listed after the watch is added so files created in between are seen at least once
+        std::error_code error;
+        fs::directory_iterator it(directory, fs::directory_options::skip_permission_denied, error);
+        for (; !error && it != fs::directory_iterator(); it.increment(error)) {
+            if (it->is_symlink(error)) {
+                continue;
+            }
+            if (it->is_directory(error)) {
+                if (!exclusions.excludesPath(it->path().string(), true)) {
+                    stack.push_back(it->path().string());
+                }
+            } else if (enqueueFiles && it->is_regular_file(error)) {
+                enqueue(it->path().string(), milliseconds(WATCH_CLOSE_DELAY_MS));
+            }
+        }
+    }
+}
+
+void WatchService::removeWatchesBelow(const std::string &directory) {
+    for (auto it = watchedDirs.begin(); it != watchedDirs.end();) {
+        const std::string &path = it->second;
+        if (path.compare(0, directory.size(), directory) == 0 &&
+            (path.size() == directory.size() || path[directory.size()] == '/')) {
+            inotify_rm_watch(inotifyFd, it->first);
+            recursiveWatches.erase(it->first);
+            it = watchedDirs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void WatchService::eventLoop(const std::vector<std::string> &roots) {
+    for (const auto &root: roots) {
+        std::error_code error;
+        if (fs::is_directory(root, error)) {
+            addWatchRecursively(root, false);
+        } else {
+            singleFiles.insert(root);
+            addWatch(fs::path(root).parent_path().string());
+        }
+    }
+    if (watchedDirs.empty()) {
+        qWarning() << "None of the scanned folders could be watched";
+    }
+
+    alignas(inotify_event) char buffer[64 * 1024];
+    pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            qWarning() << "Stopped watching for changes: " << std::strerror(errno);
+            return;
+        }
+        if (fds[1].revents & POLLIN) {
+            return;
+        }
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < length;) {
+            auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                qWarning() << "Dropped file change events, files changed in the meantime are not rescanned";
+                continue;
+            }
+            auto it = watchedDirs.find(event->wd);
+            if (it == watchedDirs.end()) {
+                continue;
+            }
+            if (event->mask & (IN_IGNORED | IN_DELETE_SELF)) { // The directory was removed or unmounted
+                recursiveWatches.erase(event->wd);
+                watchedDirs.erase(it);
+                continue;
+            }
+            if (event->mask & IN_MOVE_SELF) {
+                // A move inside the watched tree arrives as IN_MOVED_TO first and the watches are already
+                // under the new path. Otherwise the directory left the tree and its watches are stale.
+                std::error_code error;
+                if (!fs::is_directory(it->second, error)) {
+                    removeWatchesBelow(it->second);
+                }
+                continue;
+            }
+            if (event->len == 0) {
+                continue;
+            }
+
+            std::string path = it->second + "/" + event->name;
+            bool recursive = recursiveWatches.count(event->wd) > 0;
+            if (event->mask & IN_ISDIR) {
+                // Directories created or moved into a watched tree may already contain files
+                if (recursive && (event->mask & (IN_CREATE | IN_MOVED_TO)) && !exclusions.excludesPath(path, true)) {
+                    addWatchRecursively(path, true);
+                }
+                continue;
+            }
+            if (!recursive && singleFiles.count(path) == 0) {
+                continue;
+            }
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                enqueue(path, milliseconds(WATCH_CLOSE_DELAY_MS));
+            } else {
+                enqueue(path, milliseconds(WATCH_DEBOUNCE_MS));
+            }
+        }
+    }
+}
+
+#else
+
+QHash<QString, FileStat> WatchService::listDirectory(const QString &directory) const {
+    QHash<QString, FileStat> listing;
+    QDirIterator it(directory, QDir::NoDotAndDotDot | QDir::Files | QDir::Dirs | QDir::NoSymLinks);
+    while (it.hasNext()) {
+        QFileInfo fileInfo = it.nextFileInfo();
+        listing.insert(fileInfo.fileName(), FileStat::fromFileInfo(fileInfo));
+    }
+    return listing;
+}
+
+void WatchService::addWatchRecursively(const QString &root, bool enqueueFiles) {
+    QStringList stack{root};
+    while (!stack.isEmpty()) {
+        QString directory = stack.takeLast();
+        if (recursiveDirs.contains(directory) || (!snapshots.contains(directory) && !watcher->addPath(directory))) {
+            continue;
+        }
+        recursiveDirs.insert(directory);
+
+        QHash<QString, FileStat> listing = listDirectory(directory);
+        for (auto it = listing.cbegin(); it != listing.cend(); ++it) {
+            QString path = directory + "/" + it.key();
+            if (it->isDir) {
+                if (!exclusions.excludesPath(path.toStdString(), true)) {
+                    stack.push_back(path);
+                }
+            } else if (enqueueFiles) {
+                enqueue(path.toStdString(), milliseconds(WATCH_CLOSE_DELAY_MS));
+            }
+        }
+        snapshots.insert(directory, listing);
+    }
+}
+
+void WatchService::onDirectoryChanged(const QString &directory) {
+    if (!QFileInfo::exists(directory)) {
+        snapshots.remove(directory);
+        recursiveDirs.remove(directory);
+        return;
+    }
+
+    // The watcher only says that something in the directory changed, compare with the last listing
+    QHash<QString, FileStat> listing = listDirectory(directory);
+    const QHash<QString, FileStat> previous = snapshots.value(directory);
+    bool recursive = recursiveDirs.contains(directory);
+    snapshots.insert(directory, listing);
+
+    for (auto it = listing.cbegin(); it != listing.cend(); ++it) {
+        QString path = directory + "/" + it.key();
+        auto old = previous.constFind(it.key());
+        bool isNew = old == previous.cend();
+        if (!isNew && old->size == it->size && old->lastModified == it->lastModified) {
+            continue;
+        }
+        if (it->isDir) {
+            if (recursive && isNew && !exclusions.excludesPath(path.toStdString(), true)) {
+                addWatchRecursively(path, true);
+            }
+        } else if (recursive || singleFiles.count(path.toStdString())) {
+            enqueue(path.toStdString(), milliseconds(WATCH_DEBOUNCE_MS));
+        }
+    }
+}
+
+#endif
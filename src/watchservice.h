@@ -0,0 +1,118 @@
+#ifndef SENSITIVE_DATA_DELETER_WATCHSERVICE_H
+#define SENSITIVE_DATA_DELETER_WATCHSERVICE_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QFileSystemWatcher>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "filescanner.h"
+#include "directoryloader.h"
+#include "exclusionrules.h"
+
+#define WATCH_DEBOUNCE_MS 500     // Quiet time after the last change before a file is scanned
+#define WATCH_CLOSE_DELAY_MS 100  // Delay after a file was closed for writing or moved into place
+#define WATCH_MAX_DELAY_MS 5000   // Files that keep changing are scanned at least this often
+
+/**
+ * Watches the scan roots and rescans files as they are created or written, with a pattern
+ * database that is compiled once in start(). Change events only put the file in a pending
+ * map, so a burst of writes to one file turns into a single scan once the file goes quiet.
+ *
+ * On Linux the roots are watched with inotify on a thread of its own. Elsewhere directories are
+ * watched with QFileSystemWatcher and changed files are found by comparing the directory with
+ * the listing taken when it was last seen.
+ */
+class WatchService : public QObject {
+Q_OBJECT
+
+public:
+    explicit WatchService(QObject *parent = nullptr);
+
+    ~WatchService() override;
+
+    // Roots can be directories, watched recursively, or single files. Throws std::runtime_error if the
+    // patterns do not compile or the watch can not be set up.
+    void start(const std::vector<std::string> &roots,
+               const std::vector<std::pair<std::string, std::string>> &patterns,
+               const std::map<std::string, std::string> &fileTypes,
+               const std::set<std::string> &binaryFileTypes,
+               const std::map<std::string, PatternOptions> &patternOptions,
+               const ExclusionRules &exclusionRules);
+
+    void stop();
+
+    bool isRunning() const { return running; }
+
+signals:
+
+    void fileScanned(const QString &path, ScanResult result, const std::vector<MatchInfo> &matches);
+
+private:
+    struct PendingFile {
+        std::chrono::steady_clock::time_point firstChange;
+        std::chrono::steady_clock::time_point due;
+    };
+
+    FileScanner scanner;
+    ExclusionRules exclusions; // Paths are only checked on the thread that receives the change events
+    bool running = false;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::unordered_map<std::string, PendingFile> pending;
+    bool stopping = false;
+    std::thread scanThread;
+
+    // Files that were added to the scan list on their own, only these are scanned in their directory
+    std::unordered_set<std::string> singleFiles;
+
+    void enqueue(const std::string &path, std::chrono::milliseconds delay);
+
+    bool isStopping();
+
+    // Takes ownership of the scratch space allocated in start()
+    void scanLoop(hs_scratch_t *scratch);
+
+#ifdef Q_OS_LINUX
+    int inotifyFd = -1;
+    int wakeFd = -1;
+    std::thread eventThread;
+    std::unordered_map<int, std::string> watchedDirs; // Watch descriptor -> directory
+    std::unordered_set<int> recursiveWatches; // Watches of directories inside a watched root
+    bool watchLimitReached = false;
+
+    int addWatch(const std::string &directory);
+
+    void addWatchRecursively(const std::string &root, bool enqueueFiles);
+
+    // Removes the watches of directory and of every watched directory below it
+    void removeWatchesBelow(const std::string &directory);
+
+    // Adds the watches of the roots, then waits for events until stop() signals wakeFd
+    void eventLoop(const std::vector<std::string> &roots);
+#else
+    QFileSystemWatcher *watcher = nullptr;
+    QHash<QString, QHash<QString, FileStat>> snapshots; // Directory -> file name -> stat when last seen
+    QSet<QString> recursiveDirs;
+
+    QHash<QString, FileStat> listDirectory(const QString &directory) const;
+
+    void addWatchRecursively(const QString &root, bool enqueueFiles);
+
+    void onDirectoryChanged(const QString &directory);
+#endif
+};
+
+#endif //SENSITIVE_DATA_DELETER_WATCHSERVICE_H